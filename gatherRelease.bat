@@ -70,6 +70,21 @@ copy ..\samples\synthesisTest\java\build.* samples\synthesisTest\java
 copy ..\samples\synthesisTest\java\run.* samples\synthesisTest\java
 copy ..\samples\synthesisTest\java\*.java samples\synthesisTest\java
 
+mkdir samples\threadingTest
+mkdir samples\threadingTest\c++
+copy "..\samples\threadingTest\c++\SConstruct" "samples\threadingTest\c++"
+copy "..\samples\threadingTest\c++\*.cpp" "samples\threadingTest\c++"
+
+mkdir samples\daemon
+mkdir samples\daemon\c++
+copy "..\samples\daemon\c++\SConstruct" "samples\daemon\c++"
+copy "..\samples\daemon\c++\*.cpp" "samples\daemon\c++"
+
+mkdir samples\frontEndBenchmark
+mkdir samples\frontEndBenchmark\c++
+copy "..\samples\frontEndBenchmark\c++\SConstruct" "samples\frontEndBenchmark\c++"
+copy "..\samples\frontEndBenchmark\c++\*.cpp" "samples\frontEndBenchmark\c++"
+
 mkdir src
 mkdir src\c++
 copy "..\src\c++\voce.h" "src\c++"
@@ -0,0 +1,202 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+#define VOCE_CLIENT
+#include <voce/voce.h>
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+/// A load generator for the Voce daemon.  Several client threads, each 
+/// with its own connection, send requests to the daemon as fast as they 
+/// can, and the request rates and round trip times are printed for 1, 
+/// 2, 4 and so on up to the maximum number of threads.  Each thread 
+/// sends a number of messages that are not answered (pipelined 10 ms 
+/// blocks of pushed audio, if the daemon was started with 
+/// 'audioInput=push' and -push is given) followed by one request that 
+/// is (getRecognizerQueueSize).  Usage:
+///
+/// daemonBenchmark [-socket path] [-threads N] [-seconds N] [-push]
+
+/// The number of audio blocks sent before each round trip.
+const int blocksPerRoundTrip = 10;
+
+/// The number of samples in each block (10 ms at 16 kHz).
+const int samplesPerBlock = 160;
+
+/// How long each test runs, in seconds.
+int testSeconds = 2;
+
+/// True if audio is pushed as well.
+bool pushAudio = false;
+
+/// Set by the main thread to tell the client threads to stop.
+volatile bool stopClients = false;
+
+/// What each client thread measured.
+struct ClientResult
+{
+	long roundTrips;
+	long blocks;
+	double totalMs;
+	double maxMs;
+};
+
+/// Returns the current time in milliseconds.
+double getTimeMs()
+{
+	timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+}
+
+/// The client thread function.  Stores its measurements in the 
+/// ClientResult pointed to by 'arg'.
+void* client(void* arg)
+{
+	ClientResult* result = (ClientResult*)arg;
+	short samples[samplesPerBlock];
+	memset(samples, 0, sizeof(samples));
+
+	while (!stopClients)
+	{
+		if (pushAudio)
+		{
+			for (int i = 0; i < blocksPerRoundTrip; ++i)
+			{
+				voce::pushAudio(samples, samplesPerBlock);
+			}
+
+			result->blocks += blocksPerRoundTrip;
+		}
+
+		double start = getTimeMs();
+		voce::getRecognizerQueueSize();
+		double elapsed = getTimeMs() - start;
+
+		++result->roundTrips;
+		result->totalMs += elapsed;
+
+		if (elapsed > result->maxMs)
+		{
+			result->maxMs = elapsed;
+		}
+	}
+
+	return NULL;
+}
+
+/// Runs 'numThreads' client threads for the test duration and prints 
+/// what they measured.
+void runTest(int numThreads)
+{
+	std::vector<ClientResult> results(numThreads);
+	std::vector<pthread_t> threads(numThreads);
+
+	stopClients = false;
+	double startTime = getTimeMs();
+
+	for (int i = 0; i < numThreads; ++i)
+	{
+		memset(&results[i], 0, sizeof(ClientResult));
+		pthread_create(&threads[i], NULL, client, &results[i]);
+	}
+
+	usleep(testSeconds * 1000000);
+	stopClients = true;
+
+	ClientResult total;
+	memset(&total, 0, sizeof(total));
+
+	for (int i = 0; i < numThreads; ++i)
+	{
+		pthread_join(threads[i], NULL);
+		total.roundTrips += results[i].roundTrips;
+		total.blocks += results[i].blocks;
+		total.totalMs += results[i].totalMs;
+
+		if (results[i].maxMs > total.maxMs)
+		{
+			total.maxMs = results[i].maxMs;
+		}
+	}
+
+	double elapsedSeconds = (getTimeMs() - startTime) / 1000.0;
+	std::cout << numThreads << " client(s): " 
+		<< total.roundTrips / elapsedSeconds << " round trips/sec, " 
+		<< "mean " << (total.roundTrips ? total.totalMs / total.roundTrips 
+		: 0) << " ms, max " << total.maxMs << " ms";
+
+	if (pushAudio)
+	{
+		// Each block is 10 ms of audio.
+		std::cout << ", " << total.blocks / elapsedSeconds 
+			<< " audio blocks/sec (" << total.blocks / elapsedSeconds / 100 
+			<< "x real time)";
+	}
+
+	std::cout << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	std::string options;
+	int maxThreads = 16;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+
+		if ("-socket" == arg && i + 1 < argc)
+		{
+			options = std::string("daemonSocket=") + argv[++i];
+		}
+		else if ("-threads" == arg && i + 1 < argc)
+		{
+			maxThreads = atoi(argv[++i]);
+		}
+		else if ("-seconds" == arg && i + 1 < argc)
+		{
+			testSeconds = atoi(argv[++i]);
+		}
+		else if ("-push" == arg)
+		{
+			pushAudio = true;
+		}
+		else
+		{
+			std::cout << "Usage: daemonBenchmark [-socket path] " 
+				<< "[-threads N] [-seconds N] [-push]" << std::endl;
+			return 1;
+		}
+	}
+
+	voce::init("", false, false, "", "", options);
+
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		runTest(numThreads);
+	}
+
+	voce::destroy();
+	return 0;
+}
@@ -0,0 +1,534 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+#include <voce/voce.h>
+
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/// A standalone Voce daemon.  It initializes Voce once, keeping the 
+/// models loaded, and serves recognition and synthesis to programs that 
+/// include voce.h in client mode (with VOCE_CLIENT defined) over a Unix 
+/// domain socket.  Each client connection is served by its own thread, 
+/// which handles the connection's messages in order (see 
+/// voce::internal::DaemonMessage).  Only the user running the daemon 
+/// can connect to its socket.  Usage:
+///
+/// voceDaemon [options] vocePath
+///
+/// -socket path - The socket to listen on (default: /tmp/voce.sock).
+/// -synthesis - Initialize speech synthesis.
+/// -recognition - Initialize speech recognition.
+/// -grammarPath path - Directory containing grammar files.
+/// -grammarName name - Grammar to use (default: the digits grammar).
+/// -options list - Options for voce::init, such as 'audioInput=push'.
+///
+/// The daemon runs until it is interrupted.
+
+/// Set by the signal handler to stop accepting connections.
+volatile sig_atomic_t stopDaemon = 0;
+
+/// The signal handler writes to this pipe to wake the main thread, 
+/// since the signal may be delivered to any thread, including one of 
+/// the virtual machine's.
+int wakePipe[2] = {-1, -1};
+
+/// Serializes the clients pushing audio to each stream.  Each stream's 
+/// push audio buffer only supports one producer at a time.
+pthread_mutex_t pushMutexes[voce::internal::gMaxPushAudioBuffers];
+
+/// The open client connections and the number of threads serving 
+/// them, so they can be shut down before Voce is destroyed.  
+/// 'clientThreadsDone' is signaled when the last thread exits.
+std::vector<int> clients;
+int numClientThreads = 0;
+pthread_mutex_t clientsMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t clientThreadsDone = PTHREAD_COND_INITIALIZER;
+
+/// Clients waiting for a recognized string are served in slices of 
+/// this many milliseconds, so that stopping the daemon does not wait 
+/// for the rest of their timeout.
+const int waitSliceMs = 100;
+
+/// Stops the daemon on SIGINT and SIGTERM.
+void handleSignal(int /*signal*/)
+{
+	stopDaemon = 1;
+	char c = 0;
+	ssize_t written = write(wakePipe[1], &c, 1);
+	(void)written;
+}
+
+/// Sends a reply.  Returns false if the client is gone.
+bool reply(int fd, const std::string& payload)
+{
+	return voce::internal::writeMessage(fd, voce::internal::MSG_REPLY, 
+		payload);
+}
+
+/// Handles one message from a client.  'samples' is reused between 
+/// messages to avoid allocating for each block of pushed or synthesized 
+/// audio.  Returns false if the client should be disconnected.
+bool handleMessage(int fd, int type, const std::string& payload, 
+	std::vector<short>& samples)
+{
+	using namespace voce::internal;
+
+	std::string answer;
+	size_t pos = 0;
+	int n = 0;
+	std::string s;
+	std::string s2;
+
+	switch (type)
+	{
+		case MSG_SYNTHESIZE:
+			if (!readString(payload, pos, s))
+			{
+				return false;
+			}
+
+			voce::synthesize(s);
+			return true;
+		case MSG_IS_SYNTHESIZING:
+			appendInt(answer, voce::isSynthesizing() ? 1 : 0);
+			return reply(fd, answer);
+		case MSG_STOP_SYNTHESIZING:
+			voce::stopSynthesizing();
+			return true;
+		case MSG_SYNTHESIZE_TO_BUFFER:
+		{
+			if (!readString(payload, pos, s))
+			{
+				return false;
+			}
+
+			int sampleRate = 0;
+
+			if (!voce::synthesizeToBuffer(s, samples, sampleRate) 
+				|| sizeof(int) + samples.size() * sizeof(short) 
+				> gMaxMessageSize)
+			{
+				appendInt(answer, 0);
+				return reply(fd, answer);
+			}
+
+			// Send the samples straight from the vector.
+			appendInt(answer, sampleRate);
+			return writeMessage(fd, MSG_REPLY, answer, 
+				samples.empty() ? NULL : &samples[0], 
+				samples.size() * sizeof(short));
+		}
+		case MSG_GET_PHRASE_CACHE_STATS:
+		{
+			voce::PhraseCacheStats stats = voce::getPhraseCacheStats();
+			appendLong(answer, stats.hits);
+			appendLong(answer, stats.misses);
+			appendLong(answer, stats.evictions);
+			appendLong(answer, stats.bytes);
+			appendLong(answer, stats.phrases);
+			return reply(fd, answer);
+		}
+		case MSG_PRELOAD_PHRASES:
+		{
+			if (!readInt(payload, pos, n) || n < 0)
+			{
+				return false;
+			}
+
+			std::vector<std::string> phrases(n);
+
+			for (int i = 0; i < n; ++i)
+			{
+				if (!readString(payload, pos, phrases[i]))
+				{
+					return false;
+				}
+			}
+
+			voce::preloadPhrases(phrases);
+			return true;
+		}
+		case MSG_GET_PRELOAD_PENDING_COUNT:
+			appendInt(answer, voce::getPreloadPendingCount());
+			return reply(fd, answer);
+		case MSG_GET_RECOGNIZER_QUEUE_SIZE:
+			appendInt(answer, voce::getRecognizerQueueSize());
+			return reply(fd, answer);
+		case MSG_GET_RECOGNIZER_DROP_COUNT:
+			appendLong(answer, voce::getRecognizerDropCount());
+			return reply(fd, answer);
+		case MSG_POP_RECOGNIZED_STRING:
+			appendString(answer, voce::popRecognizedString());
+			return reply(fd, answer);
+		case MSG_WAIT_FOR_RECOGNIZED_STRING:
+		{
+			if (!readInt(payload, pos, n))
+			{
+				return false;
+			}
+
+			bool found = false;
+			int remaining = n;
+
+			do
+			{
+				int slice = remaining < waitSliceMs ? remaining 
+					: waitSliceMs;
+				found = voce::waitForRecognizedString(s, slice);
+				remaining -= slice;
+			}
+			while (!found && remaining > 0 && !stopDaemon);
+
+			appendInt(answer, found ? 1 : 0);
+			appendString(answer, found ? s : "");
+			return reply(fd, answer);
+		}
+		case MSG_POP_ALL_RECOGNIZED_STRINGS:
+		{
+			std::vector<std::string> strings;
+			voce::popAllRecognizedStrings(strings);
+			appendInt(answer, (int)strings.size());
+
+			for (size_t i = 0; i < strings.size(); ++i)
+			{
+				appendString(answer, strings[i]);
+			}
+
+			return reply(fd, answer);
+		}
+		case MSG_POP_PARTIAL_RESULT:
+			appendString(answer, voce::popPartialResult());
+			return reply(fd, answer);
+		case MSG_GET_PARTIAL_RESULT_LEAD_TIME:
+			appendInt(answer, voce::getPartialResultLeadTime());
+			return reply(fd, answer);
+		case MSG_GET_SCORER_THREAD_COUNT:
+			appendInt(answer, voce::getScorerThreadCount());
+			return reply(fd, answer);
+		case MSG_RECOGNIZE_FILE:
+			if (!readString(payload, pos, s))
+			{
+				return false;
+			}
+
+			appendString(answer, voce::recognizeFile(s));
+			return reply(fd, answer);
+		case MSG_PUSH_AUDIO:
+		{
+			if (!readInt(payload, pos, n))
+			{
+				return false;
+			}
+
+			// Copy the samples out of the payload, which is not aligned 
+			// for shorts.
+			size_t count = (payload.size() - pos) / sizeof(short);
+			samples.resize(count);
+
+			if (0 == count)
+			{
+				return true;
+			}
+
+			memcpy(&samples[0], payload.data() + pos, 
+				count * sizeof(short));
+
+			if (n < 0 || n >= (int)gMaxPushAudioBuffers)
+			{
+				// Let pushAudio report the unknown stream.
+				voce::pushAudio(n, &samples[0], count);
+				return true;
+			}
+
+			pthread_mutex_lock(&pushMutexes[n]);
+
+			if (0 == n)
+			{
+				voce::pushAudio(&samples[0], count);
+			}
+			else
+			{
+				voce::pushAudio(n, &samples[0], count);
+			}
+
+			pthread_mutex_unlock(&pushMutexes[n]);
+			return true;
+		}
+		case MSG_GET_PUSH_AUDIO_OVERFLOW_COUNT:
+			appendInt(answer, (int)voce::getPushAudioOverflowCount());
+			return reply(fd, answer);
+		case MSG_GET_PUSH_AUDIO_UNDERRUN_COUNT:
+			appendInt(answer, (int)voce::getPushAudioUnderrunCount());
+			return reply(fd, answer);
+		case MSG_CREATE_STREAM:
+			if (!readString(payload, pos, s))
+			{
+				return false;
+			}
+
+			appendInt(answer, voce::createStream(s));
+			return reply(fd, answer);
+		case MSG_DESTROY_STREAM:
+			if (!readInt(payload, pos, n))
+			{
+				return false;
+			}
+
+			voce::destroyStream(n);
+			return true;
+		case MSG_POP_RESULT:
+			if (!readInt(payload, pos, n))
+			{
+				return false;
+			}
+
+			appendString(answer, voce::popResult(n));
+			return reply(fd, answer);
+		case MSG_SET_GRAMMAR:
+			if (!readString(payload, pos, s) 
+				|| !readString(payload, pos, s2))
+			{
+				return false;
+			}
+
+			appendLong(answer, voce::setGrammar(s, s2));
+			return reply(fd, answer);
+		case MSG_SET_RECOGNIZER_ENABLED:
+			if (!readInt(payload, pos, n))
+			{
+				return false;
+			}
+
+			voce::setRecognizerEnabled(0 != n);
+			return true;
+		case MSG_IS_RECOGNIZER_ENABLED:
+			appendInt(answer, voce::isRecognizerEnabled() ? 1 : 0);
+			return reply(fd, answer);
+		default:
+			std::cout << "Unknown message type " << type 
+				<< "; disconnecting the client." << std::endl;
+			return false;
+	}
+}
+
+/// The body of each client thread.  'arg' holds the connection.
+void* serveClient(void* arg)
+{
+	int fd = (int)(size_t)arg;
+	int type = 0;
+	std::string payload;
+	std::vector<short> samples;
+
+	while (voce::internal::readMessage(fd, type, payload) 
+		&& handleMessage(fd, type, payload, samples))
+	{
+	}
+
+	pthread_mutex_lock(&clientsMutex);
+
+	for (size_t i = 0; i < clients.size(); ++i)
+	{
+		if (clients[i] == fd)
+		{
+			clients.erase(clients.begin() + i);
+			break;
+		}
+	}
+
+	close(fd);
+	--numClientThreads;
+
+	if (0 == numClientThreads)
+	{
+		pthread_cond_signal(&clientThreadsDone);
+	}
+
+	pthread_mutex_unlock(&clientsMutex);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	std::string socketPath = voce::internal::gDefaultDaemonSocket;
+	std::string vocePath;
+	std::string grammarPath;
+	std::string grammarName;
+	std::string options;
+	bool initSynthesis = false;
+	bool initRecognition = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+
+		if ("-socket" == arg && i + 1 < argc)
+		{
+			socketPath = argv[++i];
+		}
+		else if ("-synthesis" == arg)
+		{
+			initSynthesis = true;
+		}
+		else if ("-recognition" == arg)
+		{
+			initRecognition = true;
+		}
+		else if ("-grammarPath" == arg && i + 1 < argc)
+		{
+			grammarPath = argv[++i];
+		}
+		else if ("-grammarName" == arg && i + 1 < argc)
+		{
+			grammarName = argv[++i];
+		}
+		else if ("-options" == arg && i + 1 < argc)
+		{
+			options = argv[++i];
+		}
+		else
+		{
+			vocePath = arg;
+		}
+	}
+
+	if (vocePath.empty())
+	{
+		std::cout << "Usage: voceDaemon [-socket path] [-synthesis] " 
+			<< "[-recognition] [-grammarPath path] [-grammarName name] " 
+			<< "[-options list] vocePath" << std::endl;
+		return 1;
+	}
+
+	for (unsigned int i = 0; i < voce::internal::gMaxPushAudioBuffers; 
+		++i)
+	{
+		pthread_mutex_init(&pushMutexes[i], NULL);
+	}
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath.c_str(), 
+		sizeof(address.sun_path) - 1);
+
+	// Remove the socket left behind by a previous run.
+	unlink(socketPath.c_str());
+
+	// Create the socket with owner-only permissions, so other users 
+	// cannot connect to it, even before it is listening.
+	mode_t oldMask = umask(0077);
+	bool bound = listener >= 0 
+		&& 0 == bind(listener, (sockaddr*)&address, sizeof(address));
+	umask(oldMask);
+
+	if (!bound || listen(listener, 16) < 0 || pipe(wakePipe) < 0)
+	{
+		std::cout << "Cannot listen on " << socketPath << std::endl;
+		return 1;
+	}
+
+	voce::init(vocePath, initSynthesis, initRecognition, grammarPath, 
+		grammarName, options);
+
+	// Clients that disconnect must not kill the daemon.  The signals that 
+	// stop it wake the loop below through the pipe, whichever thread 
+	// they are delivered to.
+	signal(SIGPIPE, SIG_IGN);
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = handleSignal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	std::cout << "Voce daemon listening on " << socketPath << std::endl;
+
+	while (!stopDaemon)
+	{
+		pollfd fds[2];
+		fds[0].fd = listener;
+		fds[0].events = POLLIN;
+		fds[1].fd = wakePipe[0];
+		fds[1].events = POLLIN;
+
+		if (poll(fds, 2, -1) < 0 || !(fds[0].revents & POLLIN))
+		{
+			continue;
+		}
+
+		int fd = accept(listener, NULL, NULL);
+
+		if (fd < 0)
+		{
+			continue;
+		}
+
+		pthread_mutex_lock(&clientsMutex);
+		clients.push_back(fd);
+		++numClientThreads;
+		pthread_mutex_unlock(&clientsMutex);
+
+		pthread_t thread;
+
+		if (0 != pthread_create(&thread, NULL, serveClient, 
+			(void*)(size_t)fd))
+		{
+			pthread_mutex_lock(&clientsMutex);
+			clients.pop_back();
+			--numClientThreads;
+			pthread_mutex_unlock(&clientsMutex);
+			close(fd);
+			continue;
+		}
+
+		pthread_detach(thread);
+	}
+
+	close(listener);
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+	unlink(socketPath.c_str());
+
+	// Wake the client threads and wait for them to exit, since the 
+	// virtual machine waits for every attached thread to detach.  A 
+	// thread waiting for a recognized string notices 'stopDaemon' 
+	// within one wait slice.
+	pthread_mutex_lock(&clientsMutex);
+
+	for (size_t i = 0; i < clients.size(); ++i)
+	{
+		shutdown(clients[i], SHUT_RDWR);
+	}
+
+	while (numClientThreads > 0)
+	{
+		pthread_cond_wait(&clientThreadsDone, &clientsMutex);
+	}
+
+	pthread_mutex_unlock(&clientsMutex);
+
+	voce::destroy();
+	return 0;
+}
@@ -0,0 +1,120 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+#include <voce/voce.h>
+
+/// A sample application that runs voce.FrontEndBenchmark, which checks 
+/// the native front end against the Java one and measures the speed of 
+/// each.  The native front end is only available when the C++ interface 
+/// creates the Java virtual machine, so this creates it with voce::init 
+/// and calls the benchmark's main method.  Usage:
+///
+/// frontEndBenchmark [options] vocePath outputFile audioFile...
+///
+/// The options are those of voce.FrontEndBenchmark.  The config file 
+/// defaults to the one in 'vocePath'.  The exit status is 1 if the 
+/// features of any file differ by more than the tolerance.
+
+int main(int argc, char **argv)
+{
+	std::string vocePath;
+	std::vector<std::string> args;
+	bool hasConfig = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+
+		if ((arg == "-config" || arg == "-repeat" || arg == "-tolerance") 
+			&& i + 1 < argc)
+		{
+			hasConfig = hasConfig || arg == "-config";
+			args.push_back(arg);
+			args.push_back(argv[++i]);
+		}
+		else if (vocePath.empty())
+		{
+			vocePath = arg;
+		}
+		else
+		{
+			args.push_back(arg);
+		}
+	}
+
+	if (vocePath.empty() || args.size() < 2)
+	{
+		std::cout << "Usage: frontEndBenchmark [-config file] [-repeat n] " 
+			<< "[-tolerance t] vocePath outputFile audioFile..." 
+			<< std::endl;
+		return 1;
+	}
+
+	if (!hasConfig)
+	{
+		args.insert(args.begin(), vocePath + "/voce.config.xml");
+		args.insert(args.begin(), "-config");
+	}
+
+	// Neither synthesis nor recognition is needed; the benchmark builds 
+	// its own front ends.
+	voce::init(vocePath, false, false, "", "");
+
+	JNIEnv* env = voce::internal::getEnv();
+
+	if (!env)
+	{
+		return 1;
+	}
+
+	jclass benchmark = env->FindClass("voce/FrontEndBenchmark");
+	jmethodID mainID = benchmark ? env->GetStaticMethodID(benchmark, 
+		"main", "([Ljava/lang/String;)V") : 0;
+
+	if (!mainID)
+	{
+		std::cout << "voce.FrontEndBenchmark cannot be found in " 
+			<< vocePath << "/voce.jar." << std::endl;
+		return 1;
+	}
+
+	jobjectArray jArgs = env->NewObjectArray((jsize)args.size(), 
+		env->FindClass("java/lang/String"), NULL);
+
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		jstring jArg = env->NewStringUTF(args[i].c_str());
+		env->SetObjectArrayElement(jArgs, (jsize)i, jArg);
+		env->DeleteLocalRef(jArg);
+	}
+
+	// The benchmark exits the process with its result.
+	env->CallStaticVoidMethod(benchmark, mainID, jArgs);
+
+	if (env->ExceptionCheck())
+	{
+		env->ExceptionDescribe();
+	}
+
+	voce::destroy();
+	return 1;
+}
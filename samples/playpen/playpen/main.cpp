@@ -79,6 +79,10 @@ namespace playpen
 
 		/// Point where new objects are created.
 		opal::Point3r mCreationPoint;
+
+		/// Holds the most recently recognized string.  It is reused 
+		/// every frame to avoid reallocating.
+		std::string mRecognizedString;
 	};
 
 	PlaypenApp::PlaypenApp()
@@ -86,8 +90,33 @@ namespace playpen
 	{
 		mUseShadows = true;
 		mCreationPoint.set(-55, 60, -55);
+		// The same few phrases are spoken over and over, so keep them 
+		// in the phrase cache.
 		voce::init("../../../../lib", true, true, "../../data/grammar", 
-			"objects");
+			"objects", "phraseCacheSize=1024");
+
+		// Render every phrase appFrameStarted can speak in the 
+		// background, so none of them is delayed the first time.
+		const char* colors[] = {"", "yellow", "red", "blue", "green", 
+			"purple", "orange"};
+		const char* types[] = {" box", " sphere", " wall", " tower", 
+			" character"};
+		std::vector<std::string> phrases;
+		phrases.push_back("reset");
+
+		for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); ++i)
+		{
+			for (size_t j = 0; j < sizeof(types) / sizeof(types[0]); ++j)
+			{
+				phrases.push_back(std::string(colors[i]) + types[j]);
+			}
+		}
+
+		voce::preloadPhrases(phrases);
+
+		// Have recognized strings written into Voce's ring buffer so 
+		// each frame can read them without calling into Java.
+		voce::setRecognitionBufferEnabled(true);
 	}
 
 	PlaypenApp::~PlaypenApp()
@@ -177,9 +206,9 @@ namespace playpen
 		std::string material;
 		ObjectType type;
 		std::string outputString;
-		while (voce::getRecognizerQueueSize() > 0)
+		while (voce::popBufferedRecognizedString(mRecognizedString))
 		{
-			std::string s = voce::popRecognizedString();
+			const std::string& s = mRecognizedString;
 
 			//// Check if the string contains 'quit'.
 			//if (std::string::npos != s.rfind("quit"))
@@ -22,12 +22,6 @@
 
 #include <voce/voce.h>
 
-#ifdef WIN32
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
-
 /// A sample application showing how to use Voce's speech synthesis 
 /// capabilities.
 
@@ -40,29 +34,25 @@ int main(int argc, char **argv)
 		<< "Speak 'quit' to quit." << std::endl;
 
 	bool quit = false;
+	std::string s;
 	while (!quit)
 	{
-		// Normally, applications would do application-specific things 
-		// here.  For this sample, we'll just sleep for a little bit.
-#ifdef WIN32
-		::Sleep(200);
-#else
-		usleep(200);
-#endif
-
-		while (voce::getRecognizerQueueSize() > 0)
+		// Sleep until something is recognized.  Applications that have 
+		// other work to do in this thread can use a shorter timeout, or 
+		// call this from a separate thread.
+		if (!voce::waitForRecognizedString(s, 1000))
 		{
-			std::string s = voce::popRecognizedString();
-
-			// Check if the string contains 'quit'.
-			if (std::string::npos != s.rfind("quit"))
-			{
-				quit = true;
-			}
+			continue;
+		}
 
-			std::cout << "You said: " << s << std::endl;
-			//voce::synthesize(s);
+		// Check if the string contains 'quit'.
+		if (std::string::npos != s.rfind("quit"))
+		{
+			quit = true;
 		}
+
+		std::cout << "You said: " << s << std::endl;
+		//voce::synthesize(s);
 	}
 
 	voce::destroy();
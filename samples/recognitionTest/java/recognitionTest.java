@@ -37,29 +37,24 @@ public class recognitionTest
 		boolean quit = false;
 		while (!quit)
 		{
-			// Normally, applications would do application-specific things 
-			// here.  For this sample, we'll just sleep for a little bit.
-			try
-			{
-				Thread.sleep(200);
-			}
-			catch (InterruptedException e)
+			// Sleep until something is recognized.  Applications that 
+			// have other work to do in this thread can use a shorter 
+			// timeout, or call this from a separate thread.
+			String s = voce.SpeechInterface.waitForRecognizedString(1000);
+
+			if (null == s)
 			{
+				continue;
 			}
 
-			while (voce.SpeechInterface.getRecognizerQueueSize() > 0)
+			// Check if the string contains 'quit'.
+			if (-1 != s.indexOf("quit"))
 			{
-				String s = voce.SpeechInterface.popRecognizedString();
-
-				// Check if the string contains 'quit'.
-				if (-1 != s.indexOf("quit"))
-				{
-					quit = true;
-				}
-
-				System.out.println("You said: " + s);
-				//voce.SpeechInterface.synthesize(s);
+				quit = true;
 			}
+
+			System.out.println("You said: " + s);
+			//voce.SpeechInterface.synthesize(s);
 		}
 
 		voce.SpeechInterface.destroy();
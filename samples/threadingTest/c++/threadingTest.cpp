@@ -0,0 +1,255 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+#include <voce/voce.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+/// A sample application showing that Voce functions can be called from 
+/// any thread.  It measures how the cost of a Voce call scales as more 
+/// threads call into Voce at the same time, and how much the first call 
+/// from a new thread costs, since it attaches the thread to the Java 
+/// virtual machine.  It then stress-tests attaching and detaching by 
+/// starting many short-lived threads, and checks that every one of them 
+/// was detached when it exited.  The exit status is 1 if any was not.
+
+/// How long each test runs, in milliseconds.
+const int testDuration = 2000;
+
+/// Set by the main thread to tell the worker threads to stop.
+volatile bool stopWorkers = false;
+
+/// A per-thread call counter, padded to its own cache line so the 
+/// counters themselves don't limit scaling.
+struct Counter
+{
+	long numCalls;
+	char padding[64 - sizeof(long)];
+};
+
+/// The number of short-lived threads started by the stress test, and 
+/// how many run at once.
+const int numStressThreads = 2000;
+const int stressBatchSize = 16;
+
+/// The time taken by a new thread's first and second Voce calls, in 
+/// milliseconds.
+struct CallTimes
+{
+	double first;
+	double second;
+};
+
+/// Returns the current time in milliseconds.
+double getTimeMs()
+{
+#ifdef WIN32
+	return (double)::GetTickCount();
+#else
+	timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+#endif
+}
+
+/// The worker thread function.  Calls into Voce as fast as possible and 
+/// stores the number of calls made in the Counter pointed to by 'arg'.
+#ifdef WIN32
+DWORD WINAPI worker(void* arg)
+#else
+void* worker(void* arg)
+#endif
+{
+	Counter* counter = (Counter*)arg;
+
+	while (!stopWorkers)
+	{
+		voce::isSynthesizing();
+		++counter->numCalls;
+	}
+
+	return 0;
+}
+
+/// Runs 'numThreads' worker threads for the test duration and returns 
+/// the total number of Voce calls per second.
+double runTest(int numThreads)
+{
+	const int maxThreads = 64;
+	Counter counters[maxThreads];
+#ifdef WIN32
+	HANDLE threads[maxThreads];
+#else
+	pthread_t threads[maxThreads];
+#endif
+
+	stopWorkers = false;
+	double startTime = getTimeMs();
+
+	for (int i = 0; i < numThreads; ++i)
+	{
+		counters[i].numCalls = 0;
+#ifdef WIN32
+		threads[i] = ::CreateThread(NULL, 0, worker, &counters[i], 0, NULL);
+#else
+		pthread_create(&threads[i], NULL, worker, &counters[i]);
+#endif
+	}
+
+#ifdef WIN32
+	::Sleep(testDuration);
+#else
+	usleep(testDuration * 1000);
+#endif
+
+	stopWorkers = true;
+	long total = 0;
+
+	for (int i = 0; i < numThreads; ++i)
+	{
+#ifdef WIN32
+		::WaitForSingleObject(threads[i], INFINITE);
+		::CloseHandle(threads[i]);
+#else
+		pthread_join(threads[i], NULL);
+#endif
+		total += counters[i].numCalls;
+	}
+
+	double elapsedSeconds = (getTimeMs() - startTime) / 1000.0;
+	return total / elapsedSeconds;
+}
+
+/// The short-lived thread function.  Makes two Voce calls, storing the 
+/// time each took in the CallTimes pointed to by 'arg', and exits.
+#ifdef WIN32
+DWORD WINAPI shortLivedWorker(void* arg)
+#else
+void* shortLivedWorker(void* arg)
+#endif
+{
+	CallTimes* times = (CallTimes*)arg;
+	double start = getTimeMs();
+	voce::isSynthesizing();
+	double middle = getTimeMs();
+	voce::isSynthesizing();
+	times->first = middle - start;
+	times->second = getTimeMs() - middle;
+	return 0;
+}
+
+/// Starts 'numStressThreads' short-lived threads, 'stressBatchSize' at 
+/// a time, and prints the average cost of attaching a thread.  Returns 
+/// false if any thread was still attached after it exited.
+bool runStressTest()
+{
+	CallTimes times[stressBatchSize];
+#ifdef WIN32
+	HANDLE threads[stressBatchSize];
+#else
+	pthread_t threads[stressBatchSize];
+#endif
+	double firstTotal = 0;
+	double secondTotal = 0;
+	bool allDetached = true;
+
+	for (int started = 0; started < numStressThreads; 
+		started += stressBatchSize)
+	{
+		for (int i = 0; i < stressBatchSize; ++i)
+		{
+#ifdef WIN32
+			threads[i] = ::CreateThread(NULL, 0, shortLivedWorker, 
+				&times[i], 0, NULL);
+#else
+			pthread_create(&threads[i], NULL, shortLivedWorker, &times[i]);
+#endif
+		}
+
+		for (int i = 0; i < stressBatchSize; ++i)
+		{
+#ifdef WIN32
+			::WaitForSingleObject(threads[i], INFINITE);
+			::CloseHandle(threads[i]);
+#else
+			pthread_join(threads[i], NULL);
+#endif
+			firstTotal += times[i].first;
+			secondTotal += times[i].second;
+		}
+
+		if (0 != voce::getAttachedThreadCount())
+		{
+			allDetached = false;
+		}
+	}
+
+	int count = numStressThreads / stressBatchSize * stressBatchSize;
+	std::cout << count << " short-lived threads: first call " 
+		<< firstTotal / count << " ms, second call " 
+		<< secondTotal / count << " ms, so attaching costs about " 
+		<< (firstTotal - secondTotal) / count << " ms" << std::endl;
+
+	if (!allDetached)
+	{
+		std::cout << "FAILED: " << voce::getAttachedThreadCount() 
+			<< " thread(s) still attached after exiting" << std::endl;
+	}
+
+	return allDetached;
+}
+
+int main(int argc, char **argv)
+{
+	voce::init("../../../lib", true, false, "", "");
+
+	std::cout << "This is a threading test.  Each worker thread calls " 
+		<< "into Voce as fast as it can." << std::endl;
+
+	double baseline = 0;
+
+	for (int numThreads = 1; numThreads <= 16; numThreads *= 2)
+	{
+		double callsPerSecond = runTest(numThreads);
+
+		if (1 == numThreads)
+		{
+			baseline = callsPerSecond;
+		}
+
+		std::cout << numThreads << " thread(s): " << callsPerSecond 
+			<< " calls/sec (" << callsPerSecond / baseline 
+			<< "x single thread)" << std::endl;
+	}
+
+	bool passed = runStressTest();
+
+	// This hangs if a thread that called Voce was never detached.
+	voce::destroy();
+	return passed ? 0 : 1;
+}
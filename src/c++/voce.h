@@ -26,11 +26,45 @@
 // This file contains a C++ interface for Voce's Java functions.  All of 
 // the Java methods in Voce's API are instance methods, so we don't need 
 // to handle class methods here.  For documentation on the specific 
-// functions, refer to the API documentation for the Java source.
+// functions, refer to the API documentation for the Java source.  
+// Defining VOCE_CLIENT before including this file gives the same 
+// functions in client mode, which talks to a Voce daemon instead of 
+// starting a Java virtual machine (see samples/daemon).
 
+#if !defined(VOCE_CLIENT)
 #include <jni.h>
+#include <cmath>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VOCE_SSE2
+#endif
+#endif
 #include <iostream>
+#include <map>
 #include <string>
+#include <vector>
+#include <cstring>
+#include <new>
+
+#if defined(WIN32) || defined(_WIN32)
+#if defined(VOCE_CLIENT)
+#error Voce client mode needs Unix domain sockets.
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#endif
 
 /// The namespace containing everything in the Voce C++ API.
 namespace voce
@@ -41,380 +75,3892 @@ const std::string pathSeparator = ";";
 const std::string pathSeparator = ":";
 #endif
 
+	/// A function that receives recognized strings as soon as they are 
+	/// recognized.  'userData' is the pointer given to 
+	/// setRecognitionCallback.
+	typedef void (*RecognitionCallback)(const std::string& str, 
+		void* userData);
+
+	/// The phrase cache's counters.  See getPhraseCacheStats.
+	struct PhraseCacheStats
+	{
+		/// The number of phrases found in the cache, and the number 
+		/// synthesized because they were not.
+		long long hits;
+		long long misses;
+
+		/// The number of phrases dropped to make room for newer ones.
+		long long evictions;
+
+		/// The bytes of samples kept, and the number of phrases kept.
+		long long bytes;
+		long long phrases;
+	};
+
 	/// Contains things that should only be accessed within Voce.
 	namespace internal
 	{
-		/// Global instance of the JNI environment.
-		JNIEnv* gEnv = NULL;
+		/// A simple message logging function.  The message type gets printed 
+		/// before the actual message.
+		void log(const std::string& msgType, const std::string& msg)
+		{
+			std::cout << "[Voce";
 
-		/// Global instance of the Java virtual machine.
-		JavaVM *gJVM = NULL;
+			if (std::string("") != msgType)
+			{
+				std::cout << " " << msgType;
+			}
 
-		/// Global reference to the main Voce Java class.
-		jclass gClass = NULL;
+			std::cout << "] " << msg << std::endl;
+		}
 
-		/// Global references to the various Java method IDs.  Storing 
-		/// these saves lookup time later.
-		jmethodID gInitID = NULL;
-		jmethodID gDestroyID = NULL;
-		jmethodID gSynthesizeID = NULL;
-		jmethodID gIsSynthesizingID = NULL;
-		jmethodID gStopSynthesizingID = NULL;
-		jmethodID gGetRecognizerQueueSizeID = NULL;
-		jmethodID gPopRecognizedStringID = NULL;
-		jmethodID gSetRecognizerEnabledID = NULL;
-		jmethodID gIsRecognizerEnabledID = NULL;
+		/// Parses an options string (see init) into its 'name=value' 
+		/// entries, following the same rules as the Java interface's 
+		/// Utils.parseOptions: entries are separated by whitespace, commas 
+		/// or semicolons, malformed entries are logged and skipped, and a 
+		/// later entry replaces an earlier one with the same name.  The 
+		/// Java parser cannot be used here, since the options read in C++ 
+		/// (the heap size and the daemon socket) are needed before there 
+		/// is a JVM.
+		std::map<std::string, std::string> parseOptions(
+			const std::string& options)
+		{
+			const char* separators = " \t\r\n\f\v,;";
+			std::map<std::string, std::string> entries;
+			std::string::size_type start = 
+				options.find_first_not_of(separators);
 
-		/// The name of the main Voce Java class.
-		const std::string gClassName = "voce/SpeechInterface";
+			while (std::string::npos != start)
+			{
+				std::string::size_type end = 
+					options.find_first_of(separators, start);
+				std::string entry = options.substr(start, end - start);
+				std::string::size_type equals = entry.find('=');
 
-		/// A simple message logging function.  The message type gets printed 
-		/// before the actual message.
-		void log(const std::string& msgType, const std::string& msg)
+				if (std::string::npos == equals || 0 == equals)
+				{
+					log("warning", "Ignoring malformed option: " + entry);
+				}
+				else
+				{
+					entries[entry.substr(0, equals)] = 
+						entry.substr(equals + 1);
+				}
+
+				start = options.find_first_not_of(separators, end);
+			}
+
+			return entries;
+		}
+
+#if !defined(WIN32) && !defined(_WIN32)
+		/// The messages sent between client mode (see below) and the 
+		/// Voce daemon (samples/daemon).  Each message is a frame: a 
+		/// 4-byte payload size and a 1-byte message type, followed by the 
+		/// payload.  Client and daemon run on the same machine, so numbers 
+		/// are sent in its byte order; strings are sent as a 4-byte size 
+		/// followed by their UTF-8 bytes.  The daemon answers the messages 
+		/// that return something with a MSG_REPLY, in the order they were 
+		/// sent.  The rest are never answered, so a client can send many of 
+		/// them without waiting.
+		enum DaemonMessage
+		{
+			/// A string to synthesize.
+			MSG_SYNTHESIZE = 1,
+
+			/// Replies with an int: 1 if synthesizing, otherwise 0.
+			MSG_IS_SYNTHESIZING,
+
+			MSG_STOP_SYNTHESIZING,
+
+			/// Replies with an int.
+			MSG_GET_RECOGNIZER_QUEUE_SIZE,
+
+			/// Replies with a long.
+			MSG_GET_RECOGNIZER_DROP_COUNT,
+
+			/// Replies with a string.
+			MSG_POP_RECOGNIZED_STRING,
+
+			/// An int timeout in milliseconds.  Replies with an int (1 if 
+			/// a string was recognized, otherwise 0) and a string.
+			MSG_WAIT_FOR_RECOGNIZED_STRING,
+
+			/// Replies with an int count and that many strings.
+			MSG_POP_ALL_RECOGNIZED_STRINGS,
+
+			/// Replies with a string.
+			MSG_POP_PARTIAL_RESULT,
+
+			/// Replies with an int.
+			MSG_GET_PARTIAL_RESULT_LEAD_TIME,
+
+			/// Replies with an int.
+			MSG_GET_SCORER_THREAD_COUNT,
+
+			/// A filename.  Replies with a string.
+			MSG_RECOGNIZE_FILE,
+
+			/// An int stream (0 for the 'audioInput=push' input) followed 
+			/// by the samples.
+			MSG_PUSH_AUDIO,
+
+			/// Replies with an int.
+			MSG_GET_PUSH_AUDIO_OVERFLOW_COUNT,
+
+			/// Replies with an int.
+			MSG_GET_PUSH_AUDIO_UNDERRUN_COUNT,
+
+			/// A grammar name.  Replies with an int stream.
+			MSG_CREATE_STREAM,
+
+			/// An int stream.
+			MSG_DESTROY_STREAM,
+
+			/// An int stream.  Replies with a string.
+			MSG_POP_RESULT,
+
+			/// A grammar path and a grammar name.  Replies with a long.
+			MSG_SET_GRAMMAR,
+
+			/// An int: 1 to enable, 0 to disable.
+			MSG_SET_RECOGNIZER_ENABLED,
+
+			/// Replies with an int: 1 if enabled, otherwise 0.
+			MSG_IS_RECOGNIZER_ENABLED,
+
+			/// A string to synthesize.  Replies with an int sample rate 
+			/// (0 if it cannot be synthesized) followed by the samples.
+			MSG_SYNTHESIZE_TO_BUFFER,
+
+			/// Replies with the five longs of a PhraseCacheStats.
+			MSG_GET_PHRASE_CACHE_STATS,
+
+			/// An int count followed by that many phrases.
+			MSG_PRELOAD_PHRASES,
+
+			/// Replies with an int.
+			MSG_GET_PRELOAD_PENDING_COUNT,
+
+			/// The answer to a message.
+			MSG_REPLY = 128
+		};
+
+		/// The largest payload accepted.  Larger sizes mean the stream of 
+		/// frames is corrupt.
+		const unsigned int gMaxMessageSize = 16 * 1024 * 1024;
+
+		/// The daemon's socket when no other is given.
+		const std::string gDefaultDaemonSocket = "/tmp/voce.sock";
+
+		/// Appends an int to a message payload.
+		void appendInt(std::string& data, int value)
+		{
+			data.append((const char*)&value, sizeof(value));
+		}
+
+		/// Appends a long to a message payload.
+		void appendLong(std::string& data, long long value)
+		{
+			data.append((const char*)&value, sizeof(value));
+		}
+
+		/// Appends a string to a message payload.
+		void appendString(std::string& data, const std::string& s)
+		{
+			appendInt(data, (int)s.size());
+			data.append(s);
+		}
+
+		/// Reads an int from a message payload at 'pos' and moves 'pos' 
+		/// past it.  Returns false if the payload is too short.
+		bool readInt(const std::string& data, size_t& pos, int& value)
+		{
+			if (pos + sizeof(value) > data.size())
+			{
+				return false;
+			}
+
+			memcpy(&value, data.data() + pos, sizeof(value));
+			pos += sizeof(value);
+			return true;
+		}
+
+		/// Reads a long from a message payload at 'pos' and moves 'pos' 
+		/// past it.  Returns false if the payload is too short.
+		bool readLong(const std::string& data, size_t& pos, 
+			long long& value)
+		{
+			if (pos + sizeof(value) > data.size())
+			{
+				return false;
+			}
+
+			memcpy(&value, data.data() + pos, sizeof(value));
+			pos += sizeof(value);
+			return true;
+		}
+
+		/// Reads a string from a message payload at 'pos' and moves 'pos' 
+		/// past it.  Returns false if the payload is too short.
+		bool readString(const std::string& data, size_t& pos, 
+			std::string& s)
+		{
+			int size = 0;
+
+			if (!readInt(data, pos, size) || size < 0 
+				|| pos + (size_t)size > data.size())
+			{
+				return false;
+			}
+
+			s.assign(data, pos, size);
+			pos += size;
+			return true;
+		}
+
+		/// Writes all of 'size' bytes to a socket.  Returns false if the 
+		/// connection is gone.
+		bool writeAll(int fd, const char* data, size_t size)
+		{
+			while (size > 0)
+			{
+				ssize_t written = ::write(fd, data, size);
+
+				if (written < 0 && EINTR == errno)
+				{
+					continue;
+				}
+				else if (written <= 0)
+				{
+					return false;
+				}
+
+				data += written;
+				size -= written;
+			}
+
+			return true;
+		}
+
+		/// Reads exactly 'size' bytes from a socket.  Returns false if 
+		/// the connection is closed first.
+		bool readAll(int fd, char* data, size_t size)
+		{
+			while (size > 0)
+			{
+				ssize_t count = ::read(fd, data, size);
+
+				if (count < 0 && EINTR == errno)
+				{
+					continue;
+				}
+				else if (count <= 0)
+				{
+					return false;
+				}
+
+				data += count;
+				size -= count;
+			}
+
+			return true;
+		}
+
+		/// Sends a message whose payload is 'payload' followed by 
+		/// 'extraSize' bytes at 'extra'.  The extra bytes (audio samples, 
+		/// for example) are written straight from the caller's memory.  
+		/// Returns false if the connection is gone.
+		bool writeMessage(int fd, int type, const std::string& payload, 
+			const void* extra = NULL, size_t extraSize = 0)
+		{
+			unsigned int size = (unsigned int)(payload.size() + extraSize);
+			std::string frame;
+			frame.reserve(sizeof(size) + 1 + payload.size());
+			frame.append((const char*)&size, sizeof(size));
+			frame.push_back((char)type);
+			frame.append(payload);
+
+			if (0 == extraSize)
+			{
+				return writeAll(fd, frame.data(), frame.size());
+			}
+
+			// Write both pieces with one system call when possible.
+			iovec pieces[2];
+			pieces[0].iov_base = (void*)frame.data();
+			pieces[0].iov_len = frame.size();
+			pieces[1].iov_base = (void*)extra;
+			pieces[1].iov_len = extraSize;
+			ssize_t written = ::writev(fd, pieces, 2);
+
+			if (written < 0 && EINTR != errno)
+			{
+				return false;
+			}
+			else if (written < 0)
+			{
+				written = 0;
+			}
+
+			if ((size_t)written < frame.size())
+			{
+				return writeAll(fd, frame.data() + written, 
+					frame.size() - written) 
+					&& writeAll(fd, (const char*)extra, extraSize);
+			}
+
+			written -= frame.size();
+			return writeAll(fd, (const char*)extra + written, 
+				extraSize - written);
+		}
+
+		/// Reads the next message from a socket into 'type' and 
+		/// 'payload'.  Returns false if the connection is closed or the 
+		/// frame is corrupt.
+		bool readMessage(int fd, int& type, std::string& payload)
+		{
+			char header[sizeof(unsigned int) + 1];
+
+			if (!readAll(fd, header, sizeof(header)))
+			{
+				return false;
+			}
+
+			unsigned int size = 0;
+			memcpy(&size, header, sizeof(size));
+			type = (unsigned char)header[sizeof(size)];
+
+			if (size > gMaxMessageSize)
+			{
+				return false;
+			}
+
+			payload.resize(size);
+			return 0 == size || readAll(fd, &payload[0], size);
+		}
+#endif
+	}
+
+#if defined(VOCE_CLIENT)
+	// Client mode: every function below sends its request to a Voce 
+	// daemon (samples/daemon) over a Unix domain socket instead of 
+	// calling into a Java virtual machine in this process.  It has the 
+	// same functions as the normal mode, so switching is a matter of 
+	// defining VOCE_CLIENT before including voce.h.  The daemon is 
+	// initialized with its own options; init only connects to it.  
+	// Messages that are not answered (such as pushAudio and synthesize) 
+	// are sent without waiting, so they pipeline; a call that returns a 
+	// value waits for its reply before the thread sends anything else.
+
+	namespace internal
+	{
+		/// The path of the daemon's socket, or empty before init.
+		std::string gDaemonSocket;
+
+		/// Thread-local storage slot holding each thread's connection to 
+		/// the daemon, plus one (so that no connection reads as NULL).  
+		/// Every thread gets its own connection, so a thread never waits 
+		/// behind the replies to another thread's requests.
+		pthread_key_t gConnectionKey;
+		bool gConnectionKeyCreated = false;
+
+		/// Every open connection, so that destroy can close them.
+		std::vector<int> gConnections;
+		pthread_mutex_t gConnectionsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+		/// The user's recognition and partial result callbacks and their 
+		/// data pointers.  In client mode they are called from a thread 
+		/// that polls the daemon.
+		RecognitionCallback gRecognitionCallback = NULL;
+		void* gRecognitionCallbackData = NULL;
+		RecognitionCallback gPartialResultCallback = NULL;
+		void* gPartialResultCallbackData = NULL;
+
+		/// The thread that polls the daemon for the callbacks.
+		pthread_t gCallbackThread;
+		volatile bool gCallbackThreadRunning = false;
+
+		/// Closes a connection and forgets it.
+		void closeConnection(int fd)
+		{
+			pthread_mutex_lock(&gConnectionsMutex);
+
+			for (size_t i = 0; i < gConnections.size(); ++i)
+			{
+				if (gConnections[i] == fd)
+				{
+					gConnections.erase(gConnections.begin() + i);
+					::close(fd);
+					break;
+				}
+			}
+
+			pthread_mutex_unlock(&gConnectionsMutex);
+		}
+
+		/// Called by the thread library when a thread exits.  Closes the 
+		/// thread's connection.
+		void closeThreadConnection(void* value)
+		{
+			if (value)
+			{
+				closeConnection((int)(size_t)value - 1);
+			}
+		}
+
+		/// Returns the calling thread's connection to the daemon, or -1 
+		/// if Voce has not been initialized or the daemon cannot be 
+		/// reached.  The first call from a thread connects.
+		int getConnection()
+		{
+			if (gDaemonSocket.empty())
+			{
+				return -1;
+			}
+
+			void* value = pthread_getspecific(gConnectionKey);
+
+			if (value)
+			{
+				return (int)(size_t)value - 1;
+			}
+
+			int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+			if (fd < 0)
+			{
+				log("ERROR", "Cannot create a socket.");
+				return -1;
+			}
+
+			sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			strncpy(address.sun_path, gDaemonSocket.c_str(), 
+				sizeof(address.sun_path) - 1);
+
+			if (::connect(fd, (sockaddr*)&address, sizeof(address)) < 0)
+			{
+				log("ERROR", "Cannot connect to the Voce daemon at " 
+					+ gDaemonSocket + ".");
+				::close(fd);
+				return -1;
+			}
+
+			pthread_mutex_lock(&gConnectionsMutex);
+			gConnections.push_back(fd);
+			pthread_mutex_unlock(&gConnectionsMutex);
+			pthread_setspecific(gConnectionKey, (void*)(size_t)(fd + 1));
+			return fd;
+		}
+
+		/// Closes the calling thread's connection after an error, so that 
+		/// its next request connects again.
+		void dropConnection(int fd)
+		{
+			log("ERROR", "Lost the connection to the Voce daemon.");
+			pthread_setspecific(gConnectionKey, NULL);
+			closeConnection(fd);
+		}
+
+		/// Sends a message that is not answered.  Returns false if it 
+		/// cannot be sent.
+		bool send(int type, const std::string& payload, 
+			const void* extra = NULL, size_t extraSize = 0)
+		{
+			int fd = getConnection();
+
+			if (fd < 0)
+			{
+				return false;
+			}
+
+			if (!writeMessage(fd, type, payload, extra, extraSize))
+			{
+				dropConnection(fd);
+				return false;
+			}
+
+			return true;
+		}
+
+		/// Sends a message and waits for its reply.  Returns false if 
+		/// there is no reply.
+		bool call(int type, const std::string& payload, std::string& reply)
+		{
+			int fd = getConnection();
+
+			if (fd < 0)
+			{
+				return false;
+			}
+
+			int replyType = 0;
+
+			if (!writeMessage(fd, type, payload) 
+				|| !readMessage(fd, replyType, reply) 
+				|| MSG_REPLY != replyType)
+			{
+				dropConnection(fd);
+				return false;
+			}
+
+			return true;
+		}
+
+		/// Sends a message and returns the int it replies with, or 
+		/// 'defaultValue' if there is no reply.
+		int callInt(int type, const std::string& payload, int defaultValue)
+		{
+			std::string reply;
+			size_t pos = 0;
+			int value = defaultValue;
+
+			if (call(type, payload, reply) && readInt(reply, pos, value))
+			{
+				return value;
+			}
+
+			return defaultValue;
+		}
+
+		/// Sends a message and returns the string it replies with, or an 
+		/// empty string if there is no reply.
+		std::string callString(int type, const std::string& payload)
+		{
+			std::string reply;
+			size_t pos = 0;
+			std::string s;
+
+			if (call(type, payload, reply) && readString(reply, pos, s))
+			{
+				return s;
+			}
+
+			return "";
+		}
+
+		/// The body of the callback thread.  Waits on the daemon for 
+		/// recognized strings, and polls it for partial results, while 
+		/// either callback is set.
+		void* runCallbackThread(void* /*arg*/)
+		{
+			std::string payload;
+			appendInt(payload, 20);
+			std::string partialPayload;
+
+			while (gCallbackThreadRunning)
+			{
+				RecognitionCallback callback = gRecognitionCallback;
+				RecognitionCallback partialCallback = gPartialResultCallback;
+
+				if (partialCallback)
+				{
+					std::string partial = callString(MSG_POP_PARTIAL_RESULT, 
+						partialPayload);
+
+					if (!partial.empty())
+					{
+						partialCallback(partial, gPartialResultCallbackData);
+					}
+				}
+
+				std::string reply;
+				size_t pos = 0;
+				int found = 0;
+				std::string s;
+
+				if (!callback)
+				{
+					usleep(20000);
+				}
+				else if (!call(MSG_WAIT_FOR_RECOGNIZED_STRING, payload, 
+					reply))
+				{
+					// Don't spin while the daemon is unreachable.
+					usleep(1000000);
+				}
+				else if (readInt(reply, pos, found) && found 
+					&& readString(reply, pos, s))
+				{
+					callback(s, gRecognitionCallbackData);
+				}
+			}
+
+			return NULL;
+		}
+
+		/// Starts the callback thread if a callback is set, and stops it 
+		/// once none is.
+		void updateCallbackThread()
+		{
+			bool needed = gRecognitionCallback || gPartialResultCallback;
+
+			if (needed && !gCallbackThreadRunning)
+			{
+				gCallbackThreadRunning = true;
+				pthread_create(&gCallbackThread, NULL, runCallbackThread, 
+					NULL);
+			}
+			else if (!needed && gCallbackThreadRunning)
+			{
+				gCallbackThreadRunning = false;
+				pthread_join(gCallbackThread, NULL);
+			}
+		}
+	}
+
+	/// Connects to the Voce daemon.  The daemon's socket is given by the 
+	/// 'daemonSocket' option (default '/tmp/voce.sock').  Only the 
+	/// options are used: the path, the synthesis and recognition flags 
+	/// and the grammar are ignored, since the daemon was initialized 
+	/// with its own when it started.
+	void init(const std::string& /*vocePath*/, bool /*initSynthesis*/, 
+		bool /*initRecognition*/, const std::string& /*grammarPath*/, 
+		const std::string& /*grammarName*/, const std::string& options = "")
+	{
+		if (!internal::gConnectionKeyCreated)
+		{
+			internal::gConnectionKeyCreated = (0 == pthread_key_create(
+				&internal::gConnectionKey, internal::closeThreadConnection));
+
+			if (!internal::gConnectionKeyCreated)
+			{
+				internal::log("ERROR", "Thread-local storage for the daemon \
+connection cannot be created");
+				return;
+			}
+		}
+
+		internal::gDaemonSocket = internal::parseOptions(options)[
+			"daemonSocket"];
+
+		if (internal::gDaemonSocket.empty())
+		{
+			internal::gDaemonSocket = internal::gDefaultDaemonSocket;
+		}
+
+		if (internal::getConnection() < 0)
+		{
+			internal::gDaemonSocket = "";
+			return;
+		}
+
+		internal::log("", "Connected to the Voce daemon at " 
+			+ internal::gDaemonSocket);
+	}
+
+	/// Closes the connections to the daemon.  The daemon keeps running.  
+	/// Other threads must have stopped making Voce calls.
+	void destroy()
+	{
+		internal::gRecognitionCallback = NULL;
+		internal::gPartialResultCallback = NULL;
+		internal::updateCallbackThread();
+
+		pthread_mutex_lock(&internal::gConnectionsMutex);
+
+		for (size_t i = 0; i < internal::gConnections.size(); ++i)
+		{
+			::close(internal::gConnections[i]);
+		}
+
+		internal::gConnections.clear();
+		pthread_mutex_unlock(&internal::gConnectionsMutex);
+
+		if (internal::gConnectionKeyCreated)
+		{
+			pthread_key_delete(internal::gConnectionKey);
+			internal::gConnectionKeyCreated = false;
+		}
+
+		internal::gDaemonSocket = "";
+		internal::log("", "Disconnected from the Voce daemon");
+	}
+
+	/// Requests that the given string be synthesized as soon as possible.
+	void synthesize(const std::string& message)
+	{
+		std::string payload;
+		internal::appendString(payload, message);
+		internal::send(internal::MSG_SYNTHESIZE, payload);
+	}
+
+	/// Checks whether the speech synthesizer is currently synthesizing a 
+	/// message.
+	bool isSynthesizing()
+	{
+		return 0 != internal::callInt(internal::MSG_IS_SYNTHESIZING, "", 0);
+	}
+
+	/// Tells the speech synthesizer to stop synthesizing.  This cancels 
+	/// all pending messages.
+	void stopSynthesizing()
+	{
+		internal::send(internal::MSG_STOP_SYNTHESIZING, "");
+	}
+
+	/// Synthesizes the given string into 'samples' instead of playing 
+	/// it.  The samples are 16-bit, signed and mono, at 'sampleRate' 
+	/// Hz.  Returns false if the string cannot be synthesized.
+	bool synthesizeToBuffer(const std::string& message, 
+		std::vector<short>& samples, int& sampleRate)
+	{
+		samples.clear();
+		sampleRate = 0;
+
+		std::string payload;
+		internal::appendString(payload, message);
+		std::string reply;
+		size_t pos = 0;
+		int rate = 0;
+
+		if (!internal::call(internal::MSG_SYNTHESIZE_TO_BUFFER, payload, 
+			reply) || !internal::readInt(reply, pos, rate) || rate <= 0)
+		{
+			return false;
+		}
+
+		// Copy the samples out of the reply, which is not aligned for 
+		// shorts.
+		samples.resize((reply.size() - pos) / sizeof(short));
+
+		if (!samples.empty())
+		{
+			memcpy(&samples[0], reply.data() + pos, 
+				samples.size() * sizeof(short));
+		}
+
+		sampleRate = rate;
+		return true;
+	}
+
+	/// Returns the phrase cache's counters.  They are all 0 if the daemon 
+	/// was not initialized with the 'phraseCacheSize' option.
+	PhraseCacheStats getPhraseCacheStats()
+	{
+		PhraseCacheStats stats;
+		memset(&stats, 0, sizeof(stats));
+		std::string reply;
+		size_t pos = 0;
+
+		if (internal::call(internal::MSG_GET_PHRASE_CACHE_STATS, "", reply))
+		{
+			internal::readLong(reply, pos, stats.hits);
+			internal::readLong(reply, pos, stats.misses);
+			internal::readLong(reply, pos, stats.evictions);
+			internal::readLong(reply, pos, stats.bytes);
+			internal::readLong(reply, pos, stats.phrases);
+		}
+
+		return stats;
+	}
+
+	/// Renders phrases into the daemon's phrase cache in the background.  
+	/// Returns right away.
+	void preloadPhrases(const std::vector<std::string>& phrases)
+	{
+		std::string payload;
+		internal::appendInt(payload, (int)phrases.size());
+
+		for (size_t i = 0; i < phrases.size(); ++i)
+		{
+			internal::appendString(payload, phrases[i]);
+		}
+
+		internal::send(internal::MSG_PRELOAD_PHRASES, payload);
+	}
+
+	/// Returns the number of preloaded phrases that have not been 
+	/// rendered yet.
+	int getPreloadPendingCount()
+	{
+		return internal::callInt(internal::MSG_GET_PRELOAD_PENDING_COUNT, 
+			"", 0);
+	}
+
+	/// Returns the number of recognized strings currently in the 
+	/// recognizer's queue.
+	int getRecognizerQueueSize()
+	{
+		return internal::callInt(internal::MSG_GET_RECOGNIZER_QUEUE_SIZE, 
+			"", 0);
+	}
+
+	/// Returns the number of recognized strings dropped because the 
+	/// recognizer's queue was full.
+	long long getRecognizerDropCount()
+	{
+		std::string reply;
+		size_t pos = 0;
+		long long count = 0;
+
+		if (internal::call(internal::MSG_GET_RECOGNIZER_DROP_COUNT, "", 
+			reply))
+		{
+			internal::readLong(reply, pos, count);
+		}
+
+		return count;
+	}
+
+	/// Returns and removes the oldest recognized string from the 
+	/// recognizer's queue.
+	std::string popRecognizedString()
+	{
+		return internal::callString(internal::MSG_POP_RECOGNIZED_STRING, 
+			"");
+	}
+
+	/// Returns and removes the oldest recognized string, waiting up to 
+	/// 'timeoutMs' milliseconds for one to arrive.  Returns true and 
+	/// stores the string in 'str' if one was recognized in time.
+	bool waitForRecognizedString(std::string& str, int timeoutMs)
+	{
+		std::string payload;
+		internal::appendInt(payload, timeoutMs);
+		std::string reply;
+		size_t pos = 0;
+		int found = 0;
+
+		if (!internal::call(internal::MSG_WAIT_FOR_RECOGNIZED_STRING, 
+			payload, reply) || !internal::readInt(reply, pos, found) 
+			|| !found)
+		{
+			return false;
+		}
+
+		return internal::readString(reply, pos, str);
+	}
+
+	/// Removes all recognized strings from the recognizer's queue with a 
+	/// single request and stores them, oldest first, in 'strings'.  
+	/// Returns the number of strings.  Strings recognized while the 
+	/// queue is being emptied may be left for the next call.
+	size_t popAllRecognizedStrings(std::vector<std::string>& strings)
+	{
+		std::string reply;
+		size_t pos = 0;
+		int count = 0;
+		strings.clear();
+
+		if (!internal::call(internal::MSG_POP_ALL_RECOGNIZED_STRINGS, "", 
+			reply) || !internal::readInt(reply, pos, count))
+		{
+			return 0;
+		}
+
+		strings.resize(count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			if (!internal::readString(reply, pos, strings[i]))
+			{
+				strings.resize(i);
+				break;
+			}
+		}
+
+		return strings.size();
+	}
+
+	/// Has every recognized string passed to 'callback'.  In client mode 
+	/// the callback runs on a thread that waits on the daemon for 
+	/// recognized strings.  Passing NULL stops it.
+	void setRecognitionCallback(RecognitionCallback callback, 
+		void* userData = NULL)
+	{
+		internal::gRecognitionCallbackData = userData;
+		internal::gRecognitionCallback = callback;
+		internal::updateCallbackThread();
+	}
+
+	/// Does nothing in client mode; the daemon has its own delivery.  
+	/// popBufferedRecognizedString still works.
+	void setRecognitionBufferEnabled(bool /*e*/)
+	{
+	}
+
+	/// Returns and removes the oldest recognized string.  Returns true 
+	/// and stores the string in 'str' if there was one.  In client mode 
+	/// this asks the daemon, so it is no cheaper than 
+	/// popRecognizedString.
+	bool popBufferedRecognizedString(std::string& str)
+	{
+		std::string s = popRecognizedString();
+
+		if (s.empty())
+		{
+			return false;
+		}
+
+		str.swap(s);
+		return true;
+	}
+
+	/// Returns 0 in client mode, which has no recognition ring buffer.
+	unsigned int getRecognitionBufferDropCount()
+	{
+		return 0;
+	}
+
+	/// Returns and removes the oldest partial result.  Returns an empty 
+	/// string if there is none.
+	std::string popPartialResult()
+	{
+		return internal::callString(internal::MSG_POP_PARTIAL_RESULT, "");
+	}
+
+	/// Has every partial result passed to 'callback'.  In client mode 
+	/// the callback runs on a thread that polls the daemon.  Passing 
+	/// NULL stops it.
+	void setPartialResultCallback(RecognitionCallback callback, 
+		void* userData = NULL)
+	{
+		internal::gPartialResultCallbackData = userData;
+		internal::gPartialResultCallback = callback;
+		internal::updateCallbackThread();
+	}
+
+	/// Returns the average number of milliseconds by which the first 
+	/// partial result of an utterance came before its final result.
+	int getPartialResultLeadTime()
+	{
+		return internal::callInt(internal::MSG_GET_PARTIAL_RESULT_LEAD_TIME, 
+			"", 0);
+	}
+
+	/// Returns the number of threads the recognizer currently uses to 
+	/// score each audio frame.
+	int getScorerThreadCount()
+	{
+		return internal::callInt(internal::MSG_GET_SCORER_THREAD_COUNT, 
+			"", 0);
+	}
+
+	/// Recognizes the speech in an audio file and returns it.  The file 
+	/// is opened by the daemon, so relative paths are relative to the 
+	/// daemon's working directory.
+	std::string recognizeFile(const std::string& filename)
+	{
+		std::string payload;
+		internal::appendString(payload, filename);
+		return internal::callString(internal::MSG_RECOGNIZE_FILE, payload);
+	}
+
+	/// Hands 'count' samples to the daemon's 'audioInput=push' recognizer.  
+	/// The samples are sent without waiting for the daemon, so this 
+	/// returns 'count' (or 0 if they cannot be sent); samples the daemon 
+	/// drops are counted by getPushAudioOverflowCount.
+	size_t pushAudio(const short* samples, size_t count)
+	{
+		std::string payload;
+		internal::appendInt(payload, 0);
+
+		if (!internal::send(internal::MSG_PUSH_AUDIO, payload, samples, 
+			count * sizeof(short)))
+		{
+			return 0;
+		}
+
+		return count;
+	}
+
+	/// Returns the number of pushed samples the daemon dropped because 
+	/// its push audio buffer was full.
+	unsigned int getPushAudioOverflowCount()
+	{
+		return (unsigned int)internal::callInt(
+			internal::MSG_GET_PUSH_AUDIO_OVERFLOW_COUNT, "", 0);
+	}
+
+	/// Returns the number of times the daemon's recognizer ran out of 
+	/// pushed audio and had to wait for more.
+	unsigned int getPushAudioUnderrunCount()
+	{
+		return (unsigned int)internal::callInt(
+			internal::MSG_GET_PUSH_AUDIO_UNDERRUN_COUNT, "", 0);
+	}
+
+	/// Starts recognizing a new stream in the daemon.  Returns the 
+	/// stream's handle, or -1 if all streams are in use.
+	int createStream(const std::string& grammarName = "")
+	{
+		std::string payload;
+		internal::appendString(payload, grammarName);
+		return internal::callInt(internal::MSG_CREATE_STREAM, payload, -1);
+	}
+
+	/// Stops recognizing the given stream.
+	void destroyStream(int stream)
+	{
+		std::string payload;
+		internal::appendInt(payload, stream);
+		internal::send(internal::MSG_DESTROY_STREAM, payload);
+	}
+
+	/// Hands 'count' samples to the given stream's recognizer without 
+	/// waiting for the daemon.  Returns 'count', or 0 if they cannot be 
+	/// sent.
+	size_t pushAudio(int stream, const short* samples, size_t count)
+	{
+		std::string payload;
+		internal::appendInt(payload, stream);
+
+		if (!internal::send(internal::MSG_PUSH_AUDIO, payload, samples, 
+			count * sizeof(short)))
+		{
+			return 0;
+		}
+
+		return count;
+	}
+
+	/// Returns and removes the oldest string recognized in the given 
+	/// stream.  Returns an empty string if there is none.
+	std::string popResult(int stream)
+	{
+		std::string payload;
+		internal::appendInt(payload, stream);
+		return internal::callString(internal::MSG_POP_RESULT, payload);
+	}
+
+	/// Replaces the daemon's grammar.  Returns the time taken in 
+	/// milliseconds, or -1 on failure.
+	long long setGrammar(const std::string& grammarPath, 
+		const std::string& grammarName)
+	{
+		std::string payload;
+		internal::appendString(payload, grammarPath);
+		internal::appendString(payload, grammarName);
+		std::string reply;
+		size_t pos = 0;
+		long long duration = -1;
+
+		if (internal::call(internal::MSG_SET_GRAMMAR, payload, reply))
+		{
+			internal::readLong(reply, pos, duration);
+		}
+
+		return duration;
+	}
+
+	/// Enables and disables the daemon's speech recognizer.
+	void setRecognizerEnabled(bool e)
+	{
+		std::string payload;
+		internal::appendInt(payload, e ? 1 : 0);
+		internal::send(internal::MSG_SET_RECOGNIZER_ENABLED, payload);
+	}
+
+	/// Returns true if the daemon's recognizer is currently enabled.
+	bool isRecognizerEnabled()
+	{
+		return 0 != internal::callInt(internal::MSG_IS_RECOGNIZER_ENABLED, 
+			"", 0);
+	}
+#else
+	namespace internal
+	{
+		/// Global instance of the Java virtual machine.
+		JavaVM *gJVM = NULL;
+
+		/// Thread-local storage slot holding the JNI environment of each 
+		/// thread that Voce attached to the virtual machine.  A JNIEnv is 
+		/// only valid on the thread it belongs to, so every call looks up 
+		/// the calling thread's environment here instead of sharing one.
+#if defined(WIN32) || defined(_WIN32)
+		DWORD gEnvKey = FLS_OUT_OF_INDEXES;
+#else
+		pthread_key_t gEnvKey;
+		bool gEnvKeyCreated = false;
+#endif
+
+		/// The number of threads Voce attached to the virtual machine 
+		/// that have not exited yet.
+		volatile long gAttachedThreads = 0;
+
+		/// Global reference to the main Voce Java class.
+		jclass gClass = NULL;
+
+		/// Global references to the various Java method IDs.  Storing 
+		/// these saves lookup time later.
+		jmethodID gInitID = NULL;
+		jmethodID gDestroyID = NULL;
+		jmethodID gSynthesizeID = NULL;
+		jmethodID gIsSynthesizingID = NULL;
+		jmethodID gStopSynthesizingID = NULL;
+		jmethodID gSynthesizeToBufferID = NULL;
+		jmethodID gGetPhraseCacheStatsID = NULL;
+		jmethodID gPreloadPhrasesID = NULL;
+		jmethodID gGetPreloadPendingCountID = NULL;
+		jmethodID gGetRecognizerQueueSizeID = NULL;
+		jmethodID gGetRecognizerDropCountID = NULL;
+		jmethodID gPopRecognizedStringID = NULL;
+		jmethodID gPopAllRecognizedStringsID = NULL;
+		jmethodID gWaitForRecognizedStringID = NULL;
+		jmethodID gSetNativeRecognitionEnabledID = NULL;
+		jmethodID gRecognizeFileID = NULL;
+		jmethodID gPopPartialResultID = NULL;
+		jmethodID gGetPartialResultLeadTimeID = NULL;
+		jmethodID gSetNativePartialRecognitionEnabledID = NULL;
+		jmethodID gGetScorerThreadCountID = NULL;
+		jmethodID gSetGrammarID = NULL;
+		jmethodID gSetRecognizerEnabledID = NULL;
+		jmethodID gIsRecognizerEnabledID = NULL;
+		jmethodID gCreateStreamID = NULL;
+		jmethodID gDestroyStreamID = NULL;
+		jmethodID gPopStreamResultID = NULL;
+
+		/// The name of the main Voce Java class.
+		const std::string gClassName = "voce/SpeechInterface";
+
+		/// The user's recognition callback and its data pointer.  See 
+		/// setRecognitionCallback.
+		RecognitionCallback gRecognitionCallback = NULL;
+		void* gRecognitionCallbackData = NULL;
+
+		/// The user's partial result callback and its data pointer.  See 
+		/// setPartialResultCallback.
+		RecognitionCallback gPartialResultCallback = NULL;
+		void* gPartialResultCallbackData = NULL;
+
+		/// A lock-free ring buffer of recognized strings, written only by 
+		/// the recognition thread and read only by the application thread 
+		/// calling popBufferedRecognizedString.  'head' and 'tail' count 
+		/// strings read and written; the size must be a power of two.
+		const unsigned int gRecognitionBufferSize = 64;
+		std::string gRecognitionBuffer[gRecognitionBufferSize];
+		volatile unsigned int gRecognitionBufferHead = 0;
+		volatile unsigned int gRecognitionBufferTail = 0;
+		volatile unsigned int gRecognitionBufferDropCount = 0;
+		volatile bool gRecognitionBufferEnabled = false;
+
+		/// A lock-free ring buffer of audio samples, written by the 
+		/// application thread calling pushAudio and read in place by a 
+		/// recognition thread through a direct ByteBuffer (see 
+		/// PushAudioSource.java).  'read' and 'write' count samples; the 
+		/// size is a power of two.
+		struct PushAudioBuffer
+		{
+			short* samples;
+			unsigned int size;
+			volatile unsigned int read;
+			volatile unsigned int write;
+
+			/// The number of pushed samples dropped because the buffer 
+			/// was full, and the number of times the recognizer had to 
+			/// wait for more pushed audio.
+			volatile unsigned int overflowCount;
+			volatile unsigned int underrunCount;
+
+			/// True while the buffer's stream is in use (between 
+			/// createStream and destroyStream).  Not used by buffer 0.
+			volatile bool active;
+
+			/// Nonzero while a thread is pushing into the buffer or 
+			/// replacing it.  See lockPushAudio.
+			volatile long busy;
+		};
+
+		/// The push audio buffers.  Buffer 0 is used when Voce is 
+		/// initialized with the 'audioInput=push' option; the others 
+		/// belong to the streams created with the 'streams' option.  They 
+		/// only exist once Java has asked for them.
+		const unsigned int gMaxPushAudioBuffers = 256;
+		PushAudioBuffer gPushAudio[gMaxPushAudioBuffers];
+
+		/// Adds 'delta' to the number of attached threads.
+		void addAttachedThreads(long delta)
+		{
+#if defined(WIN32) || defined(_WIN32)
+			InterlockedExchangeAdd(&gAttachedThreads, delta);
+#else
+			__sync_fetch_and_add(&gAttachedThreads, delta);
+#endif
+		}
+
+		/// Called by the thread library when a thread exits.  Detaches 
+		/// threads that Voce attached to the virtual machine.
+#if defined(WIN32) || defined(_WIN32)
+		void WINAPI detachThread(void* env)
+#else
+		void detachThread(void* env)
+#endif
+		{
+			if (env && gJVM)
+			{
+				gJVM->DetachCurrentThread();
+				addAttachedThreads(-1);
+			}
+		}
+
+		/// Creates the thread-local storage slot used by getEnv.
+		bool createEnvKey()
+		{
+#if defined(WIN32) || defined(_WIN32)
+			// Fiber local storage is used instead of TlsAlloc because it 
+			// provides a callback when a thread exits (Windows Server 2003 
+			// and newer).
+			gEnvKey = FlsAlloc(detachThread);
+			return FLS_OUT_OF_INDEXES != gEnvKey;
+#else
+			gEnvKeyCreated = (0 == pthread_key_create(&gEnvKey, 
+				detachThread));
+			return gEnvKeyCreated;
+#endif
+		}
+
+		/// Destroys the thread-local storage slot used by getEnv.  Must 
+		/// only be called once the virtual machine is destroyed, since 
+		/// threads that exit after this are no longer detached.
+		void destroyEnvKey()
+		{
+#if defined(WIN32) || defined(_WIN32)
+			if (FLS_OUT_OF_INDEXES != gEnvKey)
+			{
+				// FlsFree runs the callback for the calling thread, which 
+				// must not detach it before the virtual machine is 
+				// destroyed.
+				FlsSetValue(gEnvKey, NULL);
+				FlsFree(gEnvKey);
+				gEnvKey = FLS_OUT_OF_INDEXES;
+			}
+#else
+			if (gEnvKeyCreated)
+			{
+				pthread_key_delete(gEnvKey);
+				gEnvKeyCreated = false;
+			}
+#endif
+		}
+
+		/// Returns the JNI environment for the calling thread, or NULL if 
+		/// Voce has not been initialized.  The first call from a new 
+		/// thread attaches it to the virtual machine; the thread is 
+		/// detached automatically when it exits.  Later calls are a 
+		/// single thread-local lookup with no locking.  Local references 
+		/// made on an attached thread are only freed when it detaches, so 
+		/// every caller deletes the ones it creates.
+		JNIEnv* getEnv()
+		{
+			if (!gJVM)
+			{
+				return NULL;
+			}
+
+#if defined(WIN32) || defined(_WIN32)
+			JNIEnv* env = (JNIEnv*)FlsGetValue(gEnvKey);
+#else
+			JNIEnv* env = (JNIEnv*)pthread_getspecific(gEnvKey);
+#endif
+
+			if (env)
+			{
+				return env;
+			}
+
+			// Threads that are already attached (the thread that created 
+			// the virtual machine, or Java threads calling back into 
+			// native code) are not ours to detach, so they are never 
+			// stored in the thread-local slot.
+			jint status = gJVM->GetEnv((void**)&env, JNI_VERSION_1_4);
+
+			if (JNI_OK == status)
+			{
+				return env;
+			}
+			else if (JNI_EDETACHED != status)
+			{
+				log("ERROR", "Cannot get the JNI environment for this "
+					"thread.");
+				return NULL;
+			}
+
+			if (gJVM->AttachCurrentThread((void**)&env, NULL) < 0)
+			{
+				log("ERROR", "Cannot attach this thread to the Java virtual "
+					"machine.");
+				return NULL;
+			}
+
+#if defined(WIN32) || defined(_WIN32)
+			FlsSetValue(gEnvKey, env);
+#else
+			pthread_setspecific(gEnvKey, env);
+#endif
+
+			addAttachedThreads(1);
+			return env;
+		}
+
+		/// A full memory barrier, used to order the ring buffer's slot and 
+		/// index updates between the two threads that share it.
+		void memoryBarrier()
+		{
+#if defined(WIN32) || defined(_WIN32)
+			MemoryBarrier();
+#else
+			__sync_synchronize();
+#endif
+		}
+
+		/// Tries to take a push audio buffer's busy flag.  Returns false 
+		/// if another thread holds it.
+		bool tryLockPushAudio(PushAudioBuffer& audio)
+		{
+#if defined(WIN32) || defined(_WIN32)
+			return 0 == InterlockedCompareExchange(&audio.busy, 1, 0);
+#else
+			return __sync_bool_compare_and_swap(&audio.busy, 0, 1);
+#endif
+		}
+
+		/// Takes a push audio buffer's busy flag, waiting for the thread 
+		/// pushing into it to finish.  Used when the buffer itself is 
+		/// replaced or freed, which only happens while the recognizer is 
+		/// being created or destroyed.
+		void lockPushAudio(PushAudioBuffer& audio)
+		{
+			while (!tryLockPushAudio(audio))
+			{
+#if defined(WIN32) || defined(_WIN32)
+				Sleep(1);
+#else
+				usleep(1000);
+#endif
+			}
+		}
+
+		/// Releases a push audio buffer's busy flag.
+		void unlockPushAudio(PushAudioBuffer& audio)
+		{
+			// Finish with the buffer before letting anyone replace it.
+			memoryBarrier();
+			audio.busy = 0;
+		}
+
+		/// Adds a string to the recognition ring buffer.  Only called from 
+		/// the recognition thread.  The newest string is dropped if the 
+		/// application has let the buffer fill up.
+		void pushBufferedString(const char* str)
+		{
+			unsigned int tail = gRecognitionBufferTail;
+
+			if (tail - gRecognitionBufferHead >= gRecognitionBufferSize)
+			{
+				++gRecognitionBufferDropCount;
+				return;
+			}
+
+			gRecognitionBuffer[tail & (gRecognitionBufferSize - 1)] = str;
+
+			// Publish the slot before the new tail.
+			memoryBarrier();
+			gRecognitionBufferTail = tail + 1;
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeStringRecognized.  Called by Java on the 
+		/// recognition thread for every recognized string once native 
+		/// delivery is enabled.
+		void JNICALL nativeStringRecognized(JNIEnv* env, jclass, 
+			jstring jstr)
+		{
+			const char* tempStr = env->GetStringUTFChars(jstr, 0);
+			RecognitionCallback callback = gRecognitionCallback;
+
+			if (callback)
+			{
+				// A local string, since stream threads and the main 
+				// recognition thread may all get here at once.
+				std::string str = tempStr;
+
+				// C++ exceptions must not propagate into the Java 
+				// virtual machine.
+				try
+				{
+					callback(str, gRecognitionCallbackData);
+				}
+				catch (...)
+				{
+					log("ERROR", "Exception thrown from recognition callback");
+				}
+			}
+			else if (gRecognitionBufferEnabled)
+			{
+				pushBufferedString(tempStr);
+			}
+
+			env->ReleaseStringUTFChars(jstr, tempStr);
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativePartialRecognized.  Called by Java on 
+		/// the recognition thread for every new partial result once a 
+		/// partial result callback is set.
+		void JNICALL nativePartialRecognized(JNIEnv* env, jclass, 
+			jstring jstr)
+		{
+			RecognitionCallback callback = gPartialResultCallback;
+
+			if (!callback)
+			{
+				return;
+			}
+
+			// A local string, since more than one recognition thread may 
+			// get here at once.
+			const char* tempStr = env->GetStringUTFChars(jstr, 0);
+			std::string str = tempStr;
+			env->ReleaseStringUTFChars(jstr, tempStr);
+
+			// C++ exceptions must not propagate into the Java virtual 
+			// machine.
+			try
+			{
+				callback(str, gPartialResultCallbackData);
+			}
+			catch (...)
+			{
+				log("ERROR", "Exception thrown from partial result callback");
+			}
+		}
+
+		/// Returns the push audio buffer for the given stream, or NULL 
+		/// if there is no such stream.
+		PushAudioBuffer* getPushAudioBuffer(int stream)
+		{
+			if (stream < 0 || stream >= (int)gMaxPushAudioBuffers)
+			{
+				return NULL;
+			}
+
+			return &gPushAudio[stream];
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeCreateAudioBuffer.  Called by Java while 
+		/// the recognizer is being created.  Allocates the stream's push 
+		/// audio buffer and wraps it in a direct ByteBuffer so Java can 
+		/// read the samples where they are.
+		jobject JNICALL nativeCreateAudioBuffer(JNIEnv* env, jclass, 
+			jint stream, jint samples)
+		{
+			PushAudioBuffer* audio = getPushAudioBuffer(stream);
+
+			if (!audio)
+			{
+				log("ERROR", "Too many push audio streams.");
+				return NULL;
+			}
+
+			unsigned int size = 1;
+
+			while (size < (unsigned int)samples)
+			{
+				size <<= 1;
+			}
+
+			// C++ exceptions must not propagate into the Java virtual 
+			// machine.
+			short* buffer = new (std::nothrow) short[size];
+
+			if (!buffer)
+			{
+				log("ERROR", "Push audio buffer cannot be allocated.");
+				return NULL;
+			}
+
+			memset(buffer, 0, size * sizeof(short));
+
+			// The application may be pushing into the old buffer, so 
+			// wait for it before freeing the old buffer.  Pushes that 
+			// arrive meanwhile are dropped rather than blocked.
+			lockPushAudio(*audio);
+			delete[] audio->samples;
+			audio->samples = buffer;
+			audio->size = size;
+			audio->read = 0;
+			audio->write = 0;
+			unlockPushAudio(*audio);
+
+			return env->NewDirectByteBuffer(buffer, 
+				(jlong)(size * sizeof(short)));
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeCreateSynthesisBuffer.  Called by Java 
+		/// from synthesizeToBuffer, on the thread that called 
+		/// voce::synthesizeToBuffer.  Resizes that call's sample vector, 
+		/// which 'buffer' points to, and wraps it in a direct ByteBuffer 
+		/// so Java can write the samples straight into it.
+		jobject JNICALL nativeCreateSynthesisBuffer(JNIEnv* env, jclass, 
+			jlong buffer, jint samples)
+		{
+			std::vector<short>* v = (std::vector<short>*)(size_t)buffer;
+
+			// C++ exceptions must not propagate into the Java virtual 
+			// machine.
+			try
+			{
+				v->resize(samples);
+			}
+			catch (std::exception&)
+			{
+				log("ERROR", "Synthesis buffer cannot be allocated.");
+				return NULL;
+			}
+
+			return env->NewDirectByteBuffer(&(*v)[0], 
+				(jlong)(samples * sizeof(short)));
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeAudioAvailable.  Called by Java on the 
+		/// stream's recognition thread.  Returns the number of pushed 
+		/// samples that have not been read yet.
+		jint JNICALL nativeAudioAvailable(JNIEnv*, jclass, 
+			jint stream, jint wanted)
+		{
+			PushAudioBuffer* audio = getPushAudioBuffer(stream);
+
+			if (!audio)
+			{
+				return 0;
+			}
+
+			unsigned int available = audio->write - audio->read;
+
+			// Make sure the samples are read only after seeing the write 
+			// index that published them.
+			memoryBarrier();
+
+			if (available < (unsigned int)wanted)
+			{
+				++audio->underrunCount;
+			}
+
+			return (jint)available;
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeAudioConsumed.  Called by Java on the 
+		/// stream's recognition thread once it has read 'count' samples.
+		void JNICALL nativeAudioConsumed(JNIEnv*, jclass, 
+			jint stream, jint count)
+		{
+			PushAudioBuffer* audio = getPushAudioBuffer(stream);
+
+			if (!audio)
+			{
+				return;
+			}
+
+			// Finish reading the samples before handing their space back 
+			// to the producer.
+			memoryBarrier();
+			audio->read = audio->read + (unsigned int)count;
+		}
+
+		/// Copies samples into a push audio buffer.  See voce::pushAudio.  
+		/// The samples are dropped if the buffer is being replaced.
+		size_t pushAudio(PushAudioBuffer& audio, const short* samples, 
+			size_t count)
+		{
+			if (!tryLockPushAudio(audio))
+			{
+				audio.overflowCount += (unsigned int)count;
+				return 0;
+			}
+
+			short* buffer = audio.samples;
+
+			if (!buffer)
+			{
+				unlockPushAudio(audio);
+				return 0;
+			}
+
+			unsigned int size = audio.size;
+			unsigned int write = audio.write;
+			size_t space = size - (write - audio.read);
+
+			// Make sure the reader is done with the free space before 
+			// overwriting it.
+			memoryBarrier();
+
+			size_t accepted = count;
+
+			if (accepted > space)
+			{
+				accepted = space;
+				audio.overflowCount += (unsigned int)(count - accepted);
+			}
+
+			// Copy the samples in at most two pieces, wrapping around the 
+			// end of the buffer.
+			size_t start = write & (size - 1);
+			size_t first = size - start;
+
+			if (first > accepted)
+			{
+				first = accepted;
+			}
+
+			memcpy(buffer + start, samples, first * sizeof(short));
+			memcpy(buffer, samples + first, 
+				(accepted - first) * sizeof(short));
+
+			// Publish the samples before the new write index.
+			memoryBarrier();
+			audio.write = write + (unsigned int)accepted;
+			unlockPushAudio(audio);
+
+			return accepted;
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeSetThreadAffinity.  Called by Java on 
+		/// each acoustic scoring thread to pin it to the CPUs in 'mask'.
+		jboolean JNICALL nativeSetThreadAffinity(JNIEnv*, jclass, 
+			jlong mask)
+		{
+#if defined(WIN32) || defined(_WIN32)
+			if (0 == SetThreadAffinityMask(GetCurrentThread(), 
+				(DWORD_PTR)mask))
+			{
+				return JNI_FALSE;
+			}
+
+			return JNI_TRUE;
+#elif defined(__linux__)
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+
+			// Shift an unsigned value, since shifting a 1 into the sign 
+			// bit of a jlong is undefined.
+			unsigned long long bits = (unsigned long long)mask;
+
+			for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu)
+			{
+				if (bits & (1ULL << cpu))
+				{
+					CPU_SET(cpu, &cpus);
+				}
+			}
+
+			if (0 != sched_setaffinity(0, sizeof(cpus), &cpus))
+			{
+				return JNI_FALSE;
+			}
+
+			return JNI_TRUE;
+#else
+			return JNI_FALSE;
+#endif
+		}
+
+		// The native front end (see NativeFeatureExtractor.java).  It does 
+		// the work of the Sphinx4 stages premphasizer, windower, fft, 
+		// melFilterBank, dct, liveCMN and featureExtraction in one pass 
+		// over each block of audio, using the same arithmetic in double 
+		// precision, so its features match theirs to within rounding. 
+		// The inner loops use AVX or SSE2 when the compiler targets them.
+
+		const double pi = 3.14159265358979323846;
+
+#if defined(__AVX__)
+		typedef __m256d SimdDouble;
+		const int simdWidth = 4;
+		inline SimdDouble simdLoad(const double* p) 
+			{return _mm256_loadu_pd(p);}
+		inline void simdStore(double* p, SimdDouble a) 
+			{_mm256_storeu_pd(p, a);}
+		inline SimdDouble simdSet(double x) {return _mm256_set1_pd(x);}
+		inline SimdDouble simdAdd(SimdDouble a, SimdDouble b) 
+			{return _mm256_add_pd(a, b);}
+		inline SimdDouble simdSub(SimdDouble a, SimdDouble b) 
+			{return _mm256_sub_pd(a, b);}
+		inline SimdDouble simdMul(SimdDouble a, SimdDouble b) 
+			{return _mm256_mul_pd(a, b);}
+		inline double simdSum(SimdDouble a)
+		{
+			double x[4];
+			_mm256_storeu_pd(x, a);
+			return (x[0] + x[1]) + (x[2] + x[3]);
+		}
+#elif defined(VOCE_SSE2)
+		typedef __m128d SimdDouble;
+		const int simdWidth = 2;
+		inline SimdDouble simdLoad(const double* p) {return _mm_loadu_pd(p);}
+		inline void simdStore(double* p, SimdDouble a) {_mm_storeu_pd(p, a);}
+		inline SimdDouble simdSet(double x) {return _mm_set1_pd(x);}
+		inline SimdDouble simdAdd(SimdDouble a, SimdDouble b) 
+			{return _mm_add_pd(a, b);}
+		inline SimdDouble simdSub(SimdDouble a, SimdDouble b) 
+			{return _mm_sub_pd(a, b);}
+		inline SimdDouble simdMul(SimdDouble a, SimdDouble b) 
+			{return _mm_mul_pd(a, b);}
+		inline double simdSum(SimdDouble a)
+		{
+			double x[2];
+			_mm_storeu_pd(x, a);
+			return x[0] + x[1];
+		}
+#else
+		typedef double SimdDouble;
+		const int simdWidth = 1;
+		inline SimdDouble simdLoad(const double* p) {return *p;}
+		inline void simdStore(double* p, SimdDouble a) {*p = a;}
+		inline SimdDouble simdSet(double x) {return x;}
+		inline SimdDouble simdAdd(SimdDouble a, SimdDouble b) {return a + b;}
+		inline SimdDouble simdSub(SimdDouble a, SimdDouble b) {return a - b;}
+		inline SimdDouble simdMul(SimdDouble a, SimdDouble b) {return a * b;}
+		inline double simdSum(SimdDouble a) {return a;}
+#endif
+
+		/// Returns the dot product of two arrays.
+		inline double simdDot(const double* a, const double* b, int count)
+		{
+			SimdDouble sum = simdSet(0);
+			int i = 0;
+
+			for (; i + simdWidth <= count; i += simdWidth)
+			{
+				sum = simdAdd(sum, simdMul(simdLoad(a + i), simdLoad(b + i)));
+			}
+
+			double result = simdSum(sum);
+
+			for (; i < count; ++i)
+			{
+				result += a[i] * b[i];
+			}
+
+			return result;
+		}
+
+		/// Multiplies two arrays element by element into 'out'.
+		inline void simdMultiply(const double* a, const double* b, 
+			double* out, int count)
+		{
+			int i = 0;
+
+			for (; i + simdWidth <= count; i += simdWidth)
+			{
+				simdStore(out + i, simdMul(simdLoad(a + i), simdLoad(b + i)));
+			}
+
+			for (; i < count; ++i)
+			{
+				out[i] = a[i] * b[i];
+			}
+		}
+
+		/// The settings of a FeatureExtractor, in the order Java passes 
+		/// them to nativeCreateFeatureExtractor.
+		enum FeatureSetting
+		{
+			SETTING_PREEMPHASIS_FACTOR,
+			SETTING_WINDOW_SIZE_MS,
+			SETTING_WINDOW_SHIFT_MS,
+			SETTING_ALPHA,
+			SETTING_NUMBER_FFT_POINTS,
+			SETTING_NUMBER_FILTERS,
+			SETTING_MIN_FREQUENCY,
+			SETTING_MAX_FREQUENCY,
+			SETTING_CEPSTRUM_LENGTH,
+			SETTING_INITIAL_MEAN,
+			SETTING_CMN_WINDOW,
+			SETTING_CMN_SHIFT_WINDOW,
+			SETTING_COUNT
+		};
+
+		/// Turns blocks of audio samples into feature vectors: cepstra 
+		/// followed by their first and second differences.  Not thread 
+		/// safe; each front end has its own.
+		class FeatureExtractor
+		{
+		public:
+			/// The number of cepstra on each side of the one whose 
+			/// differences are computed, as in Sphinx4's 
+			/// DeltasFeatureExtractor.
+			static const int deltaWindow = 3;
+
+			FeatureExtractor(int sampleRate, const double* settings)
+			{
+				mPreemphasisFactor = settings[SETTING_PREEMPHASIS_FACTOR];
+				mWindowSize = (int)((float)sampleRate 
+					* (float)settings[SETTING_WINDOW_SIZE_MS] / 1000.0f);
+				mWindowShift = (int)((float)sampleRate 
+					* (float)settings[SETTING_WINDOW_SHIFT_MS] / 1000.0f);
+				mFftSize = (int)settings[SETTING_NUMBER_FFT_POINTS];
+
+				if (mFftSize <= 0)
+				{
+					mFftSize = mWindowSize;
+				}
+
+				int size = 4;
+
+				while (size < mFftSize)
+				{
+					size <<= 1;
+				}
+
+				mFftSize = size;
+				mNumFilters = (int)settings[SETTING_NUMBER_FILTERS];
+				mCepstrumLength = (int)settings[SETTING_CEPSTRUM_LENGTH];
+				mInitialMean = settings[SETTING_INITIAL_MEAN];
+				mCmnWindow = (int)settings[SETTING_CMN_WINDOW];
+				mCmnShiftWindow = (int)settings[SETTING_CMN_SHIFT_WINDOW];
+
+				createWindow(settings[SETTING_ALPHA]);
+				createFft();
+				createMelFilters(sampleRate, 
+					settings[SETTING_MIN_FREQUENCY], 
+					settings[SETTING_MAX_FREQUENCY]);
+				createDct();
+
+				mMean.assign(mCepstrumLength, 0);
+				mMean[0] = mInitialMean;
+				mSum.assign(mCepstrumLength, 0);
+				mCmnFrameCount = 0;
+				mCepstra.assign((2 * deltaWindow + 1) * mCepstrumLength, 0);
+				mPriorSample = 0;
+				mHasNewSamples = false;
+				mCepstrumCount = 0;
+			}
+
+			/// Returns the number of values in each feature vector.
+			int getFeatureLength() const
+			{
+				return 3 * mCepstrumLength;
+			}
+
+			/// Processes a block of samples and writes a feature vector for 
+			/// each frame it completes to 'features'.  Returns the number 
+			/// of feature vectors written.
+			int extract(const double* samples, int count, float* features)
+			{
+				if (count <= 0)
+				{
+					return 0;
+				}
+
+				// Pre-emphasize the samples onto the ones left over from 
+				// the last block.
+				size_t start = mSamples.size();
+				mSamples.resize(start + count);
+				double* out = &mSamples[start];
+				out[0] = samples[0] - mPreemphasisFactor * mPriorSample;
+				SimdDouble factor = simdSet(mPreemphasisFactor);
+				int i = 1;
+
+				for (; i + simdWidth <= count; i += simdWidth)
+				{
+					simdStore(out + i, simdSub(simdLoad(samples + i), 
+						simdMul(factor, simdLoad(samples + i - 1))));
+				}
+
+				for (; i < count; ++i)
+				{
+					out[i] = samples[i] - mPreemphasisFactor 
+						* samples[i - 1];
+				}
+
+				mPriorSample = samples[count - 1];
+
+				// Like the Java windower, wait for a full window before 
+				// cutting any.
+				int total = (int)mSamples.size();
+
+				if (total < mWindowSize)
+				{
+					mHasNewSamples = true;
+					return 0;
+				}
+
+				mHasNewSamples = false;
+				int written = 0;
+				int offset = 0;
+
+				for (; offset + mWindowSize <= total; offset += mWindowShift)
+				{
+					written += processWindow(&mSamples[offset], mWindowSize, 
+						features + written * getFeatureLength());
+				}
+
+				mSamples.erase(mSamples.begin(), mSamples.begin() + offset);
+				return written;
+			}
+
+			/// Ends the current utterance: processes the samples left over, 
+			/// writes the remaining feature vectors to 'features' and 
+			/// returns their number, which is at most 
+			/// getEndFeatureCount().
+			int endUtterance(float* features)
+			{
+				int written = 0;
+				int length = getFeatureLength();
+
+				// The Java windower pads the samples it is still 
+				// collecting into one window, keeps what follows its 
+				// shift, and then pads those into one more.
+				if (mHasNewSamples)
+				{
+					int total = (int)mSamples.size();
+					written += processWindow(&mSamples[0], total, features);
+
+					if (total > mWindowShift)
+					{
+						mSamples.erase(mSamples.begin(), 
+							mSamples.begin() + mWindowShift);
+					}
+					else
+					{
+						mSamples.clear();
+					}
+				}
+
+				written += processWindow(mSamples.empty() ? NULL 
+					: &mSamples[0], (int)mSamples.size(), 
+					features + written * length);
+
+				// Repeat the last cepstrum to finish the differences.
+				if (mCepstrumCount > 0)
+				{
+					std::vector<double> last(mCepstra.end() - mCepstrumLength, 
+						mCepstra.end());
+
+					for (int i = 0; i < deltaWindow; ++i)
+					{
+						written += addCepstrum(&last[0], 
+							features + written * length);
+					}
+				}
+
+				updateCmn();
+				mSamples.clear();
+				mPriorSample = 0;
+				mHasNewSamples = false;
+				mCepstrumCount = 0;
+				return written;
+			}
+
+			/// Returns the largest number of feature vectors endUtterance 
+			/// can write.
+			int getEndFeatureCount() const
+			{
+				return 2 + deltaWindow;
+			}
+
+			/// Returns the largest number of feature vectors extract can 
+			/// write for a block of 'count' samples.
+			int getFeatureCount(int count) const
+			{
+				return (count + mWindowSize) / mWindowShift + 1;
+			}
+
+		private: 
+			/// Creates the raised cosine (Hamming, for the default alpha) 
+			/// window.
+			void createWindow(double alpha)
+			{
+				mWindow.resize(mWindowSize);
+
+				for (int i = 0; i < mWindowSize; ++i)
+				{
+					mWindow[i] = (1 - alpha) - alpha 
+						* std::cos(2 * pi * i / (mWindowSize - 1.0));
+				}
+
+				mFrame.resize(mWindowSize);
+			}
+
+			/// Creates the tables of the FFT.  A real FFT of mFftSize 
+			/// points is done as a complex FFT of half that size, whose 
+			/// result is then split into the spectrum of the even and odd 
+			/// samples.
+			void createFft()
+			{
+				int half = mFftSize / 2;
+				mFftReal.resize(half);
+				mFftImag.resize(half);
+				mBitReverse.resize(half);
+				int bits = 0;
+
+				while ((1 << bits) < half)
+				{
+					++bits;
+				}
+
+				for (int i = 0; i < half; ++i)
+				{
+					int r = 0;
+
+					for (int b = 0; b < bits; ++b)
+					{
+						r |= ((i >> b) & 1) << (bits - 1 - b);
+					}
+
+					mBitReverse[i] = r;
+				}
+
+				// The twiddle factors of each stage, one after the other, 
+				// so that a stage's butterflies read them in order.
+				mTwiddleReal.resize(half);
+				mTwiddleImag.resize(half);
+
+				for (int span = 1; span < half; span <<= 1)
+				{
+					for (int j = 0; j < span; ++j)
+					{
+						mTwiddleReal[span + j] = std::cos(pi * j / span);
+						mTwiddleImag[span + j] = -std::sin(pi * j / span);
+					}
+				}
+
+				mSplitReal.resize(half + 1);
+				mSplitImag.resize(half + 1);
+
+				for (int k = 0; k <= half; ++k)
+				{
+					mSplitReal[k] = std::cos(2 * pi * k / mFftSize);
+					mSplitImag[k] = -std::sin(2 * pi * k / mFftSize);
+				}
+
+				mSpectrum.resize(half + 1);
+			}
+
+			/// Rounds a frequency to the nearest FFT bin, as Sphinx4's 
+			/// MelFrequencyFilterBank does.
+			static double nearestBin(double frequency, double binSize)
+			{
+				return binSize * std::floor(frequency / binSize + 0.5);
+			}
+
+			static double linearToMel(double frequency)
+			{
+				return 2595.0 * std::log(1.0 + frequency / 700.0) 
+					/ std::log(10.0);
+			}
+
+			static double melToLinear(double mel)
+			{
+				return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+			}
+
+			/// Creates the triangular mel filters exactly as Sphinx4's 
+			/// MelFrequencyFilterBank and MelFilter do.
+			void createMelFilters(int sampleRate, double minFrequency, 
+				double maxFrequency)
+			{
+				double binSize = (double)sampleRate / mFftSize;
+				std::vector<double> left(mNumFilters);
+				std::vector<double> center(mNumFilters);
+				std::vector<double> right(mNumFilters);
+
+				double minMel = linearToMel(minFrequency);
+				double maxMel = linearToMel(maxFrequency);
+				double deltaMel = (maxMel - minMel) / (mNumFilters + 1);
+				double currentMel = minMel;
+				left[0] = nearestBin(minFrequency, binSize);
+
+				for (int i = 0; i < mNumFilters; ++i)
+				{
+					currentMel += deltaMel;
+					center[i] = nearestBin(melToLinear(currentMel), binSize);
+
+					if (i > 0)
+					{
+						right[i - 1] = center[i];
+					}
+
+					if (i < mNumFilters - 1)
+					{
+						left[i + 1] = center[i];
+					}
+				}
+
+				right[mNumFilters - 1] = nearestBin( 
+					melToLinear(currentMel + deltaMel), binSize);
+
+				mFilterStart.resize(mNumFilters);
+				mFilterOffset.resize(mNumFilters);
+				mFilterLength.resize(mNumFilters);
+				mFilterWeights.clear();
+
+				for (int i = 0; i < mNumFilters; ++i)
+				{
+					double initial = nearestBin(left[i], binSize);
+
+					if (initial < left[i])
+					{
+						initial += binSize;
+					}
+
+					int count = (int)std::floor((right[i] - left[i]) / binSize 
+						+ 1.0 + 0.5);
+					double height = 2.0 / (right[i] - left[i]);
+					double leftSlope = height / (center[i] - left[i]);
+					double rightSlope = height / (center[i] - right[i]);
+
+					mFilterStart[i] = (int)std::floor(initial / binSize + 0.5);
+					mFilterOffset[i] = (int)mFilterWeights.size();
+					mFilterWeights.resize(mFilterWeights.size() + count, 0);
+					double* weights = &mFilterWeights[mFilterOffset[i]];
+					int j = 0;
+
+					for (double f = initial; f <= right[i] && j < count; 
+						f += binSize, ++j)
+					{
+						if (f < center[i])
+						{
+							weights[j] = leftSlope * (f - left[i]);
+						}
+						else
+						{
+							weights[j] = height + rightSlope * (f - center[i]);
+						}
+					}
+
+					// Skip the bins past the end of the spectrum.
+					int bins = mFftSize / 2 + 1 - mFilterStart[i];
+					mFilterLength[i] = count < bins ? count : bins;
+				}
+
+				mMel.resize(mNumFilters);
+			}
+
+			/// Creates the DCT table.  The first column is halved here 
+			/// instead of halving the first log energy of every frame.
+			void createDct()
+			{
+				mDct.resize(mCepstrumLength * mNumFilters);
+
+				for (int i = 0; i < mCepstrumLength; ++i)
+				{
+					double frequency = 2 * pi * i / (2.0 * mNumFilters);
+
+					for (int j = 0; j < mNumFilters; ++j)
+					{
+						mDct[i * mNumFilters + j] = 
+							std::cos(frequency * (j + 0.5));
+					}
+
+					mDct[i * mNumFilters] *= 0.5;
+				}
+
+				mCepstrum.resize(mCepstrumLength);
+			}
+
+			/// Computes the power spectrum of mFrame into mSpectrum.
+			void computeSpectrum()
+			{
+				int half = mFftSize / 2;
+				double* re = &mFftReal[0];
+				double* im = &mFftImag[0];
+
+				// Fold a window longer than the FFT onto it, and pad a 
+				// shorter one with zeros.
+				std::vector<double>& input = mFftInput;
+				input.assign(mFftSize, 0);
+
+				for (int i = 0; i < mWindowSize; ++i)
+				{
+					input[i % mFftSize] += mFrame[i];
+				}
+
+				for (int i = 0; i < half; ++i)
+				{
+					re[mBitReverse[i]] = input[2 * i];
+					im[mBitReverse[i]] = input[2 * i + 1];
+				}
+
+				for (int span = 1; span < half; span <<= 1)
+				{
+					const double* wr = &mTwiddleReal[span];
+					const double* wi = &mTwiddleImag[span];
+
+					for (int block = 0; block < half; block += 2 * span)
+					{
+						double* ar = re + block;
+						double* ai = im + block;
+						double* br = ar + span;
+						double* bi = ai + span;
+						int j = 0;
+
+						for (; j + simdWidth <= span; j += simdWidth)
+						{
+							SimdDouble xr = simdLoad(br + j);
+							SimdDouble xi = simdLoad(bi + j);
+							SimdDouble cr = simdLoad(wr + j);
+							SimdDouble ci = simdLoad(wi + j);
+							SimdDouble tr = simdSub(simdMul(xr, cr), 
+								simdMul(xi, ci));
+							SimdDouble ti = simdAdd(simdMul(xr, ci), 
+								simdMul(xi, cr));
+							SimdDouble yr = simdLoad(ar + j);
+							SimdDouble yi = simdLoad(ai + j);
+							simdStore(ar + j, simdAdd(yr, tr));
+							simdStore(ai + j, simdAdd(yi, ti));
+							simdStore(br + j, simdSub(yr, tr));
+							simdStore(bi + j, simdSub(yi, ti));
+						}
+
+						for (; j < span; ++j)
+						{
+							double tr = br[j] * wr[j] - bi[j] * wi[j];
+							double ti = br[j] * wi[j] + bi[j] * wr[j];
+							br[j] = ar[j] - tr;
+							bi[j] = ai[j] - ti;
+							ar[j] += tr;
+							ai[j] += ti;
+						}
+					}
+				}
+
+				for (int k = 0; k <= half; ++k)
+				{
+					int a = k % half;
+					int b = (half - k) % half;
+					double evenReal = 0.5 * (re[a] + re[b]);
+					double evenImag = 0.5 * (im[a] - im[b]);
+					double oddReal = 0.5 * (im[a] + im[b]);
+					double oddImag = -0.5 * (re[a] - re[b]);
+					double real = evenReal + mSplitReal[k] * oddReal 
+						- mSplitImag[k] * oddImag;
+					double imag = evenImag + mSplitReal[k] * oddImag 
+						+ mSplitImag[k] * oddReal;
+					mSpectrum[k] = real * real + imag * imag;
+				}
+			}
+
+			/// Windows 'count' pre-emphasized samples, padded with zeros 
+			/// to a full window, turns them into a cepstrum and adds it to 
+			/// the utterance.  Returns the number of feature vectors 
+			/// written to 'features' (0 or 1).
+			int processWindow(const double* samples, int count, 
+				float* features)
+			{
+				if (count < mWindowSize)
+				{
+					mFrame.assign(mWindowSize, 0.0);
+
+					if (count > 0)
+					{
+						simdMultiply(samples, &mWindow[0], &mFrame[0], count);
+					}
+				}
+				else
+				{
+					simdMultiply(samples, &mWindow[0], &mFrame[0], 
+						mWindowSize);
+				}
+
+				computeSpectrum();
+
+				for (int i = 0; i < mNumFilters; ++i)
+				{
+					double energy = 0;
+
+					if (mFilterLength[i] > 0)
+					{
+						energy = simdDot(&mSpectrum[mFilterStart[i]], 
+							&mFilterWeights[mFilterOffset[i]], 
+							mFilterLength[i]);
+					}
+
+					mMel[i] = energy > 0 ? std::log(energy) : -1.0e5;
+				}
+
+				for (int i = 0; i < mCepstrumLength; ++i)
+				{
+					mCepstrum[i] = simdDot(&mDct[i * mNumFilters], &mMel[0], 
+						mNumFilters) / mNumFilters;
+				}
+
+				normalize(&mCepstrum[0]);
+
+				if (0 == mCepstrumCount)
+				{
+					// The differences at the start of an utterance treat 
+					// the first cepstrum as repeated.
+					for (int i = 0; i < deltaWindow; ++i)
+					{
+						addCepstrum(&mCepstrum[0], features);
+					}
+				}
+
+				return addCepstrum(&mCepstrum[0], features);
+			}
+
+			/// Subtracts the running cepstral mean, as Sphinx4's LiveCMN 
+			/// does.
+			void normalize(double* cepstrum)
+			{
+				for (int i = 0; i < mCepstrumLength; ++i)
+				{
+					mSum[i] += cepstrum[i];
+					cepstrum[i] -= mMean[i];
+				}
+
+				if (++mCmnFrameCount > mCmnShiftWindow)
+				{
+					updateCmn();
+				}
+			}
+
+			void updateCmn()
+			{
+				if (mCmnFrameCount <= 0)
+				{
+					return;
+				}
+
+				double scale = 1.0 / mCmnFrameCount;
+
+				for (int i = 0; i < mCepstrumLength; ++i)
+				{
+					mMean[i] = mSum[i] * scale;
+				}
+
+				if (mCmnFrameCount >= mCmnShiftWindow)
+				{
+					for (int i = 0; i < mCepstrumLength; ++i)
+					{
+						mSum[i] = mSum[i] * scale * mCmnWindow;
+					}
+
+					mCmnFrameCount = mCmnWindow;
+				}
+			}
+
+			/// Adds a cepstrum to the last 2 * deltaWindow + 1, and writes 
+			/// the feature vector of the middle one once there are that 
+			/// many.  Returns the number of feature vectors written.
+			int addCepstrum(const double* cepstrum, float* features)
+			{
+				int length = mCepstrumLength;
+				memmove(&mCepstra[0], &mCepstra[length], 
+					(mCepstra.size() - length) * sizeof(double));
+				memcpy(&mCepstra[mCepstra.size() - length], cepstrum, 
+					length * sizeof(double));
+
+				if (++mCepstrumCount < 2 * deltaWindow + 1)
+				{
+					return 0;
+				}
+
+				const double* c = &mCepstra[0];
+
+				for (int i = 0; i < length; ++i)
+				{
+					features[i] = (float)c[3 * length + i];
+					features[length + i] = (float)(c[5 * length + i] 
+						- c[1 * length + i]);
+					features[2 * length + i] = (float)((c[6 * length + i] 
+						- c[2 * length + i]) - (c[4 * length + i] - c[i]));
+				}
+
+				return 1;
+			}
+
+			double mPreemphasisFactor;
+			int mWindowSize;
+			int mWindowShift;
+			int mFftSize;
+			int mNumFilters;
+			int mCepstrumLength;
+			double mInitialMean;
+			int mCmnWindow;
+			int mCmnShiftWindow;
+
+			/// Pre-emphasis and windowing state.
+			double mPriorSample;
+			std::vector<double> mSamples;
+			bool mHasNewSamples;
+			std::vector<double> mWindow;
+			std::vector<double> mFrame;
+
+			/// FFT tables and buffers.
+			std::vector<int> mBitReverse;
+			std::vector<double> mTwiddleReal;
+			std::vector<double> mTwiddleImag;
+			std::vector<double> mSplitReal;
+			std::vector<double> mSplitImag;
+			std::vector<double> mFftInput;
+			std::vector<double> mFftReal;
+			std::vector<double> mFftImag;
+			std::vector<double> mSpectrum;
+
+			/// Mel filters, stored one after the other in mFilterWeights.
+			std::vector<int> mFilterStart;
+			std::vector<int> mFilterOffset;
+			std::vector<int> mFilterLength;
+			std::vector<double> mFilterWeights;
+			std::vector<double> mMel;
+
+			/// DCT table, mCepstrumLength rows of mNumFilters.
+			std::vector<double> mDct;
+			std::vector<double> mCepstrum;
+
+			/// Cepstral mean normalization state, kept across utterances.
+			std::vector<double> mMean;
+			std::vector<double> mSum;
+			int mCmnFrameCount;
+
+			/// The last 2 * deltaWindow + 1 cepstra of the utterance.
+			std::vector<double> mCepstra;
+			int mCepstrumCount;
+		};
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeCreateFeatureExtractor.  Returns a handle 
+		/// to a new FeatureExtractor, or 0 if it cannot be created.
+		jlong JNICALL nativeCreateFeatureExtractor(JNIEnv* env, jclass, 
+			jint sampleRate, jdoubleArray settings)
+		{
+			if (env->GetArrayLength(settings) < SETTING_COUNT)
+			{
+				log("ERROR", "Too few native front end settings.");
+				return 0;
+			}
+
+			double values[SETTING_COUNT];
+			env->GetDoubleArrayRegion(settings, 0, SETTING_COUNT, values);
+
+			// C++ exceptions must not propagate into the Java virtual 
+			// machine.
+			try
+			{
+				return (jlong)(size_t)new FeatureExtractor(sampleRate, values);
+			}
+			catch (std::exception&)
+			{
+				log("ERROR", "Native front end cannot be created.");
+				return 0;
+			}
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeExtractFeatures.  Called by Java on the 
+		/// recognition thread with each block of audio.  Returns the 
+		/// number of feature vectors written to 'features'.
+		jint JNICALL nativeExtractFeatures(JNIEnv* env, jclass, 
+			jlong handle, jdoubleArray samples, jint count, 
+			jfloatArray features)
+		{
+			FeatureExtractor* extractor = (FeatureExtractor*)(size_t)handle;
+
+			if (!extractor || count <= 0)
+			{
+				return 0;
+			}
+
+			if (env->GetArrayLength(features) < 
+				extractor->getFeatureCount(count)
+				* extractor->getFeatureLength())
+			{
+				log("ERROR", "Native front end output array is too small.");
+				return 0;
+			}
+
+			// Neither array can move while the frames are computed.
+			double* in = (double*)env->GetPrimitiveArrayCritical(samples, 
+				NULL);
+			float* out = (float*)env->GetPrimitiveArrayCritical(features, 
+				NULL);
+			jint written = 0;
+
+			if (in && out)
+			{
+				try
+				{
+					written = extractor->extract(in, count, out);
+				}
+				catch (std::exception&)
+				{
+					written = 0;
+				}
+			}
+
+			if (out)
+			{
+				env->ReleasePrimitiveArrayCritical(features, out, 0);
+			}
+
+			if (in)
+			{
+				env->ReleasePrimitiveArrayCritical(samples, in, JNI_ABORT);
+			}
+
+			return written;
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeEndFeatureUtterance.  Returns the number 
+		/// of feature vectors written to 'features'.
+		jint JNICALL nativeEndFeatureUtterance(JNIEnv* env, jclass, 
+			jlong handle, jfloatArray features)
+		{
+			FeatureExtractor* extractor = (FeatureExtractor*)(size_t)handle;
+
+			if (!extractor)
+			{
+				return 0;
+			}
+
+			if (env->GetArrayLength(features) < 
+				extractor->getEndFeatureCount()
+				* extractor->getFeatureLength())
+			{
+				log("ERROR", "Native front end output array is too small.");
+				return 0;
+			}
+
+			float* out = (float*)env->GetPrimitiveArrayCritical(features, 
+				NULL);
+			jint written = 0;
+
+			if (out)
+			{
+				try
+				{
+					written = extractor->endUtterance(out);
+				}
+				catch (std::exception&)
+				{
+					written = 0;
+				}
+
+				env->ReleasePrimitiveArrayCritical(features, out, 0);
+			}
+
+			return written;
+		}
+
+		/// The native implementation of 
+		/// SpeechInterface.nativeDestroyFeatureExtractor.
+		void JNICALL nativeDestroyFeatureExtractor(JNIEnv*, jclass, 
+			jlong handle)
+		{
+			delete (FeatureExtractor*)(size_t)handle;
+		}
+
+		/// Checks whether the Java call just made by 'function' threw an 
+		/// exception.  If so, prints and clears it, since no other JNI 
+		/// call may be made while it is pending, and returns true.
+		bool checkException(JNIEnv* env, const std::string& function)
+		{
+			if (!env->ExceptionCheck())
+			{
+				return false;
+			}
+
+			log("ERROR", "Java exception thrown in " + function + ":");
+			env->ExceptionDescribe();
+			env->ExceptionClear();
+			return true;
+		}
+
+		/// Registers the native methods declared in the main Voce Java 
+		/// class.
+		bool registerNatives(JNIEnv* env)
+		{
+			JNINativeMethod methods[] = 
+			{
+				{(char*)"nativeStringRecognized", 
+					(char*)"(Ljava/lang/String;)V", 
+					(void*)nativeStringRecognized}, 
+				{(char*)"nativePartialRecognized", 
+					(char*)"(Ljava/lang/String;)V", 
+					(void*)nativePartialRecognized}, 
+				{(char*)"nativeCreateAudioBuffer", 
+					(char*)"(II)Ljava/nio/ByteBuffer;", 
+					(void*)nativeCreateAudioBuffer}, 
+				{(char*)"nativeCreateSynthesisBuffer", 
+					(char*)"(JI)Ljava/nio/ByteBuffer;", 
+					(void*)nativeCreateSynthesisBuffer}, 
+				{(char*)"nativeAudioAvailable", (char*)"(II)I", 
+					(void*)nativeAudioAvailable}, 
+				{(char*)"nativeAudioConsumed", (char*)"(II)V", 
+					(void*)nativeAudioConsumed}, 
+				{(char*)"nativeSetThreadAffinity", (char*)"(J)Z", 
+					(void*)nativeSetThreadAffinity}, 
+				{(char*)"nativeCreateFeatureExtractor", (char*)"(I[D)J", 
+					(void*)nativeCreateFeatureExtractor}, 
+				{(char*)"nativeExtractFeatures", (char*)"(J[DI[F)I", 
+					(void*)nativeExtractFeatures}, 
+				{(char*)"nativeEndFeatureUtterance", (char*)"(J[F)I", 
+					(void*)nativeEndFeatureUtterance}, 
+				{(char*)"nativeDestroyFeatureExtractor", (char*)"(J)V", 
+					(void*)nativeDestroyFeatureExtractor}
+			};
+
+			if (env->RegisterNatives(gClass, methods, 
+				sizeof(methods) / sizeof(methods[0])) < 0)
+			{
+				checkException(env, "registerNatives");
+				log("ERROR", "Native methods cannot be registered.  Make \
+sure voce.jar is up to date with voce.h.");
+				return false;
+			}
+
+			return true;
+		}
+
+		/// Tells Java whether recognized strings should be sent to the 
+		/// native handler: they are if either a callback is set or the 
+		/// ring buffer is enabled.
+		void updateNativeRecognition(JNIEnv* env)
+		{
+			jboolean enabled = (gRecognitionCallback || 
+				gRecognitionBufferEnabled) ? JNI_TRUE : JNI_FALSE;
+
+			env->CallStaticVoidMethod(gClass, 
+				gSetNativeRecognitionEnabledID, enabled);
+			checkException(env, "setNativeRecognitionEnabled");
+		}
+
+		/// The number of method IDs loadJavaMethodID could not find since 
+		/// init started.
+		int gMissingMethodCount = 0;
+
+		/// Undoes a failed init: forgets the main Voce class and destroys 
+		/// the virtual machine, leaving Voce uninitialized.
+		void abortInit(JNIEnv* env)
+		{
+			if (gClass)
+			{
+				env->DeleteGlobalRef((jobject)gClass);
+				gClass = NULL;
+			}
+
+			gJVM->DestroyJavaVM();
+			gJVM = NULL;
+			destroyEnvKey();
+		}
+
+		/// Finds and returns a method ID for the given function name and 
+		/// Java method signature.
+		jmethodID loadJavaMethodID(const std::string& functionName, 
+			const std::string& functionSignature)
+		{
+			JNIEnv* env = getEnv();
+
+			if (!env)
+			{
+				log("ERROR", "Method ID cannot be found for function: " 
+					+ functionName + " before initialization.");
+				return 0;
+			}
+
+			// Call the JNI function GetStaticMethodID, which performs a 
+			// lookup for the given Java method.  The lookup is based on 
+			// the name of the method as well as the method signature.  If 
+			// the method does not exist, GetStaticMethodID 
+			// returns zero (0). An immediate return from the native method 
+			// at that point causes a NoSuchMethodError to be thrown in the 
+			// Java application code.  Note that the JNI uses the method 
+			// signature to denote the return type of a Java method. The 
+			// signature (I)V, for example, denotes a Java method that takes 
+			// one argument of type int and has a return type void. The 
+			// general form of a method signature argument is: 
+			// "(argument-types)return-type".
+			jmethodID methodID = env->GetStaticMethodID(gClass, 
+				functionName.c_str(), functionSignature.c_str());
+
+			if (0 == methodID)
+			{
+				// The lookup leaves a NoSuchMethodError pending.
+				checkException(env, "GetStaticMethodID");
+				++gMissingMethodCount;
+				log("ERROR", "Invalid Java method ID requested for: " 
+					+ functionName + ".  Make sure voce.jar is up to date \
+with voce.h.");
+				return 0;
+			}
+
+			return methodID;
+		}
+	}
+
+	/// Initializes Voce.  This function performs some extra stuff needed 
+	/// to setup the Java virtual machine and cache the Java method IDs.  
+	/// The 'vocePath' argument is the path to the Voce class files and 
+	/// config file.  This path can be absolute or relative to the 
+	/// working directory of the executable using Voce.  See documentation 
+	/// for the Java version for an explanation of the rest of the 
+	/// parameters, including the list of supported 'options'.
+	void init(const std::string& vocePath, bool initSynthesis, 
+		bool initRecognition, const std::string& grammarPath, 
+		const std::string& grammarName, const std::string& options = "")
+	{
+		// Setup the Java virtual machine.
+		JNIEnv* env = NULL;
+		JavaVMInitArgs vm_args;
+		memset(&vm_args, 0, sizeof(vm_args));
+		vm_args.version = JNI_VERSION_1_4;
+
+		long status = 0;
+
+		// If recognition is being used, we need to increase the max heap 
+		// size.
+		if (initRecognition)
+		{
+			vm_args.nOptions = 2;
+
+			// The max heap size can be lowered when the dictionary is 
+			// pruned or memory-mapped.
+			std::string maxHeap = 
+				internal::parseOptions(options)["maxHeap"];
+
+			if (maxHeap.empty())
+			{
+				maxHeap = "256m";
+			}
+
+			// Setup the VM options.
+			// TODO: check out other options to be used here, like disabling the 
+			// JIT compiler.
+			JavaVMOption vmOptions[2];
+
+			// Add the required Java class paths.  JavaVMOption wants 
+			// writable strings, so the options are copied into vectors, 
+			// which hold paths and sizes of any length.
+			std::string classPathString = "-Djava.class.path=";
+			classPathString += vocePath;
+			classPathString += "/voce.jar";
+			std::vector<char> classPath(classPathString.begin(), 
+				classPathString.end());
+			classPath.push_back('\0');
+			vmOptions[0].optionString = &classPath[0];
+			vmOptions[0].extraInfo = NULL;
+
+			// Add an option to increase the max heap size.
+			std::string maxHeapString = "-Xmx" + maxHeap;
+			std::vector<char> heap(maxHeapString.begin(), 
+				maxHeapString.end());
+			heap.push_back('\0');
+			vmOptions[1].optionString = &heap[0];
+			vmOptions[1].extraInfo = NULL;
+			//vmOptions[1].optionString = "-Djava.compiler=NONE"; // Disable JIT.
+			//vmOptions[1].optionString = "-verbose:gc,class,jni";
+			vm_args.options = vmOptions;
+			//vm_args.ignoreUnrecognized = JNI_FALSE;
+
+			// Create the VM.
+			status = JNI_CreateJavaVM(&internal::gJVM, 
+				(void**)&env, &vm_args);
+		}
+		else
+		{
+			vm_args.nOptions = 1;
+
+			// Setup the VM options.
+			// TODO: check out other options to be used here, like disabling the 
+			// JIT compiler.
+			JavaVMOption vmOptions[1];
+
+			// Add the required Java class paths.
+			std::string classPathString = "-Djava.class.path=";
+			classPathString += vocePath;
+			classPathString += "/voce.jar";
+			std::vector<char> classPath(classPathString.begin(), 
+				classPathString.end());
+			classPath.push_back('\0');
+			vmOptions[0].optionString = &classPath[0];
+			vmOptions[0].extraInfo = NULL;
+			//vmOptions[1].optionString = "-Djava.compiler=NONE"; // Disable JIT.
+			//vmOptions[1].optionString = "-verbose:gc,class,jni";
+			vm_args.options = vmOptions;
+			//vm_args.ignoreUnrecognized = JNI_FALSE;
+
+			// Create the VM.
+			status = JNI_CreateJavaVM(&internal::gJVM, 
+				(void**)&env, &vm_args);
+		}
+
+		if (status < 0)
+		{
+			internal::log("ERROR", "Java virtual machine cannot be created");
+			return;
+		}
+
+		internal::log("", "Java virtual machine created");
+
+		if (!internal::createEnvKey())
+		{
+			internal::log("ERROR", "Thread-local storage for the JNI \
+environment cannot be created");
+
+			// Without the slot no thread can get its environment, so 
+			// leave Voce uninitialized rather than half set up.
+			internal::gJVM->DestroyJavaVM();
+			internal::gJVM = NULL;
+			return;
+		}
+
+		// Find the main Voce class by name.
+		jclass c = env->FindClass(internal::gClassName.c_str());
+
+		if (0 == c)
+		{
+			internal::checkException(env, "FindClass");
+			internal::log("ERROR", "The requested Java class: " 
+				+ internal::gClassName + " could not be found.  Make \
+sure the Voce path given to 'init' correctly points to the Voce classes.");
+			internal::abortInit(env);
+			return;
+		}
+
+		// Store a global reference so the class won't go out of 
+		// scope and get destroyed.
+		internal::gClass = (jclass)env->NewGlobalRef(c);
+		env->DeleteLocalRef(c);
+
+		// Cache the global method ID references for the various 
+		// functions.  This should save lookup time.
+		internal::gMissingMethodCount = 0;
+		internal::gInitID = internal::loadJavaMethodID("init", 
+			"(Ljava/lang/String;ZZLjava/lang/String;Ljava/lang/String;\
+Ljava/lang/String;)V");
+		internal::gDestroyID = internal::loadJavaMethodID("destroy", "()V");
+		internal::gSynthesizeID = internal::loadJavaMethodID("synthesize", 
+			"(Ljava/lang/String;)V");
+		internal::gIsSynthesizingID = internal::loadJavaMethodID(
+			"isSynthesizing", "()Z");
+		internal::gStopSynthesizingID = internal::loadJavaMethodID(
+			"stopSynthesizing", "()V");
+		internal::gSynthesizeToBufferID = internal::loadJavaMethodID(
+			"synthesizeToBuffer", "(Ljava/lang/String;J)I");
+		internal::gGetPhraseCacheStatsID = internal::loadJavaMethodID(
+			"getPhraseCacheStats", "()[J");
+		internal::gPreloadPhrasesID = internal::loadJavaMethodID(
+			"preloadPhrases", "(Ljava/lang/String;)V");
+		internal::gGetPreloadPendingCountID = internal::loadJavaMethodID(
+			"getPreloadPendingCount", "()I");
+		internal::gGetRecognizerQueueSizeID = internal::loadJavaMethodID(
+			"getRecognizerQueueSize", "()I");
+		internal::gGetRecognizerDropCountID = internal::loadJavaMethodID(
+			"getRecognizerDropCount", "()J");
+		internal::gPopRecognizedStringID = internal::loadJavaMethodID(
+			"popRecognizedString", "()Ljava/lang/String;");
+		internal::gPopAllRecognizedStringsID = internal::loadJavaMethodID(
+			"popAllRecognizedStrings", "()[B");
+		internal::gWaitForRecognizedStringID = internal::loadJavaMethodID(
+			"waitForRecognizedString", "(I)Ljava/lang/String;");
+		internal::gSetNativeRecognitionEnabledID = internal::loadJavaMethodID(
+			"setNativeRecognitionEnabled", "(Z)V");
+		internal::gRecognizeFileID = internal::loadJavaMethodID(
+			"recognizeFile", "(Ljava/lang/String;)Ljava/lang/String;");
+		internal::gPopPartialResultID = internal::loadJavaMethodID(
+			"popPartialResult", "()Ljava/lang/String;");
+		internal::gGetPartialResultLeadTimeID = internal::loadJavaMethodID(
+			"getPartialResultLeadTime", "()I");
+		internal::gSetNativePartialRecognitionEnabledID = 
+			internal::loadJavaMethodID("setNativePartialRecognitionEnabled", 
+			"(Z)V");
+		internal::gGetScorerThreadCountID = internal::loadJavaMethodID(
+			"getScorerThreadCount", "()I");
+		bool nativesRegistered = internal::registerNatives(env);
+		internal::gSetGrammarID = internal::loadJavaMethodID("setGrammar", 
+			"(Ljava/lang/String;Ljava/lang/String;)J");
+		internal::gSetRecognizerEnabledID = internal::loadJavaMethodID(
+			"setRecognizerEnabled", "(Z)V");
+		internal::gIsRecognizerEnabledID = internal::loadJavaMethodID(
+			"isRecognizerEnabled", "()Z");
+		internal::gCreateStreamID = internal::loadJavaMethodID(
+			"createStream", "(Ljava/lang/String;)I");
+		internal::gDestroyStreamID = internal::loadJavaMethodID(
+			"destroyStream", "(I)V");
+		internal::gPopStreamResultID = internal::loadJavaMethodID(
+			"popStreamResult", "(I)Ljava/lang/String;");
+
+		// A voce.jar older than this header lacks some of the methods.  
+		// Calling into it would fail one call at a time, so fail now.
+		if (!nativesRegistered || internal::gMissingMethodCount > 0)
+		{
+			internal::log("ERROR", "Voce cannot be initialized because \
+voce.jar does not match voce.h.  Rebuild it with src/java/voce/build.sh.");
+			internal::abortInit(env);
+			return;
+		}
+
+		// Convert the C++ strings to Java strings.
+		jstring jStrVocePath = env->NewStringUTF(
+			vocePath.c_str());
+		jstring jStrGrammarPath = env->NewStringUTF(
+			grammarPath.c_str());
+		jstring jStrGrammarName = env->NewStringUTF(
+			grammarName.c_str());
+		jstring jStrOptions = env->NewStringUTF(options.c_str());
+
+		// Initialize the Java Voce stuff.
+		env->CallStaticVoidMethod(internal::gClass, 
+			internal::gInitID, jStrVocePath, initSynthesis, initRecognition, 
+			jStrGrammarPath, jStrGrammarName, jStrOptions);
+		internal::checkException(env, "init");
+
+		// This thread stays attached after init returns, so its local 
+		// references are only freed if they are deleted explicitly.
+		env->DeleteLocalRef(jStrVocePath);
+		env->DeleteLocalRef(jStrGrammarPath);
+		env->DeleteLocalRef(jStrGrammarName);
+		env->DeleteLocalRef(jStrOptions);
+	}
+
+	/// In addition to the usual Java Voce destroy call, this function 
+	/// performs some extra stuff needed to destroy the virtual machine.
+	void destroy()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "destroy called before \
+initialization.  Request will be ignored.");
+			return;
+		}
+
+		// Destroy the Java Voce stuff.
+		env->CallStaticVoidMethod(internal::gClass, internal::gDestroyID);
+		internal::checkException(env, "destroy");
+
+		// Destroy the global reference to the main Voce Java class.  Method 
+		// IDs are not references, so they only need to be forgotten.
+		env->DeleteGlobalRef((jobject)internal::gClass);
+		internal::gClass = NULL;
+		internal::gInitID = NULL;
+		internal::gDestroyID = NULL;
+		internal::gSynthesizeID = NULL;
+		internal::gIsSynthesizingID = NULL;
+		internal::gStopSynthesizingID = NULL;
+		internal::gSynthesizeToBufferID = NULL;
+		internal::gGetPhraseCacheStatsID = NULL;
+		internal::gPreloadPhrasesID = NULL;
+		internal::gGetPreloadPendingCountID = NULL;
+		internal::gGetRecognizerQueueSizeID = NULL;
+		internal::gGetRecognizerDropCountID = NULL;
+		internal::gPopRecognizedStringID = NULL;
+		internal::gPopAllRecognizedStringsID = NULL;
+		internal::gWaitForRecognizedStringID = NULL;
+		internal::gSetNativeRecognitionEnabledID = NULL;
+		internal::gRecognizeFileID = NULL;
+		internal::gPopPartialResultID = NULL;
+		internal::gGetPartialResultLeadTimeID = NULL;
+		internal::gSetNativePartialRecognitionEnabledID = NULL;
+		internal::gGetScorerThreadCountID = NULL;
+		internal::gRecognitionCallback = NULL;
+		internal::gRecognitionCallbackData = NULL;
+		internal::gPartialResultCallback = NULL;
+		internal::gPartialResultCallbackData = NULL;
+		internal::gRecognitionBufferEnabled = false;
+		internal::gRecognitionBufferHead = 0;
+		internal::gRecognitionBufferTail = 0;
+		internal::gRecognitionBufferDropCount = 0;
+		internal::gSetGrammarID = NULL;
+		internal::gSetRecognizerEnabledID = NULL;
+		internal::gIsRecognizerEnabledID = NULL;
+		internal::gCreateStreamID = NULL;
+		internal::gDestroyStreamID = NULL;
+		internal::gPopStreamResultID = NULL;
+
+		// The recognition threads have stopped reading pushed audio, so 
+		// the buffers can be freed.
+		for (unsigned int i = 0; i < internal::gMaxPushAudioBuffers; ++i)
+		{
+			internal::PushAudioBuffer& audio = internal::gPushAudio[i];
+			internal::lockPushAudio(audio);
+			delete[] audio.samples;
+			audio.samples = NULL;
+			audio.size = 0;
+			audio.read = 0;
+			audio.write = 0;
+			audio.overflowCount = 0;
+			audio.underrunCount = 0;
+			internal::unlockPushAudio(audio);
+		}
+
+		// Destroy the virtual machine.  DestroyJavaVM waits for all other 
+		// attached threads to detach.  The threads Voce attached detach 
+		// when they exit, through the thread-local slot's destructor, so 
+		// the slot is kept until the virtual machine is gone.
+		if (internal::gAttachedThreads > 0)
+		{
+			internal::log("warning", "Threads that called Voce are still \
+running.  Waiting for them to exit...");
+		}
+
+		internal::gJVM->DestroyJavaVM();
+		internal::gJVM = NULL;
+		internal::destroyEnvKey();
+		internal::log("", "Java virtual machine destroyed");
+	}
+
+	/// Returns the number of threads that Voce attached to the Java 
+	/// virtual machine because they called a Voce function, and that 
+	/// have not exited yet.  The thread that called init is not counted.  
+	/// destroy waits for these threads to exit.
+	int getAttachedThreadCount()
+	{
+		return (int)internal::gAttachedThreads;
+	}
+
+	/// Requests that the given string be synthesized as soon as possible.
+	void synthesize(const std::string& message)
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "synthesize called before \
+initialization.  Request will be ignored.");
+			return;
+		}
+
+		// Convert the C++ string to a Java string.
+		jstring jstr = env->NewStringUTF(message.c_str());
+
+		// Call the Java method.
+		env->CallStaticVoidMethod(internal::gClass, 
+			internal::gSynthesizeID, jstr);
+		internal::checkException(env, "synthesize");
+		env->DeleteLocalRef(jstr);
+	}
+
+	/// Checks whether the speech synthesizer is currently synthesizing 
+	/// a message.
+	bool isSynthesizing()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "isSynthesizing called before \
+initialization.  Request will be ignored.");
+			return false;
+		}
+
+		// Call the Java method.
+		jboolean b = env->CallStaticBooleanMethod(internal::gClass, 
+			internal::gIsSynthesizingID);
+		internal::checkException(env, "isSynthesizing");
+
+		if (JNI_FALSE == b)
+		{
+			return false;
+		}
+		else
+		{
+			return true;
+		}
+	}
+
+	/// Tells the speech synthesizer to stop synthesizing.  This cancels all 
+	/// pending messages.
+	void stopSynthesizing()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "stopSynthesizing called before \
+initialization.  Request will be ignored.");
+			return;
+		}
+
+		// Call the Java method.
+		env->CallStaticVoidMethod(internal::gClass, 
+			internal::gStopSynthesizingID);
+		internal::checkException(env, "stopSynthesizing");
+	}
+
+	/// Synthesizes the given string into 'samples' instead of playing 
+	/// it.  The samples are 16-bit, signed and mono, at 'sampleRate' 
+	/// Hz.  No audio line is opened, so this works on machines without 
+	/// an audio device (see the 'audioOutput' init option), and the 
+	/// caller can mix the speech itself.  Java writes the samples 
+	/// straight into 'samples' through a direct ByteBuffer.  The calling 
+	/// thread waits until the whole string is synthesized; strings 
+	/// queued by synthesize are not affected.  Returns false if the 
+	/// string cannot be synthesized.
+	bool synthesizeToBuffer(const std::string& message, 
+		std::vector<short>& samples, int& sampleRate)
+	{
+		samples.clear();
+		sampleRate = 0;
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "synthesizeToBuffer called before \
+initialization.  Request will be ignored.");
+			return false;
+		}
+
+		// Convert the C++ string to a Java string.
+		jstring jstr = env->NewStringUTF(message.c_str());
+
+		// Call the Java method.  It calls back into 
+		// nativeCreateSynthesisBuffer with the address of 'samples'.
+		jint rate = env->CallStaticIntMethod(internal::gClass, 
+			internal::gSynthesizeToBufferID, jstr, 
+			(jlong)(size_t)&samples);
+		internal::checkException(env, "synthesizeToBuffer");
+		env->DeleteLocalRef(jstr);
+
+		if (rate <= 0)
+		{
+			samples.clear();
+			return false;
+		}
+
+		sampleRate = rate;
+		return true;
+	}
+
+	/// Returns the phrase cache's counters, which show how often 
+	/// synthesize and synthesizeToBuffer reuse a phrase and how much 
+	/// memory the cache uses.  They are all 0 without the 
+	/// 'phraseCacheSize' init option.
+	PhraseCacheStats getPhraseCacheStats()
+	{
+		PhraseCacheStats stats;
+		memset(&stats, 0, sizeof(stats));
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "getPhraseCacheStats called before \
+initialization.  Request will be ignored.");
+			return stats;
+		}
+
+		// Call the Java method.
+		jlongArray jStats = (jlongArray)env->CallStaticObjectMethod(
+			internal::gClass, internal::gGetPhraseCacheStatsID);
+		internal::checkException(env, "getPhraseCacheStats");
+
+		if (!jStats)
+		{
+			return stats;
+		}
+
+		jlong values[5];
+		env->GetLongArrayRegion(jStats, 0, 5, values);
+		env->DeleteLocalRef(jStats);
+		stats.hits = values[0];
+		stats.misses = values[1];
+		stats.evictions = values[2];
+		stats.bytes = values[3];
+		stats.phrases = values[4];
+		return stats;
+	}
+
+	/// Renders phrases into the phrase cache in the background, on the 
+	/// threads set by the 'synthesisThreads' init option, so that 
+	/// synthesize calls with them later start playing without delay.  
+	/// Returns right away; see getPreloadPendingCount.  Requires the 
+	/// 'phraseCacheSize' or 'phraseFile' init option.  A phrase 
+	/// containing a line break is preloaded as two phrases.
+	void preloadPhrases(const std::vector<std::string>& phrases)
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "preloadPhrases called before \
+initialization.  Request will be ignored.");
+			return;
+		}
+
+		// Send all of the phrases in one call, one per line.
+		std::string lines;
+
+		for (size_t i = 0; i < phrases.size(); ++i)
+		{
+			lines += phrases[i];
+			lines += '\n';
+		}
+
+		jstring jstr = env->NewStringUTF(lines.c_str());
+
+		// Call the Java method.
+		env->CallStaticVoidMethod(internal::gClass, 
+			internal::gPreloadPhrasesID, jstr);
+		internal::checkException(env, "preloadPhrases");
+		env->DeleteLocalRef(jstr);
+	}
+
+	/// Returns the number of preloaded phrases that have not been 
+	/// rendered yet.
+	int getPreloadPendingCount()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "getPreloadPendingCount called \
+before initialization.  Request will be ignored.");
+			return 0;
+		}
+
+		// Call the Java method.
+		jint result = env->CallStaticIntMethod(internal::gClass, 
+			internal::gGetPreloadPendingCountID);
+		internal::checkException(env, "getPreloadPendingCount");
+		return result;
+	}
+
+	/// Returns the number of recognized strings currently in the 
+	/// recognizer's queue.
+	int getRecognizerQueueSize()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "getRecognizerQueueSize called before \
+initialization.  Request will be ignored.");
+			return 0;
+		}
+
+		// Call the Java method.
+		jint result = env->CallStaticIntMethod(internal::gClass, 
+			internal::gGetRecognizerQueueSizeID);
+		internal::checkException(env, "getRecognizerQueueSize");
+		return result;
+	}
+
+	/// Returns the number of recognized strings that were dropped 
+	/// because the recognizer's queue was full.  See the 'queueCapacity' 
+	/// and 'queueOverflow' init options.
+	long long getRecognizerDropCount()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "getRecognizerDropCount called before \
+initialization.  Request will be ignored.");
+			return 0;
+		}
+
+		// Call the Java method.
+		jlong result = env->CallStaticLongMethod(internal::gClass, 
+			internal::gGetRecognizerDropCountID);
+		internal::checkException(env, "getRecognizerDropCount");
+		return result;
+	}
+
+	/// Returns and removes the oldest recognized string from the 
+	/// recognizer's queue.
+	std::string popRecognizedString()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "popRecognizedString called before \
+initialization.  Request will be ignored.");
+			return "";
+		}
+
+		// Call the Java method.
+		jstring jstr = (jstring)env->CallStaticObjectMethod(
+			internal::gClass, internal::gPopRecognizedStringID);
+		internal::checkException(env, "popRecognizedString");
+
+		if (!jstr)
+		{
+			return "";
+		}
+
+		// Convert string from Java to C++.  Be sure to release memory 
+		// when finished.
+		const char* tempStr = env->GetStringUTFChars(jstr, 0);
+		std::string cppStr = tempStr;
+		env->ReleaseStringUTFChars(jstr, tempStr);
+		env->DeleteLocalRef(jstr);
+
+		return cppStr;
+	}
+
+	/// Returns and removes the oldest recognized string from the 
+	/// recognizer's queue, waiting up to 'timeoutMs' milliseconds for one 
+	/// to arrive if the queue is empty.  The calling thread sleeps while 
+	/// it waits, so this is much cheaper than polling 
+	/// getRecognizerQueueSize in a loop.  Returns true and stores the 
+	/// string in 'str' if one was recognized before the timeout expired; 
+	/// otherwise returns false and leaves 'str' unchanged.
+	bool waitForRecognizedString(std::string& str, int timeoutMs)
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "waitForRecognizedString called before \
+initialization.  Request will be ignored.");
+			return false;
+		}
+
+		// Call the Java method.  It returns null if the timeout expires.
+		jstring jstr = (jstring)env->CallStaticObjectMethod(
+			internal::gClass, internal::gWaitForRecognizedStringID, 
+			(jint)timeoutMs);
+		internal::checkException(env, "waitForRecognizedString");
+
+		if (!jstr)
+		{
+			return false;
+		}
+
+		// Convert string from Java to C++.  Be sure to release memory 
+		// when finished.
+		const char* tempStr = env->GetStringUTFChars(jstr, 0);
+		str = tempStr;
+		env->ReleaseStringUTFChars(jstr, tempStr);
+		env->DeleteLocalRef(jstr);
+
+		return true;
+	}
+
+	/// Removes all recognized strings from the recognizer's queue with a 
+	/// single Java call and stores them, oldest first, in 'strings' 
+	/// (replacing its previous contents).  Returns the number of strings.  
+	/// Passing the same vector every time lets its strings reuse their 
+	/// memory, and nothing is allocated when the queue is empty.  Each 
+	/// string is returned by exactly one call, but the queue is emptied 
+	/// one string at a time, so strings recognized meanwhile may be left 
+	/// for the next call.
+	size_t popAllRecognizedStrings(std::vector<std::string>& strings)
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
-			std::cout << "[Voce";
+			internal::log("warning", "popAllRecognizedStrings called before \
+initialization.  Request will be ignored.");
+			strings.clear();
+			return 0;
+		}
 
-			if (std::string("") != msgType)
-			{
-				std::cout << " " << msgType;
-			}
+		// Call the Java method.  It returns null if the queue is empty.
+		jbyteArray packed = (jbyteArray)env->CallStaticObjectMethod(
+			internal::gClass, internal::gPopAllRecognizedStringsID);
+		internal::checkException(env, "popAllRecognizedStrings");
 
-			std::cout << "] " << msg << std::endl;
+		if (!packed)
+		{
+			strings.clear();
+			return 0;
 		}
 
-		/// Finds and returns a method ID for the given function name and 
-		/// Java method signature.
-		jmethodID loadJavaMethodID(const std::string& functionName, 
-			const std::string& functionSignature)
+		// The array holds each UTF-8 string followed by a zero byte.  Copy 
+		// it out before splitting it, so that nothing is allocated while 
+		// the virtual machine's array is held.
+		jsize length = env->GetArrayLength(packed);
+		std::vector<char> data(length + 1);
+		env->GetByteArrayRegion(packed, 0, length, (jbyte*)&data[0]);
+		env->DeleteLocalRef(packed);
+
+		const char* end = &data[0] + length;
+		size_t count = 0;
+
+		for (const char* start = &data[0]; start < end; ++count)
 		{
-			if (!gEnv)
+			const char* terminator = (const char*)memchr(start, 0, 
+				end - start);
+
+			if (!terminator)
 			{
-				log("ERROR", "Method ID cannot be found for function: " 
-					+ functionName + " before initialization.");
-				return 0;
+				terminator = end;
 			}
 
-			// Call the JNI function GetStaticMethodID, which performs a 
-			// lookup for the given Java method.  The lookup is based on 
-			// the name of the method as well as the method signature.  If 
-			// the method does not exist, GetStaticMethodID 
-			// returns zero (0). An immediate return from the native method 
-			// at that point causes a NoSuchMethodError to be thrown in the 
-			// Java application code.  Note that the JNI uses the method 
-			// signature to denote the return type of a Java method. The 
-			// signature (I)V, for example, denotes a Java method that takes 
-			// one argument of type int and has a return type void. The 
-			// general form of a method signature argument is: 
-			// "(argument-types)return-type".
-			jmethodID methodID = gEnv->GetStaticMethodID(gClass, 
-				functionName.c_str(), functionSignature.c_str());
-
-			if (0 == methodID)
+			if (count < strings.size())
 			{
-				log("ERROR", "Invalid Java method ID requested for: " 
-					+ functionName + ".  Function call ignored.");
-				return 0;
+				strings[count].assign(start, terminator);
+			}
+			else
+			{
+				strings.push_back(std::string(start, terminator));
 			}
 
-			return methodID;
+			start = terminator + 1;
 		}
+
+		strings.resize(count);
+		return count;
 	}
 
-	/// Initializes Voce.  This function performs some extra stuff needed 
-	/// to setup the Java virtual machine and cache the Java method IDs.  
-	/// The 'vocePath' argument is the path to the Voce class files and 
-	/// config file.  This path can be absolute or relative to the 
-	/// working directory of the executable using Voce.  See documentation 
-	/// for the Java version for an explanation of the rest of the 
-	/// parameters.
-	void init(const std::string& vocePath, bool initSynthesis, 
-		bool initRecognition, const std::string& grammarPath, 
-		const std::string& grammarName)
+	/// Has every recognized string passed to 'callback' as soon as it is 
+	/// recognized, instead of storing it in the recognizer's queue.  The 
+	/// callback runs on the recognition thread, so it should return 
+	/// quickly and do its own synchronization.  Passing NULL restores 
+	/// the previous delivery method.  Set the callback once after init 
+	/// rather than changing it while recognition is running.
+	void setRecognitionCallback(RecognitionCallback callback, 
+		void* userData = NULL)
 	{
-		// Setup the Java virtual machine.
-		JavaVMInitArgs vm_args;
-		memset(&vm_args, 0, sizeof(vm_args));
-		vm_args.version = JNI_VERSION_1_4;
-
-		long status = 0;
+		JNIEnv* env = internal::getEnv();
 
-		// If recognition is being used, we need to increase the max heap 
-		// size.
-		if (initRecognition)
+		if (!env)
 		{
-			vm_args.nOptions = 2;
-
-			// Setup the VM options.
-			// TODO: check out other options to be used here, like disabling the 
-			// JIT compiler.
-			JavaVMOption options[2];
+			internal::log("warning", "setRecognitionCallback called before \
+initialization.  Request will be ignored.");
+			return;
+		}
 
-			// Add the required Java class paths.
-			std::string classPathString = "-Djava.class.path=";
-			classPathString += vocePath;
-			classPathString += "/voce.jar";
-			char s[1024];
-			sprintf(s, classPathString.c_str());
-			options[0].optionString = s;
-			options[0].extraInfo = NULL;
+		// Make sure the data pointer is visible before the callback is.
+		internal::gRecognitionCallbackData = userData;
+		internal::memoryBarrier();
+		internal::gRecognitionCallback = callback;
+		internal::updateNativeRecognition(env);
+	}
 
-			// Add an option to increase the max heap size.
-			options[1].optionString = "-Xmx256m";
-			options[1].extraInfo = NULL;
-			//options[1].optionString = "-Djava.compiler=NONE"; // Disable JIT.
-			//options[1].optionString = "-verbose:gc,class,jni";
-			vm_args.options = options;
-			//vm_args.ignoreUnrecognized = JNI_FALSE;
+	/// Enables and disables the recognition ring buffer.  When enabled 
+	/// (and no callback is set), recognized strings are written into a 
+	/// fixed-size lock-free buffer instead of the recognizer's queue, and 
+	/// popBufferedRecognizedString reads them without calling into Java.  
+	/// Only one application thread may read from the buffer.
+	void setRecognitionBufferEnabled(bool e)
+	{
+		JNIEnv* env = internal::getEnv();
 
-			// Create the VM.
-			status = JNI_CreateJavaVM(&internal::gJVM, 
-				(void**)&internal::gEnv, &vm_args);
+		if (!env)
+		{
+			internal::log("warning", "setRecognitionBufferEnabled called \
+before initialization.  Request will be ignored.");
+			return;
 		}
-		else
+
+		internal::gRecognitionBufferEnabled = e;
+		internal::updateNativeRecognition(env);
+	}
+
+	/// Returns and removes the oldest string from the recognition ring 
+	/// buffer.  Returns true and stores the string in 'str' if there was 
+	/// one; otherwise returns false.  This never calls into Java or 
+	/// locks, so it is cheap enough to call every frame.  The buffer's 
+	/// memory is swapped with 'str', so reusing the same string avoids 
+	/// allocations.
+	bool popBufferedRecognizedString(std::string& str)
+	{
+		unsigned int head = internal::gRecognitionBufferHead;
+
+		if (head == internal::gRecognitionBufferTail)
 		{
-			vm_args.nOptions = 1;
+			return false;
+		}
 
-			// Setup the VM options.
-			// TODO: check out other options to be used here, like disabling the 
-			// JIT compiler.
-			JavaVMOption options[1];
+		// Read the slot only after seeing the tail that published it.
+		internal::memoryBarrier();
+		str.swap(internal::gRecognitionBuffer[head & 
+			(internal::gRecognitionBufferSize - 1)]);
 
-			// Add the required Java class paths.
-			std::string classPathString = "-Djava.class.path=";
-			classPathString += vocePath;
-			classPathString += "/voce.jar";
-			char s[4096];
-			sprintf(s, classPathString.c_str());
-			options[0].optionString = s;
-			options[0].extraInfo = NULL;
-			//options[1].optionString = "-Djava.compiler=NONE"; // Disable JIT.
-			//options[1].optionString = "-verbose:gc,class,jni";
-			vm_args.options = options;
-			//vm_args.ignoreUnrecognized = JNI_FALSE;
+		// Finish with the slot before handing it back to the producer.
+		internal::memoryBarrier();
+		internal::gRecognitionBufferHead = head + 1;
+		return true;
+	}
 
-			// Create the VM.
-			status = JNI_CreateJavaVM(&internal::gJVM, 
-				(void**)&internal::gEnv, &vm_args);
+	/// Returns the number of recognized strings dropped because the 
+	/// recognition ring buffer was full.
+	unsigned int getRecognitionBufferDropCount()
+	{
+		return internal::gRecognitionBufferDropCount;
+	}
+
+	/// Returns and removes the oldest partial result: the best guess at 
+	/// what is being said before the utterance has ended, so 
+	/// applications can react to an unambiguous prefix of a command 
+	/// without waiting for the final result.  Returns an empty string if 
+	/// there is none.  Requires the 'partialResults' init option.  The 
+	/// final result still arrives through the usual functions.
+	std::string popPartialResult()
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "popPartialResult called before \
+initialization.  Request will be ignored.");
+			return "";
 		}
 
-		if (status < 0)
+		// Call the Java method.
+		jstring jstr = (jstring)env->CallStaticObjectMethod(
+			internal::gClass, internal::gPopPartialResultID);
+		internal::checkException(env, "popPartialResult");
+
+		if (!jstr)
 		{
-			internal::log("ERROR", "Java virtual machine cannot be created");
-			return;
+			return "";
 		}
 
-		internal::log("", "Java virtual machine created");
+		// Convert string from Java to C++.  Be sure to release memory 
+		// when finished.
+		const char* tempStr = env->GetStringUTFChars(jstr, 0);
+		std::string cppStr = tempStr;
+		env->ReleaseStringUTFChars(jstr, tempStr);
+		env->DeleteLocalRef(jstr);
 
-		// Find the main Voce class by name.
-		jclass c = internal::gEnv->FindClass(internal::gClassName.c_str());
+		return cppStr;
+	}
 
-		if (0 == c)
+	/// Has every partial result passed to 'callback' as soon as it is 
+	/// available, instead of storing it for popPartialResult.  The 
+	/// callback runs on the recognition thread, so it should return 
+	/// quickly and do its own synchronization.  Passing NULL restores 
+	/// popPartialResult.  Requires the 'partialResults' init option.
+	void setPartialResultCallback(RecognitionCallback callback, 
+		void* userData = NULL)
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
-			internal::log("ERROR", "The requested Java class: " 
-				+ internal::gClassName + " could not be found.  Make \
-sure the Voce path given to 'init' correctly points to the Voce classes.");
+			internal::log("warning", "setPartialResultCallback called \
+before initialization.  Request will be ignored.");
 			return;
 		}
 
-		// Store a global reference so the class won't go out of 
-		// scope and get destroyed.
-		internal::gClass = (jclass)internal::gEnv->NewGlobalRef(c);
+		// Make sure the data pointer is visible before the callback is.
+		internal::gPartialResultCallbackData = userData;
+		internal::memoryBarrier();
+		internal::gPartialResultCallback = callback;
 
-		// Cache the global method ID references for the various 
-		// functions.  This should save lookup time.
-		internal::gInitID = internal::loadJavaMethodID("init", 
-			"(Ljava/lang/String;ZZLjava/lang/String;Ljava/lang/String;)V");
-		internal::gDestroyID = internal::loadJavaMethodID("destroy", "()V");
-		internal::gSynthesizeID = internal::loadJavaMethodID("synthesize", 
-			"(Ljava/lang/String;)V");
-		internal::gIsSynthesizingID = internal::loadJavaMethodID(
-			"isSynthesizing", "()Z");
-		internal::gStopSynthesizingID = internal::loadJavaMethodID(
-			"stopSynthesizing", "()V");
-		internal::gGetRecognizerQueueSizeID = internal::loadJavaMethodID(
-			"getRecognizerQueueSize", "()I");
-		internal::gPopRecognizedStringID = internal::loadJavaMethodID(
-			"popRecognizedString", "()Ljava/lang/String;");
-		internal::gSetRecognizerEnabledID = internal::loadJavaMethodID(
-			"setRecognizerEnabled", "(Z)V");
-		internal::gIsRecognizerEnabledID = internal::loadJavaMethodID(
-			"isRecognizerEnabled", "()Z");
+		env->CallStaticVoidMethod(internal::gClass, 
+			internal::gSetNativePartialRecognitionEnabledID, 
+			callback ? JNI_TRUE : JNI_FALSE);
+		internal::checkException(env, "setPartialResultCallback");
+	}
 
-		// Convert the C++ strings to Java strings.
-		jstring jStrVocePath = internal::gEnv->NewStringUTF(
-			vocePath.c_str());
-		jstring jStrGrammarPath = internal::gEnv->NewStringUTF(
-			grammarPath.c_str());
-		jstring jStrGrammarName = internal::gEnv->NewStringUTF(
-			grammarName.c_str());
+	/// Returns the average number of milliseconds by which the first 
+	/// partial result of an utterance came before its final result.  
+	/// Returns 0 if no utterance has had a partial result yet.
+	int getPartialResultLeadTime()
+	{
+		JNIEnv* env = internal::getEnv();
 
-		// Initialize the Java Voce stuff.
-		internal::gEnv->CallStaticVoidMethod(internal::gClass, 
-			internal::gInitID, jStrVocePath, initSynthesis, initRecognition, 
-			jStrGrammarPath, jStrGrammarName);
+		if (!env)
+		{
+			internal::log("warning", "getPartialResultLeadTime called \
+before initialization.  Request will be ignored.");
+			return 0;
+		}
+
+		// Call the Java method.
+		jint result = env->CallStaticIntMethod(internal::gClass, 
+			internal::gGetPartialResultLeadTimeID);
+		internal::checkException(env, "getPartialResultLeadTime");
+		return result;
 	}
 
-	/// In addition to the usual Java Voce destroy call, this function 
-	/// performs some extra stuff needed to destroy the virtual machine.
-	void destroy()
+	/// Returns the number of threads the recognizer currently uses to 
+	/// score each audio frame.  See the 'scorerThreads' and 
+	/// 'scorerAutoTune' init options.
+	int getScorerThreadCount()
 	{
-		if (!internal::gEnv)
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
-			internal::log("warning", "destroy called before \
-initialization.  Request will be ignored.");
-			return;
+			internal::log("warning", "getScorerThreadCount called \
+before initialization.  Request will be ignored.");
+			return 0;
 		}
 
-		// Destroy the Java Voce stuff.
-		internal::gEnv->CallStaticVoidMethod(internal::gClass, 
-			internal::gDestroyID);
-
-		// Destroy the global reference to the main Voce Java class and to 
-		// the various global method ID references.
-		internal::gEnv->DeleteGlobalRef((jobject)internal::gClass);
-		internal::gEnv->DeleteGlobalRef((jobject)internal::gInitID);
-		internal::gEnv->DeleteGlobalRef((jobject)internal::gDestroyID);
-		internal::gEnv->DeleteGlobalRef((jobject)internal::gSynthesizeID);
-		internal::gEnv->DeleteGlobalRef((jobject)internal::gIsSynthesizingID);
-		internal::gEnv->DeleteGlobalRef(
-			(jobject)internal::gStopSynthesizingID);
-		internal::gEnv->DeleteGlobalRef(
-			(jobject)internal::gGetRecognizerQueueSizeID);
-		internal::gEnv->DeleteGlobalRef(
-			(jobject)internal::gPopRecognizedStringID);
-		internal::gEnv->DeleteGlobalRef(
-			(jobject)internal::gSetRecognizerEnabledID);
-		internal::gEnv->DeleteGlobalRef(
-			(jobject)internal::gIsRecognizerEnabledID);
-
-		if (internal::gJVM)
-		{
-			// Destroy the virtual machine.
-			internal::gJVM->DestroyJavaVM();
-			internal::log("", "Java virtual machine destroyed");
-		}
+		// Call the Java method.
+		jint result = env->CallStaticIntMethod(internal::gClass, 
+			internal::gGetScorerThreadCountID);
+		internal::checkException(env, "getScorerThreadCount");
+		return result;
 	}
 
-	/// Requests that the given string be synthesized as soon as possible.
-	void synthesize(const std::string& message)
+	/// Recognizes the speech in a WAV or raw audio file (16 kHz, 16-bit, 
+	/// signed, mono; raw data must be little-endian) and returns it.  The 
+	/// calling thread waits until the whole file has been decoded.  
+	/// Requires Voce to be initialized with the 'audioInput=file' option.
+	std::string recognizeFile(const std::string& filename)
 	{
-		if (!internal::gEnv)
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
-			internal::log("warning", "synthesize called before \
+			internal::log("warning", "recognizeFile called before \
 initialization.  Request will be ignored.");
+			return "";
 		}
 
 		// Convert the C++ string to a Java string.
-		jstring jstr = internal::gEnv->NewStringUTF(message.c_str());
+		jstring jFilename = env->NewStringUTF(filename.c_str());
 
 		// Call the Java method.
-		internal::gEnv->CallStaticVoidMethod(internal::gClass, 
-			internal::gSynthesizeID, jstr);
+		jstring jstr = (jstring)env->CallStaticObjectMethod(
+			internal::gClass, internal::gRecognizeFileID, jFilename);
+		internal::checkException(env, "recognizeFile");
+		env->DeleteLocalRef(jFilename);
+
+		if (!jstr)
+		{
+			return "";
+		}
+
+		// Convert string from Java to C++.  Be sure to release memory 
+		// when finished.
+		const char* tempStr = env->GetStringUTFChars(jstr, 0);
+		std::string cppStr = tempStr;
+		env->ReleaseStringUTFChars(jstr, tempStr);
+		env->DeleteLocalRef(jstr);
+
+		return cppStr;
 	}
 
-	/// Checks whether the speech synthesizer is currently synthesizing 
-	/// a message.
-	bool isSynthesizing()
+	/// Hands 'count' 16 kHz, 16-bit, signed, mono samples to the 
+	/// recognizer.  Requires Voce to be initialized with the 
+	/// 'audioInput=push' option.  The samples are copied once into a 
+	/// lock-free ring buffer that Java reads in place, so this never 
+	/// calls into Java or locks and is cheap enough to call from an 
+	/// audio callback.  Only one thread may push audio.  Returns the 
+	/// number of samples accepted; if the recognizer has fallen behind 
+	/// and the buffer is full, the rest are dropped and counted by 
+	/// getPushAudioOverflowCount, as is audio pushed while Java is 
+	/// re-creating the buffer.  Nothing is read while the recognizer is 
+	/// disabled, so pushing then soon fills the buffer.
+	size_t pushAudio(const short* samples, size_t count)
 	{
-		if (!internal::gEnv)
+		if (!internal::gPushAudio[0].samples)
 		{
-			internal::log("warning", "isSynthesizing called before \
+			internal::log("warning", "pushAudio called before push audio \
+input was initialized.  Use the 'audioInput=push' init option.");
+			return 0;
+		}
+
+		return internal::pushAudio(internal::gPushAudio[0], samples, 
+			count);
+	}
+
+	/// Returns the number of pushed samples dropped because the push 
+	/// audio buffer was full.  A growing count means the recognizer 
+	/// cannot keep up (or is disabled); see the 'pushBufferSize' init 
+	/// option.
+	unsigned int getPushAudioOverflowCount()
+	{
+		return internal::gPushAudio[0].overflowCount;
+	}
+
+	/// Returns the number of times the recognizer ran out of pushed 
+	/// audio and had to wait for more.  Some underruns are normal when 
+	/// audio is pushed in large blocks; more than one per push means the 
+	/// audio is arriving late.
+	unsigned int getPushAudioUnderrunCount()
+	{
+		return internal::gPushAudio[0].underrunCount;
+	}
+
+	/// Starts recognizing a new stream of audio with the given grammar 
+	/// (from the grammar path given to init), or with the grammar the 
+	/// stream was last used with if 'grammarName' is empty.  Requires 
+	/// Voce to be initialized with the 'streams' option; all streams 
+	/// share one copy of the acoustic model and dictionary.  Returns a 
+	/// handle for the stream's pushAudio and popResult calls, or -1 if 
+	/// all streams are in use.
+	int createStream(const std::string& grammarName = "")
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "createStream called before \
 initialization.  Request will be ignored.");
+			return -1;
 		}
 
+		// Convert the C++ string to a Java string.
+		jstring jStrGrammarName = env->NewStringUTF(grammarName.c_str());
+
 		// Call the Java method.
-		jboolean b = internal::gEnv->CallStaticBooleanMethod(internal::gClass, 
-			internal::gIsSynthesizingID);
+		jint stream = env->CallStaticIntMethod(internal::gClass, 
+			internal::gCreateStreamID, jStrGrammarName);
+		env->DeleteLocalRef(jStrGrammarName);
 
-		if (JNI_FALSE == b)
+		if (internal::checkException(env, "createStream"))
 		{
-			return false;
+			return -1;
 		}
-		else
+
+		internal::PushAudioBuffer* audio = 
+			internal::getPushAudioBuffer(stream);
+
+		if (stream > 0 && audio)
 		{
-			return true;
+			audio->active = true;
 		}
+
+		return stream;
 	}
 
-	/// Tells the speech synthesizer to stop synthesizing.  This cancels all 
-	/// pending messages.
-	void stopSynthesizing()
+	/// Stops recognizing the given stream and makes it available to 
+	/// createStream again.  Audio and results that have not been read 
+	/// are discarded.
+	void destroyStream(int stream)
 	{
-		if (!internal::gEnv)
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
-			internal::log("warning", "stopSynthesizing called before \
+			internal::log("warning", "destroyStream called before \
 initialization.  Request will be ignored.");
+			return;
+		}
+
+		// Refuse further audio before the stream's buffer is cleared.
+		internal::PushAudioBuffer* audio = 
+			internal::getPushAudioBuffer(stream);
+
+		if (stream > 0 && audio)
+		{
+			audio->active = false;
 		}
 
 		// Call the Java method.
-		internal::gEnv->CallStaticVoidMethod(internal::gClass, 
-			internal::gStopSynthesizingID);
+		env->CallStaticVoidMethod(internal::gClass, 
+			internal::gDestroyStreamID, (jint)stream);
+		internal::checkException(env, "destroyStream");
 	}
 
-	/// Returns the number of recognized strings currently in the 
-	/// recognizer's queue.
-	int getRecognizerQueueSize()
+	/// Hands 'count' 16 kHz, 16-bit, signed, mono samples to the given 
+	/// stream's recognizer.  Works like the pushAudio above: each stream 
+	/// has its own ring buffer, and only one thread may push audio to 
+	/// each stream.  Returns the number of samples accepted, which is 0 
+	/// once the stream has been destroyed.
+	size_t pushAudio(int stream, const short* samples, size_t count)
 	{
-		if (!internal::gEnv)
+		internal::PushAudioBuffer* audio = 
+			internal::getPushAudioBuffer(stream);
+
+		if (stream < 1 || !audio || !audio->samples)
 		{
-			internal::log("warning", "getRecognizerQueueSize called before \
-initialization.  Request will be ignored.");
+			internal::log("warning", "pushAudio called with an unknown \
+stream.  Use createStream with the 'streams' init option.");
+			return 0;
 		}
 
-		// Call the Java method.
-		return internal::gEnv->CallStaticIntMethod(internal::gClass, 
-			internal::gGetRecognizerQueueSizeID);
+		if (!audio->active)
+		{
+			internal::log("warning", "pushAudio called with a stream that \
+is not in use.  Audio will be ignored.");
+			return 0;
+		}
+
+		return internal::pushAudio(*audio, samples, count);
 	}
 
-	/// Returns and removes the oldest recognized string from the 
-	/// recognizer's queue.
-	std::string popRecognizedString()
+	/// Returns and removes the oldest string recognized in the given 
+	/// stream.  Returns an empty string if there is none.
+	std::string popResult(int stream)
 	{
-		if (!internal::gEnv)
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
-			internal::log("warning", "popRecognizedString called before \
+			internal::log("warning", "popResult called before \
 initialization.  Request will be ignored.");
+			return "";
 		}
 
 		// Call the Java method.
-		jstring jstr = (jstring)internal::gEnv->CallStaticObjectMethod(
-			internal::gClass, internal::gPopRecognizedStringID);
+		jstring jstr = (jstring)env->CallStaticObjectMethod(
+			internal::gClass, internal::gPopStreamResultID, (jint)stream);
+		internal::checkException(env, "popResult");
+
+		if (!jstr)
+		{
+			return "";
+		}
 
 		// Convert string from Java to C++.  Be sure to release memory 
 		// when finished.
-		const char* tempStr = internal::gEnv->GetStringUTFChars(jstr, 0);
+		const char* tempStr = env->GetStringUTFChars(jstr, 0);
 		std::string cppStr = tempStr;
-		internal::gEnv->ReleaseStringUTFChars(jstr, tempStr);
+		env->ReleaseStringUTFChars(jstr, tempStr);
+		env->DeleteLocalRef(jstr);
 
 		return cppStr;
 	}
 
+	/// Replaces the recognizer's grammar without reloading the acoustic 
+	/// model or restarting the Java virtual machine; only the search 
+	/// graph is rebuilt.  'grammarPath' and 'grammarName' work as in 
+	/// init.  Recognized strings that have not been read yet are 
+	/// discarded.  Returns the time taken in milliseconds, or -1 on 
+	/// failure.
+	long long setGrammar(const std::string& grammarPath, 
+		const std::string& grammarName)
+	{
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
+		{
+			internal::log("warning", "setGrammar called before \
+initialization.  Request will be ignored.");
+			return -1;
+		}
+
+		// Convert the C++ strings to Java strings.
+		jstring jStrGrammarPath = env->NewStringUTF(grammarPath.c_str());
+		jstring jStrGrammarName = env->NewStringUTF(grammarName.c_str());
+
+		// Call the Java method.
+		jlong duration = env->CallStaticLongMethod(internal::gClass, 
+			internal::gSetGrammarID, jStrGrammarPath, jStrGrammarName);
+		internal::checkException(env, "setGrammar");
+		env->DeleteLocalRef(jStrGrammarPath);
+		env->DeleteLocalRef(jStrGrammarName);
+
+		return duration;
+	}
+
 	/// Enables and disables the speech recognizer.
 	void setRecognizerEnabled(bool e)
 	{
-		if (!internal::gEnv)
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
 			internal::log("warning", "setRecognizerEnabled called before \
 initialization.  Request will be ignored.");
+			return;
 		}
 
 		// Call the Java method.
-		internal::gEnv->CallStaticVoidMethod(internal::gClass, 
+		env->CallStaticVoidMethod(internal::gClass, 
 			internal::gSetRecognizerEnabledID, e);
+		internal::checkException(env, "setRecognizerEnabled");
 	}
 
 	/// Returns true if the recognizer is currently enabled.
 	bool isRecognizerEnabled()
 	{
-		if (!internal::gEnv)
+		JNIEnv* env = internal::getEnv();
+
+		if (!env)
 		{
 			internal::log("warning", "isRecognizerEnabled called before \
 initialization.  Request will be ignored.");
+			return false;
 		}
 
 		// Call the Java method.
-		jboolean b = internal::gEnv->CallStaticBooleanMethod(internal::gClass, 
+		jboolean b = env->CallStaticBooleanMethod(internal::gClass, 
 			internal::gIsRecognizerEnabledID);
+		internal::checkException(env, "isRecognizerEnabled");
 
 		if (JNI_FALSE == b)
 		{
@@ -425,6 +3971,7 @@ initialization.  Request will be ignored.");
 			return true;
 		}
 	}
+#endif
 }
 
 #endif
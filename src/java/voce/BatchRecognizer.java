@@ -0,0 +1,345 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.BufferedReader;
+import java.io.FileReader;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/// A command line tool that transcribes a list of audio files using 
+/// several recognizer threads that share one acoustic model (see 
+/// RecognizerPool).  Results are written to a JSON lines file, or a CSV 
+/// file if the output filename ends in '.csv', with the decoding time 
+/// of each file.  Usage:
+///
+/// java -cp voce.jar voce.BatchRecognizer [options] fileList outputFile
+///
+/// 'fileList' is a text file naming one audio file per line (see 
+/// SpeechRecognizer.recognizeFile for the supported formats).  Options:
+///
+/// -threads N - Number of decoding threads (default: number of CPUs).
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -grammarPath path - Directory containing grammar files.
+/// -grammarName name - Grammar to use (default: the digits grammar).
+public class BatchRecognizer
+{
+	/// The result of decoding one file.
+	private static class FileResult
+	{
+		String text = "";
+		String error = null;
+		double audioSeconds = 0;
+		double decodeSeconds = 0;
+	}
+
+	/// The files being transcribed.
+	private String[] mFilenames;
+
+	/// The results, in the same order as mFilenames.
+	private FileResult[] mResults;
+
+	/// The index of the next file to be decoded.
+	private AtomicInteger mNextFile = new AtomicInteger(0);
+
+	/// The recognizers used by the decoding threads.
+	private RecognizerPool mPool;
+
+	public static void main(String[] args)
+	{
+		int numThreads = Runtime.getRuntime().availableProcessors();
+		String configFilename = "voce.config.xml";
+		String grammarPath = "./";
+		String grammarName = "";
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-threads") && i + 1 < args.length)
+			{
+				numThreads = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-grammarPath") && i + 1 < args.length)
+			{
+				grammarPath = args[++i];
+			}
+			else if (args[i].equals("-grammarName") && i + 1 < args.length)
+			{
+				grammarName = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 2 || numThreads < 1)
+		{
+			System.out.println("Usage: java voce.BatchRecognizer " 
+				+ "[-threads N] [-config file] [-grammarPath path] " 
+				+ "[-grammarName name] fileList outputFile");
+			System.exit(1);
+		}
+
+		try
+		{
+			BatchRecognizer batch = new BatchRecognizer(configFilename, 
+				grammarPath, grammarName, numThreads);
+			batch.run(readFileList(positional.get(0)), positional.get(1));
+			batch.destroy();
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Batch recognition failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+
+		System.exit(0);
+	}
+
+	/// Creates a batch recognizer with 'numThreads' decoding threads.
+	public BatchRecognizer(String configFilename, String grammarPath, 
+		String grammarName, int numThreads) throws Exception
+	{
+		Utils.log("", "Initializing " + numThreads + " recognizers. " 
+			+ "This may take some time...");
+		mPool = new RecognizerPool(configFilename, grammarPath, 
+			grammarName, numThreads);
+	}
+
+	/// Transcribes the given files and writes the results to 
+	/// 'outputFilename'.  Prints a summary including the aggregate 
+	/// real-time factor (decoding time divided by audio length).
+	public void run(String[] filenames, String outputFilename) 
+		throws IOException
+	{
+		mFilenames = filenames;
+		mResults = new FileResult[filenames.length];
+		mNextFile.set(0);
+
+		Thread[] threads = new Thread[mPool.size()];
+		long startTime = System.nanoTime();
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			final int index = i;
+
+			threads[i] = new Thread(new Runnable()
+				{
+					public void run()
+					{
+						decodeFiles(index);
+					}
+				}, "Batch recognition thread " + i);
+			threads[i].start();
+		}
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			try
+			{
+				threads[i].join();
+			}
+			catch (InterruptedException e)
+			{
+			}
+		}
+
+		double wallSeconds = (System.nanoTime() - startTime) / 1e9;
+		writeResults(outputFilename);
+
+		double audioSeconds = 0;
+		double decodeSeconds = 0;
+
+		for (int i = 0; i < mResults.length; ++i)
+		{
+			audioSeconds += mResults[i].audioSeconds;
+			decodeSeconds += mResults[i].decodeSeconds;
+		}
+
+		Utils.log("", "Decoded " + mResults.length + " files (" 
+			+ audioSeconds + " s of audio) in " + wallSeconds + " s using " 
+			+ threads.length + " threads");
+
+		if (audioSeconds > 0)
+		{
+			Utils.log("", "Real-time factor per thread: " 
+				+ decodeSeconds / audioSeconds + ", aggregate: " 
+				+ wallSeconds / audioSeconds);
+		}
+	}
+
+	/// Deallocates the recognizers.
+	public void destroy()
+	{
+		mPool.deallocate();
+	}
+
+	/// The body of each decoding thread.  Takes files from the list until 
+	/// none are left, decoding them with the given recognizer.
+	private void decodeFiles(int recognizerIndex)
+	{
+		int i = mNextFile.getAndIncrement();
+
+		while (i < mFilenames.length)
+		{
+			FileResult result = new FileResult();
+			long startTime = System.nanoTime();
+
+			try
+			{
+				result.audioSeconds = SpeechRecognizer.getAudioFileDuration(
+					mFilenames[i]);
+				result.text = SpeechRecognizer.decodeFile(
+					mPool.getRecognizer(recognizerIndex), 
+					mPool.getDataSource(recognizerIndex), mFilenames[i]);
+			}
+			catch (Exception e)
+			{
+				// Sphinx4 reports bad audio with runtime exceptions, which 
+				// must not end the thread and leave the result missing.
+				result.error = (null == e.getMessage()) ? e.toString() 
+					: e.getMessage();
+				Utils.log("warning", "Cannot decode " + mFilenames[i] 
+					+ ": " + result.error);
+			}
+
+			result.decodeSeconds = (System.nanoTime() - startTime) / 1e9;
+			mResults[i] = result;
+			i = mNextFile.getAndIncrement();
+		}
+	}
+
+	/// Writes the results as JSON lines, or as CSV if the filename ends 
+	/// in '.csv'.
+	private void writeResults(String outputFilename) throws IOException
+	{
+		boolean csv = outputFilename.toLowerCase().endsWith(".csv");
+		PrintWriter out = new PrintWriter(new FileWriter(outputFilename));
+
+		try
+		{
+			if (csv)
+			{
+				out.println("file,text,audioSeconds,decodeSeconds,error");
+			}
+
+			for (int i = 0; i < mResults.length; ++i)
+			{
+				FileResult r = mResults[i];
+				String error = (null == r.error) ? "" : r.error;
+
+				if (csv)
+				{
+					out.println(quoteCsv(mFilenames[i]) + "," 
+						+ quoteCsv(r.text) + "," + r.audioSeconds + "," 
+						+ r.decodeSeconds + "," + quoteCsv(error));
+				}
+				else
+				{
+					out.println("{\"file\": " + quoteJson(mFilenames[i]) 
+						+ ", \"text\": " + quoteJson(r.text) 
+						+ ", \"audioSeconds\": " + r.audioSeconds 
+						+ ", \"decodeSeconds\": " + r.decodeSeconds 
+						+ (null == r.error ? "" : ", \"error\": " 
+						+ quoteJson(r.error)) + "}");
+				}
+			}
+		}
+		finally
+		{
+			out.close();
+		}
+	}
+
+	/// Reads a list of filenames, one per line, skipping blank lines.
+	static String[] readFileList(String filename) 
+		throws IOException
+	{
+		ArrayList<String> filenames = new ArrayList<String>();
+		BufferedReader in = new BufferedReader(new FileReader(filename));
+
+		try
+		{
+			String line = in.readLine();
+
+			while (null != line)
+			{
+				line = line.trim();
+
+				if (!line.equals(""))
+				{
+					filenames.add(line);
+				}
+
+				line = in.readLine();
+			}
+		}
+		finally
+		{
+			in.close();
+		}
+
+		return filenames.toArray(new String[filenames.size()]);
+	}
+
+	/// Returns the given string as a quoted CSV field.
+	static String quoteCsv(String s)
+	{
+		return "\"" + s.replace("\"", "\"\"") + "\"";
+	}
+
+	/// Returns the given string as a quoted JSON string.
+	static String quoteJson(String s)
+	{
+		StringBuilder quoted = new StringBuilder("\"");
+
+		for (int i = 0; i < s.length(); ++i)
+		{
+			char c = s.charAt(i);
+
+			if ('"' == c || '\\' == c)
+			{
+				quoted.append('\\').append(c);
+			}
+			else if (c < 0x20)
+			{
+				quoted.append(String.format("\\u%04x", (int)c));
+			}
+			else
+			{
+				quoted.append(c);
+			}
+		}
+
+		return quoted.append('"').toString();
+	}
+}
@@ -0,0 +1,409 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.ByteArrayInputStream;
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+import java.util.concurrent.atomic.AtomicInteger;
+import javax.sound.sampled.AudioFileFormat;
+import javax.sound.sampled.AudioFormat;
+import javax.sound.sampled.AudioInputStream;
+import javax.sound.sampled.AudioSystem;
+
+/// A command line tool that renders a list of prompts to WAV files 
+/// using several synthesis threads.  Each thread has its own instance 
+/// of the voice, since a FreeTTS voice synthesizes one message at a 
+/// time; the instances share the voice's lexicon (see 
+/// SpeechSynthesizer.loadVoice).  Results are written to a JSON lines 
+/// file, or a CSV file if the output filename ends in '.csv', with the 
+/// audio length and synthesis time of each prompt.  Usage:
+///
+/// java -cp voce.jar voce.BatchSynthesizer [options] jobList outputFile
+///
+/// 'jobList' is a text file with one prompt per line: the text, a tab, 
+/// and the WAV file to write.  The WAV files hold 16-bit mono samples 
+/// at the voice's sample rate.  Options:
+///
+/// -threads N - Number of synthesis threads (default: number of CPUs).
+/// -voice name - The voice to synthesize with (default: Kevin16).
+/// -scaling file - First render the whole list with 1, 2, 4 and so on 
+///   up to N threads, and write the throughput of each thread count to 
+///   this CSV file: seconds of audio per wall-clock second, and the 
+///   speedup over one thread.
+public class BatchSynthesizer
+{
+	/// The result of rendering one prompt.
+	private static class JobResult
+	{
+		String error = null;
+		double audioSeconds = 0;
+		double synthesisSeconds = 0;
+	}
+
+	/// The prompts being rendered and the files they are written to.
+	private String[] mTexts;
+	private String[] mWavFiles;
+
+	/// The results, in the same order as mTexts.
+	private JobResult[] mResults;
+
+	/// The index of the next prompt to be rendered.
+	private AtomicInteger mNextJob = new AtomicInteger(0);
+
+	/// The voice instances used by the synthesis threads, and the 
+	/// players they write into.
+	private com.sun.speech.freetts.Voice[] mVoices;
+	private BufferAudioPlayer[] mPlayers;
+
+	public static void main(String[] args)
+	{
+		int numThreads = Runtime.getRuntime().availableProcessors();
+		String voiceName = "Kevin16";
+		String scalingFilename = null;
+		java.util.ArrayList<String> positional = 
+			new java.util.ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-threads") && i + 1 < args.length)
+			{
+				numThreads = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-voice") && i + 1 < args.length)
+			{
+				voiceName = args[++i];
+			}
+			else if (args[i].equals("-scaling") && i + 1 < args.length)
+			{
+				scalingFilename = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 2 || numThreads < 1)
+		{
+			System.out.println("Usage: java voce.BatchSynthesizer " 
+				+ "[-threads N] [-voice name] [-scaling file] jobList " 
+				+ "outputFile");
+			System.exit(1);
+		}
+
+		try
+		{
+			BatchSynthesizer batch = new BatchSynthesizer(voiceName, 
+				numThreads);
+			batch.readJobList(positional.get(0));
+
+			if (null != scalingFilename)
+			{
+				batch.measureScaling(scalingFilename);
+			}
+
+			batch.run(numThreads);
+			batch.writeResults(positional.get(1));
+			batch.destroy();
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Batch synthesis failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+
+		System.exit(0);
+	}
+
+	/// Creates a batch synthesizer with up to 'numThreads' synthesis 
+	/// threads, loading an instance of the named voice for each.
+	public BatchSynthesizer(String voiceName, int numThreads) 
+		throws IOException
+	{
+		Utils.log("", "Loading " + numThreads + " instances of the " 
+			+ voiceName + " voice...");
+		mVoices = new com.sun.speech.freetts.Voice[numThreads];
+		mPlayers = new BufferAudioPlayer[numThreads];
+
+		for (int i = 0; i < numThreads; ++i)
+		{
+			mPlayers[i] = new BufferAudioPlayer();
+			mVoices[i] = SpeechSynthesizer.loadVoice(voiceName, 
+				mPlayers[i]);
+
+			if (null == mVoices[i])
+			{
+				destroy();
+				throw new IOException("Cannot load the voice " 
+					+ voiceName);
+			}
+		}
+	}
+
+	/// Reads the prompts to render: one per line, the text and the WAV 
+	/// file separated by a tab.
+	public void readJobList(String filename) throws IOException
+	{
+		String[] lines = BatchRecognizer.readFileList(filename);
+		mTexts = new String[lines.length];
+		mWavFiles = new String[lines.length];
+
+		for (int i = 0; i < lines.length; ++i)
+		{
+			int tab = lines[i].indexOf('\t');
+
+			if (tab < 0)
+			{
+				throw new IOException("No tab between the text and the " 
+					+ "WAV file on line " + (i + 1) + " of " + filename);
+			}
+
+			mTexts[i] = lines[i].substring(0, tab).trim();
+			mWavFiles[i] = lines[i].substring(tab + 1).trim();
+		}
+	}
+
+	/// Renders every prompt with 'numThreads' threads (at most the number 
+	/// of voice instances).  Prints a summary including the throughput, 
+	/// in seconds of audio per wall-clock second, and returns it.
+	public double run(int numThreads)
+	{
+		mResults = new JobResult[mTexts.length];
+		mNextJob.set(0);
+
+		Thread[] threads = new Thread[Math.min(numThreads, 
+			mVoices.length)];
+		long startTime = System.nanoTime();
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			final int index = i;
+
+			threads[i] = new Thread(new Runnable()
+				{
+					public void run()
+					{
+						synthesizeJobs(index);
+					}
+				}, "Batch synthesis thread " + i);
+			threads[i].start();
+		}
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			try
+			{
+				threads[i].join();
+			}
+			catch (InterruptedException e)
+			{
+			}
+		}
+
+		double wallSeconds = (System.nanoTime() - startTime) / 1e9;
+		double audioSeconds = 0;
+
+		for (int i = 0; i < mResults.length; ++i)
+		{
+			audioSeconds += mResults[i].audioSeconds;
+		}
+
+		double throughput = wallSeconds > 0 ? audioSeconds / wallSeconds 
+			: 0;
+		Utils.log("", "Rendered " + mResults.length + " prompts (" 
+			+ audioSeconds + " s of audio) in " + wallSeconds + " s using " 
+			+ threads.length + " threads: " + throughput 
+			+ " s of audio per second");
+		return throughput;
+	}
+
+	/// Renders every prompt with 1, 2, 4 and so on up to all of the voice 
+	/// instances, and writes the throughput of each thread count as CSV.
+	public void measureScaling(String outputFilename) throws IOException
+	{
+		PrintWriter out = new PrintWriter(new FileWriter(outputFilename));
+
+		try
+		{
+			out.println("threads,audioSecondsPerSecond,speedup");
+			double baseline = 0;
+
+			// The powers of two below the number of voices, then all of 
+			// them, whether or not that is a power of two.
+			ArrayList<Integer> counts = new ArrayList<Integer>();
+
+			for (int n = 1; n < mVoices.length; n *= 2)
+			{
+				counts.add(n);
+			}
+
+			counts.add(mVoices.length);
+
+			for (int i = 0; i < counts.size(); ++i)
+			{
+				int n = counts.get(i);
+				double throughput = run(n);
+				baseline = (1 == n) ? throughput : baseline;
+				out.println(n + "," + throughput + "," 
+					+ (baseline > 0 ? throughput / baseline : 0));
+				out.flush();
+			}
+		}
+		finally
+		{
+			out.close();
+		}
+	}
+
+	/// Deallocates the voice instances.
+	public void destroy()
+	{
+		for (int i = 0; i < mVoices.length; ++i)
+		{
+			if (null != mVoices[i])
+			{
+				mVoices[i].deallocate();
+				mVoices[i] = null;
+			}
+		}
+	}
+
+	/// The body of each synthesis thread.  Takes prompts from the list 
+	/// until none are left, rendering them with the given voice 
+	/// instance.
+	private void synthesizeJobs(int voiceIndex)
+	{
+		int i = mNextJob.getAndIncrement();
+
+		while (i < mTexts.length)
+		{
+			JobResult result = new JobResult();
+			long startTime = System.nanoTime();
+			BufferAudioPlayer player = mPlayers[voiceIndex];
+
+			try
+			{
+				short[] samples = SpeechSynthesizer.render(
+					mVoices[voiceIndex], player, mTexts[i]);
+
+				if (null == samples)
+				{
+					result.error = "Cannot synthesize the text";
+				}
+				else
+				{
+					writeWavFile(mWavFiles[i], samples, 
+						player.getSampleRate());
+					result.audioSeconds = (double)samples.length 
+						/ player.getSampleRate();
+				}
+			}
+			catch (Exception e)
+			{
+				// FreeTTS reports some bad input with runtime exceptions, 
+				// which must not end the thread and leave the result 
+				// missing.
+				result.error = (null == e.getMessage()) ? e.toString() 
+					: e.getMessage();
+				Utils.log("warning", "Cannot render " + mWavFiles[i] 
+					+ ": " + result.error);
+			}
+
+			result.synthesisSeconds = (System.nanoTime() - startTime) 
+				/ 1e9;
+			mResults[i] = result;
+			i = mNextJob.getAndIncrement();
+		}
+	}
+
+	/// Writes 16-bit mono samples to a WAV file.
+	static void writeWavFile(String filename, short[] samples, 
+		int sampleRate) throws IOException
+	{
+		byte[] bytes = new byte[2 * samples.length];
+
+		for (int i = 0; i < samples.length; ++i)
+		{
+			bytes[2 * i] = (byte)samples[i];
+			bytes[2 * i + 1] = (byte)(samples[i] >> 8);
+		}
+
+		AudioFormat format = new AudioFormat(sampleRate, 16, 1, true, 
+			false);
+		AudioInputStream stream = new AudioInputStream(
+			new ByteArrayInputStream(bytes), format, samples.length);
+		AudioSystem.write(stream, AudioFileFormat.Type.WAVE, 
+			new File(filename));
+	}
+
+	/// Writes the results as JSON lines, or as CSV if the filename ends 
+	/// in '.csv'.
+	private void writeResults(String outputFilename) throws IOException
+	{
+		boolean csv = outputFilename.toLowerCase().endsWith(".csv");
+		PrintWriter out = new PrintWriter(new FileWriter(outputFilename));
+
+		try
+		{
+			if (csv)
+			{
+				out.println("text,file,audioSeconds,synthesisSeconds," 
+					+ "error");
+			}
+
+			for (int i = 0; i < mResults.length; ++i)
+			{
+				JobResult r = mResults[i];
+				String error = (null == r.error) ? "" : r.error;
+
+				if (csv)
+				{
+					out.println(BatchRecognizer.quoteCsv(mTexts[i]) + "," 
+						+ BatchRecognizer.quoteCsv(mWavFiles[i]) + "," 
+						+ r.audioSeconds + "," + r.synthesisSeconds + "," 
+						+ BatchRecognizer.quoteCsv(error));
+				}
+				else
+				{
+					out.println("{\"text\": " 
+						+ BatchRecognizer.quoteJson(mTexts[i]) 
+						+ ", \"file\": " 
+						+ BatchRecognizer.quoteJson(mWavFiles[i]) 
+						+ ", \"audioSeconds\": " + r.audioSeconds 
+						+ ", \"synthesisSeconds\": " + r.synthesisSeconds 
+						+ (null == r.error ? "" : ", \"error\": " 
+						+ BatchRecognizer.quoteJson(r.error)) + "}");
+				}
+			}
+		}
+		finally
+		{
+			out.close();
+		}
+	}
+}
@@ -0,0 +1,159 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import com.sun.speech.freetts.audio.AudioPlayer;
+
+import java.io.ByteArrayOutputStream;
+import javax.sound.sampled.AudioFormat;
+
+/// A FreeTTS audio player that keeps the synthesized audio in memory 
+/// instead of playing it, so no audio line is ever opened.  Used by 
+/// SpeechSynthesizer.synthesizeToBuffer.
+public class BufferAudioPlayer implements AudioPlayer
+{
+	/// The format FreeTTS writes the audio in.  Read by other threads 
+	/// through getSampleRate.
+	private volatile AudioFormat mFormat = new AudioFormat(16000, 16, 1, true, 
+		true);
+
+	/// The audio written since the last reset, in 'mFormat'.
+	private ByteArrayOutputStream mAudio = new ByteArrayOutputStream();
+
+	private float mVolume = 1.0f;
+
+	public void setAudioFormat(AudioFormat format)
+	{
+		mFormat = format;
+	}
+
+	public AudioFormat getAudioFormat()
+	{
+		return mFormat;
+	}
+
+	/// Returns the sample rate of the audio, in Hz.
+	public int getSampleRate()
+	{
+		return (int)mFormat.getSampleRate();
+	}
+
+	/// Returns the audio written since the last reset as 16-bit samples, 
+	/// or null if FreeTTS wrote it in a format other than 16-bit mono.
+	public short[] getSamples()
+	{
+		if (mFormat.getSampleSizeInBits() != 16 
+			|| mFormat.getChannels() != 1)
+		{
+			Utils.log("ERROR", "Unsupported synthesized audio format: " 
+				+ mFormat);
+			return null;
+		}
+
+		byte[] bytes = mAudio.toByteArray();
+		short[] samples = new short[bytes.length / 2];
+		int high = mFormat.isBigEndian() ? 0 : 1;
+
+		for (int i = 0; i < samples.length; ++i)
+		{
+			samples[i] = (short)((bytes[2 * i + high] << 8) 
+				| (bytes[2 * i + 1 - high] & 0xff));
+		}
+
+		return samples;
+	}
+
+	/// Discards the audio written so far.
+	public void reset()
+	{
+		mAudio.reset();
+	}
+
+	public boolean write(byte[] audioData)
+	{
+		return write(audioData, 0, audioData.length);
+	}
+
+	public boolean write(byte[] audioData, int offset, int size)
+	{
+		mAudio.write(audioData, offset, size);
+		return true;
+	}
+
+	public void begin(int size)
+	{
+	}
+
+	public boolean end()
+	{
+		return true;
+	}
+
+	public boolean drain()
+	{
+		return true;
+	}
+
+	public void pause()
+	{
+	}
+
+	public void resume()
+	{
+	}
+
+	public void cancel()
+	{
+	}
+
+	public void close()
+	{
+	}
+
+	public float getVolume()
+	{
+		return mVolume;
+	}
+
+	public void setVolume(float volume)
+	{
+		mVolume = volume;
+	}
+
+	public long getTime()
+	{
+		return 0;
+	}
+
+	public void resetTime()
+	{
+	}
+
+	public void startFirstSampleTimer()
+	{
+	}
+
+	public void showMetrics()
+	{
+	}
+}
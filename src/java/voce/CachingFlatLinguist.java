@@ -0,0 +1,324 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.linguist.SearchGraph;
+import edu.cmu.sphinx.linguist.acoustic.AcousticModel;
+import edu.cmu.sphinx.linguist.dictionary.Dictionary;
+import edu.cmu.sphinx.linguist.flat.FlatLinguist;
+import edu.cmu.sphinx.linguist.language.grammar.Grammar;
+import edu.cmu.sphinx.linguist.language.grammar.GrammarNode;
+import edu.cmu.sphinx.util.StatisticsVariable;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.lang.reflect.Field;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.Arrays;
+import java.util.Properties;
+
+/// A FlatLinguist that keeps its compiled search graph in a cache file.  
+/// If the file holds a graph built from the same grammar, dictionary and 
+/// acoustic model, allocate reads it instead of parsing the grammar and 
+/// compiling the graph; otherwise the graph is compiled as usual and 
+/// written to the file for next time.  The grammar itself is still 
+/// loaded, so it can be used and replaced as usual.  Grammars set after 
+/// allocation (see SpeechRecognizer.setGrammar) are always compiled.  
+/// The recognizer only uses this linguist when the 'grammarCache' 
+/// option is set.
+public class CachingFlatLinguist extends FlatLinguist
+{
+	/// The Sphinx property for the cache file.  An empty name disables 
+	/// the cache.
+	public static final String PROP_CACHE_FILE = "cacheFile";
+
+	/// The Sphinx property for the key identifying everything the graph 
+	/// is built from.  See computeCacheKey.
+	public static final String PROP_CACHE_KEY = "cacheKey";
+
+	/// The Sphinx property for the dictionary used by the grammar.  Words 
+	/// in a cached graph are looked up in it.
+	public static final String PROP_DICTIONARY = "dictionary";
+
+	private AcousticModel mAcousticModel = null;
+	private Grammar mGrammar = null;
+	private Dictionary mDictionary = null;
+	private String mCacheFile = "";
+	private String mCacheKey = "";
+
+	/// The graph read from the cache file, or null if the graph was 
+	/// compiled.
+	private SearchGraph mCachedGraph = null;
+
+	/// The grammar's initial node when the cached graph was read.  A 
+	/// different node means the grammar has been replaced since.
+	private GrammarNode mCachedGrammarNode = null;
+
+	/// The statistics FlatLinguist updates while compiling a graph.  Its 
+	/// allocate creates them before compiling the first graph.
+	private static final String[] STATISTICS = {"totalStates", 
+		"totalArcs", "actualArcs"};
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		super.register(name, registry);
+		registry.register(PROP_CACHE_FILE, PropertyType.STRING);
+		registry.register(PROP_CACHE_KEY, PropertyType.STRING);
+		registry.register(PROP_DICTIONARY, PropertyType.COMPONENT);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		super.newProperties(ps);
+		mAcousticModel = (AcousticModel) ps.getComponent(
+			PROP_ACOUSTIC_MODEL, AcousticModel.class);
+		mGrammar = (Grammar) ps.getComponent(PROP_GRAMMAR, Grammar.class);
+		mDictionary = (Dictionary) ps.getComponent(PROP_DICTIONARY, 
+			Dictionary.class);
+		mCacheFile = ps.getString(PROP_CACHE_FILE, "");
+		mCacheKey = ps.getString(PROP_CACHE_KEY, "");
+	}
+
+	/// Reads the search graph from the cache file if possible.  
+	/// Otherwise compiles it and writes it to the cache file.
+	public void allocate() throws IOException
+	{
+		if (mCacheFile.equals(""))
+		{
+			super.allocate();
+			return;
+		}
+
+		long startTime = System.currentTimeMillis();
+		File file = new File(mCacheFile);
+
+		// The acoustic model and dictionary are needed to read the 
+		// graph.
+		allocateAcousticModel();
+		mDictionary.allocate();
+
+		try
+		{
+			mCachedGraph = SearchGraphFile.read(file, mCacheKey, 
+				mAcousticModel, mDictionary);
+		}
+		catch (IOException e)
+		{
+			Utils.log("warning", "Cannot read search graph cache " 
+				+ mCacheFile + ": " + e.getMessage());
+			mCachedGraph = null;
+		}
+
+		if (null != mCachedGraph && !createStatistics())
+		{
+			mCachedGraph = null;
+		}
+
+		if (null != mCachedGraph)
+		{
+			// Everything FlatLinguist.allocate does except compiling the 
+			// graph: the grammar is loaded so it can be replaced later.
+			mGrammar.allocate();
+			mCachedGrammarNode = mGrammar.getInitialNode();
+			Utils.log("", "Search graph loaded from cache in " 
+				+ (System.currentTimeMillis() - startTime) + " ms");
+			return;
+		}
+
+		super.allocate();
+		Utils.log("", "Search graph compiled in " 
+			+ (System.currentTimeMillis() - startTime) + " ms");
+
+		try
+		{
+			SearchGraphFile.write(super.getSearchGraph(), mCacheKey, file);
+		}
+		catch (IOException e)
+		{
+			Utils.log("warning", "Cannot write search graph cache " 
+				+ mCacheFile + ": " + e.getMessage());
+		}
+	}
+
+	/// Creates the statistics FlatLinguist.allocate creates before it 
+	/// compiles the first graph, so a grammar that replaces the cached 
+	/// one can be compiled later.  FlatLinguist keeps them in private 
+	/// fields, which are set through reflection.  Returns false if that 
+	/// is not possible, in which case the graph must be compiled.
+	private boolean createStatistics()
+	{
+		try
+		{
+			for (int i = 0; i < STATISTICS.length; ++i)
+			{
+				Field field = FlatLinguist.class.getDeclaredField(
+					STATISTICS[i]);
+				field.setAccessible(true);
+				field.set(this, StatisticsVariable.getStatisticsVariable(
+					getName(), STATISTICS[i]));
+			}
+		}
+		catch (Exception e)
+		{
+			Utils.log("warning", "Cannot use search graph cache " 
+				+ mCacheFile + ": " + e);
+			return false;
+		}
+
+		return true;
+	}
+
+	/// Keeps using the cached graph until the grammar is replaced.
+	public void startRecognition()
+	{
+		if (null != mCachedGraph)
+		{
+			if (mGrammar.getInitialNode() == mCachedGrammarNode)
+			{
+				return;
+			}
+
+			mCachedGraph = null;
+		}
+
+		super.startRecognition();
+	}
+
+	public SearchGraph getSearchGraph()
+	{
+		if (null != mCachedGraph)
+		{
+			return mCachedGraph;
+		}
+
+		return super.getSearchGraph();
+	}
+
+	/// Returns a key identifying everything a search graph depends on: 
+	/// the grammar name and the .gram files in 'grammarPath', the config 
+	/// file (which names the dictionary and acoustic model and holds the 
+	/// linguist's settings), the name, size and date of every entry on 
+	/// the class path (which contain the dictionary and model data), and 
+	/// the dictionary options in 'options': the name, size and date of 
+	/// the compiled 'dictionary' file and the 'pruneDictionary' setting.
+	public static String computeCacheKey(String configFilename, 
+		String grammarPath, String grammarName, Properties options) 
+		throws IOException
+	{
+		MessageDigest digest;
+
+		try
+		{
+			digest = MessageDigest.getInstance("MD5");
+		}
+		catch (NoSuchAlgorithmException e)
+		{
+			throw new IOException("MD5 is not available");
+		}
+
+		digest.update(grammarName.getBytes("UTF-8"));
+		digestFile(digest, new File(configFilename));
+
+		File[] grammarFiles = new File(grammarPath).listFiles();
+
+		if (null != grammarFiles)
+		{
+			Arrays.sort(grammarFiles);
+
+			for (int i = 0; i < grammarFiles.length; ++i)
+			{
+				if (grammarFiles[i].getName().endsWith(".gram"))
+				{
+					digest.update(grammarFiles[i].getName().getBytes(
+						"UTF-8"));
+					digestFile(digest, grammarFiles[i]);
+				}
+			}
+		}
+
+		String[] classPath = System.getProperty("java.class.path", "")
+			.split(File.pathSeparator);
+
+		for (int i = 0; i < classPath.length; ++i)
+		{
+			File entry = new File(classPath[i]);
+			digest.update((entry.getAbsolutePath() + " " + entry.length() 
+				+ " " + entry.lastModified()).getBytes("UTF-8"));
+		}
+
+		String dictionaryFile = options.getProperty("dictionary");
+
+		if (null != dictionaryFile)
+		{
+			File dictionary = new File(dictionaryFile);
+			digest.update(("dictionary " + dictionary.getAbsolutePath() 
+				+ " " + dictionary.length() + " " 
+				+ dictionary.lastModified()).getBytes("UTF-8"));
+		}
+
+		digest.update(("pruneDictionary " + "true".equals(
+			options.getProperty("pruneDictionary"))).getBytes("UTF-8"));
+
+		byte[] hash = digest.digest();
+		StringBuffer key = new StringBuffer();
+
+		for (int i = 0; i < hash.length; ++i)
+		{
+			key.append(Integer.toHexString((hash[i] >> 4) & 0xf));
+			key.append(Integer.toHexString(hash[i] & 0xf));
+		}
+
+		return key.toString();
+	}
+
+	/// Adds the contents of 'file' to 'digest'.
+	static void digestFile(MessageDigest digest, File file) 
+		throws IOException
+	{
+		InputStream in = new FileInputStream(file);
+		byte[] buffer = new byte[8192];
+
+		try
+		{
+			int count = in.read(buffer);
+
+			while (count > 0)
+			{
+				digest.update(buffer, 0, count);
+				count = in.read(buffer);
+			}
+		}
+		finally
+		{
+			in.close();
+		}
+	}
+}
@@ -0,0 +1,533 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.linguist.acoustic.UnitManager;
+import edu.cmu.sphinx.linguist.dictionary.Word;
+
+import java.io.BufferedOutputStream;
+import java.io.BufferedReader;
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.InputStreamReader;
+import java.io.OutputStream;
+import java.net.MalformedURLException;
+import java.net.URL;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.Set;
+import java.util.StringTokenizer;
+
+/// A command line tool that compiles a Sphinx pronunciation dictionary 
+/// and its filler dictionary (the text files read by FastDictionary) 
+/// into the binary format read by MappedDictionary.  Usage:
+///
+/// java -cp voce.jar voce.DictionaryCompiler [-vocabulary file] 
+///   dictionary fillerDictionary outputFile
+///
+/// The dictionaries can be files or URLs, such as a jar: URL pointing 
+/// into the acoustic model jar.  If a vocabulary file (one word per 
+/// line, like vocabulary.txt) is given, only the words it lists are 
+/// compiled, along with all the filler words.
+public class DictionaryCompiler
+{
+	/// The most units, pronunciations per word, or characters per 
+	/// spelling an entry can have.
+	private static final int MAX_COUNT = 255;
+
+	/// Seeds tried for one hash bucket before giving up.
+	private static final int MAX_SEED = 1 << 24;
+
+	/// A word and its pronunciations, each an array of unit names.
+	private static class Entry
+	{
+		String spelling;
+		boolean isFiller;
+		ArrayList<String[]> pronunciations = new ArrayList<String[]>();
+	}
+
+	/// The words to compile, in the order they were read.
+	private LinkedHashMap<String, Entry> mEntries = 
+		new LinkedHashMap<String, Entry>();
+
+	/// The words to read, or null to read them all.
+	private Set<String> mVocabulary = null;
+
+	public static void main(String[] args)
+	{
+		String vocabularyFilename = null;
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-vocabulary") && i + 1 < args.length)
+			{
+				vocabularyFilename = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 3)
+		{
+			System.out.println("Usage: java voce.DictionaryCompiler " 
+				+ "[-vocabulary file] dictionary fillerDictionary " 
+				+ "outputFile");
+			System.exit(1);
+		}
+
+		try
+		{
+			long startTime = System.currentTimeMillis();
+			DictionaryCompiler compiler = new DictionaryCompiler();
+
+			if (null != vocabularyFilename)
+			{
+				compiler.setVocabulary(readVocabulary(vocabularyFilename));
+			}
+
+			compiler.read(positional.get(0), false);
+			compiler.read(positional.get(1), true);
+
+			File output = new File(positional.get(2));
+			compiler.write(output);
+			Utils.log("", "Compiled " + compiler.mEntries.size() 
+				+ " words into " + output + " (" + output.length() 
+				+ " bytes) in " + (System.currentTimeMillis() - startTime) 
+				+ " ms");
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Dictionary compilation failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+
+		System.exit(0);
+	}
+
+	/// Reads a dictionary file: one pronunciation per line, the word 
+	/// followed by its units.  Alternate pronunciations are listed as 
+	/// separate words with a "(2)", "(3)", etc. suffix; these are merged 
+	/// into the word's entry, as FastDictionary does.  If a vocabulary 
+	/// has been set, the other words are skipped as they are read.
+	public void read(String location, boolean isFiller) throws IOException
+	{
+		BufferedReader reader = new BufferedReader(new InputStreamReader(
+			openLocation(location), "ISO-8859-1"));
+
+		try
+		{
+			String line;
+
+			while (null != (line = reader.readLine()))
+			{
+				StringTokenizer tokens = new StringTokenizer(line);
+
+				if (!tokens.hasMoreTokens() || line.startsWith(";;;") 
+					|| line.startsWith("#"))
+				{
+					continue;
+				}
+
+				String spelling = tokens.nextToken().toLowerCase();
+				int variant = spelling.indexOf('(');
+
+				if (variant > 0 && spelling.endsWith(")"))
+				{
+					spelling = spelling.substring(0, variant);
+				}
+
+				if (!isFiller && null != mVocabulary 
+					&& !mVocabulary.contains(spelling))
+				{
+					continue;
+				}
+
+				String[] units = new String[tokens.countTokens()];
+
+				for (int i = 0; i < units.length; ++i)
+				{
+					units[i] = tokens.nextToken();
+				}
+
+				if (0 == units.length || units.length > MAX_COUNT 
+					|| spelling.length() > MAX_COUNT)
+				{
+					throw new IOException("Bad dictionary entry in " 
+						+ location + ": " + line);
+				}
+
+				Entry entry = mEntries.get(spelling);
+
+				if (null != entry && isFiller && !entry.isFiller)
+				{
+					// A word in both dictionaries keeps its filler 
+					// pronunciations, so it is still listed among the 
+					// filler words as it is with FullDictionary.
+					mEntries.remove(spelling);
+					entry = null;
+				}
+
+				if (null == entry)
+				{
+					entry = new Entry();
+					entry.spelling = spelling;
+					entry.isFiller = isFiller;
+					mEntries.put(spelling, entry);
+				}
+
+				entry.pronunciations.add(units);
+			}
+		}
+		finally
+		{
+			reader.close();
+		}
+	}
+
+	/// Limits the words read by later calls to 'read' to the given 
+	/// (lowercase) spellings.  Filler words are always read.
+	public void setVocabulary(Set<String> vocabulary)
+	{
+		mVocabulary = vocabulary;
+	}
+
+	/// Reads a vocabulary file: one word per line.
+	public static Set<String> readVocabulary(String vocabularyFilename) 
+		throws IOException
+	{
+		HashSet<String> vocabulary = new HashSet<String>();
+		BufferedReader reader = new BufferedReader(new InputStreamReader(
+			openLocation(vocabularyFilename), "ISO-8859-1"));
+
+		try
+		{
+			String line;
+
+			while (null != (line = reader.readLine()))
+			{
+				line = line.trim();
+
+				if (line.length() > 0)
+				{
+					vocabulary.add(line.toLowerCase());
+				}
+			}
+		}
+		finally
+		{
+			reader.close();
+		}
+
+		return vocabulary;
+	}
+
+	/// Creates a Word, with its pronunciations, for every word read so 
+	/// far.  See ScopedDictionary.
+	Word[] createWords(UnitManager unitManager, 
+		boolean addSilEndingPronunciation) throws IOException
+	{
+		Word[] words = new Word[mEntries.size()];
+		int i = 0;
+
+		for (Entry entry : mEntries.values())
+		{
+			words[i++] = MappedDictionary.createWord(entry.spelling, 
+				entry.pronunciations, entry.isFiller, unitManager, 
+				addSilEndingPronunciation);
+		}
+
+		return words;
+	}
+
+	/// Writes the binary dictionary.  See MappedDictionary for how it is 
+	/// read.
+	public void write(File file) throws IOException
+	{
+		Entry[] entries = mEntries.values().toArray(new Entry[0]);
+
+		// Number the units and lay out the entries.
+		HashMap<String, Integer> unitNumbers = new HashMap<String, Integer>();
+		ArrayList<String> unitNames = new ArrayList<String>();
+		ByteArrayOutputStream entryBytes = new ByteArrayOutputStream();
+		int[] entryOffsets = new int[entries.length];
+		ArrayList<Integer> fillers = new ArrayList<Integer>();
+
+		for (int i = 0; i < entries.length; ++i)
+		{
+			Entry entry = entries[i];
+			entryOffsets[i] = entryBytes.size();
+
+			if (entry.isFiller)
+			{
+				fillers.add(new Integer(i));
+			}
+
+			if (entry.pronunciations.size() > MAX_COUNT)
+			{
+				throw new IOException("Too many pronunciations for " 
+					+ entry.spelling);
+			}
+
+			entryBytes.write(entry.isFiller ? MappedDictionary.FILLER : 0);
+			writeString(entryBytes, entry.spelling);
+			entryBytes.write(entry.pronunciations.size());
+
+			for (String[] units : entry.pronunciations)
+			{
+				entryBytes.write(units.length);
+
+				for (int j = 0; j < units.length; ++j)
+				{
+					Integer number = unitNumbers.get(units[j]);
+
+					if (null == number)
+					{
+						if (unitNames.size() > MAX_COUNT)
+						{
+							throw new IOException("Too many units");
+						}
+
+						number = new Integer(unitNames.size());
+						unitNumbers.put(units[j], number);
+						unitNames.add(units[j]);
+					}
+
+					entryBytes.write(number.intValue());
+				}
+			}
+		}
+
+		int[] seeds = new int[Math.max(1, entries.length / 4)];
+		int[] slots = buildHashTable(entries, seeds);
+
+		int unitNamesSize = 0;
+
+		for (int i = 0; i < unitNames.size(); ++i)
+		{
+			unitNamesSize += 1 + unitNames.get(i).length();
+		}
+
+		int entriesOffset = MappedDictionary.HEADER_SIZE + unitNamesSize 
+			+ 4 * (seeds.length + slots.length + fillers.size());
+
+		DataOutputStream out = new DataOutputStream(new BufferedOutputStream(
+			new FileOutputStream(file)));
+
+		try
+		{
+			out.writeInt(MappedDictionary.MAGIC);
+			out.writeInt(MappedDictionary.VERSION);
+			out.writeInt(unitNames.size());
+			out.writeInt(entries.length);
+			out.writeInt(seeds.length);
+			out.writeInt(fillers.size());
+
+			for (int i = 0; i < unitNames.size(); ++i)
+			{
+				writeString(out, unitNames.get(i));
+			}
+
+			for (int i = 0; i < seeds.length; ++i)
+			{
+				out.writeInt(seeds[i]);
+			}
+
+			for (int i = 0; i < slots.length; ++i)
+			{
+				out.writeInt(entriesOffset + entryOffsets[slots[i]]);
+			}
+
+			for (int i = 0; i < fillers.size(); ++i)
+			{
+				out.writeInt(entriesOffset 
+					+ entryOffsets[fillers.get(i).intValue()]);
+			}
+
+			entryBytes.writeTo(out);
+		}
+		finally
+		{
+			out.close();
+		}
+	}
+
+	/// Builds a minimal perfect hash table for the entries' spellings 
+	/// (hash and displace): the words are split into buckets by one hash, 
+	/// then, starting with the largest bucket, each bucket gets the first 
+	/// seed for which a second hash sends all its words to free slots.  
+	/// Fills in 'seeds' (one per bucket) and returns, for each slot, the 
+	/// index of the entry that hashes to it.
+	private static int[] buildHashTable(final Entry[] entries, int[] seeds) 
+		throws IOException
+	{
+		final int numBuckets = seeds.length;
+		final int[] bucketSizes = new int[numBuckets];
+		int[] bucketOf = new int[entries.length];
+
+		for (int i = 0; i < entries.length; ++i)
+		{
+			bucketOf[i] = MappedDictionary.hash(entries[i].spelling, 0) 
+				% numBuckets;
+			++bucketSizes[bucketOf[i]];
+		}
+
+		// Group the entries by bucket.
+		int[] bucketStart = new int[numBuckets + 1];
+
+		for (int b = 0; b < numBuckets; ++b)
+		{
+			bucketStart[b + 1] = bucketStart[b] + bucketSizes[b];
+		}
+
+		int[] members = new int[entries.length];
+		int[] filled = new int[numBuckets];
+
+		for (int i = 0; i < entries.length; ++i)
+		{
+			int b = bucketOf[i];
+			members[bucketStart[b] + filled[b]++] = i;
+		}
+
+		Integer[] order = new Integer[numBuckets];
+
+		for (int b = 0; b < numBuckets; ++b)
+		{
+			order[b] = new Integer(b);
+		}
+
+		Arrays.sort(order, new Comparator<Integer>()
+		{
+			public int compare(Integer a, Integer b)
+			{
+				return bucketSizes[b.intValue()] - bucketSizes[a.intValue()];
+			}
+		});
+
+		int[] slots = new int[entries.length];
+		Arrays.fill(slots, -1);
+		int[] trial = new int[MAX_COUNT];
+
+		for (int k = 0; k < numBuckets; ++k)
+		{
+			int b = order[k].intValue();
+			int size = bucketSizes[b];
+
+			if (0 == size)
+			{
+				break;
+			}
+
+			if (size > MAX_COUNT)
+			{
+				throw new IOException("Hash bucket too large");
+			}
+
+			int seed = 1;
+
+			for (; seed < MAX_SEED; ++seed)
+			{
+				boolean fits = true;
+
+				for (int j = 0; j < size && fits; ++j)
+				{
+					String spelling = entries[members[bucketStart[b] + j]]
+						.spelling;
+					trial[j] = MappedDictionary.hash(spelling, seed) 
+						% entries.length;
+					fits = -1 == slots[trial[j]];
+
+					for (int m = 0; m < j && fits; ++m)
+					{
+						fits = trial[m] != trial[j];
+					}
+				}
+
+				if (fits)
+				{
+					break;
+				}
+			}
+
+			if (MAX_SEED == seed)
+			{
+				throw new IOException("Cannot build the hash table");
+			}
+
+			seeds[b] = seed;
+
+			for (int j = 0; j < size; ++j)
+			{
+				slots[trial[j]] = members[bucketStart[b] + j];
+			}
+		}
+
+		return slots;
+	}
+
+	/// Writes a string as a length byte followed by one byte per 
+	/// character.
+	private static void writeString(OutputStream out, String s) 
+		throws IOException
+	{
+		out.write(s.length());
+
+		for (int i = 0; i < s.length(); ++i)
+		{
+			char c = s.charAt(i);
+
+			if (c > 0xff)
+			{
+				throw new IOException("Unsupported character in " + s);
+			}
+
+			out.write(c);
+		}
+	}
+
+	/// Opens a file or URL.
+	private static InputStream openLocation(String location) 
+		throws IOException
+	{
+		try
+		{
+			return new URL(location).openStream();
+		}
+		catch (MalformedURLException e)
+		{
+			return new FileInputStream(location);
+		}
+	}
+}
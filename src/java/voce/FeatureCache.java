@@ -0,0 +1,408 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.frontend.BaseDataProcessor;
+import edu.cmu.sphinx.frontend.Data;
+import edu.cmu.sphinx.frontend.DataEndSignal;
+import edu.cmu.sphinx.frontend.DataProcessingException;
+import edu.cmu.sphinx.frontend.DataStartSignal;
+import edu.cmu.sphinx.frontend.FloatData;
+import edu.cmu.sphinx.frontend.Signal;
+import edu.cmu.sphinx.frontend.endpoint.SpeechEndSignal;
+import edu.cmu.sphinx.frontend.endpoint.SpeechStartSignal;
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.BufferUnderflowException;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+
+/// The last stage of the 'cachedFileFrontEnd' pipeline.  It can record 
+/// the feature vectors and signals coming out of the rest of the front 
+/// end to a feature file while passing them on, and replay a feature 
+/// file later instead of asking the rest of the front end for anything, 
+/// so that re-decoding an audio file (under a new grammar or new beam 
+/// widths, for example) skips reading the audio, endpointing and 
+/// feature extraction.  Otherwise it passes data through.  See the 
+/// 'featureCache' option of SpeechInterface.init and 
+/// FeatureCacheBenchmark.
+///
+/// A feature file starts with MAGIC, VERSION and the key of the audio 
+/// and front end it was recorded from (see computeKey), followed by 
+/// records that each start with a type byte.  A FORMAT record holds the 
+/// sample rate and the length of the feature vectors that follow it.  A 
+/// FRAME record holds a vector's first sample number and its values.  
+/// Signal records hold the signal's time, plus the duration for 
+/// DataEndSignals.  Numbers are big-endian, as DataOutputStream writes 
+/// them.  With the default front end a file takes about half the space 
+/// of the audio.
+public class FeatureCache extends BaseDataProcessor
+{
+	/// Identifies feature files ("VCFT").
+	private static final int MAGIC = 0x56434654;
+
+	/// The version of the file format.
+	private static final int VERSION = 1;
+
+	/// The kinds of records.
+	private static final byte FORMAT = 0;
+	private static final byte FRAME = 1;
+	private static final byte DATA_START = 2;
+	private static final byte DATA_END = 3;
+	private static final byte SPEECH_START = 4;
+	private static final byte SPEECH_END = 5;
+
+	/// The file being recorded, or null.  It is written under a 
+	/// temporary name until the audio has been read to its end.
+	private DataOutputStream mRecording = null;
+	private File mRecordingFile = null;
+	private File mRecordingTempFile = null;
+
+	/// The format of the last FORMAT record written or read.
+	private int mSampleRate = -1;
+	private int mFeatureLength = -1;
+
+	/// The file being replayed, or null.
+	private MappedByteBuffer mReplay = null;
+
+	/// Returns a key identifying what a feature file for 'audioFilename' 
+	/// depends on: the audio file's path, size and date, the config file 
+	/// (which holds the front end's settings) and the name of the front 
+	/// end in it.
+	public static String computeKey(String configFilename, 
+		String frontEndName, String audioFilename) throws IOException
+	{
+		MessageDigest digest;
+
+		try
+		{
+			digest = MessageDigest.getInstance("MD5");
+		}
+		catch (NoSuchAlgorithmException e)
+		{
+			throw new IOException("MD5 is not available");
+		}
+
+		File audio = new File(audioFilename);
+		digest.update((audio.getAbsolutePath() + " " + audio.length() + " " 
+			+ audio.lastModified() + " " + frontEndName).getBytes("UTF-8"));
+		CachingFlatLinguist.digestFile(digest, new File(configFilename));
+		return toHex(digest.digest());
+	}
+
+	/// Returns the file in 'cacheDirectory' that holds the features of 
+	/// 'audioFilename'.  It is named after a hash of the audio file's 
+	/// path, so that files with the same name in different directories 
+	/// do not share it.
+	public static File getCacheFile(String cacheDirectory, 
+		String audioFilename) throws IOException
+	{
+		try
+		{
+			MessageDigest digest = MessageDigest.getInstance("MD5");
+			String path = new File(audioFilename).getAbsolutePath();
+			return new File(cacheDirectory, toHex(digest.digest(
+				path.getBytes("UTF-8"))) + ".features");
+		}
+		catch (NoSuchAlgorithmException e)
+		{
+			throw new IOException("MD5 is not available");
+		}
+	}
+
+	private static String toHex(byte[] hash)
+	{
+		StringBuffer hex = new StringBuffer();
+
+		for (int i = 0; i < hash.length; ++i)
+		{
+			hex.append(Integer.toHexString((hash[i] >> 4) & 0xf));
+			hex.append(Integer.toHexString(hash[i] & 0xf));
+		}
+
+		return hex.toString();
+	}
+
+	/// Starts recording everything that passes through to 'file', 
+	/// identified by 'key'.  The file replaces any existing one once the 
+	/// end of the audio is reached; stop discards it before then.
+	public void record(File file, String key) throws IOException
+	{
+		stop();
+		file.getAbsoluteFile().getParentFile().mkdirs();
+		mRecordingFile = file;
+		mRecordingTempFile = new File(file.getPath() + ".tmp");
+		mRecording = new DataOutputStream(new BufferedOutputStream(
+			new FileOutputStream(mRecordingTempFile)));
+		mRecording.writeInt(MAGIC);
+		mRecording.writeInt(VERSION);
+		mRecording.writeUTF(key);
+		mSampleRate = -1;
+		mFeatureLength = -1;
+	}
+
+	/// Starts replaying 'file' instead of reading from the rest of the 
+	/// front end.  Returns false, and does nothing, if the file does not 
+	/// exist or was recorded with a different key.
+	public boolean replay(File file, String key) throws IOException
+	{
+		stop();
+
+		if (!file.exists())
+		{
+			return false;
+		}
+
+		MappedByteBuffer in;
+		FileInputStream stream = new FileInputStream(file);
+
+		try
+		{
+			FileChannel channel = stream.getChannel();
+			in = channel.map(FileChannel.MapMode.READ_ONLY, 0, 
+				channel.size());
+		}
+		finally
+		{
+			stream.close();
+		}
+
+		try
+		{
+			if (MAGIC != in.getInt() || VERSION != in.getInt())
+			{
+				return false;
+			}
+
+			byte[] bytes = new byte[in.getShort() & 0xffff];
+			in.get(bytes);
+
+			if (!key.equals(new String(bytes, "UTF-8")))
+			{
+				return false;
+			}
+		}
+		catch (BufferUnderflowException e)
+		{
+			return false;
+		}
+
+		mReplay = in;
+		mSampleRate = -1;
+		mFeatureLength = -1;
+		return true;
+	}
+
+	/// Stops recording or replaying.  A recording that has not reached 
+	/// the end of the audio is discarded.
+	public void stop()
+	{
+		mReplay = null;
+
+		if (null != mRecording)
+		{
+			try
+			{
+				mRecording.close();
+			}
+			catch (IOException e)
+			{
+			}
+
+			mRecordingTempFile.delete();
+			mRecording = null;
+		}
+	}
+
+	/// Returns true while a file is being replayed.
+	public boolean isReplaying()
+	{
+		return null != mReplay;
+	}
+
+	/// Returns the next feature vector or signal, from the file being 
+	/// replayed or else from the rest of the front end.
+	public Data getData() throws DataProcessingException
+	{
+		if (null != mReplay)
+		{
+			return readRecord();
+		}
+
+		Data data = getPredecessor().getData();
+
+		if (null != mRecording)
+		{
+			getTimer().start();
+
+			try
+			{
+				writeRecord(data);
+			}
+			catch (IOException e)
+			{
+				Utils.log("warning", "Cannot write feature file " 
+					+ mRecordingFile + ": " + e.getMessage());
+				stop();
+			}
+
+			getTimer().stop();
+		}
+
+		return data;
+	}
+
+	/// Writes a record for 'data' to the recording.  Null marks the end 
+	/// of the audio, which completes the file.
+	private void writeRecord(Data data) throws IOException
+	{
+		if (null == data)
+		{
+			mRecording.close();
+			mRecording = null;
+			mRecordingFile.delete();
+
+			if (!mRecordingTempFile.renameTo(mRecordingFile))
+			{
+				mRecordingTempFile.delete();
+				throw new IOException("Cannot rename " + mRecordingTempFile);
+			}
+		}
+		else if (data instanceof FloatData)
+		{
+			FloatData frame = (FloatData) data;
+			float[] values = frame.getValues();
+
+			if (values.length != mFeatureLength 
+				|| frame.getSampleRate() != mSampleRate)
+			{
+				mFeatureLength = values.length;
+				mSampleRate = frame.getSampleRate();
+				mRecording.writeByte(FORMAT);
+				mRecording.writeInt(mSampleRate);
+				mRecording.writeInt(mFeatureLength);
+			}
+
+			mRecording.writeByte(FRAME);
+			mRecording.writeLong(frame.getFirstSampleNumber());
+
+			for (int i = 0; i < values.length; ++i)
+			{
+				mRecording.writeFloat(values[i]);
+			}
+		}
+		else if (data instanceof DataStartSignal)
+		{
+			writeSignal(DATA_START, (Signal) data);
+		}
+		else if (data instanceof DataEndSignal)
+		{
+			writeSignal(DATA_END, (Signal) data);
+			mRecording.writeLong(((DataEndSignal) data).getDuration());
+		}
+		else if (data instanceof SpeechStartSignal)
+		{
+			writeSignal(SPEECH_START, (Signal) data);
+		}
+		else if (data instanceof SpeechEndSignal)
+		{
+			writeSignal(SPEECH_END, (Signal) data);
+		}
+		else
+		{
+			throw new IOException("Cannot record " + data);
+		}
+	}
+
+	private void writeSignal(byte type, Signal signal) throws IOException
+	{
+		mRecording.writeByte(type);
+		mRecording.writeLong(signal.getTime());
+	}
+
+	/// Reads the next record of the file being replayed.  Returns null, 
+	/// and stops replaying, at the end of the file.
+	private Data readRecord() throws DataProcessingException
+	{
+		try
+		{
+			while (mReplay.hasRemaining())
+			{
+				byte type = mReplay.get();
+
+				if (FORMAT == type)
+				{
+					mSampleRate = mReplay.getInt();
+					mFeatureLength = mReplay.getInt();
+					continue;
+				}
+
+				if (FRAME == type)
+				{
+					long firstSampleNumber = mReplay.getLong();
+					float[] values = new float[mFeatureLength];
+					mReplay.asFloatBuffer().get(values);
+					mReplay.position(mReplay.position() + 4 * mFeatureLength);
+					return new FloatData(values, mSampleRate, 
+						System.currentTimeMillis(), firstSampleNumber);
+				}
+
+				long time = mReplay.getLong();
+
+				if (DATA_START == type)
+				{
+					return new DataStartSignal(time);
+				}
+				else if (DATA_END == type)
+				{
+					return new DataEndSignal(mReplay.getLong(), time);
+				}
+				else if (SPEECH_START == type)
+				{
+					return new SpeechStartSignal(time);
+				}
+				else if (SPEECH_END == type)
+				{
+					return new SpeechEndSignal(time);
+				}
+
+				throw new DataProcessingException("Bad record in feature " 
+					+ "file.");
+			}
+		}
+		catch (BufferUnderflowException e)
+		{
+			throw new DataProcessingException("Feature file is truncated.");
+		}
+
+		mReplay = null;
+		return null;
+	}
+}
@@ -0,0 +1,184 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+
+/// A command line tool that measures how much faster audio files are 
+/// decoded again from the feature cache (see the 'featureCache' option 
+/// of SpeechInterface.init) than from the audio.  Usage:
+///
+/// java -cp voce.jar voce.FeatureCacheBenchmark [options] cacheDirectory 
+///   fileList outputFile
+///
+/// The file list names one audio file per line, each in the format 
+/// described in SpeechRecognizer.recognizeFile.  The files are decoded 
+/// three times: from the audio without the cache, from the audio while 
+/// recording their feature files (any old ones are deleted first), and 
+/// from the feature files.  For each mode the results are written as 
+/// CSV: the seconds spent decoding all of the files, the speedup over 
+/// decoding the audio, and whether the recognized text is the same as 
+/// from the audio.  The share of decoding time spent in the front end 
+/// is logged.  Options:
+///
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -grammarPath path - Where to find the grammar (default: ./).
+/// -grammarName name - The grammar to decode with (default: digits).
+public class FeatureCacheBenchmark
+{
+	public static void main(String[] args)
+	{
+		String configFilename = "voce.config.xml";
+		String grammarPath = "./";
+		String grammarName = "";
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-grammarPath") && i + 1 < args.length)
+			{
+				grammarPath = args[++i];
+			}
+			else if (args[i].equals("-grammarName") && i + 1 < args.length)
+			{
+				grammarName = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 3)
+		{
+			System.out.println("Usage: java voce.FeatureCacheBenchmark " 
+				+ "[-config file] [-grammarPath path] [-grammarName name] " 
+				+ "cacheDirectory fileList outputFile");
+			System.exit(1);
+		}
+
+		String cacheDirectory = positional.get(0);
+		PrintWriter out = null;
+
+		try
+		{
+			String[] filenames = BatchRecognizer.readFileList(
+				positional.get(1));
+
+			for (int i = 0; i < filenames.length; ++i)
+			{
+				FeatureCache.getCacheFile(cacheDirectory, 
+					filenames[i]).delete();
+			}
+
+			out = new PrintWriter(new FileWriter(positional.get(2)));
+			out.println("mode,files,seconds,speedup,sameText");
+
+			SpeechRecognizer recognizer = new SpeechRecognizer(
+				configFilename, grammarPath, grammarName, 
+				Utils.parseOptions("audioInput=file"));
+			String[] audioText = new String[filenames.length];
+			double audioSeconds = decodeFiles(recognizer, filenames, 
+				audioText);
+			recognizer.destroy();
+
+			// The recording and replaying passes share one recognizer, 
+			// so the second pass finds the files the first one made.
+			recognizer = new SpeechRecognizer(configFilename, grammarPath, 
+				grammarName, Utils.parseOptions("audioInput=file " 
+				+ "featureCache=" + cacheDirectory));
+			String[] modes = {"audio", "record", "replay"};
+
+			for (int i = 0; i < modes.length; ++i)
+			{
+				String[] text = audioText;
+				double seconds = audioSeconds;
+
+				if (i > 0)
+				{
+					text = new String[filenames.length];
+					seconds = decodeFiles(recognizer, filenames, text);
+				}
+
+				boolean sameText = true;
+
+				for (int j = 0; j < filenames.length; ++j)
+				{
+					sameText = sameText && text[j].equals(audioText[j]);
+				}
+
+				String row = filenames.length + "," + seconds + "," 
+					+ (seconds > 0 ? audioSeconds / seconds : 0) + "," 
+					+ sameText;
+				out.println(modes[i] + "," + row);
+				out.flush();
+				Utils.log("", modes[i] + ": " + row);
+
+				if (modes[i].equals("replay") && audioSeconds > 0)
+				{
+					Utils.log("", "Front end share of decoding time: " 
+						+ (100 * (1 - seconds / audioSeconds)) + "%");
+				}
+			}
+
+			recognizer.destroy();
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+		}
+
+		System.exit(0);
+	}
+
+	/// Decodes each file in turn, storing the recognized text in 'text', 
+	/// and returns the seconds it took.
+	private static double decodeFiles(SpeechRecognizer recognizer, 
+		String[] filenames, String[] text)
+	{
+		long startTime = System.nanoTime();
+
+		for (int i = 0; i < filenames.length; ++i)
+		{
+			text[i] = recognizer.recognizeFile(filenames[i]);
+		}
+
+		return (System.nanoTime() - startTime) / 1e9;
+	}
+}
@@ -0,0 +1,352 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.frontend.BaseDataProcessor;
+import edu.cmu.sphinx.frontend.Data;
+import edu.cmu.sphinx.frontend.DataProcessor;
+import edu.cmu.sphinx.frontend.DataProcessingException;
+import edu.cmu.sphinx.frontend.DoubleData;
+import edu.cmu.sphinx.frontend.FloatData;
+import edu.cmu.sphinx.frontend.FrontEnd;
+import edu.cmu.sphinx.frontend.util.StreamDataSource;
+import edu.cmu.sphinx.util.props.ConfigurationManager;
+import edu.cmu.sphinx.util.props.PropertyException;
+
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+
+/// A command line tool that checks the native front end (see 
+/// NativeFeatureExtractor) against the Java one and measures how many 
+/// frames per second each turns into features.  The natives only exist 
+/// when the C++ interface creates the virtual machine, so this is run 
+/// through samples/frontEndBenchmark, which passes its arguments on:
+///
+/// frontEndBenchmark [options] vocePath outputFile audioFile...
+///
+/// The audio files must be in the format described in 
+/// SpeechRecognizer.recognizeFile.  Each file is read into memory and 
+/// run through the 'fileFrontEnd' and 'nativeFileFrontEnd' pipelines, 
+/// each built from its own copy of the config so that neither sees the 
+/// other's endpointer or CMN state.  The first pass compares the 
+/// features; the rest are timed.  The native front end is also checked 
+/// a second time with its audio cut into blocks of 1 to 7 samples, 
+/// which must give the same features, since the samples carried over 
+/// between blocks (for pre-emphasis and partial windows) are easy to 
+/// get wrong.  For each file the results are written as CSV: the number 
+/// of frames from each front end, the largest deviation of a native 
+/// feature from the Java one, relative to the Java value (or absolute 
+/// below 1), the same for the small blocks, whether both are within 
+/// the tolerance, and the frames per second of each front end.  Exits 
+/// with status 1 if any file is not within the tolerance.  Options:
+///
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -repeat n - The number of timed passes over each file (default: 5).
+/// -tolerance t - The largest deviation allowed (default: 1e-4).
+public class FrontEndBenchmark
+{
+	public static void main(String[] args)
+	{
+		String configFilename = "voce.config.xml";
+		int repeat = 5;
+		double tolerance = 1e-4;
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-repeat") && i + 1 < args.length)
+			{
+				repeat = Math.max(1, Integer.parseInt(args[++i]));
+			}
+			else if (args[i].equals("-tolerance") && i + 1 < args.length)
+			{
+				tolerance = Double.parseDouble(args[++i]);
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() < 2)
+		{
+			System.out.println("Usage: java voce.FrontEndBenchmark " 
+				+ "[-config file] [-repeat n] [-tolerance t] outputFile " 
+				+ "audioFile...");
+			System.exit(1);
+		}
+
+		if (!NativeFeatureExtractor.isAvailable())
+		{
+			Utils.log("ERROR", "The native front end is only available " 
+				+ "through the C++ interface.  See " 
+				+ "samples/frontEndBenchmark.");
+			System.exit(1);
+		}
+
+		PrintWriter out = null;
+		boolean allWithinTolerance = true;
+
+		try
+		{
+			FrontEndRunner javaRunner = new FrontEndRunner(configFilename, 
+				"fileFrontEnd");
+			FrontEndRunner nativeRunner = new FrontEndRunner(configFilename, 
+				"nativeFileFrontEnd");
+			FrontEndRunner smallBlockRunner = new FrontEndRunner(
+				configFilename, "nativeFileFrontEnd");
+			smallBlockRunner.splitBlocks("nativeFeatureExtraction");
+
+			out = new PrintWriter(new FileWriter(positional.get(0)));
+			out.println("file,javaFrames,nativeFrames,maxDeviation," 
+				+ "smallBlockMaxDeviation,withinTolerance," 
+				+ "javaFramesPerSecond,nativeFramesPerSecond");
+
+			for (int i = 1; i < positional.size(); ++i)
+			{
+				String audioFile = positional.get(i);
+				byte[] audio = readAudioFile(audioFile);
+
+				ArrayList<float[]> javaFeatures = javaRunner.run(audio);
+				ArrayList<float[]> nativeFeatures = nativeRunner.run(audio);
+				double deviation = getMaxDeviation(javaFeatures, 
+					nativeFeatures);
+				ArrayList<float[]> smallBlockFeatures = 
+					smallBlockRunner.run(audio);
+				double smallBlockDeviation = getMaxDeviation(javaFeatures, 
+					smallBlockFeatures);
+				boolean withinTolerance = deviation <= tolerance 
+					&& smallBlockDeviation <= tolerance 
+					&& javaFeatures.size() == nativeFeatures.size() 
+					&& javaFeatures.size() == smallBlockFeatures.size();
+				allWithinTolerance &= withinTolerance;
+
+				double javaSeconds = 0;
+				double nativeSeconds = 0;
+
+				for (int j = 0; j < repeat; ++j)
+				{
+					long start = System.nanoTime();
+					javaRunner.run(audio);
+					long middle = System.nanoTime();
+					nativeRunner.run(audio);
+					long end = System.nanoTime();
+					javaSeconds += (middle - start) / 1e9;
+					nativeSeconds += (end - middle) / 1e9;
+				}
+
+				String row = javaFeatures.size() + "," 
+					+ nativeFeatures.size() + "," + deviation + "," 
+					+ smallBlockDeviation + "," + withinTolerance + "," 
+					+ repeat * javaFeatures.size() / javaSeconds + "," 
+					+ repeat * nativeFeatures.size() / nativeSeconds;
+				out.println("\"" + audioFile.replace("\"", "\"\"") + "\"," 
+					+ row);
+				out.flush();
+				Utils.log("", audioFile + ": " + row);
+			}
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+		}
+
+		System.exit(allWithinTolerance ? 0 : 1);
+	}
+
+	/// Returns the largest deviation between two lists of feature 
+	/// vectors: relative to the first list's value, or absolute where 
+	/// that is below 1.  Only the vectors both lists have are compared.
+	private static double getMaxDeviation(ArrayList<float[]> expected, 
+		ArrayList<float[]> actual)
+	{
+		double maxDeviation = 0;
+		int count = Math.min(expected.size(), actual.size());
+
+		for (int i = 0; i < count; ++i)
+		{
+			float[] a = expected.get(i);
+			float[] b = actual.get(i);
+
+			if (a.length != b.length)
+			{
+				return Double.POSITIVE_INFINITY;
+			}
+
+			for (int j = 0; j < a.length; ++j)
+			{
+				double deviation = Math.abs(a[j] - b[j]) 
+					/ Math.max(1.0, Math.abs(a[j]));
+				maxDeviation = Math.max(maxDeviation, deviation);
+			}
+		}
+
+		return maxDeviation;
+	}
+
+	/// Reads a whole audio file into memory, without its header, so that 
+	/// the timed passes do not include reading the disk.
+	private static byte[] readAudioFile(String filename) throws IOException
+	{
+		InputStream in = SpeechRecognizer.openAudioFile(filename);
+		ByteArrayOutputStream bytes = new ByteArrayOutputStream();
+
+		try
+		{
+			byte[] buffer = new byte[65536];
+			int count = 0;
+
+			while ((count = in.read(buffer)) > 0)
+			{
+				bytes.write(buffer, 0, count);
+			}
+		}
+		finally
+		{
+			in.close();
+		}
+
+		return bytes.toByteArray();
+	}
+
+	/// One front end built from its own ConfigurationManager.
+	private static class FrontEndRunner
+	{
+		private ConfigurationManager mConfigurationManager;
+		private StreamDataSource mSource;
+		private FrontEnd mFrontEnd;
+
+		public FrontEndRunner(String configFilename, String frontEndName) 
+			throws IOException, PropertyException, InstantiationException
+		{
+			ConfigurationManager cm = new ConfigurationManager(
+				new File(configFilename).toURI().toURL());
+			mConfigurationManager = cm;
+			mSource = (StreamDataSource) cm.lookup("streamDataSource");
+			mFrontEnd = (FrontEnd) cm.lookup(frontEndName);
+			mFrontEnd.initialize();
+		}
+
+		/// Cuts the audio reaching the named pipeline stage into small 
+		/// blocks (see BlockSplitter).
+		public void splitBlocks(String processorName) 
+			throws IOException, PropertyException, InstantiationException
+		{
+			DataProcessor processor = (DataProcessor) 
+				mConfigurationManager.lookup(processorName);
+			BlockSplitter splitter = new BlockSplitter();
+			splitter.setPredecessor(processor.getPredecessor());
+			processor.setPredecessor(splitter);
+		}
+
+		/// Runs audio through the front end and returns its feature 
+		/// vectors.
+		public ArrayList<float[]> run(byte[] audio) 
+			throws DataProcessingException
+		{
+			ArrayList<float[]> features = new ArrayList<float[]>();
+			mSource.setInputStream(new ByteArrayInputStream(audio), 
+				"benchmark");
+
+			// The end of the stream makes the front end return null.
+			Data data = mFrontEnd.getData();
+
+			while (null != data)
+			{
+				if (data instanceof FloatData)
+				{
+					features.add(((FloatData) data).getValues());
+				}
+
+				data = mFrontEnd.getData();
+			}
+
+			return features;
+		}
+	}
+
+	/// Cuts each block of audio into blocks of 1, 2, 3 and so on up to 
+	/// 7 samples, then starting over, and passes everything else through.
+	private static class BlockSplitter extends BaseDataProcessor
+	{
+		private static final int MAX_BLOCK_SIZE = 7;
+
+		/// The block being cut up, and the next sample to hand on.
+		private DoubleData mBlock = null;
+		private int mPosition = 0;
+		private int mNextSize = 1;
+
+		public Data getData() throws DataProcessingException
+		{
+			if (null == mBlock)
+			{
+				Data input = getPredecessor().getData();
+
+				if (!(input instanceof DoubleData))
+				{
+					return input;
+				}
+
+				mBlock = (DoubleData) input;
+				mPosition = 0;
+			}
+
+			double[] values = mBlock.getValues();
+			int size = Math.min(mNextSize, values.length - mPosition);
+			double[] part = new double[size];
+			System.arraycopy(values, mPosition, part, 0, size);
+			DoubleData data = new DoubleData(part, mBlock.getSampleRate(), 
+				mBlock.getCollectTime(), 
+				mBlock.getFirstSampleNumber() + mPosition);
+
+			mPosition += size;
+			mNextSize = mNextSize % MAX_BLOCK_SIZE + 1;
+
+			if (mPosition >= values.length)
+			{
+				mBlock = null;
+			}
+
+			return data;
+		}
+	}
+}
@@ -0,0 +1,448 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.linguist.WordSequence;
+import edu.cmu.sphinx.linguist.dictionary.Dictionary;
+import edu.cmu.sphinx.linguist.dictionary.Word;
+import edu.cmu.sphinx.linguist.language.grammar.Grammar;
+import edu.cmu.sphinx.linguist.language.grammar.GrammarArc;
+import edu.cmu.sphinx.linguist.language.grammar.GrammarNode;
+import edu.cmu.sphinx.linguist.language.ngram.LanguageModel;
+import edu.cmu.sphinx.util.LogMath;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.IdentityHashMap;
+import java.util.Set;
+
+/// A bigram language model built from a grammar, so that the LexTree 
+/// linguist (which needs a language model) can decode the same JSGF 
+/// grammars as the flat linguist.  A word can follow another only if 
+/// the grammar allows it, and all the words that can follow a given 
+/// word are equally likely.  Since only word pairs are checked, longer 
+/// word sequences the grammar does not allow can still be recognized.
+public class GrammarLanguageModel implements LanguageModel
+{
+	/// The Sphinx property for the grammar.
+	public static final String PROP_GRAMMAR = "grammar";
+
+	/// The Sphinx property for the LogMath used for probabilities.
+	public static final String PROP_LOG_MATH = "logMath";
+
+	/// The words that can follow a word.  Words followed by the same 
+	/// grammar nodes share one of these.
+	private static class Successors
+	{
+		HashSet<String> words = new HashSet<String>();
+		boolean canEnd = false;
+		float logProbability;
+	}
+
+	private String mName;
+	private Grammar mGrammar;
+	private Dictionary mDictionary;
+	private LogMath mLogMath;
+
+	/// The grammar's initial node when the model was built.
+	private GrammarNode mInitialNode = null;
+
+	/// The spellings of the words in the grammar, plus the sentence start 
+	/// and end words.
+	private HashSet<String> mVocabulary = new HashSet<String>();
+
+	/// The successors of each word, by spelling.
+	private HashMap<String, Successors> mSuccessors = 
+		new HashMap<String, Successors>();
+
+	private float mUnigramProbability;
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		mName = name;
+		registry.register(PROP_GRAMMAR, PropertyType.COMPONENT);
+		registry.register(PROP_DICTIONARY, PropertyType.COMPONENT);
+		registry.register(PROP_LOG_MATH, PropertyType.COMPONENT);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		mGrammar = (Grammar) ps.getComponent(PROP_GRAMMAR, Grammar.class);
+		mDictionary = (Dictionary) ps.getComponent(PROP_DICTIONARY, 
+			Dictionary.class);
+		mLogMath = (LogMath) ps.getComponent(PROP_LOG_MATH, LogMath.class);
+	}
+
+	public String getName()
+	{
+		return mName;
+	}
+
+	/// Loads the grammar if it has not been loaded yet, and builds the 
+	/// model from it.  Allocating again rebuilds the model if the grammar 
+	/// has been replaced since.
+	public void allocate() throws IOException
+	{
+		if (null == mGrammar.getInitialNode())
+		{
+			mGrammar.allocate();
+		}
+
+		if (mGrammar.getInitialNode() != mInitialNode)
+		{
+			build(mGrammar.getInitialNode());
+		}
+	}
+
+	public void deallocate()
+	{
+		mInitialNode = null;
+		mVocabulary.clear();
+		mSuccessors.clear();
+	}
+
+	public void start()
+	{
+	}
+
+	public void stop()
+	{
+	}
+
+	public float getProbability(WordSequence wordSequence)
+	{
+		int size = wordSequence.size();
+
+		if (size < 2)
+		{
+			return mUnigramProbability;
+		}
+
+		Word previous = wordSequence.getWord(size - 2);
+		Word word = wordSequence.getWord(size - 1);
+		Successors successors = mSuccessors.get(previous.getSpelling());
+
+		if (null == successors)
+		{
+			return LogMath.getLogZero();
+		}
+
+		if (word.isSentenceEndWord())
+		{
+			return successors.canEnd ? successors.logProbability 
+				: LogMath.getLogZero();
+		}
+
+		if (word.isFiller())
+		{
+			return LogMath.getLogOne();
+		}
+
+		return successors.words.contains(word.getSpelling()) 
+			? successors.logProbability : LogMath.getLogZero();
+	}
+
+	public float getSmear(WordSequence wordSequence)
+	{
+		return 0.0f;
+	}
+
+	public Set getVocabulary()
+	{
+		return mVocabulary;
+	}
+
+	public int getMaxDepth()
+	{
+		return 2;
+	}
+
+	/// Collects the word pairs the grammar allows.  Empty nodes and 
+	/// nodes holding only filler words (such as the silences around the 
+	/// grammar) are skipped over, so they connect the words on either 
+	/// side of them.
+	private void build(GrammarNode initialNode)
+	{
+		long startTime = System.currentTimeMillis();
+		mVocabulary.clear();
+		mSuccessors.clear();
+
+		String start = mDictionary.getSentenceStartWord().getSpelling();
+		String end = mDictionary.getSentenceEndWord().getSpelling();
+		mVocabulary.add(start);
+		mVocabulary.add(end);
+
+		// The successors of a node depend only on the nodes it leads to, 
+		// which are often the same for many nodes (every word in a word 
+		// list, for example), so they are shared.
+		HashMap<String, Successors> successorsByTargets = 
+			new HashMap<String, Successors>();
+		IdentityHashMap<GrammarNode, Integer> nodeNumbers = 
+			new IdentityHashMap<GrammarNode, Integer>();
+		IdentityHashMap<GrammarNode, GrammarNode> visited = 
+			new IdentityHashMap<GrammarNode, GrammarNode>();
+		ArrayList<GrammarNode> nodes = new ArrayList<GrammarNode>();
+		visited.put(initialNode, initialNode);
+		nodes.add(initialNode);
+
+		// The initial node is treated as following the sentence start.
+		if (isTransparent(initialNode))
+		{
+			addSuccessors(start, getSuccessors(initialNode, nodeNumbers, 
+				successorsByTargets));
+		}
+		else
+		{
+			Successors first = new Successors();
+			first.words.addAll(getFirstWords(initialNode));
+			first.logProbability = mLogMath.linearToLog(
+				1.0 / first.words.size());
+			addSuccessors(start, first);
+		}
+
+		for (int i = 0; i < nodes.size(); ++i)
+		{
+			GrammarNode node = nodes.get(i);
+			GrammarArc[] arcs = node.getSuccessors();
+
+			for (int j = 0; j < arcs.length; ++j)
+			{
+				GrammarNode next = arcs[j].getGrammarNode();
+
+				if (!visited.containsKey(next))
+				{
+					visited.put(next, next);
+					nodes.add(next);
+				}
+			}
+
+			if (isTransparent(node))
+			{
+				continue;
+			}
+
+			Successors successors = getSuccessors(node, nodeNumbers, 
+				successorsByTargets);
+
+			if (node.isFinalNode() && !successors.canEnd)
+			{
+				Successors withEnd = new Successors();
+				withEnd.words.addAll(successors.words);
+				withEnd.canEnd = true;
+				setProbability(withEnd);
+				successors = withEnd;
+			}
+
+			Word[][] alternatives = node.getAlternatives();
+
+			for (int a = 0; a < alternatives.length; ++a)
+			{
+				String last = null;
+
+				for (int w = 0; w < alternatives[a].length; ++w)
+				{
+					if (alternatives[a][w].isFiller())
+					{
+						continue;
+					}
+
+					String spelling = alternatives[a][w].getSpelling();
+					mVocabulary.add(spelling);
+
+					if (null != last)
+					{
+						Successors inside = new Successors();
+						inside.words.add(spelling);
+						setProbability(inside);
+						addSuccessors(last, inside);
+					}
+
+					last = spelling;
+				}
+
+				if (null != last)
+				{
+					addSuccessors(last, successors);
+				}
+			}
+		}
+
+		mUnigramProbability = mLogMath.linearToLog(
+			1.0 / mVocabulary.size());
+		mInitialNode = initialNode;
+
+		Utils.log("debug", "Grammar language model built in " 
+			+ (System.currentTimeMillis() - startTime) + " ms (" 
+			+ mVocabulary.size() + " words)");
+	}
+
+	/// Returns the words that can come right after 'node', and whether 
+	/// the sentence can end there.
+	private Successors getSuccessors(GrammarNode node, 
+		IdentityHashMap<GrammarNode, Integer> nodeNumbers, 
+		HashMap<String, Successors> successorsByTargets)
+	{
+		GrammarArc[] arcs = node.getSuccessors();
+		int[] targets = new int[arcs.length];
+
+		for (int i = 0; i < arcs.length; ++i)
+		{
+			Integer number = nodeNumbers.get(arcs[i].getGrammarNode());
+
+			if (null == number)
+			{
+				number = new Integer(nodeNumbers.size());
+				nodeNumbers.put(arcs[i].getGrammarNode(), number);
+			}
+
+			targets[i] = number.intValue();
+		}
+
+		Arrays.sort(targets);
+		String key = Arrays.toString(targets);
+		Successors successors = successorsByTargets.get(key);
+
+		if (null != successors)
+		{
+			return successors;
+		}
+
+		successors = new Successors();
+		IdentityHashMap<GrammarNode, GrammarNode> visited = 
+			new IdentityHashMap<GrammarNode, GrammarNode>();
+		ArrayList<GrammarNode> pending = new ArrayList<GrammarNode>();
+
+		for (int i = 0; i < arcs.length; ++i)
+		{
+			pending.add(arcs[i].getGrammarNode());
+		}
+
+		while (!pending.isEmpty())
+		{
+			GrammarNode next = pending.remove(pending.size() - 1);
+
+			if (null != visited.put(next, next))
+			{
+				continue;
+			}
+
+			if (isTransparent(next))
+			{
+				if (next.isFinalNode())
+				{
+					successors.canEnd = true;
+				}
+
+				GrammarArc[] nextArcs = next.getSuccessors();
+
+				for (int i = 0; i < nextArcs.length; ++i)
+				{
+					pending.add(nextArcs[i].getGrammarNode());
+				}
+			}
+			else
+			{
+				successors.words.addAll(getFirstWords(next));
+			}
+		}
+
+		setProbability(successors);
+		successorsByTargets.put(key, successors);
+		return successors;
+	}
+
+	/// Adds 'successors' to the words that can follow 'spelling'.
+	private void addSuccessors(String spelling, Successors successors)
+	{
+		Successors existing = mSuccessors.get(spelling);
+
+		if (null == existing || existing == successors)
+		{
+			mSuccessors.put(spelling, successors);
+			return;
+		}
+
+		Successors merged = new Successors();
+		merged.words.addAll(existing.words);
+		merged.words.addAll(successors.words);
+		merged.canEnd = existing.canEnd || successors.canEnd;
+		setProbability(merged);
+		mSuccessors.put(spelling, merged);
+	}
+
+	private void setProbability(Successors successors)
+	{
+		int count = successors.words.size() + (successors.canEnd ? 1 : 0);
+		successors.logProbability = 0 == count ? LogMath.getLogZero() 
+			: mLogMath.linearToLog(1.0 / count);
+	}
+
+	/// Returns the first non-filler word of each of the node's 
+	/// alternatives.
+	private static ArrayList<String> getFirstWords(GrammarNode node)
+	{
+		ArrayList<String> words = new ArrayList<String>();
+		Word[][] alternatives = node.getAlternatives();
+
+		for (int a = 0; a < alternatives.length; ++a)
+		{
+			for (int w = 0; w < alternatives[a].length; ++w)
+			{
+				if (!alternatives[a][w].isFiller())
+				{
+					words.add(alternatives[a][w].getSpelling());
+					break;
+				}
+			}
+		}
+
+		return words;
+	}
+
+	/// Returns true if the node has no words other than fillers.
+	private static boolean isTransparent(GrammarNode node)
+	{
+		Word[][] alternatives = node.getAlternatives();
+
+		for (int a = 0; a < alternatives.length; ++a)
+		{
+			for (int w = 0; w < alternatives[a].length; ++w)
+			{
+				if (!alternatives[a][w].isFiller())
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,515 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.linguist.acoustic.Context;
+import edu.cmu.sphinx.linguist.acoustic.Unit;
+import edu.cmu.sphinx.linguist.acoustic.UnitManager;
+import edu.cmu.sphinx.linguist.dictionary.Dictionary;
+import edu.cmu.sphinx.linguist.dictionary.Pronunciation;
+import edu.cmu.sphinx.linguist.dictionary.Word;
+import edu.cmu.sphinx.linguist.dictionary.WordClassification;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.lang.reflect.Constructor;
+import java.lang.reflect.Method;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.HashMap;
+
+/// A pronunciation dictionary read from a binary file written by 
+/// DictionaryCompiler.  The file is memory-mapped, and words are found 
+/// through a minimal perfect hash table stored in it, so allocating the 
+/// dictionary involves no parsing.  A word is only turned into Word and 
+/// Pronunciation objects the first time it is looked up, which keeps 
+/// the tens of thousands of words the grammar never uses off the heap.  
+/// The properties are the same as FastDictionary's, except that 
+/// 'dictionaryPath' is the binary file (which must be a plain file, not 
+/// a resource inside a jar) and there is no 'fillerPath', since the 
+/// compiler puts the filler words in the binary file.
+public class MappedDictionary implements Dictionary
+{
+	/// Identifies binary dictionary files ("VCDC").
+	static final int MAGIC = 0x56434443;
+
+	/// The version of the file format.
+	static final int VERSION = 1;
+
+	/// Entry flag marking filler words.
+	static final int FILLER = 1;
+
+	/// The size of the file header: the magic number, the version, and 
+	/// the numbers of units, words, hash buckets and filler words.
+	static final int HEADER_SIZE = 24;
+
+	private String mName;
+	private String mDictionaryFile;
+	private boolean mAddSilEndingPronunciation;
+	private String mWordReplacement;
+	private boolean mAllowMissingWords;
+	private boolean mCreateMissingWords;
+	private UnitManager mUnitManager;
+
+	/// The mapped file, or null if the dictionary is not allocated.
+	private MappedByteBuffer mBuffer = null;
+
+	/// The names of the units used by the pronunciations.  Entries 
+	/// refer to units by their index in this array.
+	private String[] mUnitNames;
+
+	private int mNumWords;
+	private int mNumBuckets;
+	private int mNumFillers;
+
+	/// The offsets within the file of the hash seeds (one per bucket), 
+	/// the hash table (the offset of one entry per word) and the offsets 
+	/// of the filler words' entries.
+	private int mSeedsOffset;
+	private int mSlotsOffset;
+	private int mFillersOffset;
+
+	/// The words that have been looked up so far.
+	private HashMap<String, Word> mWords = new HashMap<String, Word>();
+
+	/// Pronunciation's constructor and setWord method are not public, 
+	/// since Sphinx4 expects only its own dictionaries to create 
+	/// pronunciations.
+	private static Constructor<Pronunciation> mPronunciationConstructor = null;
+	private static Method mSetWordMethod = null;
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		mName = name;
+		registry.register(PROP_DICTIONARY, PropertyType.STRING);
+		registry.register(PROP_ADD_SIL_ENDING_PRONUNCIATION, 
+			PropertyType.BOOLEAN);
+		registry.register(PROP_WORD_REPLACEMENT, PropertyType.STRING);
+		registry.register(PROP_ALLOW_MISSING_WORDS, PropertyType.BOOLEAN);
+		registry.register(PROP_CREATE_MISSING_WORDS, PropertyType.BOOLEAN);
+		registry.register(PROP_UNIT_MANAGER, PropertyType.COMPONENT);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		mDictionaryFile = ps.getString(PROP_DICTIONARY, "");
+		mAddSilEndingPronunciation = ps.getBoolean(
+			PROP_ADD_SIL_ENDING_PRONUNCIATION, 
+			PROP_ADD_SIL_ENDING_PRONUNCIATION_DEFAULT);
+		mWordReplacement = ps.getString(PROP_WORD_REPLACEMENT, 
+			PROP_WORD_REPLACEMENT_DEFAULT);
+		mAllowMissingWords = ps.getBoolean(PROP_ALLOW_MISSING_WORDS, 
+			PROP_ALLOW_MISSING_WORDS_DEFAULT);
+		mCreateMissingWords = ps.getBoolean(PROP_CREATE_MISSING_WORDS, 
+			PROP_CREATE_MISSING_WORDS_DEFAULT);
+		mUnitManager = (UnitManager) ps.getComponent(PROP_UNIT_MANAGER, 
+			UnitManager.class);
+	}
+
+	public String getName()
+	{
+		return mName;
+	}
+
+	/// Maps the dictionary file and reads its header and unit names.
+	public synchronized void allocate() throws IOException
+	{
+		if (null != mBuffer)
+		{
+			return;
+		}
+
+		long startTime = System.currentTimeMillis();
+		findPronunciationMethods();
+
+		FileInputStream in = new FileInputStream(mDictionaryFile);
+		MappedByteBuffer buffer;
+
+		try
+		{
+			FileChannel channel = in.getChannel();
+			buffer = channel.map(FileChannel.MapMode.READ_ONLY, 0, 
+				channel.size());
+		}
+		finally
+		{
+			in.close();
+		}
+
+		if (buffer.limit() < HEADER_SIZE || buffer.getInt(0) != MAGIC 
+			|| buffer.getInt(4) != VERSION)
+		{
+			throw new IOException(mDictionaryFile 
+				+ " is not a compiled dictionary.  See DictionaryCompiler.");
+		}
+
+		int numUnits = buffer.getInt(8);
+		mNumWords = buffer.getInt(12);
+		mNumBuckets = buffer.getInt(16);
+		mNumFillers = buffer.getInt(20);
+
+		mUnitNames = new String[numUnits];
+		int position = HEADER_SIZE;
+
+		for (int i = 0; i < numUnits; ++i)
+		{
+			mUnitNames[i] = readString(buffer, position);
+			position += 1 + (buffer.get(position) & 0xff);
+		}
+
+		mSeedsOffset = position;
+		mSlotsOffset = mSeedsOffset + 4 * mNumBuckets;
+		mFillersOffset = mSlotsOffset + 4 * mNumWords;
+		mBuffer = buffer;
+
+		Utils.log("", "Dictionary mapped in " 
+			+ (System.currentTimeMillis() - startTime) + " ms (" 
+			+ mNumWords + " words)");
+	}
+
+	public synchronized void deallocate()
+	{
+		// The mapping itself is released when the buffer is garbage 
+		// collected.
+		mBuffer = null;
+		mWords.clear();
+	}
+
+	public synchronized Word getWord(String text)
+	{
+		text = text.toLowerCase();
+		Word word = lookupWord(text);
+
+		if (null != word)
+		{
+			return word;
+		}
+
+		Utils.log("warning", "Missing word: " + text);
+
+		if (null != mWordReplacement)
+		{
+			// The replacement is looked up once; it is not replaced in 
+			// turn if it is missing too.
+			word = lookupWord(mWordReplacement.toLowerCase());
+
+			if (null == word)
+			{
+				Utils.log("ERROR", "Replacement word " + mWordReplacement 
+					+ " not found");
+			}
+
+			return word;
+		}
+		else if (mAllowMissingWords && mCreateMissingWords)
+		{
+			word = new Word(text, null, false);
+			mWords.put(text, word);
+			return word;
+		}
+
+		return null;
+	}
+
+	public Word getSentenceStartWord()
+	{
+		return getWord(SENTENCE_START_SPELLING);
+	}
+
+	public Word getSentenceEndWord()
+	{
+		return getWord(SENTENCE_END_SPELLING);
+	}
+
+	public Word getSilenceWord()
+	{
+		return getWord(SILENCE_SPELLING);
+	}
+
+	public WordClassification[] getPossibleWordClassifications()
+	{
+		return null;
+	}
+
+	public synchronized Word[] getFillerWords()
+	{
+		Word[] fillers = new Word[mNumFillers];
+
+		for (int i = 0; i < mNumFillers; ++i)
+		{
+			int entry = mBuffer.getInt(mFillersOffset + 4 * i);
+			String spelling = readString(mBuffer, entry + 1);
+			fillers[i] = mWords.get(spelling);
+
+			if (null == fillers[i])
+			{
+				fillers[i] = decodeEntry(entry);
+			}
+		}
+
+		return fillers;
+	}
+
+	public void dump()
+	{
+		System.out.println("MappedDictionary " + mDictionaryFile + ": " 
+			+ mNumWords + " words, " + mNumFillers + " fillers, " 
+			+ mWords.size() + " looked up");
+	}
+
+	public String toString()
+	{
+		return "MappedDictionary";
+	}
+
+	/// Hashes 'spelling' with the given seed (32-bit FNV-1a over the 
+	/// characters, which are all below 256 in a compiled dictionary).  
+	/// Used both to build and to search the hash table.
+	static int hash(String spelling, int seed)
+	{
+		int h = 0x811c9dc5 ^ seed;
+
+		for (int i = 0; i < spelling.length(); ++i)
+		{
+			h ^= spelling.charAt(i) & 0xff;
+			h *= 0x01000193;
+		}
+
+		return h & 0x7fffffff;
+	}
+
+	/// Returns the word with the given (lowercase) spelling, decoding it 
+	/// from the mapped file if needed, or null if it is not listed.
+	private Word lookupWord(String text)
+	{
+		Word word = mWords.get(text);
+
+		if (null != word)
+		{
+			return word;
+		}
+
+		int entry = findEntry(text);
+
+		if (entry >= 0)
+		{
+			return decodeEntry(entry);
+		}
+
+		return null;
+	}
+
+	/// Returns the offset of the entry for 'spelling', or -1 if the 
+	/// dictionary does not have it.  The first hash picks a bucket, 
+	/// whose seed gives the second hash a distinct slot for every word 
+	/// in the dictionary.  Words that are not in the dictionary land on 
+	/// some other word's slot, so the spelling is checked too.
+	private int findEntry(String spelling)
+	{
+		if (0 == mNumWords || spelling.length() > 255)
+		{
+			return -1;
+		}
+
+		int bucket = hash(spelling, 0) % mNumBuckets;
+		int seed = mBuffer.getInt(mSeedsOffset + 4 * bucket);
+		int slot = hash(spelling, seed) % mNumWords;
+		int entry = mBuffer.getInt(mSlotsOffset + 4 * slot);
+
+		if ((mBuffer.get(entry + 1) & 0xff) != spelling.length())
+		{
+			return -1;
+		}
+
+		for (int i = 0; i < spelling.length(); ++i)
+		{
+			if ((mBuffer.get(entry + 2 + i) & 0xff) != spelling.charAt(i))
+			{
+				return -1;
+			}
+		}
+
+		return entry;
+	}
+
+	/// Creates the Word for the entry at 'entry', along with its 
+	/// pronunciations, and remembers it for later lookups.  An entry is 
+	/// a flags byte, the spelling (a length byte followed by the 
+	/// characters), the number of pronunciations, and each pronunciation 
+	/// as a number of units followed by the units' indices.
+	private Word decodeEntry(int entry)
+	{
+		boolean isFiller = (mBuffer.get(entry) & FILLER) != 0;
+		String spelling = readString(mBuffer, entry + 1);
+		int position = entry + 2 + spelling.length();
+		Pronunciation[] pronunciations = 
+			new Pronunciation[mBuffer.get(position++) & 0xff];
+		boolean addSilence = mAddSilEndingPronunciation && !isFiller;
+
+		for (int i = 0; i < pronunciations.length; ++i)
+		{
+			int numUnits = mBuffer.get(position++) & 0xff;
+			Unit[] units = new Unit[addSilence ? numUnits + 1 : numUnits];
+
+			for (int j = 0; j < numUnits; ++j)
+			{
+				units[j] = mUnitManager.getUnit(
+					mUnitNames[mBuffer.get(position++) & 0xff], isFiller, 
+					Context.EMPTY_CONTEXT);
+			}
+
+			if (addSilence)
+			{
+				units[numUnits] = UnitManager.SILENCE;
+			}
+
+			pronunciations[i] = newPronunciation(units);
+		}
+
+		Word word = new Word(spelling, pronunciations, isFiller);
+
+		for (int i = 0; i < pronunciations.length; ++i)
+		{
+			setWord(pronunciations[i], word);
+		}
+
+		mWords.put(spelling, word);
+		return word;
+	}
+
+	/// Creates a word from pronunciations given as arrays of unit names, 
+	/// the way decodeEntry does.  This lets ScopedDictionary build words 
+	/// from the text dictionary without loading it all.
+	static Word createWord(String spelling, ArrayList<String[]> unitNames, 
+		boolean isFiller, UnitManager unitManager, 
+		boolean addSilEndingPronunciation) throws IOException
+	{
+		findPronunciationMethods();
+
+		Pronunciation[] pronunciations = 
+			new Pronunciation[unitNames.size()];
+		boolean addSilence = addSilEndingPronunciation && !isFiller;
+
+		for (int i = 0; i < pronunciations.length; ++i)
+		{
+			String[] names = unitNames.get(i);
+			Unit[] units = new Unit[addSilence ? names.length + 1 
+				: names.length];
+
+			for (int j = 0; j < names.length; ++j)
+			{
+				units[j] = unitManager.getUnit(names[j], isFiller, 
+					Context.EMPTY_CONTEXT);
+			}
+
+			if (addSilence)
+			{
+				units[names.length] = UnitManager.SILENCE;
+			}
+
+			pronunciations[i] = newPronunciation(units);
+		}
+
+		Word word = new Word(spelling, pronunciations, isFiller);
+
+		for (int i = 0; i < pronunciations.length; ++i)
+		{
+			setWord(pronunciations[i], word);
+		}
+
+		return word;
+	}
+
+	/// Reads a string stored as a length byte followed by one byte per 
+	/// character.
+	static String readString(ByteBuffer buffer, int position)
+	{
+		char[] chars = new char[buffer.get(position) & 0xff];
+
+		for (int i = 0; i < chars.length; ++i)
+		{
+			chars[i] = (char) (buffer.get(position + 1 + i) & 0xff);
+		}
+
+		return new String(chars);
+	}
+
+	private static synchronized void findPronunciationMethods() 
+		throws IOException
+	{
+		if (null != mPronunciationConstructor)
+		{
+			return;
+		}
+
+		try
+		{
+			Constructor<Pronunciation> constructor = Pronunciation.class
+				.getDeclaredConstructor(new Class[] {Unit[].class, 
+				String.class, WordClassification.class, Float.TYPE});
+			constructor.setAccessible(true);
+			Method setWord = Pronunciation.class.getDeclaredMethod(
+				"setWord", new Class[] {Word.class});
+			setWord.setAccessible(true);
+
+			mSetWordMethod = setWord;
+			mPronunciationConstructor = constructor;
+		}
+		catch (Exception e)
+		{
+			throw new IOException("Cannot create pronunciations: " + e);
+		}
+	}
+
+	private static Pronunciation newPronunciation(Unit[] units)
+	{
+		try
+		{
+			return mPronunciationConstructor.newInstance(
+				new Object[] {units, null, null, new Float(1.0f)});
+		}
+		catch (Exception e)
+		{
+			throw new RuntimeException(e);
+		}
+	}
+
+	private static void setWord(Pronunciation pronunciation, Word word)
+	{
+		try
+		{
+			mSetWordMethod.invoke(pronunciation, new Object[] {word});
+		}
+		catch (Exception e)
+		{
+			throw new RuntimeException(e);
+		}
+	}
+}
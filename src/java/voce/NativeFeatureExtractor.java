@@ -0,0 +1,330 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.frontend.BaseDataProcessor;
+import edu.cmu.sphinx.frontend.Data;
+import edu.cmu.sphinx.frontend.DataEndSignal;
+import edu.cmu.sphinx.frontend.DataProcessingException;
+import edu.cmu.sphinx.frontend.DataStartSignal;
+import edu.cmu.sphinx.frontend.DoubleData;
+import edu.cmu.sphinx.frontend.FloatData;
+import edu.cmu.sphinx.frontend.feature.LiveCMN;
+import edu.cmu.sphinx.frontend.filter.Preemphasizer;
+import edu.cmu.sphinx.frontend.frequencywarp.MelFrequencyFilterBank;
+import edu.cmu.sphinx.frontend.transform.DiscreteCosineTransform;
+import edu.cmu.sphinx.frontend.transform.DiscreteFourierTransform;
+import edu.cmu.sphinx.frontend.util.DataUtil;
+import edu.cmu.sphinx.frontend.window.RaisedCosineWindower;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.util.LinkedList;
+
+/// A front end stage that does the work of the Java stages after 
+/// endpointing (premphasizer, windower, fft, melFilterBank, dct, liveCMN 
+/// and featureExtraction) in native code.  Each block of audio is handed 
+/// to voce.h in one call, which returns the feature vectors of all the 
+/// frames it completes, ready for the acoustic scorer.  The native code 
+/// follows the arithmetic of the Sphinx4 stages it replaces, so the 
+/// features match theirs to within float rounding, and it takes the 
+/// same properties with the same defaults.  Used by the native front 
+/// ends (see the 'nativeFrontEnd' option of SpeechInterface.init); the 
+/// natives are only registered when the C++ interface creates the 
+/// virtual machine.  See FrontEndBenchmark.
+public class NativeFeatureExtractor extends BaseDataProcessor
+{
+	private double mPreemphasisFactor;
+	private float mWindowSizeMs;
+	private float mWindowShiftMs;
+	private double mAlpha;
+	private int mNumberFftPoints;
+	private int mNumberFilters;
+	private double mMinFrequency;
+	private double mMaxFrequency;
+	private int mCepstrumLength;
+	private float mInitialMean;
+	private int mCmnWindow;
+	private int mCmnShiftWindow;
+
+	/// The handle of the native feature extractor, or 0 before the first 
+	/// audio arrives.  It is created for the audio's sample rate.
+	private long mExtractor = 0;
+	private int mSampleRate = 0;
+	private int mWindowSize = 0;
+	private int mWindowShift = 0;
+
+	/// Receives the feature vectors from native code, one after the 
+	/// other.  Grown as needed.
+	private float[] mFeatures = new float[0];
+
+	/// Data waiting to be returned by getData.
+	private LinkedList<Data> mOutputQueue = new LinkedList<Data>();
+
+	/// True between the first audio of an utterance and its 
+	/// DataEndSignal.
+	private boolean mUtteranceOpen = false;
+
+	/// The number of the first sample of the utterance and the number of 
+	/// feature vectors returned for it so far, from which each feature 
+	/// vector's first sample number is found.
+	private long mFirstSampleNumber = 0;
+	private long mFeatureCount = 0;
+	private long mCollectTime = 0;
+
+	/// Returns true if the natives this needs have been registered.
+	public static boolean isAvailable()
+	{
+		try
+		{
+			SpeechInterface.nativeDestroyFeatureExtractor(0);
+			return true;
+		}
+		catch (UnsatisfiedLinkError e)
+		{
+			return false;
+		}
+	}
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		super.register(name, registry);
+		registry.register(Preemphasizer.PROP_PREEMPHASIS_FACTOR, 
+			PropertyType.DOUBLE);
+		registry.register(RaisedCosineWindower.PROP_WINDOW_SIZE_MS, 
+			PropertyType.FLOAT);
+		registry.register(RaisedCosineWindower.PROP_WINDOW_SHIFT_MS, 
+			PropertyType.FLOAT);
+		registry.register(RaisedCosineWindower.PROP_ALPHA, 
+			PropertyType.DOUBLE);
+		registry.register(DiscreteFourierTransform.PROP_NUMBER_FFT_POINTS, 
+			PropertyType.INT);
+		registry.register(MelFrequencyFilterBank.PROP_NUMBER_FILTERS, 
+			PropertyType.INT);
+		registry.register(MelFrequencyFilterBank.PROP_MIN_FREQ, 
+			PropertyType.DOUBLE);
+		registry.register(MelFrequencyFilterBank.PROP_MAX_FREQ, 
+			PropertyType.DOUBLE);
+		registry.register(DiscreteCosineTransform.PROP_CEPSTRUM_LENGTH, 
+			PropertyType.INT);
+		registry.register(LiveCMN.PROP_INITIAL_MEAN, PropertyType.FLOAT);
+		registry.register(LiveCMN.PROP_CMN_WINDOW, PropertyType.INT);
+		registry.register(LiveCMN.PROP_CMN_SHIFT_WINDOW, PropertyType.INT);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		super.newProperties(ps);
+		mPreemphasisFactor = ps.getDouble(
+			Preemphasizer.PROP_PREEMPHASIS_FACTOR, 
+			Preemphasizer.PROP_PREEMPHASIS_FACTOR_DEFAULT);
+		mWindowSizeMs = ps.getFloat(RaisedCosineWindower.PROP_WINDOW_SIZE_MS, 
+			RaisedCosineWindower.PROP_WINDOW_SIZE_MS_DEFAULT);
+		mWindowShiftMs = ps.getFloat(
+			RaisedCosineWindower.PROP_WINDOW_SHIFT_MS, 
+			RaisedCosineWindower.PROP_WINDOW_SHIFT_MS_DEFAULT);
+		mAlpha = ps.getDouble(RaisedCosineWindower.PROP_ALPHA, 
+			RaisedCosineWindower.PROP_ALPHA_DEFAULT);
+		mNumberFftPoints = ps.getInt(
+			DiscreteFourierTransform.PROP_NUMBER_FFT_POINTS, -1);
+		mNumberFilters = ps.getInt(MelFrequencyFilterBank.PROP_NUMBER_FILTERS, 
+			MelFrequencyFilterBank.PROP_NUMBER_FILTERS_DEFAULT);
+		mMinFrequency = ps.getDouble(MelFrequencyFilterBank.PROP_MIN_FREQ, 
+			MelFrequencyFilterBank.PROP_MIN_FREQ_DEFAULT);
+		mMaxFrequency = ps.getDouble(MelFrequencyFilterBank.PROP_MAX_FREQ, 
+			MelFrequencyFilterBank.PROP_MAX_FREQ_DEFAULT);
+		mCepstrumLength = ps.getInt(
+			DiscreteCosineTransform.PROP_CEPSTRUM_LENGTH, 
+			DiscreteCosineTransform.PROP_CEPSTRUM_LENGTH_DEFAULT);
+		mInitialMean = ps.getFloat(LiveCMN.PROP_INITIAL_MEAN, 
+			LiveCMN.PROP_INITIAL_MEAN_DEFAULT);
+		mCmnWindow = ps.getInt(LiveCMN.PROP_CMN_WINDOW, 
+			LiveCMN.PROP_CMN_WINDOW_DEFAULT);
+		mCmnShiftWindow = ps.getInt(LiveCMN.PROP_CMN_SHIFT_WINDOW, 
+			LiveCMN.PROP_CMN_SHIFT_WINDOW_DEFAULT);
+
+		// Start over with the new settings.
+		destroyExtractor();
+	}
+
+	/// Returns the settings given to nativeCreateFeatureExtractor, in 
+	/// the order of the FeatureSetting enum in voce.h.
+	private double[] getSettings()
+	{
+		return new double[] {mPreemphasisFactor, mWindowSizeMs, 
+			mWindowShiftMs, mAlpha, mNumberFftPoints, mNumberFilters, 
+			mMinFrequency, mMaxFrequency, mCepstrumLength, mInitialMean, 
+			mCmnWindow, mCmnShiftWindow};
+	}
+
+	/// Returns the next feature vector or signal.
+	public Data getData() throws DataProcessingException
+	{
+		while (mOutputQueue.isEmpty())
+		{
+			Data input = getPredecessor().getData();
+
+			if (null == input)
+			{
+				return null;
+			}
+
+			getTimer().start();
+
+			if (input instanceof DoubleData)
+			{
+				process((DoubleData) input);
+			}
+			else
+			{
+				if (input instanceof DataEndSignal)
+				{
+					endUtterance();
+				}
+				else if (input instanceof DataStartSignal)
+				{
+					mUtteranceOpen = false;
+				}
+
+				mOutputQueue.add(input);
+			}
+
+			getTimer().stop();
+		}
+
+		return mOutputQueue.removeFirst();
+	}
+
+	/// Hands a block of audio to the native feature extractor and queues 
+	/// the feature vectors it completes.
+	private void process(DoubleData data) throws DataProcessingException
+	{
+		if (0 == mExtractor || data.getSampleRate() != mSampleRate)
+		{
+			createExtractor(data.getSampleRate());
+		}
+
+		if (!mUtteranceOpen)
+		{
+			mUtteranceOpen = true;
+			mFirstSampleNumber = data.getFirstSampleNumber();
+			mFeatureCount = 0;
+		}
+
+		mCollectTime = data.getCollectTime();
+		double[] samples = data.getValues();
+
+		// Room for every frame the block can complete.  The native code 
+		// checks this too.
+		reserve((samples.length + mWindowSize) / mWindowShift + 1);
+		int count = SpeechInterface.nativeExtractFeatures(mExtractor, 
+			samples, samples.length, mFeatures);
+		queueFeatures(count);
+	}
+
+	/// Queues the last feature vectors of the utterance.
+	private void endUtterance()
+	{
+		// Nothing has been started before the first audio.
+		if (0 == mExtractor)
+		{
+			return;
+		}
+
+		// Two windows of leftover samples, and the frames held back to 
+		// compute the differences.
+		reserve(5);
+		int count = SpeechInterface.nativeEndFeatureUtterance(mExtractor, 
+			mFeatures);
+		queueFeatures(count);
+		mUtteranceOpen = false;
+	}
+
+	/// Wraps the first 'count' feature vectors in mFeatures in FloatData 
+	/// objects and queues them.
+	private void queueFeatures(int count)
+	{
+		int length = 3 * mCepstrumLength;
+
+		for (int i = 0; i < count; ++i)
+		{
+			float[] feature = new float[length];
+			System.arraycopy(mFeatures, i * length, feature, 0, length);
+			mOutputQueue.add(new FloatData(feature, mSampleRate, 
+				mCollectTime, mFirstSampleNumber 
+				+ mFeatureCount * mWindowShift));
+			++mFeatureCount;
+		}
+	}
+
+	/// Makes sure mFeatures can hold 'frames' feature vectors.
+	private void reserve(int frames)
+	{
+		int size = frames * 3 * mCepstrumLength;
+
+		if (mFeatures.length < size)
+		{
+			mFeatures = new float[size];
+		}
+	}
+
+	/// Creates the native feature extractor for the given sample rate.
+	private void createExtractor(int sampleRate) 
+		throws DataProcessingException
+	{
+		destroyExtractor();
+		mExtractor = SpeechInterface.nativeCreateFeatureExtractor(sampleRate, 
+			getSettings());
+
+		if (0 == mExtractor)
+		{
+			throw new DataProcessingException("Cannot create native " 
+				+ "feature extractor.");
+		}
+
+		mSampleRate = sampleRate;
+		mWindowSize = DataUtil.getSamplesPerWindow(sampleRate, 
+			mWindowSizeMs);
+		mWindowShift = DataUtil.getSamplesPerShift(sampleRate, 
+			mWindowShiftMs);
+	}
+
+	/// Destroys the native feature extractor, if there is one.
+	private void destroyExtractor()
+	{
+		if (0 != mExtractor)
+		{
+			SpeechInterface.nativeDestroyFeatureExtractor(mExtractor);
+			mExtractor = 0;
+		}
+	}
+
+	protected void finalize() throws Throwable
+	{
+		destroyExtractor();
+		super.finalize();
+	}
+}
@@ -0,0 +1,507 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.decoder.scorer.AcousticScorer;
+import edu.cmu.sphinx.decoder.scorer.Scoreable;
+import edu.cmu.sphinx.decoder.scorer.ThreadedAcousticScorer;
+import edu.cmu.sphinx.frontend.Data;
+import edu.cmu.sphinx.frontend.DataEndSignal;
+import edu.cmu.sphinx.frontend.DataProcessingException;
+import edu.cmu.sphinx.frontend.DataStartSignal;
+import edu.cmu.sphinx.frontend.FrontEnd;
+import edu.cmu.sphinx.frontend.Signal;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.ThreadFactory;
+
+/// An acoustic scorer that scores each frame on several threads, like 
+/// Sphinx4's ThreadedAcousticScorer (whose properties it shares), but 
+/// whose threads can be given a priority and pinned to a set of CPUs, 
+/// and which can pick its number of threads itself.  When auto-tuning, 
+/// the scorer tries each thread count from 1 up to 'numThreads' for a 
+/// number of frames, measuring the scoring time per scoreable, and then 
+/// keeps the fastest.  Only frames with enough scoreables to keep every 
+/// thread busy are measured, since the smaller ones are scored by fewer 
+/// threads whatever the count and would make all counts look alike.
+public class ParallelAcousticScorer implements AcousticScorer
+{
+	/// The Sphinx property for the scoring threads' priority, from 
+	/// Thread.MIN_PRIORITY to Thread.MAX_PRIORITY.  Like the CPU 
+	/// affinity, it only applies to the helper threads, not to the 
+	/// decoder thread that scores the first part of each frame.
+	public static final String PROP_THREAD_PRIORITY = "threadPriority";
+
+	/// The Sphinx property for the CPUs the scoring threads may run on: 
+	/// a list of CPU numbers and ranges such as "0-3,6".  Empty (the 
+	/// default) leaves the threads to the operating system.  Only 
+	/// available through the C++ interface.
+	public static final String PROP_CPU_AFFINITY = "cpuAffinity";
+
+	/// The Sphinx property that turns auto-tuning on.
+	public static final String PROP_AUTO_TUNE = "autoTune";
+
+	/// The Sphinx property for the number of frames each thread count is 
+	/// measured for when auto-tuning.
+	public static final String PROP_AUTO_TUNE_FRAMES = "autoTuneFrames";
+
+	/// The Sphinx property that makes each scoring thread keep its own 
+	/// senone scores (see SenoneScoreCache), for recognizers that share 
+	/// the acoustic model with others decoding at the same time.
+	public static final String PROP_PRIVATE_SCORE_CACHE = 
+		"privateScoreCache";
+
+	/// A thread count must be this much faster than a smaller one to be 
+	/// chosen by the auto-tuner.
+	private static final double AUTO_TUNE_MARGIN = 0.95;
+
+	private String mName;
+	private FrontEnd mFrontEnd;
+	private int mMaxThreads;
+	private int mMinScoreablesPerThread;
+	private boolean mKeepData;
+	private float mAcousticGain;
+	private int mThreadPriority;
+	private long mCpuMask;
+	private boolean mAutoTune;
+	private int mAutoTuneFrames;
+	private boolean mPrivateScoreCache;
+
+	/// Each scoring thread's senone scores, with 'privateScoreCache'.
+	private ThreadLocal<SenoneScoreCache> mScoreCaches = 
+		new ThreadLocal<SenoneScoreCache>()
+		{
+			protected SenoneScoreCache initialValue()
+			{
+				return new SenoneScoreCache();
+			}
+		};
+
+	/// The threads that help the calling thread score each frame.
+	private ExecutorService mExecutor = null;
+
+	/// The number of threads (including the calling thread) scoring 
+	/// each frame.
+	private volatile int mNumThreads = 1;
+
+	/// The data being scored.
+	private Data mCurrentData;
+
+	/// Auto-tuning state: the thread count being measured, the smallest 
+	/// frame that is measured, the frames and time measured for the 
+	/// count so far, and the best time per scoreable for each thread 
+	/// count.
+	private boolean mTuning = false;
+	private int mTuneMinScoreables = 0;
+	private int mTuneFrames = 0;
+	private long mTuneScoreables = 0;
+	private long mTuneNanos = 0;
+	private double[] mNanosPerScoreable;
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		mName = name;
+		registry.register(ThreadedAcousticScorer.PROP_FRONTEND, 
+			PropertyType.COMPONENT);
+		registry.register(ThreadedAcousticScorer.PROP_IS_CPU_RELATIVE, 
+			PropertyType.BOOLEAN);
+		registry.register(ThreadedAcousticScorer.PROP_NUM_THREADS, 
+			PropertyType.INT);
+		registry.register(
+			ThreadedAcousticScorer.PROP_MIN_SCOREABLES_PER_THREAD, 
+			PropertyType.INT);
+		registry.register(ThreadedAcousticScorer.PROP_SCOREABLES_KEEP_FEATURE, 
+			PropertyType.BOOLEAN);
+		registry.register(ThreadedAcousticScorer.PROP_ACOUSTIC_GAIN, 
+			PropertyType.FLOAT);
+		registry.register(PROP_THREAD_PRIORITY, PropertyType.INT);
+		registry.register(PROP_CPU_AFFINITY, PropertyType.STRING);
+		registry.register(PROP_AUTO_TUNE, PropertyType.BOOLEAN);
+		registry.register(PROP_AUTO_TUNE_FRAMES, PropertyType.INT);
+		registry.register(PROP_PRIVATE_SCORE_CACHE, PropertyType.BOOLEAN);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		mFrontEnd = (FrontEnd) ps.getComponent(
+			ThreadedAcousticScorer.PROP_FRONTEND, FrontEnd.class);
+		boolean isCpuRelative = ps.getBoolean(
+			ThreadedAcousticScorer.PROP_IS_CPU_RELATIVE, 
+			ThreadedAcousticScorer.PROP_IS_CPU_RELATIVE_DEFAULT);
+		mMaxThreads = ps.getInt(ThreadedAcousticScorer.PROP_NUM_THREADS, 
+			ThreadedAcousticScorer.PROP_NUM_THREADS_DEFAULT);
+		mMinScoreablesPerThread = ps.getInt(
+			ThreadedAcousticScorer.PROP_MIN_SCOREABLES_PER_THREAD, 
+			ThreadedAcousticScorer.PROP_MIN_SCOREABLES_PER_THREAD_DEFAULT);
+		mKeepData = ps.getBoolean(
+			ThreadedAcousticScorer.PROP_SCOREABLES_KEEP_FEATURE, 
+			ThreadedAcousticScorer.PROP_SCOREABLES_KEEP_FEATURE_DEFAULT);
+		mAcousticGain = ps.getFloat(ThreadedAcousticScorer.PROP_ACOUSTIC_GAIN, 
+			ThreadedAcousticScorer.PROP_ACOUSTIC_GAIN_DEFAULT);
+		mThreadPriority = ps.getInt(PROP_THREAD_PRIORITY, 
+			Thread.NORM_PRIORITY);
+		mCpuMask = parseCpuList(ps.getString(PROP_CPU_AFFINITY, ""));
+		mAutoTune = ps.getBoolean(PROP_AUTO_TUNE, false);
+		mAutoTuneFrames = ps.getInt(PROP_AUTO_TUNE_FRAMES, 100);
+		mPrivateScoreCache = ps.getBoolean(PROP_PRIVATE_SCORE_CACHE, false);
+
+		// Same as ThreadedAcousticScorer: the count is added to the 
+		// number of CPUs when it is CPU-relative.
+		if (isCpuRelative)
+		{
+			mMaxThreads += Runtime.getRuntime().availableProcessors();
+		}
+
+		if (mMaxThreads < 1)
+		{
+			mMaxThreads = 1;
+		}
+
+		mThreadPriority = Math.max(Thread.MIN_PRIORITY, 
+			Math.min(Thread.MAX_PRIORITY, mThreadPriority));
+	}
+
+	public String getName()
+	{
+		return mName;
+	}
+
+	public void allocate() throws IOException
+	{
+		if (mMaxThreads > 1 && null == mExecutor)
+		{
+			mExecutor = Executors.newFixedThreadPool(mMaxThreads - 1, 
+				new ThreadFactory()
+				{
+					private int mCount = 0;
+
+					public Thread newThread(final Runnable r)
+					{
+						Thread thread = new Thread(new Runnable()
+							{
+								public void run()
+								{
+									pinThread();
+									r.run();
+								}
+							}, mName + " " + (++mCount));
+						thread.setDaemon(true);
+						thread.setPriority(mThreadPriority);
+						return thread;
+					}
+				});
+		}
+
+		mNumThreads = mMaxThreads;
+
+		if (mAutoTune && mMaxThreads > 1)
+		{
+			mNanosPerScoreable = new double[mMaxThreads + 1];
+			mTuneMinScoreables = mMaxThreads 
+				* Math.max(mMinScoreablesPerThread, 1);
+			mNumThreads = 1;
+			mTuneFrames = 0;
+			mTuneScoreables = 0;
+			mTuneNanos = 0;
+			mTuning = true;
+		}
+
+		Utils.log("debug", "Scoring with up to " + mMaxThreads 
+			+ " threads");
+	}
+
+	public void deallocate()
+	{
+		if (null != mExecutor)
+		{
+			mExecutor.shutdownNow();
+			mExecutor = null;
+		}
+	}
+
+	public void startRecognition()
+	{
+	}
+
+	public void stopRecognition()
+	{
+	}
+
+	/// Returns the number of threads currently scoring each frame.
+	public int getNumThreads()
+	{
+		return mNumThreads;
+	}
+
+	public Scoreable calculateScores(List scoreableList)
+	{
+		Data data;
+
+		try
+		{
+			data = mFrontEnd.getData();
+
+			if (data instanceof DataStartSignal)
+			{
+				data = mFrontEnd.getData();
+			}
+		}
+		catch (DataProcessingException e)
+		{
+			e.printStackTrace();
+			return null;
+		}
+
+		if (null == data || data instanceof DataEndSignal)
+		{
+			return null;
+		}
+
+		if (data instanceof Signal)
+		{
+			throw new Error("Can't score non-content feature");
+		}
+
+		mCurrentData = data;
+		long startTime = mTuning ? System.nanoTime() : 0;
+		Scoreable best = scoreAll(scoreableList);
+
+		if (mTuning && scoreableList.size() >= mTuneMinScoreables)
+		{
+			tune(scoreableList.size(), System.nanoTime() - startTime);
+		}
+
+		return best;
+	}
+
+	/// Splits the list among the threads and returns the best scoreable.
+	private Scoreable scoreAll(List scoreableList)
+	{
+		int size = scoreableList.size();
+		int numThreads = mNumThreads;
+		int perThread = (size + numThreads - 1) / Math.max(numThreads, 1);
+		perThread = Math.max(perThread, Math.max(mMinScoreablesPerThread, 1));
+
+		// Rounding the parts up can leave fewer parts than threads (127 
+		// scoreables on 14 threads make 13 parts of 10), so the thread 
+		// count always follows from the part size.
+		numThreads = (size + perThread - 1) / perThread;
+
+		if (numThreads <= 1 || null == mExecutor)
+		{
+			return score(scoreableList);
+		}
+
+		ArrayList<Future<Scoreable>> results = 
+			new ArrayList<Future<Scoreable>>(numThreads - 1);
+
+		for (int i = 1; i < numThreads; ++i)
+		{
+			final List part = scoreableList.subList(i * perThread, 
+				Math.min(size, (i + 1) * perThread));
+			results.add(mExecutor.submit(new Callable<Scoreable>()
+				{
+					public Scoreable call()
+					{
+						return score(part);
+					}
+				}));
+		}
+
+		// The calling thread scores the first part itself.  It is the 
+		// decoder's thread, which also runs the search, so it keeps its 
+		// own priority and CPU affinity.
+		Scoreable best = score(scoreableList.subList(0, perThread));
+
+		for (int i = 0; i < results.size(); ++i)
+		{
+			Scoreable partBest;
+
+			try
+			{
+				partBest = results.get(i).get();
+			}
+			catch (InterruptedException e)
+			{
+				Thread.currentThread().interrupt();
+				return best;
+			}
+			catch (ExecutionException e)
+			{
+				throw new Error("Scoring failed", e.getCause());
+			}
+
+			if (null == best 
+				|| (null != partBest && partBest.getScore() > best.getScore()))
+			{
+				best = partBest;
+			}
+		}
+
+		return best;
+	}
+
+	/// Scores every scoreable in the list and returns the best one.
+	private Scoreable score(List scoreables)
+	{
+		Scoreable best = null;
+		float bestScore = -Float.MAX_VALUE;
+		Iterator iterator = scoreables.iterator();
+		SenoneScoreCache cache = mPrivateScoreCache ? mScoreCaches.get() 
+			: null;
+
+		while (iterator.hasNext())
+		{
+			Scoreable scoreable = (Scoreable) iterator.next();
+			float score = (null != cache) ? cache.calculateScore(scoreable, 
+				mCurrentData, mKeepData, mAcousticGain) 
+				: scoreable.calculateScore(mCurrentData, mKeepData, 
+				mAcousticGain);
+
+			if (null == best || score > bestScore)
+			{
+				best = scoreable;
+				bestScore = score;
+			}
+		}
+
+		return best;
+	}
+
+	/// Records the time taken to score a frame with the current thread 
+	/// count.  After enough frames, moves on to the next count, or picks 
+	/// the fastest one once they have all been measured.
+	private void tune(int numScoreables, long nanos)
+	{
+		mTuneScoreables += numScoreables;
+		mTuneNanos += nanos;
+
+		if (++mTuneFrames < mAutoTuneFrames)
+		{
+			return;
+		}
+
+		mNanosPerScoreable[mNumThreads] = mTuneScoreables > 0 
+			? (double) mTuneNanos / mTuneScoreables : Double.MAX_VALUE;
+		mTuneFrames = 0;
+		mTuneScoreables = 0;
+		mTuneNanos = 0;
+
+		if (mNumThreads < mMaxThreads)
+		{
+			++mNumThreads;
+			return;
+		}
+
+		int best = 1;
+
+		for (int i = 2; i <= mMaxThreads; ++i)
+		{
+			if (mNanosPerScoreable[i] < AUTO_TUNE_MARGIN 
+				* mNanosPerScoreable[best])
+			{
+				best = i;
+			}
+		}
+
+		mNumThreads = best;
+		mTuning = false;
+		Utils.log("", "Scorer auto-tuned to " + best + " thread(s) (" 
+			+ (int) mNanosPerScoreable[best] + " ns per scoreable)");
+	}
+
+	/// Pins the calling thread to the CPUs in mCpuMask, if any.
+	private void pinThread()
+	{
+		if (0 == mCpuMask)
+		{
+			return;
+		}
+
+		try
+		{
+			if (!SpeechInterface.nativeSetThreadAffinity(mCpuMask))
+			{
+				Utils.log("warning", "Cannot set the CPU affinity of " 
+					+ Thread.currentThread().getName());
+			}
+		}
+		catch (UnsatisfiedLinkError e)
+		{
+			Utils.log("warning", "CPU affinity is only available through " 
+				+ "the C++ interface.");
+			mCpuMask = 0;
+		}
+	}
+
+	/// Parses a list of CPU numbers and ranges, such as "0-3,6", into a 
+	/// bit mask.  CPUs above 63 are ignored.
+	static long parseCpuList(String list)
+	{
+		long mask = 0;
+		String[] entries = list.trim().split("[\\s,]+");
+
+		for (int i = 0; i < entries.length; ++i)
+		{
+			if (entries[i].equals(""))
+			{
+				continue;
+			}
+
+			try
+			{
+				int dash = entries[i].indexOf('-');
+				int first = Integer.parseInt(dash < 0 ? entries[i] 
+					: entries[i].substring(0, dash));
+				int last = dash < 0 ? first 
+					: Integer.parseInt(entries[i].substring(dash + 1));
+
+				for (int cpu = Math.max(first, 0); cpu <= last && cpu < 64; 
+					++cpu)
+				{
+					mask |= 1L << cpu;
+				}
+			}
+			catch (NumberFormatException e)
+			{
+				Utils.log("warning", "Ignoring malformed CPU number: " 
+					+ entries[i]);
+			}
+		}
+
+		return mask;
+	}
+}
@@ -0,0 +1,129 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+/// A cache of synthesized phrases, so that a phrase spoken again costs a 
+/// memory copy instead of running FreeTTS's text analysis, unit 
+/// selection and waveform generation again.  Phrases are keyed by voice 
+/// and text, and the least recently used ones are evicted to keep the 
+/// samples within a memory budget.  All methods are thread-safe.
+public class PhraseCache
+{
+	/// The cached samples, from least to most recently used.
+	private LinkedHashMap<String, short[]> mPhrases = 
+		new LinkedHashMap<String, short[]>(16, 0.75f, true);
+
+	/// The most bytes of samples kept, and the bytes kept now.
+	private long mCapacity;
+	private long mSize = 0;
+
+	/// Counters for getStats.
+	private long mHitCount = 0;
+	private long mMissCount = 0;
+	private long mEvictionCount = 0;
+
+	/// Creates a cache that keeps at most 'capacity' bytes of samples.
+	public PhraseCache(long capacity)
+	{
+		mCapacity = capacity;
+	}
+
+	/// Returns the cached samples of a phrase, or null if it is not 
+	/// cached.  The samples are shared with the cache and must not be 
+	/// modified.
+	public synchronized short[] get(String voice, String text)
+	{
+		short[] samples = mPhrases.get(makeKey(voice, text));
+
+		if (null == samples)
+		{
+			++mMissCount;
+		}
+		else
+		{
+			++mHitCount;
+		}
+
+		return samples;
+	}
+
+	/// Checks whether a phrase is cached, without counting a hit or a 
+	/// miss or making it recently used.
+	public synchronized boolean contains(String voice, String text)
+	{
+		return mPhrases.containsKey(makeKey(voice, text));
+	}
+
+	/// Adds the samples of a phrase, evicting the least recently used 
+	/// phrases to make room.  A phrase larger than the whole cache is 
+	/// not kept.
+	public synchronized void put(String voice, String text, 
+		short[] samples)
+	{
+		long size = 2L * samples.length;
+
+		if (size > mCapacity)
+		{
+			return;
+		}
+
+		short[] old = mPhrases.put(makeKey(voice, text), samples);
+
+		if (null != old)
+		{
+			mSize -= 2L * old.length;
+		}
+
+		mSize += size;
+		Iterator<Map.Entry<String, short[]>> i = 
+			mPhrases.entrySet().iterator();
+
+		while (mSize > mCapacity)
+		{
+			mSize -= 2L * i.next().getValue().length;
+			i.remove();
+			++mEvictionCount;
+		}
+	}
+
+	/// Returns the number of lookups that found their phrase, the 
+	/// number that did not, the number of phrases evicted, the bytes of 
+	/// samples kept, and the number of phrases kept.
+	public synchronized long[] getStats()
+	{
+		return new long[] {mHitCount, mMissCount, mEvictionCount, mSize, 
+			mPhrases.size()};
+	}
+
+	/// Returns the key of a phrase.  Runs of whitespace are collapsed, 
+	/// since they do not change what is spoken.  Case is kept, since 
+	/// FreeTTS spells out some capitalized words.
+	private static String makeKey(String voice, String text)
+	{
+		return voice + "\n" + text.trim().replaceAll("\\s+", " ");
+	}
+}
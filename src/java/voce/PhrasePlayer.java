@@ -0,0 +1,240 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.util.LinkedList;
+import javax.sound.sampled.AudioFormat;
+import javax.sound.sampled.AudioSystem;
+import javax.sound.sampled.SourceDataLine;
+
+/// Plays queued messages through the audio device on its own thread.  
+/// Each message is rendered with SpeechSynthesizer.synthesizeToBuffer, 
+/// which answers repeated phrases from the phrase cache, and its 
+/// samples are written to a JavaSound line.  Used instead of the JSAPI 
+/// synthesizer's queue when the phrase cache is enabled.
+public class PhrasePlayer implements Runnable
+{
+	/// The number of bytes written to the line at a time, so that 
+	/// cancelAll takes effect quickly.
+	private static final int WRITE_SIZE = 4096;
+
+	/// Renders the messages.
+	private SpeechSynthesizer mSynthesizer;
+
+	/// The messages waiting to be played.  Also the monitor that guards 
+	/// the fields below.
+	private LinkedList<String> mQueue = new LinkedList<String>();
+
+	/// True while a message taken from the queue is being rendered or 
+	/// played.
+	private boolean mPlaying = false;
+
+	/// Set by cancelAll to stop the message being played.
+	private volatile boolean mCancelled = false;
+
+	private volatile boolean mRunning = true;
+	private Thread mThread;
+
+	/// The line the audio is played through, opened for the first 
+	/// message, and its sample rate.
+	private SourceDataLine mLine = null;
+	private int mLineSampleRate = 0;
+
+	/// Creates a player that renders messages with 'synthesizer', and 
+	/// starts its thread.
+	public PhrasePlayer(SpeechSynthesizer synthesizer)
+	{
+		mSynthesizer = synthesizer;
+		mThread = new Thread(this, "Phrase player thread");
+		mThread.setDaemon(true);
+		mThread.start();
+	}
+
+	/// Adds a message to the end of the queue.
+	public void speak(String message)
+	{
+		synchronized (mQueue)
+		{
+			mQueue.addLast(message);
+			mQueue.notifyAll();
+		}
+	}
+
+	/// Checks whether a message is being played or waiting to be.
+	public boolean isPlaying()
+	{
+		synchronized (mQueue)
+		{
+			return mPlaying || !mQueue.isEmpty();
+		}
+	}
+
+	/// Stops the message being played and removes all waiting ones.
+	public void cancelAll()
+	{
+		synchronized (mQueue)
+		{
+			mQueue.clear();
+
+			if (mPlaying)
+			{
+				mCancelled = true;
+			}
+		}
+	}
+
+	/// Stops the thread and closes the line.
+	public void destroy()
+	{
+		cancelAll();
+		mRunning = false;
+
+		synchronized (mQueue)
+		{
+			mQueue.notifyAll();
+		}
+
+		try
+		{
+			mThread.join();
+		}
+		catch (InterruptedException e)
+		{
+			Thread.currentThread().interrupt();
+		}
+
+		if (null != mLine)
+		{
+			mLine.close();
+		}
+	}
+
+	/// The body of the player thread.
+	public void run()
+	{
+		// Open the line now, so that the first message starts playing as 
+		// soon as it is rendered.
+		openLine(mSynthesizer.getBufferSampleRate());
+
+		while (mRunning)
+		{
+			String message;
+
+			synchronized (mQueue)
+			{
+				if (mQueue.isEmpty())
+				{
+					try
+					{
+						mQueue.wait();
+					}
+					catch (InterruptedException e)
+					{
+						return;
+					}
+
+					continue;
+				}
+
+				message = mQueue.removeFirst();
+				mPlaying = true;
+				mCancelled = false;
+			}
+
+			short[] samples = mSynthesizer.synthesizeToBuffer(message);
+
+			if (null != samples && !mCancelled)
+			{
+				play(samples, mSynthesizer.getBufferSampleRate());
+			}
+
+			synchronized (mQueue)
+			{
+				mPlaying = false;
+			}
+		}
+	}
+
+	/// Plays samples at the given rate, opening the line first if it is 
+	/// not open at that rate.  Returns early if cancelAll is called.
+	private void play(short[] samples, int sampleRate)
+	{
+		if (sampleRate != mLineSampleRate && !openLine(sampleRate))
+		{
+			return;
+		}
+
+		byte[] bytes = new byte[2 * samples.length];
+
+		for (int i = 0; i < samples.length; ++i)
+		{
+			bytes[2 * i] = (byte)samples[i];
+			bytes[2 * i + 1] = (byte)(samples[i] >> 8);
+		}
+
+		for (int i = 0; i < bytes.length && !mCancelled; i += WRITE_SIZE)
+		{
+			mLine.write(bytes, i, Math.min(WRITE_SIZE, bytes.length - i));
+		}
+
+		if (mCancelled)
+		{
+			mLine.flush();
+		}
+		else
+		{
+			mLine.drain();
+		}
+	}
+
+	/// Opens the line for 16-bit mono little-endian samples at the given 
+	/// rate.  Returns false if there is no such line.
+	private boolean openLine(int sampleRate)
+	{
+		if (null != mLine)
+		{
+			mLine.close();
+			mLine = null;
+			mLineSampleRate = 0;
+		}
+
+		AudioFormat format = new AudioFormat(sampleRate, 16, 1, true, 
+			false);
+
+		try
+		{
+			mLine = AudioSystem.getSourceDataLine(format);
+			mLine.open(format);
+			mLine.start();
+			mLineSampleRate = sampleRate;
+			return true;
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Cannot open an audio line for " 
+				+ "synthesized speech: " + e.getMessage());
+			mLine = null;
+			return false;
+		}
+	}
+}
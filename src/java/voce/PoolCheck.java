@@ -0,0 +1,239 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.decoder.search.Token;
+import edu.cmu.sphinx.frontend.util.StreamDataSource;
+import edu.cmu.sphinx.recognizer.Recognizer;
+import edu.cmu.sphinx.result.Result;
+import java.io.IOException;
+import java.io.InputStream;
+import java.util.ArrayList;
+
+/// A command line tool that checks that recognizers sharing one acoustic 
+/// model (see RecognizerPool) give the same results when they decode at 
+/// the same time as when one decodes alone.  The audio file is first 
+/// decoded by a single recognizer; then every recognizer decodes it 
+/// concurrently, several times over, and each result (the recognized 
+/// text and the best final token's score) must match the single-thread 
+/// result exactly.  Exits with status 1 if any result differs.  Usage:
+///
+/// java -cp voce.jar voce.PoolCheck [options] audioFile
+///
+/// Options:
+///
+/// -recognizers N - Number of concurrent recognizers (default: 2 per 
+/// CPU).
+/// -rounds N - Times each recognizer decodes the file (default: 3).
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -grammarPath path - Directory containing grammar files.
+/// -grammarName name - Grammar to use (default: the digits grammar).
+public class PoolCheck
+{
+	/// The audio file every recognizer decodes.
+	private String mFilename;
+
+	/// The recognizers being checked.
+	private RecognizerPool mPool;
+
+	/// The single-thread result every concurrent result must match.
+	private String mReference;
+
+	/// The number of concurrent results that did not match.
+	private int mMismatches = 0;
+
+	public static void main(String[] args)
+	{
+		int numRecognizers = 2 * Runtime.getRuntime().availableProcessors();
+		int rounds = 3;
+		String configFilename = "voce.config.xml";
+		String grammarPath = "./";
+		String grammarName = "";
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-recognizers") && i + 1 < args.length)
+			{
+				numRecognizers = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-rounds") && i + 1 < args.length)
+			{
+				rounds = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-grammarPath") && i + 1 < args.length)
+			{
+				grammarPath = args[++i];
+			}
+			else if (args[i].equals("-grammarName") && i + 1 < args.length)
+			{
+				grammarName = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 1 || numRecognizers < 2 || rounds < 1)
+		{
+			System.out.println("Usage: java voce.PoolCheck " 
+				+ "[-recognizers N] [-rounds N] [-config file] " 
+				+ "[-grammarPath path] [-grammarName name] audioFile");
+			System.exit(1);
+		}
+
+		int mismatches = 0;
+
+		try
+		{
+			Utils.log("", "Initializing " + numRecognizers 
+				+ " recognizers. This may take some time...");
+			PoolCheck check = new PoolCheck();
+			check.mFilename = positional.get(0);
+			check.mPool = new RecognizerPool(configFilename, grammarPath, 
+				grammarName, numRecognizers);
+			mismatches = check.run(rounds);
+			check.mPool.deallocate();
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Pool check failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+
+		if (mismatches > 0)
+		{
+			Utils.log("ERROR", mismatches 
+				+ " concurrent results differed from the single-thread " 
+				+ "result");
+			System.exit(1);
+		}
+
+		Utils.log("", "All concurrent results match");
+		System.exit(0);
+	}
+
+	/// Decodes the file on one recognizer, then on all of them at once 
+	/// 'rounds' times each.  Returns the number of concurrent results 
+	/// that differed from the single-thread one.
+	private int run(final int rounds) throws IOException
+	{
+		mReference = decode(mPool.getRecognizer(0), mPool.getDataSource(0));
+		Utils.log("", "Single-thread result: " + mReference);
+
+		Thread[] threads = new Thread[mPool.size()];
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			final int index = i;
+
+			threads[i] = new Thread(new Runnable()
+				{
+					public void run()
+					{
+						for (int round = 0; round < rounds; ++round)
+						{
+							check(index);
+						}
+					}
+				}, "Pool check " + i);
+			threads[i].start();
+		}
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			try
+			{
+				threads[i].join();
+			}
+			catch (InterruptedException e)
+			{
+			}
+		}
+
+		return mMismatches;
+	}
+
+	/// Decodes the file with the given recognizer and compares the result 
+	/// to the single-thread one.
+	private void check(int recognizerIndex)
+	{
+		String result;
+
+		try
+		{
+			result = decode(mPool.getRecognizer(recognizerIndex), 
+				mPool.getDataSource(recognizerIndex));
+		}
+		catch (Exception e)
+		{
+			result = "error: " + e;
+		}
+
+		if (!result.equals(mReference))
+		{
+			Utils.log("warning", "Recognizer " + recognizerIndex 
+				+ " returned '" + result + "'");
+
+			synchronized (this)
+			{
+				++mMismatches;
+			}
+		}
+	}
+
+	/// Decodes the file and returns each utterance's text and best final 
+	/// token score, so that results differing only in score are caught.
+	private String decode(Recognizer recognizer, StreamDataSource source) 
+		throws IOException
+	{
+		InputStream stream = SpeechRecognizer.openAudioFile(mFilename);
+
+		try
+		{
+			source.setInputStream(stream, mFilename);
+			String text = "";
+			Result result = recognizer.recognize();
+
+			while (null != result)
+			{
+				Token token = result.getBestFinalToken();
+				text += "[" + result.getBestFinalResultNoFiller() + " " 
+					+ (null == token ? "-" : "" + token.getScore()) + "]";
+				result = recognizer.recognize();
+			}
+
+			return text;
+		}
+		finally
+		{
+			stream.close();
+		}
+	}
+}
@@ -0,0 +1,537 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
+import java.util.LinkedHashSet;
+import java.util.TreeSet;
+
+/// A command line tool that compares the search profiles (see the 
+/// 'searchProfile' option of SpeechInterface.init) on grammars of 
+/// several kinds and sizes.  For each profile, kind and size it reports 
+/// the time to create the recognizer, the heap it uses, the real-time 
+/// factor and the word error rate on a set of test recordings.  Usage:
+///
+/// java -cp voce.jar voce.ProfileBenchmark [options] testList outputFile
+///
+/// Each line of 'testList' names a 16 kHz mono audio file (see 
+/// SpeechRecognizer.recognizeFile) followed by its transcript.  Each 
+/// grammar uses the transcripts' words plus enough words from the 
+/// vocabulary file to reach the size.  The kinds of grammar are:
+///
+/// loop - Any sequence of the words.
+/// phrases - A list of alternative phrases: the transcripts, and 
+///   phrases of vocabulary words as long as the average transcript.
+/// slots - Sentences with one slot per word position.  Each slot lists 
+///   the transcripts' words at that position, and the vocabulary words 
+///   are spread over the slots.  The sentences are as long as the 
+///   transcripts.
+///
+/// The results are written as CSV.  Options:
+///
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -vocabulary file - Word list to draw from (default: 
+///   ./vocabulary.txt).
+/// -sizes list - Comma-separated grammar sizes (default: 10,1000,10000).
+/// -grammars list - Comma-separated kinds of grammar (default: 
+///   loop,phrases,slots).
+///
+/// The flat profile needs a large heap for the bigger grammars (run 
+/// java with -Xmx1g, for example).
+public class ProfileBenchmark
+{
+	/// The profiles being compared.
+	private static final String[] PROFILES = {"flat", "lexTree"};
+
+	/// The test recordings and their transcripts.
+	private ArrayList<String> mAudioFiles = new ArrayList<String>();
+	private ArrayList<String[]> mTranscripts = new ArrayList<String[]>();
+
+	public static void main(String[] args)
+	{
+		String configFilename = "voce.config.xml";
+		String vocabularyFilename = "vocabulary.txt";
+		String sizes = "10,1000,10000";
+		String grammars = "loop,phrases,slots";
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-vocabulary") && i + 1 < args.length)
+			{
+				vocabularyFilename = args[++i];
+			}
+			else if (args[i].equals("-sizes") && i + 1 < args.length)
+			{
+				sizes = args[++i];
+			}
+			else if (args[i].equals("-grammars") && i + 1 < args.length)
+			{
+				grammars = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 2)
+		{
+			System.out.println("Usage: java voce.ProfileBenchmark " 
+				+ "[-config file] [-vocabulary file] [-sizes list] " 
+				+ "[-grammars list] testList outputFile");
+			System.exit(1);
+		}
+
+		PrintWriter out = null;
+
+		try
+		{
+			ProfileBenchmark benchmark = new ProfileBenchmark();
+			benchmark.readTestList(positional.get(0));
+			String[] vocabulary = readVocabulary(vocabularyFilename);
+
+			File grammarDirectory = File.createTempFile("voceBenchmark", "");
+			grammarDirectory.delete();
+			grammarDirectory.mkdirs();
+
+			out = new PrintWriter(new FileWriter(positional.get(1)));
+			out.println("profile,grammar,words,initSeconds,heapMegabytes," 
+				+ "realTimeFactor,wordErrorRate");
+
+			String[] sizeList = sizes.split(",");
+			String[] grammarList = grammars.split(",");
+
+			for (int i = 0; i < sizeList.length; ++i)
+			{
+				int size = Integer.parseInt(sizeList[i].trim());
+
+				for (int j = 0; j < grammarList.length; ++j)
+				{
+					String kind = grammarList[j].trim();
+					String grammarName = kind + size;
+					int numWords = benchmark.writeGrammar(new File(
+						grammarDirectory, grammarName + ".gram"), 
+						grammarName, kind, vocabulary, size);
+
+					if (numWords < 0)
+					{
+						Utils.log("warning", "Unknown kind of grammar: " 
+							+ kind);
+						continue;
+					}
+
+					for (int k = 0; k < PROFILES.length; ++k)
+					{
+						String row = benchmark.run(configFilename, 
+							grammarDirectory.getPath(), grammarName, 
+							PROFILES[k]);
+						out.println(PROFILES[k] + "," + kind + "," 
+							+ numWords + "," + row);
+						out.flush();
+						Utils.log("", PROFILES[k] + ", " + kind + ", " 
+							+ numWords + " words: " + row);
+					}
+				}
+			}
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+		}
+
+		System.exit(0);
+	}
+
+	/// Creates a recognizer with the given profile and grammar, decodes 
+	/// every test recording, and returns the CSV fields for the results.
+	public String run(String configFilename, String grammarPath, 
+		String grammarName, String profile)
+	{
+		long heapBefore = getUsedHeap();
+		long startTime = System.nanoTime();
+		SpeechRecognizer recognizer = new SpeechRecognizer(configFilename, 
+			grammarPath, grammarName, Utils.parseOptions(
+			"audioInput=file searchProfile=" + profile));
+		double initSeconds = (System.nanoTime() - startTime) / 1e9;
+		long heapUsed = getUsedHeap() - heapBefore;
+
+		double audioSeconds = 0;
+		double decodeSeconds = 0;
+		int errors = 0;
+		int referenceWords = 0;
+
+		for (int i = 0; i < mAudioFiles.size(); ++i)
+		{
+			String filename = mAudioFiles.get(i);
+
+			try
+			{
+				audioSeconds += SpeechRecognizer.getAudioFileDuration(
+					filename);
+			}
+			catch (IOException e)
+			{
+				Utils.log("warning", "Cannot read " + filename + ": " 
+					+ e.getMessage());
+				continue;
+			}
+
+			startTime = System.nanoTime();
+			String text = recognizer.recognizeFile(filename);
+			decodeSeconds += (System.nanoTime() - startTime) / 1e9;
+
+			String[] reference = mTranscripts.get(i);
+			errors += getEditDistance(reference, splitWords(text));
+			referenceWords += reference.length;
+		}
+
+		recognizer.destroy();
+
+		return initSeconds + "," + heapUsed / (1024.0 * 1024.0) + "," 
+			+ (audioSeconds > 0 ? decodeSeconds / audioSeconds : 0) + "," 
+			+ (referenceWords > 0 ? (double) errors / referenceWords : 0);
+	}
+
+	/// Reads the test list: an audio filename and its transcript per 
+	/// line.
+	private void readTestList(String filename) throws IOException
+	{
+		BufferedReader in = new BufferedReader(new FileReader(filename));
+
+		try
+		{
+			String line = in.readLine();
+
+			while (null != line)
+			{
+				String[] fields = splitWords(line);
+
+				if (fields.length > 0)
+				{
+					String[] transcript = new String[fields.length - 1];
+					System.arraycopy(fields, 1, transcript, 0, 
+						transcript.length);
+					mAudioFiles.add(fields[0]);
+					mTranscripts.add(transcript);
+				}
+
+				line = in.readLine();
+			}
+		}
+		finally
+		{
+			in.close();
+		}
+	}
+
+	/// Writes a grammar of the given kind (see above) with 'size' words 
+	/// in all, or more if the transcripts use more.  Returns the number 
+	/// of words, or -1 if the kind is unknown.
+	private int writeGrammar(File file, String grammarName, String kind, 
+		String[] vocabulary, int size) throws IOException
+	{
+		LinkedHashSet<String> words = new LinkedHashSet<String>();
+		ArrayList<String> rules = new ArrayList<String>();
+		String body;
+
+		for (int i = 0; i < mTranscripts.size(); ++i)
+		{
+			words.addAll(Arrays.asList(mTranscripts.get(i)));
+		}
+
+		if (kind.equals("loop"))
+		{
+			for (int i = 0; i < vocabulary.length && words.size() < size; 
+				++i)
+			{
+				words.add(vocabulary[i]);
+			}
+
+			body = "(" + join(words, " | ") + ")*";
+		}
+		else if (kind.equals("phrases"))
+		{
+			body = getPhrases(words, vocabulary, size);
+		}
+		else if (kind.equals("slots"))
+		{
+			body = getSlots(words, rules, vocabulary, size);
+		}
+		else
+		{
+			return -1;
+		}
+
+		PrintWriter out = new PrintWriter(new FileWriter(file));
+
+		try
+		{
+			out.println("#JSGF V1.0;");
+			out.println("grammar " + grammarName + ";");
+			out.println("public <sentence> = " + body + ";");
+
+			for (int i = 0; i < rules.size(); ++i)
+			{
+				out.println(rules.get(i));
+			}
+		}
+		finally
+		{
+			out.close();
+		}
+
+		return words.size();
+	}
+
+	/// Returns the alternatives of a phrases grammar, adding the 
+	/// vocabulary words it uses to 'words'.
+	private String getPhrases(LinkedHashSet<String> words, 
+		String[] vocabulary, int size)
+	{
+		LinkedHashSet<String> phrases = new LinkedHashSet<String>();
+		int totalLength = 0;
+
+		for (int i = 0; i < mTranscripts.size(); ++i)
+		{
+			String[] transcript = mTranscripts.get(i);
+
+			if (transcript.length > 0)
+			{
+				phrases.add(join(Arrays.asList(transcript), " "));
+				totalLength += transcript.length;
+			}
+		}
+
+		int length = phrases.isEmpty() ? 1 
+			: Math.max(1, Math.round((float) totalLength / phrases.size()));
+		ArrayList<String> phrase = new ArrayList<String>();
+
+		for (int i = 0; i < vocabulary.length && words.size() < size; ++i)
+		{
+			words.add(vocabulary[i]);
+			phrase.add(vocabulary[i]);
+
+			if (phrase.size() == length)
+			{
+				phrases.add(join(phrase, " "));
+				phrase.clear();
+			}
+		}
+
+		if (!phrase.isEmpty())
+		{
+			phrases.add(join(phrase, " "));
+		}
+
+		return "(" + join(phrases, " | ") + ")";
+	}
+
+	/// Returns the alternatives of a slots grammar, adding a rule for each 
+	/// slot to 'rules' and the vocabulary words it uses to 'words'.
+	private String getSlots(LinkedHashSet<String> words, 
+		ArrayList<String> rules, String[] vocabulary, int size)
+	{
+		ArrayList<LinkedHashSet<String>> slots = 
+			new ArrayList<LinkedHashSet<String>>();
+		TreeSet<Integer> lengths = new TreeSet<Integer>();
+
+		for (int i = 0; i < mTranscripts.size(); ++i)
+		{
+			String[] transcript = mTranscripts.get(i);
+
+			if (0 == transcript.length)
+			{
+				continue;
+			}
+
+			lengths.add(new Integer(transcript.length));
+
+			for (int j = 0; j < transcript.length; ++j)
+			{
+				if (slots.size() == j)
+				{
+					slots.add(new LinkedHashSet<String>());
+				}
+
+				slots.get(j).add(transcript[j]);
+			}
+		}
+
+		if (slots.isEmpty())
+		{
+			// Without transcripts, fall back to sentences of one word.
+			slots.add(new LinkedHashSet<String>());
+			lengths.add(new Integer(1));
+		}
+
+		for (int i = 0; i < vocabulary.length && words.size() < size; ++i)
+		{
+			words.add(vocabulary[i]);
+			slots.get(i % slots.size()).add(vocabulary[i]);
+		}
+
+		ArrayList<String> sentences = new ArrayList<String>();
+
+		for (Integer length : lengths)
+		{
+			String sentence = "";
+
+			for (int i = 0; i < length.intValue(); ++i)
+			{
+				sentence += (0 == i ? "" : " ") + "<slot" + i + ">";
+			}
+
+			sentences.add(sentence);
+		}
+
+		for (int i = 0; i < slots.size(); ++i)
+		{
+			rules.add("<slot" + i + "> = " + join(slots.get(i), " | ") 
+				+ ";");
+		}
+
+		return "(" + join(sentences, " | ") + ")";
+	}
+
+	/// Joins strings with a separator.
+	private static String join(Collection<String> strings, 
+		String separator)
+	{
+		StringBuffer result = new StringBuffer();
+
+		for (String s : strings)
+		{
+			if (result.length() > 0)
+			{
+				result.append(separator);
+			}
+
+			result.append(s);
+		}
+
+		return result.toString();
+	}
+
+	/// Reads the vocabulary, keeping only plain words that can appear in 
+	/// a grammar without quoting.
+	private static String[] readVocabulary(String filename) 
+		throws IOException
+	{
+		ArrayList<String> words = new ArrayList<String>();
+		BufferedReader in = new BufferedReader(new FileReader(filename));
+
+		try
+		{
+			String line = in.readLine();
+
+			while (null != line)
+			{
+				line = line.trim().toLowerCase();
+
+				if (line.matches("[a-z]+"))
+				{
+					words.add(line);
+				}
+
+				line = in.readLine();
+			}
+		}
+		finally
+		{
+			in.close();
+		}
+
+		return words.toArray(new String[words.size()]);
+	}
+
+	/// Splits text into lower case words.
+	private static String[] splitWords(String text)
+	{
+		text = text.trim().toLowerCase();
+		return text.equals("") ? new String[0] : text.split("\\s+");
+	}
+
+	/// Returns the number of word substitutions, insertions and deletions 
+	/// that turn 'reference' into 'hypothesis'.
+	private static int getEditDistance(String[] reference, 
+		String[] hypothesis)
+	{
+		int[] previous = new int[hypothesis.length + 1];
+		int[] current = new int[hypothesis.length + 1];
+
+		for (int j = 0; j <= hypothesis.length; ++j)
+		{
+			previous[j] = j;
+		}
+
+		for (int i = 1; i <= reference.length; ++i)
+		{
+			current[0] = i;
+
+			for (int j = 1; j <= hypothesis.length; ++j)
+			{
+				int substitution = previous[j - 1] 
+					+ (reference[i - 1].equals(hypothesis[j - 1]) ? 0 : 1);
+				current[j] = Math.min(substitution, 
+					Math.min(previous[j], current[j - 1]) + 1);
+			}
+
+			int[] swap = previous;
+			previous = current;
+			current = swap;
+		}
+
+		return previous[hypothesis.length];
+	}
+
+	/// Returns the heap in use after a garbage collection.
+	private static long getUsedHeap()
+	{
+		Runtime runtime = Runtime.getRuntime();
+		runtime.gc();
+		runtime.gc();
+		return runtime.totalMemory() - runtime.freeMemory();
+	}
+}
@@ -0,0 +1,254 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.frontend.BaseDataProcessor;
+import edu.cmu.sphinx.frontend.Data;
+import edu.cmu.sphinx.frontend.DataEndSignal;
+import edu.cmu.sphinx.frontend.DataProcessingException;
+import edu.cmu.sphinx.frontend.DataStartSignal;
+import edu.cmu.sphinx.frontend.DoubleData;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.ShortBuffer;
+
+/// A front end data source that reads audio pushed from native code 
+/// with voce::pushAudio.  The samples stay in a ring buffer owned by the 
+/// C++ interface and are read in place through a direct ByteBuffer, so 
+/// they are never copied into Java arrays.  It takes the place of the 
+/// Microphone at the start of the 'pushFrontEnd' pipeline.  The audio 
+/// must be 16 kHz, 16-bit, signed, mono.  Each stream served by 
+/// StreamServer has its own source and ring buffer, identified by the 
+/// 'stream' property.
+public class PushAudioSource extends BaseDataProcessor
+{
+	/// The Sphinx property for the size of the ring buffer in samples.  
+	/// It is rounded up to a power of two.
+	public static final String PROP_BUFFER_SIZE = "bufferSize";
+
+	/// The default value for PROP_BUFFER_SIZE (about 4 seconds).
+	public static final int PROP_BUFFER_SIZE_DEFAULT = 65536;
+
+	/// The Sphinx property for the number of samples in each Data object 
+	/// given to the rest of the front end.
+	public static final String PROP_SAMPLES_PER_READ = "samplesPerRead";
+
+	/// The default value for PROP_SAMPLES_PER_READ (10 ms).
+	public static final int PROP_SAMPLES_PER_READ_DEFAULT = 160;
+
+	/// The Sphinx property for the number of the native ring buffer to 
+	/// read from.  0 (the default) is the one fed by voce::pushAudio 
+	/// without a stream; StreamServer's streams are numbered from 1.
+	public static final String PROP_STREAM = "stream";
+
+	/// The sample rate of the pushed audio.
+	public static final int SAMPLE_RATE = 16000;
+
+	/// How long the recognition thread sleeps while waiting for more 
+	/// audio to be pushed.
+	private static final int POLL_INTERVAL_MS = 5;
+
+	private int mBufferSize = PROP_BUFFER_SIZE_DEFAULT;
+	private int mSamplesPerRead = PROP_SAMPLES_PER_READ_DEFAULT;
+	private int mStreamId = 0;
+
+	/// A view of the native ring buffer, or null if it does not exist.
+	private ShortBuffer mSamples = null;
+
+	/// The native ring buffer's size minus one, used to wrap positions.
+	private int mMask = 0;
+
+	/// The number of samples read so far (wrapping around).  Only the 
+	/// recognition thread reads from the ring buffer.
+	private int mReadPosition = 0;
+
+	/// The number of samples returned since the stream began.
+	private long mSampleNumber = 0;
+
+	/// The sample number at which the current stream began.
+	private long mStreamStartSample = 0;
+
+	/// True while audio should be delivered.  See start and stop.
+	private volatile boolean mStarted = false;
+
+	/// True between the DataStartSignal and DataEndSignal of a stream.
+	private boolean mStreamOpen = false;
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		super.register(name, registry);
+		registry.register(PROP_BUFFER_SIZE, PropertyType.INT);
+		registry.register(PROP_SAMPLES_PER_READ, PropertyType.INT);
+		registry.register(PROP_STREAM, PropertyType.INT);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		super.newProperties(ps);
+		mBufferSize = ps.getInt(PROP_BUFFER_SIZE, PROP_BUFFER_SIZE_DEFAULT);
+		mSamplesPerRead = ps.getInt(PROP_SAMPLES_PER_READ, 
+			PROP_SAMPLES_PER_READ_DEFAULT);
+		mStreamId = ps.getInt(PROP_STREAM, 0);
+	}
+
+	/// Creates the native ring buffer.  Called when the front end is 
+	/// initialized.
+	public void initialize()
+	{
+		super.initialize();
+
+		ByteBuffer bytes = null;
+
+		try
+		{
+			bytes = SpeechInterface.nativeCreateAudioBuffer(mStreamId, 
+				mBufferSize);
+		}
+		catch (UnsatisfiedLinkError e)
+		{
+			Utils.log("ERROR", "Push audio input is only available " 
+				+ "through the C++ interface.");
+			return;
+		}
+
+		if (null == bytes)
+		{
+			Utils.log("ERROR", "Cannot create push audio buffer.");
+			return;
+		}
+
+		// The samples are written by native code in native byte order.
+		mSamples = bytes.order(ByteOrder.nativeOrder()).asShortBuffer();
+		mMask = mSamples.capacity() - 1;
+		mReadPosition = 0;
+	}
+
+	/// Starts delivering pushed audio.  The next call to getData begins 
+	/// a new stream.
+	public void start()
+	{
+		mStarted = true;
+	}
+
+	/// Stops delivering pushed audio.  The stream is ended the next time 
+	/// getData is called, including a call that is already waiting for 
+	/// audio.
+	public void stop()
+	{
+		mStarted = false;
+	}
+
+	/// Returns true if pushed audio is being delivered.
+	public boolean isStarted()
+	{
+		return mStarted;
+	}
+
+	/// Discards any audio that has been pushed but not yet read.  Must 
+	/// not be called while the recognition thread is running.
+	public void clear()
+	{
+		if (null == mSamples)
+		{
+			return;
+		}
+
+		int available = SpeechInterface.nativeAudioAvailable(mStreamId, 0);
+		mReadPosition += available;
+		SpeechInterface.nativeAudioConsumed(mStreamId, available);
+	}
+
+	/// Returns the next frame of pushed audio, waiting for the 
+	/// application to push more if necessary.  Each stream begins with a 
+	/// DataStartSignal and ends with a DataEndSignal once stop is called.  
+	/// Returns null when stopped between streams.
+	public Data getData() throws DataProcessingException
+	{
+		if (null == mSamples)
+		{
+			throw new DataProcessingException("Push audio buffer has not " 
+				+ "been created.");
+		}
+
+		if (!mStreamOpen)
+		{
+			if (!mStarted)
+			{
+				return null;
+			}
+
+			mStreamOpen = true;
+			mStreamStartSample = mSampleNumber;
+			return new DataStartSignal();
+		}
+
+		// Passing the frame size only on the first check counts one 
+		// underrun per wait, however long it lasts.
+		int available = SpeechInterface.nativeAudioAvailable(mStreamId, 
+			mSamplesPerRead);
+
+		while (mStarted && available < mSamplesPerRead)
+		{
+			try
+			{
+				Thread.sleep(POLL_INTERVAL_MS);
+			}
+			catch (InterruptedException e)
+			{
+			}
+
+			available = SpeechInterface.nativeAudioAvailable(mStreamId, 0);
+		}
+
+		if (!mStarted)
+		{
+			mStreamOpen = false;
+			long duration = (mSampleNumber - mStreamStartSample) * 1000 
+				/ SAMPLE_RATE;
+			return new DataEndSignal(duration);
+		}
+
+		// The front end works on doubles, so converting here is the only 
+		// time the samples are touched on the Java side.
+		double[] values = new double[mSamplesPerRead];
+
+		for (int i = 0; i < mSamplesPerRead; ++i)
+		{
+			values[i] = mSamples.get((mReadPosition + i) & mMask);
+		}
+
+		mReadPosition += mSamplesPerRead;
+		SpeechInterface.nativeAudioConsumed(mStreamId, mSamplesPerRead);
+
+		Data data = new DoubleData(values, SAMPLE_RATE, 
+			System.currentTimeMillis(), mSampleNumber);
+		mSampleNumber += mSamplesPerRead;
+		return data;
+	}
+}
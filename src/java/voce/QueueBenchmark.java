@@ -0,0 +1,587 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.FileWriter;
+import java.io.PrintWriter;
+import java.lang.management.ManagementFactory;
+import java.lang.management.ThreadMXBean;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.LinkedList;
+import java.util.Random;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicIntegerArray;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.LockSupport;
+
+/// A command line tool that tests and measures the queue that carries 
+/// recognized strings from the recognition thread to the application 
+/// (see StringQueue).  No audio or Sphinx4 configuration is needed.  
+/// Usage:
+///
+/// java -cp voce.jar voce.QueueBenchmark [options] outputFile
+///
+/// The results are written as CSV, one row per measurement:
+///
+/// wait - How long a consumer waiting in poll(timeoutMs), as 
+///   waitForRecognizedString does, takes to see a string added to the 
+///   empty queue, and how much CPU time it uses while waiting.
+/// sleep200us, sleep1ms - The same for a consumer that polls every 200 
+///   microseconds, as recognitionTest did before 
+///   waitForRecognizedString existed, and every millisecond.
+/// stress, stressBounded - One producer and several consumers using 
+///   poll, poll(timeoutMs) and drainTo at once, on an unbounded queue 
+///   and on one holding 16 strings.  Counts the strings that were lost, 
+///   received twice or received out of order, and the times size() was 
+///   negative.
+/// coalesce - Checks that the COALESCE policy drops exactly the strings 
+///   that are already queued.
+/// lockFree, original, blocking - Strings per second passed from one 
+///   thread to another by StringQueue, by the unsynchronized LinkedList 
+///   the recognizer originally used, and by the LinkedBlockingQueue that 
+///   StringQueue replaced, with the strings each one lost.  The 
+///   original queue was not safe to use from two threads, so its lost 
+///   strings are expected; the others must lose none.
+///
+/// The tool exits with an error if the stress tests, the coalesce check 
+/// or the lockFree or blocking queues find any errors.
+///
+/// Options:
+///
+/// -iterations N - Number of strings per latency measurement (default: 
+///   1000).
+/// -strings N - Number of strings per stress test and throughput 
+///   measurement (default: 1000000).
+/// -consumers N - Number of consumers in the stress tests (default: 4).
+public class QueueBenchmark
+{
+	/// The number of strings passed before the latency measurements 
+	/// start, so that they do not include the JIT compiler's work.
+	private static final int WARMUP_ITERATIONS = 100;
+
+	/// The queue operations used by measureThroughput, so StringQueue 
+	/// can be compared with the queues it replaced.
+	private static abstract class BenchmarkQueue
+	{
+		abstract void add(String s);
+		abstract String poll();
+	}
+
+	private static class LockFreeQueue extends BenchmarkQueue
+	{
+		private StringQueue mQueue = new StringQueue();
+
+		void add(String s)
+		{
+			mQueue.add(s);
+		}
+
+		String poll()
+		{
+			return mQueue.poll();
+		}
+	}
+
+	/// The queue exactly as SpeechRecognizer first used it: a LinkedList 
+	/// with no synchronization at all.
+	private static class OriginalQueue extends BenchmarkQueue
+	{
+		private LinkedList<String> mQueue = new LinkedList<String>();
+
+		void add(String s)
+		{
+			mQueue.addLast(s);
+		}
+
+		String poll()
+		{
+			if (mQueue.size() > 0)
+			{
+				return mQueue.removeFirst();
+			}
+
+			return null;
+		}
+	}
+
+	private static class BlockingStringQueue extends BenchmarkQueue
+	{
+		private LinkedBlockingQueue<String> mQueue = 
+			new LinkedBlockingQueue<String>();
+
+		void add(String s)
+		{
+			mQueue.offer(s);
+		}
+
+		String poll()
+		{
+			return mQueue.poll();
+		}
+	}
+
+	public static void main(String[] args)
+	{
+		int iterations = 1000;
+		int numStrings = 1000000;
+		int numConsumers = 4;
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-iterations") && i + 1 < args.length)
+			{
+				iterations = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-strings") && i + 1 < args.length)
+			{
+				numStrings = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-consumers") && i + 1 < args.length)
+			{
+				numConsumers = Integer.parseInt(args[++i]);
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 1 || iterations < 1 || numStrings < 1 
+			|| numConsumers < 1)
+		{
+			System.out.println("Usage: java voce.QueueBenchmark " 
+				+ "[-iterations N] [-strings N] [-consumers N] outputFile");
+			System.exit(1);
+		}
+
+		ThreadMXBean threads = ManagementFactory.getThreadMXBean();
+
+		if (threads.isCurrentThreadCpuTimeSupported())
+		{
+			threads.setThreadCpuTimeEnabled(true);
+		}
+
+		PrintWriter out = null;
+		int errors = 0;
+
+		try
+		{
+			out = new PrintWriter(new FileWriter(positional.get(0)));
+			out.println("measurement,strings,medianMicros,p99Micros," 
+				+ "maxMicros,consumerCpuMillis,stringsPerSecond,errors");
+
+			String[] modes = {"wait", "sleep200us", "sleep1ms"};
+			long[] pollNanos = {0, 200000, 1000000};
+
+			for (int i = 0; i < modes.length; ++i)
+			{
+				String row = iterations + "," + measureWakeLatency(
+					pollNanos[i], iterations, threads) + ",,";
+				out.println(modes[i] + "," + row);
+				out.flush();
+				Utils.log("", modes[i] + ": " + row);
+			}
+
+			int[] capacities = {0, 16};
+
+			for (int i = 0; i < capacities.length; ++i)
+			{
+				String name = (0 == i) ? "stress" : "stressBounded";
+				int count = stressTest(numStrings, numConsumers, 
+					capacities[i]);
+				errors += count;
+				out.println(name + "," + numStrings + ",,,,,," + count);
+				out.flush();
+				Utils.log("", name + ": " + count + " errors");
+			}
+
+			int coalesceErrors = checkCoalesce();
+			errors += coalesceErrors;
+			out.println("coalesce,,,,,,," + coalesceErrors);
+			out.flush();
+			Utils.log("", "coalesce: " + coalesceErrors + " errors");
+
+			BenchmarkQueue[] queues = {new LockFreeQueue(), 
+				new OriginalQueue(), new BlockingStringQueue()};
+			String[] names = {"lockFree", "original", "blocking"};
+
+			for (int i = 0; i < queues.length; ++i)
+			{
+				long[] lost = new long[1];
+				double rate = measureThroughput(queues[i], numStrings, 
+					lost);
+				out.println(names[i] + "," + numStrings + ",,,,," + rate 
+					+ "," + lost[0]);
+				out.flush();
+				Utils.log("", names[i] + ": " + rate + " strings/s, " 
+					+ lost[0] + " lost");
+
+				if (!(queues[i] instanceof OriginalQueue))
+				{
+					errors += (int)Math.min(lost[0], Integer.MAX_VALUE);
+				}
+			}
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+		}
+
+		if (errors > 0)
+		{
+			Utils.log("ERROR", "The checks found " + errors + " errors.");
+			System.exit(1);
+		}
+
+		System.exit(0);
+	}
+
+	/// Measures how long a consumer takes to see a string after it is 
+	/// added to an empty queue.  The consumer blocks in poll(timeoutMs) 
+	/// if 'pollNanos' is 0, and otherwise sleeps for that long between 
+	/// polls.  The producer adds the strings 2 to 5 ms apart, each 
+	/// holding the time it was added.  The first WARMUP_ITERATIONS 
+	/// strings are not measured.  Returns the median, 99th percentile 
+	/// and maximum latency, and the CPU time used by the consumer, as CSV 
+	/// columns.
+	private static String measureWakeLatency(final long pollNanos, 
+		final int iterations, final ThreadMXBean threads) 
+		throws InterruptedException
+	{
+		final StringQueue queue = new StringQueue();
+		final long[] latencies = new long[iterations];
+		final long[] cpuTime = new long[1];
+
+		Thread consumer = new Thread(new Runnable()
+			{
+				public void run()
+				{
+					long startCpuTime = 0;
+
+					for (int i = -WARMUP_ITERATIONS; i < iterations; ++i)
+					{
+						if (0 == i)
+						{
+							startCpuTime = getCpuTime(threads);
+						}
+
+						String s = null;
+
+						while (null == s)
+						{
+							s = (0 == pollNanos) ? queue.poll(1000) 
+								: queue.poll();
+
+							if (null == s && 0 != pollNanos)
+							{
+								LockSupport.parkNanos(pollNanos);
+							}
+						}
+
+						long latency = System.nanoTime() - Long.parseLong(s);
+
+						if (i >= 0)
+						{
+							latencies[i] = latency;
+						}
+					}
+
+					cpuTime[0] = getCpuTime(threads) - startCpuTime;
+				}
+			}, "Queue benchmark consumer");
+		consumer.start();
+
+		Random random = new Random(1);
+
+		for (int i = -WARMUP_ITERATIONS; i < iterations; ++i)
+		{
+			Thread.sleep(2 + random.nextInt(4));
+			queue.add(Long.toString(System.nanoTime()));
+		}
+
+		consumer.join();
+		Arrays.sort(latencies);
+		int p99 = Math.min(iterations * 99 / 100, iterations - 1);
+
+		return latencies[iterations / 2] / 1000 + "," 
+			+ latencies[p99] / 1000 + "," + latencies[iterations - 1] / 1000 
+			+ "," + cpuTime[0] / 1e6;
+	}
+
+	/// Adds the numbers 0 to numStrings - 1 to a queue holding at most 
+	/// 'capacity' strings (0 means no limit, otherwise the oldest are 
+	/// dropped), while 'numConsumers' threads take them with poll(), 
+	/// poll(timeoutMs) and drainTo in turn.  Returns the number of 
+	/// errors: strings neither received nor counted as dropped, strings 
+	/// received more than once, strings a consumer received before an 
+	/// older one, and negative sizes.
+	private static int stressTest(final int numStrings, int numConsumers, 
+		int capacity) throws InterruptedException
+	{
+		final StringQueue queue = new StringQueue(capacity, 
+			StringQueue.DROP_OLDEST);
+		final AtomicIntegerArray received = 
+			new AtomicIntegerArray(numStrings);
+		final AtomicInteger errors = new AtomicInteger(0);
+		final AtomicBoolean done = new AtomicBoolean(false);
+		Thread[] consumers = new Thread[numConsumers];
+
+		for (int i = 0; i < numConsumers; ++i)
+		{
+			consumers[i] = new Thread(new Runnable()
+				{
+					public void run()
+					{
+						ArrayList<String> strings = new ArrayList<String>();
+						int last = -1;
+
+						for (int turn = 0; true; ++turn)
+						{
+							// Once the producer is done, an empty result 
+							// means the queue is empty for good.
+							boolean finished = done.get();
+							strings.clear();
+
+							if (0 == turn % 3)
+							{
+								addIfNotNull(strings, queue.poll());
+							}
+							else if (1 == turn % 3)
+							{
+								addIfNotNull(strings, queue.poll(1));
+							}
+							else
+							{
+								queue.drainTo(strings);
+							}
+
+							if (queue.size() < 0)
+							{
+								errors.incrementAndGet();
+							}
+
+							if (strings.isEmpty() && finished)
+							{
+								break;
+							}
+
+							for (int j = 0; j < strings.size(); ++j)
+							{
+								int n = Integer.parseInt(strings.get(j));
+
+								if (n <= last)
+								{
+									errors.incrementAndGet();
+								}
+
+								last = n;
+								received.incrementAndGet(n);
+							}
+						}
+					}
+				}, "Queue stress test consumer " + i);
+			consumers[i].start();
+		}
+
+		for (int i = 0; i < numStrings; ++i)
+		{
+			queue.add(Integer.toString(i));
+		}
+
+		done.set(true);
+
+		for (int i = 0; i < numConsumers; ++i)
+		{
+			consumers[i].join();
+		}
+
+		long total = 0;
+
+		for (int i = 0; i < numStrings; ++i)
+		{
+			int count = received.get(i);
+			total += count;
+
+			if (count > 1)
+			{
+				errors.addAndGet(count - 1);
+			}
+		}
+
+		// Every string not received must have been dropped.
+		long lost = numStrings - queue.getDropCount() - total;
+
+		if (lost != 0 || queue.size() != 0)
+		{
+			errors.addAndGet((int)Math.max(Math.abs(lost), 1));
+		}
+
+		return errors.get();
+	}
+
+	/// Passes 'numStrings' strings from one thread to another through 
+	/// 'queue', with the consumer polling without waiting, and returns 
+	/// the number of strings per second.  Stores the number of strings 
+	/// that never arrived in lost[0]; the consumer gives up once the 
+	/// producer is done and the queue looks empty, or if the queue 
+	/// throws, which the original unsynchronized queue can.
+	private static double measureThroughput(final BenchmarkQueue queue, 
+		final int numStrings, long[] lost) throws InterruptedException
+	{
+		final AtomicBoolean done = new AtomicBoolean(false);
+		final AtomicLong received = new AtomicLong(0);
+
+		Thread consumer = new Thread(new Runnable()
+			{
+				public void run()
+				{
+					int count = 0;
+
+					try
+					{
+						while (count < numStrings)
+						{
+							boolean finished = done.get();
+
+							if (null != queue.poll())
+							{
+								++count;
+							}
+							else if (finished)
+							{
+								break;
+							}
+							else
+							{
+								Thread.yield();
+							}
+						}
+					}
+					catch (RuntimeException e)
+					{
+						Utils.log("warning", "Queue failed: " + e);
+					}
+
+					received.set(count);
+				}
+			}, "Queue benchmark consumer");
+
+		String s = "recognized string";
+		long startTime = System.nanoTime();
+		consumer.start();
+
+		try
+		{
+			for (int i = 0; i < numStrings; ++i)
+			{
+				queue.add(s);
+			}
+		}
+		catch (RuntimeException e)
+		{
+			Utils.log("warning", "Queue failed: " + e);
+		}
+
+		done.set(true);
+		consumer.join();
+		double seconds = (System.nanoTime() - startTime) / 1e9;
+		lost[0] = numStrings - received.get();
+		return seconds > 0 ? received.get() / seconds : 0;
+	}
+
+	/// Adds strings to a COALESCE queue, some of them already queued and 
+	/// some queued earlier but taken out since, and returns the number 
+	/// of strings that were wrongly dropped or kept.
+	private static int checkCoalesce()
+	{
+		StringQueue queue = new StringQueue(0, StringQueue.COALESCE);
+		int errors = 0;
+
+		queue.add("one");
+		queue.add("two");
+		queue.add("one");
+
+		if (queue.size() != 2 || queue.getDropCount() != 1)
+		{
+			++errors;
+		}
+
+		if (!"one".equals(queue.poll()))
+		{
+			++errors;
+		}
+
+		// "one" has been taken out, so it may be queued again.
+		queue.add("one");
+		queue.add("two");
+
+		if (queue.size() != 2 || queue.getDropCount() != 2)
+		{
+			++errors;
+		}
+
+		queue.clear();
+		queue.add("two");
+
+		if (queue.size() != 1 || !"two".equals(queue.poll()))
+		{
+			++errors;
+		}
+
+		return errors;
+	}
+
+	/// Adds 's' to 'strings' unless it is null.
+	private static void addIfNotNull(ArrayList<String> strings, String s)
+	{
+		if (null != s)
+		{
+			strings.add(s);
+		}
+	}
+
+	/// Returns the CPU time used so far by the calling thread in 
+	/// nanoseconds, or 0 if the JVM cannot measure it.
+	private static long getCpuTime(ThreadMXBean threads)
+	{
+		if (!threads.isCurrentThreadCpuTimeSupported())
+		{
+			return 0;
+		}
+
+		return Math.max(threads.getCurrentThreadCpuTime(), 0);
+	}
+}
@@ -0,0 +1,467 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.frontend.util.StreamDataSource;
+import edu.cmu.sphinx.jsapi.JSGFGrammar;
+import edu.cmu.sphinx.linguist.Linguist;
+import edu.cmu.sphinx.recognizer.Recognizer;
+import edu.cmu.sphinx.util.props.ConfigurationManager;
+import edu.cmu.sphinx.util.props.PropertyException;
+
+import java.io.File;
+import java.io.IOException;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Map;
+import java.util.Set;
+import javax.xml.parsers.DocumentBuilderFactory;
+import javax.xml.transform.TransformerFactory;
+import javax.xml.transform.dom.DOMSource;
+import javax.xml.transform.stream.StreamResult;
+import org.w3c.dom.Document;
+import org.w3c.dom.Element;
+import org.w3c.dom.Node;
+import org.w3c.dom.NodeList;
+
+/// A set of recognizers that decode separate audio streams in parallel 
+/// while sharing a single copy of the acoustic model, dictionary and 
+/// grammar.  Each recognizer gets its own decoder, scorer and front end 
+/// reading from its own StreamDataSource or PushAudioSource, and can 
+/// optionally get its own grammar and search graph.  This works by 
+/// writing a copy of the config file in which the components that hold 
+/// per-stream state are duplicated once per recognizer, while every 
+/// other component is shared.  The shared acoustic model caches each 
+/// senone's last score in the senone itself, so each stream's scorer 
+/// keeps its own senone scores (see SenoneScoreCache) instead.
+public class RecognizerPool
+{
+	/// The components that hold per-stream state.  These are duplicated 
+	/// for each recognizer; all other components are shared.
+	private static final String[] STREAM_COMPONENTS = 
+	{
+		"recognizer", "decoder", "searchManager", "activeList", 
+		"trivialPruner", "threadedScorer", "fileFrontEnd", 
+		"streamDataSource", "speechClassifier", "speechMarker", 
+		"nonSpeechDataFilter", "premphasizer", "windower", "fft", 
+		"melFilterBank", "dct", "liveCMN", "featureExtraction", 
+		"pushFrontEnd", "pushAudioSource"
+	};
+
+	/// The components that are also duplicated when each recognizer has 
+	/// its own grammar.
+	private static final String[] GRAMMAR_COMPONENTS = 
+	{
+		"jsgfGrammar", "flatLinguist"
+	};
+
+	/// The recognizers in the pool.
+	private Recognizer[] mRecognizers;
+
+	/// The data source feeding each recognizer's front end, when reading 
+	/// from files.
+	private StreamDataSource[] mDataSources = null;
+
+	/// The data source feeding each recognizer's front end, when reading 
+	/// pushed audio.
+	private PushAudioSource[] mPushAudioSources = null;
+
+	/// Each recognizer's grammar and linguist, when they are not shared.
+	private JSGFGrammar[] mGrammars = null;
+	private Linguist[] mLinguists = null;
+
+	/// The configuration manager that created the recognizers.
+	private ConfigurationManager mConfigurationManager;
+
+	/// Creates and allocates 'numRecognizers' recognizers from the given 
+	/// config file.  'grammarPath' and 'grammarName' are the same as for 
+	/// SpeechRecognizer.  The recognizers read from files and share the 
+	/// grammar.
+	public RecognizerPool(String configFilename, String grammarPath, 
+		String grammarName, int numRecognizers) 
+		throws IOException, PropertyException, InstantiationException
+	{
+		this(configFilename, grammarPath, grammarName, numRecognizers, 
+			false, false, 0);
+	}
+
+	/// Creates and allocates 'numRecognizers' recognizers from the given 
+	/// config file.  If 'pushAudio' is true, recognizer i reads audio 
+	/// pushed to stream i + 1 (see PushAudioSource) instead of files.  
+	/// If 'separateGrammars' is true, each recognizer gets its own copy 
+	/// of the grammar and search graph, which can then be changed with 
+	/// setGrammar; they all start with the given grammar.  
+	/// 'pushBufferSize' is the number of samples each stream's push audio 
+	/// buffer holds, or 0 for the config file's size.
+	public RecognizerPool(String configFilename, String grammarPath, 
+		String grammarName, int numRecognizers, boolean pushAudio, 
+		boolean separateGrammars, int pushBufferSize) 
+		throws IOException, PropertyException, InstantiationException
+	{
+		File config = writeStreamConfig(configFilename, numRecognizers, 
+			pushAudio ? "pushFrontEnd" : "fileFrontEnd", separateGrammars);
+		ConfigurationManager cm = new ConfigurationManager(
+			config.toURI().toURL());
+		mConfigurationManager = cm;
+
+		mRecognizers = new Recognizer[numRecognizers];
+
+		if (pushAudio)
+		{
+			mPushAudioSources = new PushAudioSource[numRecognizers];
+		}
+		else
+		{
+			mDataSources = new StreamDataSource[numRecognizers];
+		}
+
+		if (separateGrammars)
+		{
+			mGrammars = new JSGFGrammar[numRecognizers];
+			mLinguists = new Linguist[numRecognizers];
+		}
+
+		for (int i = 0; i < numRecognizers; ++i)
+		{
+			if (!grammarName.equals("") && (separateGrammars || 0 == i))
+			{
+				String grammar = separateGrammars 
+					? getStreamName("jsgfGrammar", i) : "jsgfGrammar";
+				cm.lookup(grammar);
+				cm.setProperty(grammar, "grammarLocation", grammarPath);
+				cm.setProperty(grammar, "grammarName", grammarName);
+			}
+
+			mRecognizers[i] = (Recognizer) cm.lookup(
+				getStreamName("recognizer", i));
+
+			if (pushAudio)
+			{
+				mPushAudioSources[i] = (PushAudioSource) cm.lookup(
+					getStreamName("pushAudioSource", i));
+
+				if (pushBufferSize > 0)
+				{
+					cm.setProperty(getStreamName("pushAudioSource", i), 
+						"bufferSize", "" + pushBufferSize);
+				}
+			}
+			else
+			{
+				mDataSources[i] = (StreamDataSource) cm.lookup(
+					getStreamName("streamDataSource", i));
+			}
+		}
+
+		// Allocate one at a time.  The shared components are loaded by 
+		// the first recognizer and reused by the rest.
+		for (int i = 0; i < numRecognizers; ++i)
+		{
+			mRecognizers[i].allocate();
+
+			if (separateGrammars)
+			{
+				mGrammars[i] = (JSGFGrammar) cm.lookup(
+					getStreamName("jsgfGrammar", i));
+				mLinguists[i] = (Linguist) cm.lookup(
+					getStreamName("flatLinguist", i));
+			}
+		}
+	}
+
+	/// Returns the number of recognizers in the pool.
+	public int size()
+	{
+		return mRecognizers.length;
+	}
+
+	/// Returns the recognizer with the given index.  Each recognizer must 
+	/// only be used by one thread at a time.
+	public Recognizer getRecognizer(int i)
+	{
+		return mRecognizers[i];
+	}
+
+	/// Returns the data source that feeds the recognizer with the given 
+	/// index, or null if the recognizers read pushed audio.
+	public StreamDataSource getDataSource(int i)
+	{
+		if (null == mDataSources)
+		{
+			return null;
+		}
+
+		return mDataSources[i];
+	}
+
+	/// Returns the pushed audio source that feeds the recognizer with 
+	/// the given index, or null if the recognizers read files.
+	public PushAudioSource getPushAudioSource(int i)
+	{
+		if (null == mPushAudioSources)
+		{
+			return null;
+		}
+
+		return mPushAudioSources[i];
+	}
+
+	/// Replaces the grammar of the recognizer with the given index and 
+	/// rebuilds its search graph, like SpeechRecognizer.setGrammar.  The 
+	/// recognizer must not be decoding.  Only possible if the pool was 
+	/// created with separate grammars.
+	public void setGrammar(int i, String grammarPath, String grammarName) 
+		throws IOException, PropertyException
+	{
+		if (null == mGrammars)
+		{
+			throw new IllegalStateException("The recognizers share one " 
+				+ "grammar.");
+		}
+
+		String grammar = getStreamName("jsgfGrammar", i);
+		mConfigurationManager.setProperty(grammar, "grammarLocation", 
+			grammarPath);
+		mConfigurationManager.setProperty(grammar, "grammarName", 
+			grammarName);
+		mGrammars[i].loadJSGF(grammarName);
+
+		// The linguist rebuilds its search graph when it notices the new 
+		// grammar.
+		mLinguists[i].startRecognition();
+		mLinguists[i].stopRecognition();
+	}
+
+	/// Deallocates all recognizers.
+	public void deallocate()
+	{
+		for (int i = 0; i < mRecognizers.length; ++i)
+		{
+			mRecognizers[i].deallocate();
+		}
+	}
+
+	/// Returns the name of a per-stream component's copy for the stream 
+	/// with the given index.
+	private static String getStreamName(String component, int i)
+	{
+		return component + "_" + i;
+	}
+
+	/// Writes a temporary copy of the given config file containing 
+	/// 'numStreams' copies of the per-stream components, and returns it.  
+	/// Each stream's scorer reads from its copy of 'frontEnd'.
+	private static File writeStreamConfig(String configFilename, 
+		int numStreams, String frontEnd, boolean separateGrammars) 
+		throws IOException
+	{
+		try
+		{
+			Document doc = DocumentBuilderFactory.newInstance()
+				.newDocumentBuilder().parse(new File(configFilename));
+			Element root = doc.getDocumentElement();
+
+			Set<String> streamComponents = new HashSet<String>();
+			Map<String, Element> components = new HashMap<String, Element>();
+
+			for (int i = 0; i < STREAM_COMPONENTS.length; ++i)
+			{
+				streamComponents.add(STREAM_COMPONENTS[i]);
+			}
+
+			if (separateGrammars)
+			{
+				for (int i = 0; i < GRAMMAR_COMPONENTS.length; ++i)
+				{
+					streamComponents.add(GRAMMAR_COMPONENTS[i]);
+				}
+			}
+
+			String[] copied = streamComponents.toArray(
+				new String[streamComponents.size()]);
+
+			NodeList nodes = root.getElementsByTagName("component");
+
+			for (int i = 0; i < nodes.getLength(); ++i)
+			{
+				Element component = (Element)nodes.item(i);
+				components.put(component.getAttribute("name"), component);
+			}
+
+			for (int stream = 0; stream < numStreams; ++stream)
+			{
+				for (int i = 0; i < copied.length; ++i)
+				{
+					Element original = components.get(copied[i]);
+
+					if (null == original)
+					{
+						throw new IOException("Config file is missing the " 
+							+ copied[i] + " component.");
+					}
+
+					Element copy = (Element)original.cloneNode(true);
+					copy.setAttribute("name", 
+						getStreamName(copied[i], stream));
+					renameReferences(copy, streamComponents, stream);
+					root.appendChild(copy);
+				}
+
+				// Point the scorer at this stream's front end.  Scoring 
+				// runs on the pool's threads, so the scorer doesn't need 
+				// threads of its own.  The senones cache their last score 
+				// in the shared acoustic model, so each stream keeps its 
+				// own senone scores instead (ParallelAcousticScorer 
+				// accepts all of ThreadedAcousticScorer's properties).
+				Element scorer = findComponent(root, 
+					getStreamName("threadedScorer", stream));
+				scorer.setAttribute("type", 
+					ParallelAcousticScorer.class.getName());
+				setProperty(doc, scorer, "frontend", 
+					getStreamName(frontEnd, stream));
+				setProperty(doc, scorer, "isCpuRelative", "false");
+				setProperty(doc, scorer, "numThreads", "1");
+				setProperty(doc, scorer, 
+					ParallelAcousticScorer.PROP_PRIVATE_SCORE_CACHE, "true");
+
+				// Stream 0 is the single recognizer's push audio input.
+				setProperty(doc, findComponent(root, 
+					getStreamName("pushAudioSource", stream)), "stream", 
+					String.valueOf(stream + 1));
+
+				// The monitors refer to the original recognizer, so 
+				// leave them out.
+				removePropertyList(findComponent(root, 
+					getStreamName("recognizer", stream)), "monitors");
+			}
+
+			File file = File.createTempFile("voce", ".config.xml");
+			file.deleteOnExit();
+			TransformerFactory.newInstance().newTransformer().transform(
+				new DOMSource(doc), new StreamResult(file));
+			return file;
+		}
+		catch (IOException e)
+		{
+			throw e;
+		}
+		catch (Exception e)
+		{
+			IOException exception = new IOException(
+				"Cannot create stream config from " + configFilename);
+			exception.initCause(e);
+			throw exception;
+		}
+	}
+
+	/// Renames every property value and list item in 'component' that 
+	/// refers to a per-stream component so it refers to that 
+	/// component's copy for the given stream.
+	private static void renameReferences(Element component, 
+		Set<String> streamComponents, int stream)
+	{
+		NodeList properties = component.getElementsByTagName("property");
+
+		for (int i = 0; i < properties.getLength(); ++i)
+		{
+			Element property = (Element)properties.item(i);
+			String value = property.getAttribute("value").trim();
+
+			if (streamComponents.contains(value))
+			{
+				property.setAttribute("value", getStreamName(value, stream));
+			}
+		}
+
+		NodeList items = component.getElementsByTagName("item");
+
+		for (int i = 0; i < items.getLength(); ++i)
+		{
+			Node item = items.item(i);
+			String value = item.getTextContent().trim();
+
+			if (streamComponents.contains(value))
+			{
+				item.setTextContent(getStreamName(value, stream));
+			}
+		}
+	}
+
+	/// Returns the component element with the given name.
+	private static Element findComponent(Element root, String name)
+	{
+		NodeList nodes = root.getElementsByTagName("component");
+
+		for (int i = nodes.getLength() - 1; i >= 0; --i)
+		{
+			Element component = (Element)nodes.item(i);
+
+			if (component.getAttribute("name").equals(name))
+			{
+				return component;
+			}
+		}
+
+		return null;
+	}
+
+	/// Sets a property of a component element, adding the property if 
+	/// it doesn't exist.
+	private static void setProperty(Document doc, Element component, 
+		String name, String value)
+	{
+		NodeList properties = component.getElementsByTagName("property");
+
+		for (int i = 0; i < properties.getLength(); ++i)
+		{
+			Element property = (Element)properties.item(i);
+
+			if (property.getAttribute("name").equals(name))
+			{
+				property.setAttribute("value", value);
+				return;
+			}
+		}
+
+		Element property = doc.createElement("property");
+		property.setAttribute("name", name);
+		property.setAttribute("value", value);
+		component.appendChild(property);
+	}
+
+	/// Removes a property list from a component element.
+	private static void removePropertyList(Element component, String name)
+	{
+		NodeList lists = component.getElementsByTagName("propertylist");
+
+		for (int i = lists.getLength() - 1; i >= 0; --i)
+		{
+			Element list = (Element)lists.item(i);
+
+			if (list.getAttribute("name").equals(name))
+			{
+				component.removeChild(list);
+			}
+		}
+	}
+}
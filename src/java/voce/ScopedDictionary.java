@@ -0,0 +1,441 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.linguist.acoustic.UnitManager;
+import edu.cmu.sphinx.linguist.dictionary.Dictionary;
+import edu.cmu.sphinx.linguist.dictionary.FastDictionary;
+import edu.cmu.sphinx.linguist.dictionary.FullDictionary;
+import edu.cmu.sphinx.linguist.dictionary.Word;
+import edu.cmu.sphinx.linguist.dictionary.WordClassification;
+import edu.cmu.sphinx.util.props.PropertyException;
+import edu.cmu.sphinx.util.props.PropertySheet;
+import edu.cmu.sphinx.util.props.PropertyType;
+import edu.cmu.sphinx.util.props.Registry;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStreamReader;
+import java.net.URL;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Set;
+
+/// A dictionary that keeps only the words the grammar uses.  When its 
+/// full dictionary is a text dictionary (FastDictionary or 
+/// FullDictionary), it reads the dictionary files itself: 
+/// SpeechRecognizer gives it the words of the grammar files before the 
+/// grammar is loaded, and only those words and the filler words are 
+/// read.  The other words are skipped as the files are read, so they 
+/// never become objects and the full dictionary is never loaded.  A word 
+/// outside that vocabulary is read from the files when it is looked up.  
+/// Any other full dictionary, such as MappedDictionary, is allocated and 
+/// looked words up in as usual.  Either way, 'prune' keeps only the words 
+/// looked up since the last prune, plus the filler words, and deallocates 
+/// the full dictionary.  Looking up a word that was pruned away from a 
+/// MappedDictionary allocates it again until the next prune; this happens 
+/// when a new grammar is loaded (see SpeechRecognizer.setGrammar).
+public class ScopedDictionary implements Dictionary
+{
+	/// The Sphinx property for the full dictionary.
+	public static final String PROP_DICTIONARY = "dictionary";
+
+	private String mName;
+
+	/// The full dictionary.
+	private Dictionary mDictionary;
+
+	/// The full dictionary's files and settings if it is a text 
+	/// dictionary, which is then read here instead.  The locations are 
+	/// null otherwise.
+	private URL mDictionaryLocation = null;
+	private URL mFillerLocation = null;
+	private UnitManager mUnitManager = null;
+	private boolean mAddSilEndingPronunciation = false;
+
+	/// The words to read from the text dictionary when it is next needed, 
+	/// or null if there are none.
+	private Set<String> mVocabulary = null;
+
+	/// The words looked up since the last prune.
+	private HashMap<String, Word> mUsedWords = new HashMap<String, Word>();
+
+	/// The words kept by the last prune or read from the text dictionary, 
+	/// or null if the full dictionary is allocated.
+	private HashMap<String, Word> mScopeWords = null;
+
+	/// The filler words kept by the last prune or read from the text 
+	/// dictionary.
+	private Word[] mScopeFillers = null;
+
+	public void register(String name, Registry registry) 
+		throws PropertyException
+	{
+		mName = name;
+		registry.register(PROP_DICTIONARY, PropertyType.COMPONENT);
+	}
+
+	public void newProperties(PropertySheet ps) throws PropertyException
+	{
+		mDictionary = (Dictionary) ps.getComponent(PROP_DICTIONARY, 
+			Dictionary.class);
+		mDictionaryLocation = null;
+		mFillerLocation = null;
+
+		if (mDictionary instanceof FastDictionary 
+			|| mDictionary instanceof FullDictionary)
+		{
+			// Both keep their settings private, so read them from their 
+			// property sheet.
+			PropertySheet full = ps.getPropertyManager().getPropertySheet(
+				mDictionary.getName());
+			mDictionaryLocation = full.getResource(
+				Dictionary.PROP_DICTIONARY);
+			mFillerLocation = full.getResource(
+				Dictionary.PROP_FILLER_DICTIONARY);
+			mUnitManager = (UnitManager) full.getComponent(
+				PROP_UNIT_MANAGER, UnitManager.class);
+			mAddSilEndingPronunciation = full.getBoolean(
+				PROP_ADD_SIL_ENDING_PRONUNCIATION, 
+				PROP_ADD_SIL_ENDING_PRONUNCIATION_DEFAULT);
+		}
+	}
+
+	public String getName()
+	{
+		return mName;
+	}
+
+	/// Sets the words to read from a text dictionary the next time the 
+	/// dictionary is allocated or a word is missing, along with the 
+	/// filler words.  Has no effect with other dictionaries.
+	public synchronized void setVocabulary(Set<String> vocabulary)
+	{
+		if (null != mDictionaryLocation)
+		{
+			mVocabulary = vocabulary;
+		}
+	}
+
+	public synchronized void allocate() throws IOException
+	{
+		if (null != mVocabulary)
+		{
+			readVocabulary();
+		}
+		else if (null == mScopeWords)
+		{
+			mDictionary.allocate();
+		}
+	}
+
+	public synchronized void deallocate()
+	{
+		mDictionary.deallocate();
+		mUsedWords.clear();
+		mScopeWords = null;
+		mScopeFillers = null;
+	}
+
+	/// Keeps only the words looked up since the last prune and the 
+	/// filler words, and deallocates the full dictionary.
+	public synchronized void prune()
+	{
+		if (null == mScopeWords)
+		{
+			mScopeFillers = mDictionary.getFillerWords();
+		}
+
+		// The linguist looks these up whenever it compiles a graph.
+		getSentenceStartWord();
+		getSentenceEndWord();
+		getSilenceWord();
+
+		HashMap<String, Word> scope = mUsedWords;
+
+		for (int i = 0; i < mScopeFillers.length; ++i)
+		{
+			addWord(scope, mScopeFillers[i]);
+		}
+
+		mScopeWords = scope;
+		mUsedWords = new HashMap<String, Word>();
+		mDictionary.deallocate();
+
+		Utils.log("", "Dictionary pruned to " + scope.size() + " words");
+	}
+
+	public synchronized Word getWord(String text)
+	{
+		text = text.toLowerCase();
+		Word word = mUsedWords.get(text);
+
+		if (null != word)
+		{
+			return word;
+		}
+
+		if (null != mScopeWords)
+		{
+			word = mScopeWords.get(text);
+
+			if (null == word)
+			{
+				word = readMissingWord(text);
+
+				if (null == word && null != mDictionaryLocation)
+				{
+					Utils.log("warning", "Missing word: " + text);
+					return null;
+				}
+			}
+		}
+
+		if (null == word)
+		{
+			word = mDictionary.getWord(text);
+		}
+
+		addWord(mUsedWords, word);
+		return word;
+	}
+
+	public Word getSentenceStartWord()
+	{
+		return getWord(SENTENCE_START_SPELLING);
+	}
+
+	public Word getSentenceEndWord()
+	{
+		return getWord(SENTENCE_END_SPELLING);
+	}
+
+	public Word getSilenceWord()
+	{
+		return getWord(SILENCE_SPELLING);
+	}
+
+	public WordClassification[] getPossibleWordClassifications()
+	{
+		return mDictionary.getPossibleWordClassifications();
+	}
+
+	public synchronized Word[] getFillerWords()
+	{
+		if (null != mScopeWords)
+		{
+			return mScopeFillers;
+		}
+
+		return mDictionary.getFillerWords();
+	}
+
+	public synchronized void dump()
+	{
+		if (null != mScopeWords)
+		{
+			System.out.println("ScopedDictionary: " + mScopeWords.size() 
+				+ " words kept by the last prune");
+		}
+		else
+		{
+			mDictionary.dump();
+		}
+	}
+
+	/// Returns the words of the grammars (.gram files) in 'grammarPath': 
+	/// every token that is not a comment, tag, weight, rule name or JSGF 
+	/// operator, in lowercase.  This can include a few other tokens, such 
+	/// as keywords, but those are simply read from the dictionary and 
+	/// pruned again.  Returns null if 'grammarPath' has no grammar files.
+	public static Set<String> readGrammarWords(String grammarPath) 
+		throws IOException
+	{
+		File[] files = new File(grammarPath).listFiles();
+		HashSet<String> words = new HashSet<String>();
+		boolean foundGrammar = false;
+
+		if (null == files)
+		{
+			return null;
+		}
+
+		for (int i = 0; i < files.length; ++i)
+		{
+			if (!files[i].getName().endsWith(".gram"))
+			{
+				continue;
+			}
+
+			foundGrammar = true;
+			String grammar = readFile(files[i])
+				.replaceAll("(?s)/\\*.*?\\*/", " ")
+				.replaceAll("//[^\n]*", " ")
+				.replaceAll("\\{[^}]*\\}", " ")
+				.replaceAll("<[^>]*>", " ")
+				.replaceAll("/[^/]*/", " ");
+			String[] tokens = grammar.split("[\\s()\\[\\]|*+;=\"]+");
+
+			for (int j = 0; j < tokens.length; ++j)
+			{
+				if (tokens[j].length() > 0)
+				{
+					words.add(tokens[j].toLowerCase());
+				}
+			}
+		}
+
+		return foundGrammar ? words : null;
+	}
+
+	/// Reads the words of the vocabulary that have not been read yet, 
+	/// and the filler words the first time, from the text dictionary.
+	private void readVocabulary() throws IOException
+	{
+		HashSet<String> spellings = new HashSet<String>(mVocabulary);
+		mVocabulary = null;
+
+		if (null != mScopeWords)
+		{
+			spellings.removeAll(mScopeWords.keySet());
+		}
+
+		if (spellings.isEmpty() && null != mScopeFillers)
+		{
+			return;
+		}
+
+		long startTime = System.currentTimeMillis();
+		DictionaryCompiler reader = new DictionaryCompiler();
+		reader.setVocabulary(spellings);
+		reader.read(mDictionaryLocation.toString(), false);
+
+		if (null == mScopeFillers)
+		{
+			reader.read(mFillerLocation.toString(), true);
+		}
+
+		Word[] words = reader.createWords(mUnitManager, 
+			mAddSilEndingPronunciation);
+		ArrayList<Word> fillers = new ArrayList<Word>();
+
+		if (null == mScopeWords)
+		{
+			mScopeWords = new HashMap<String, Word>();
+		}
+
+		for (int i = 0; i < words.length; ++i)
+		{
+			addWord(mScopeWords, words[i]);
+
+			if (words[i].isFiller())
+			{
+				fillers.add(words[i]);
+			}
+		}
+
+		if (null == mScopeFillers)
+		{
+			mScopeFillers = fillers.toArray(new Word[0]);
+		}
+
+		Utils.log("debug", "Read " + words.length + " words from the " 
+			+ "dictionary in " + (System.currentTimeMillis() - startTime) 
+			+ " ms");
+	}
+
+	/// Finds a word that is not in the scope: reads it from a text 
+	/// dictionary, or else allocates the full dictionary again.  Returns 
+	/// null if the word is missing or still has to be looked up in the 
+	/// full dictionary.
+	private Word readMissingWord(String text)
+	{
+		try
+		{
+			if (null == mDictionaryLocation)
+			{
+				// The word was pruned, so bring the full dictionary back.
+				Utils.log("debug", "Reloading the dictionary for: " + text);
+				mDictionary.allocate();
+				mScopeWords = null;
+				return null;
+			}
+
+			// Read the word along with any vocabulary still pending.
+			Utils.log("debug", "Reading the dictionary for: " + text);
+			HashSet<String> spellings = new HashSet<String>();
+
+			if (null != mVocabulary)
+			{
+				spellings.addAll(mVocabulary);
+			}
+
+			spellings.add(text);
+			mVocabulary = spellings;
+			readVocabulary();
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Cannot read the dictionary: " 
+				+ e.getMessage());
+			return null;
+		}
+
+		return mScopeWords.get(text);
+	}
+
+	/// Reads a whole grammar file.
+	private static String readFile(File file) throws IOException
+	{
+		BufferedReader reader = new BufferedReader(new InputStreamReader(
+			new FileInputStream(file), "UTF-8"));
+		StringBuffer text = new StringBuffer();
+
+		try
+		{
+			String line;
+
+			while (null != (line = reader.readLine()))
+			{
+				text.append(line).append('\n');
+			}
+		}
+		finally
+		{
+			reader.close();
+		}
+
+		return text.toString();
+	}
+
+	private static void addWord(HashMap<String, Word> words, Word word)
+	{
+		if (null != word)
+		{
+			words.put(word.getSpelling().toLowerCase(), word);
+		}
+	}
+}
@@ -0,0 +1,620 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.linguist.HMMSearchState;
+import edu.cmu.sphinx.linguist.SearchGraph;
+import edu.cmu.sphinx.linguist.SearchState;
+import edu.cmu.sphinx.linguist.SearchStateArc;
+import edu.cmu.sphinx.linguist.UnitSearchState;
+import edu.cmu.sphinx.linguist.WordSearchState;
+import edu.cmu.sphinx.linguist.WordSequence;
+import edu.cmu.sphinx.linguist.acoustic.AcousticModel;
+import edu.cmu.sphinx.linguist.acoustic.HMM;
+import edu.cmu.sphinx.linguist.acoustic.HMMState;
+import edu.cmu.sphinx.linguist.acoustic.Unit;
+import edu.cmu.sphinx.linguist.dictionary.Dictionary;
+import edu.cmu.sphinx.linguist.dictionary.Pronunciation;
+import edu.cmu.sphinx.linguist.dictionary.Word;
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.IdentityHashMap;
+import java.util.Iterator;
+
+/// Reads and writes compiled search graphs.  The states of a graph built 
+/// by the FlatLinguist point straight at acoustic model and dictionary 
+/// objects, so they cannot be serialized as they are.  Instead, each 
+/// state is written with the names of the HMM and word it refers to, 
+/// which are looked up again when the graph is read back into a set of 
+/// lightweight states.
+public class SearchGraphFile
+{
+	/// Identifies search graph files ("VCSG").
+	private static final int MAGIC = 0x56435347;
+
+	/// The version of the file format.
+	private static final int VERSION = 1;
+
+	/// The kinds of states.
+	private static final byte PLAIN_STATE = 0;
+	private static final byte HMM_STATE = 1;
+	private static final byte WORD_STATE = 2;
+	private static final byte UNIT_STATE = 3;
+
+	/// State flags.
+	private static final byte FINAL = 1;
+	private static final byte EMITTING = 2;
+	private static final byte WORD_START = 4;
+
+	/// Writes 'graph' to 'file'.  'key' identifies everything the graph 
+	/// was built from; read only accepts a file with the same key.
+	public static void write(SearchGraph graph, String key, File file) 
+		throws IOException
+	{
+		// Number every state reachable from the initial state, which 
+		// gets number 0.
+		IdentityHashMap<SearchState, Integer> stateNumbers = 
+			new IdentityHashMap<SearchState, Integer>();
+		ArrayList<SearchState> states = new ArrayList<SearchState>();
+		stateNumbers.put(graph.getInitialState(), new Integer(0));
+		states.add(graph.getInitialState());
+
+		for (int i = 0; i < states.size(); ++i)
+		{
+			SearchStateArc[] arcs = states.get(i).getSuccessors();
+
+			for (int j = 0; j < arcs.length; ++j)
+			{
+				SearchState next = arcs[j].getState();
+
+				if (!stateNumbers.containsKey(next))
+				{
+					stateNumbers.put(next, new Integer(states.size()));
+					states.add(next);
+				}
+			}
+		}
+
+		// Collect the HMMs and words the states refer to.
+		IdentityHashMap<HMM, Integer> hmmNumbers = 
+			new IdentityHashMap<HMM, Integer>();
+		ArrayList<String> hmmNames = new ArrayList<String>();
+		HashMap<String, Integer> wordNumbers = new HashMap<String, Integer>();
+		ArrayList<String> words = new ArrayList<String>();
+
+		for (int i = 0; i < states.size(); ++i)
+		{
+			SearchState state = states.get(i);
+			HMM hmm = getHMM(state);
+
+			if (null != hmm && !hmmNumbers.containsKey(hmm))
+			{
+				hmmNumbers.put(hmm, new Integer(hmmNames.size()));
+				hmmNames.add(getHMMName(hmm));
+			}
+
+			if (state instanceof WordSearchState)
+			{
+				String spelling = ((WordSearchState)state).getPronunciation()
+					.getWord().getSpelling();
+
+				if (!wordNumbers.containsKey(spelling))
+				{
+					wordNumbers.put(spelling, new Integer(words.size()));
+					words.add(spelling);
+				}
+			}
+		}
+
+		DataOutputStream out = new DataOutputStream(new BufferedOutputStream(
+			new FileOutputStream(file)));
+
+		try
+		{
+			out.writeInt(MAGIC);
+			out.writeInt(VERSION);
+			out.writeUTF(key);
+			out.writeInt(graph.getNumStateOrder());
+
+			out.writeInt(hmmNames.size());
+
+			for (int i = 0; i < hmmNames.size(); ++i)
+			{
+				out.writeUTF(hmmNames.get(i));
+			}
+
+			out.writeInt(words.size());
+
+			for (int i = 0; i < words.size(); ++i)
+			{
+				out.writeUTF(words.get(i));
+			}
+
+			out.writeInt(states.size());
+
+			for (int i = 0; i < states.size(); ++i)
+			{
+				writeState(out, states.get(i), hmmNumbers, wordNumbers);
+			}
+
+			for (int i = 0; i < states.size(); ++i)
+			{
+				SearchStateArc[] arcs = states.get(i).getSuccessors();
+				out.writeInt(arcs.length);
+
+				for (int j = 0; j < arcs.length; ++j)
+				{
+					out.writeInt(stateNumbers.get(arcs[j].getState())
+						.intValue());
+					out.writeFloat(arcs[j].getAcousticProbability());
+					out.writeFloat(arcs[j].getLanguageProbability());
+					out.writeFloat(arcs[j].getInsertionProbability());
+				}
+			}
+		}
+		finally
+		{
+			out.close();
+		}
+	}
+
+	/// Reads a graph written by 'write', looking up its HMMs in 'model' 
+	/// and its words in 'dictionary' (which must be allocated).  The file 
+	/// is memory-mapped rather than read through a stream.  Returns null 
+	/// if the file does not exist, has a different key, or refers to 
+	/// something the model or dictionary does not have.
+	public static SearchGraph read(File file, String key, 
+		AcousticModel model, Dictionary dictionary) throws IOException
+	{
+		if (!file.exists())
+		{
+			return null;
+		}
+
+		MappedByteBuffer in;
+		FileInputStream stream = new FileInputStream(file);
+
+		try
+		{
+			FileChannel channel = stream.getChannel();
+			in = channel.map(FileChannel.MapMode.READ_ONLY, 0, 
+				channel.size());
+		}
+		finally
+		{
+			stream.close();
+		}
+
+		if (MAGIC != in.getInt() || VERSION != in.getInt() 
+			|| !key.equals(readUTF(in)))
+		{
+			return null;
+		}
+
+		int numStateOrder = in.getInt();
+
+		// Index the model's HMMs by name.
+		HashMap<String, HMM> modelHMMs = new HashMap<String, HMM>();
+
+		for (Iterator i = model.getHMMIterator(); i.hasNext(); )
+		{
+			HMM hmm = (HMM) i.next();
+			modelHMMs.put(getHMMName(hmm), hmm);
+		}
+
+		HMM[] hmms = new HMM[in.getInt()];
+
+		for (int i = 0; i < hmms.length; ++i)
+		{
+			hmms[i] = modelHMMs.get(readUTF(in));
+
+			if (null == hmms[i])
+			{
+				return null;
+			}
+		}
+
+		Word[] words = new Word[in.getInt()];
+
+		for (int i = 0; i < words.length; ++i)
+		{
+			words[i] = dictionary.getWord(readUTF(in));
+
+			if (null == words[i])
+			{
+				return null;
+			}
+		}
+
+		CachedState[] states = new CachedState[in.getInt()];
+
+		for (int i = 0; i < states.length; ++i)
+		{
+			states[i] = readState(in, i, hmms, words);
+
+			if (null == states[i])
+			{
+				return null;
+			}
+		}
+
+		for (int i = 0; i < states.length; ++i)
+		{
+			SearchStateArc[] arcs = new SearchStateArc[in.getInt()];
+
+			for (int j = 0; j < arcs.length; ++j)
+			{
+				CachedState next = states[in.getInt()];
+				float acoustic = in.getFloat();
+				float language = in.getFloat();
+				float insertion = in.getFloat();
+				arcs[j] = new CachedArc(next, acoustic, language, insertion);
+			}
+
+			states[i].mSuccessors = arcs;
+		}
+
+		return new CachedSearchGraph(states[0], numStateOrder);
+	}
+
+	/// Returns the HMM a state refers to, or null if it has none.  Unit 
+	/// states refer to the HMM of the first HMM state that follows them.
+	private static HMM getHMM(SearchState state)
+	{
+		if (state instanceof HMMSearchState)
+		{
+			return ((HMMSearchState)state).getHMMState().getHMM();
+		}
+		else if (state instanceof UnitSearchState)
+		{
+			SearchStateArc[] arcs = state.getSuccessors();
+
+			for (int i = 0; i < arcs.length; ++i)
+			{
+				if (arcs[i].getState() instanceof HMMSearchState)
+				{
+					return getHMM(arcs[i].getState());
+				}
+			}
+		}
+
+		return null;
+	}
+
+	/// Returns the name an HMM is stored under: its unit, including the 
+	/// context, and its position within a word.
+	private static String getHMMName(HMM hmm)
+	{
+		return hmm.getUnit().toString() + " " + hmm.getPosition();
+	}
+
+	private static void writeState(DataOutputStream out, SearchState state, 
+		IdentityHashMap<HMM, Integer> hmmNumbers, 
+		HashMap<String, Integer> wordNumbers) throws IOException
+	{
+		byte flags = 0;
+
+		if (state.isFinal())
+		{
+			flags |= FINAL;
+		}
+
+		if (state.isEmitting())
+		{
+			flags |= EMITTING;
+		}
+
+		HMM hmm = getHMM(state);
+
+		if (state instanceof HMMSearchState)
+		{
+			out.writeByte(HMM_STATE);
+			out.writeByte(flags);
+			out.writeInt(state.getOrder());
+			out.writeInt(hmmNumbers.get(hmm).intValue());
+			out.writeInt(((HMMSearchState)state).getHMMState().getState());
+		}
+		else if (state instanceof WordSearchState)
+		{
+			WordSearchState wordState = (WordSearchState)state;
+			Pronunciation pronunciation = wordState.getPronunciation();
+			Pronunciation[] pronunciations = pronunciation.getWord()
+				.getPronunciations();
+			int index = 0;
+
+			while (index < pronunciations.length 
+				&& pronunciations[index] != pronunciation)
+			{
+				++index;
+			}
+
+			if (wordState.isWordStart())
+			{
+				flags |= WORD_START;
+			}
+
+			out.writeByte(WORD_STATE);
+			out.writeByte(flags);
+			out.writeInt(state.getOrder());
+			out.writeInt(wordNumbers.get(pronunciation.getWord()
+				.getSpelling()).intValue());
+			out.writeInt(index);
+		}
+		else if (state instanceof UnitSearchState && null != hmm)
+		{
+			out.writeByte(UNIT_STATE);
+			out.writeByte(flags);
+			out.writeInt(state.getOrder());
+			out.writeInt(hmmNumbers.get(hmm).intValue());
+		}
+		else
+		{
+			out.writeByte(PLAIN_STATE);
+			out.writeByte(flags);
+			out.writeInt(state.getOrder());
+		}
+	}
+
+	/// Reads one state.  Returns null if it refers to a pronunciation the 
+	/// dictionary does not have.
+	private static CachedState readState(MappedByteBuffer in, int index, 
+		HMM[] hmms, Word[] words)
+	{
+		byte kind = in.get();
+		byte flags = in.get();
+		int order = in.getInt();
+		CachedState state;
+
+		if (HMM_STATE == kind)
+		{
+			HMM hmm = hmms[in.getInt()];
+			state = new CachedHMMState(hmm.getState(in.getInt()));
+		}
+		else if (WORD_STATE == kind)
+		{
+			Pronunciation[] pronunciations = words[in.getInt()]
+				.getPronunciations();
+			int pronunciation = in.getInt();
+
+			if (pronunciation >= pronunciations.length)
+			{
+				return null;
+			}
+
+			state = new CachedWordState(pronunciations[pronunciation], 
+				0 != (flags & WORD_START));
+		}
+		else if (UNIT_STATE == kind)
+		{
+			state = new CachedUnitState(hmms[in.getInt()].getUnit());
+		}
+		else
+		{
+			state = new CachedState();
+		}
+
+		state.mIndex = index;
+		state.mOrder = order;
+		state.mFinal = 0 != (flags & FINAL);
+		state.mEmitting = 0 != (flags & EMITTING);
+		return state;
+	}
+
+	/// Reads a string written by DataOutputStream.writeUTF.  Only the 
+	/// ASCII names used here are supported.
+	private static String readUTF(MappedByteBuffer in) throws IOException
+	{
+		byte[] bytes = new byte[in.getShort() & 0xffff];
+		in.get(bytes);
+		return new String(bytes, "UTF-8");
+	}
+
+	/// A search graph read from a file.
+	private static class CachedSearchGraph implements SearchGraph
+	{
+		private SearchState mInitialState;
+		private int mNumStateOrder;
+
+		CachedSearchGraph(SearchState initialState, int numStateOrder)
+		{
+			mInitialState = initialState;
+			mNumStateOrder = numStateOrder;
+		}
+
+		public SearchState getInitialState()
+		{
+			return mInitialState;
+		}
+
+		public int getNumStateOrder()
+		{
+			return mNumStateOrder;
+		}
+	}
+
+	/// A transition between two states read from a file.
+	private static class CachedArc implements SearchStateArc
+	{
+		private SearchState mState;
+		private float mAcousticProbability;
+		private float mLanguageProbability;
+		private float mInsertionProbability;
+
+		CachedArc(SearchState state, float acousticProbability, 
+			float languageProbability, float insertionProbability)
+		{
+			mState = state;
+			mAcousticProbability = acousticProbability;
+			mLanguageProbability = languageProbability;
+			mInsertionProbability = insertionProbability;
+		}
+
+		public SearchState getState()
+		{
+			return mState;
+		}
+
+		public float getProbability()
+		{
+			return mAcousticProbability + mLanguageProbability 
+				+ mInsertionProbability;
+		}
+
+		public float getLanguageProbability()
+		{
+			return mLanguageProbability;
+		}
+
+		public float getAcousticProbability()
+		{
+			return mAcousticProbability;
+		}
+
+		public float getInsertionProbability()
+		{
+			return mInsertionProbability;
+		}
+	}
+
+	/// A state read from a file that is not part of a word or HMM.
+	private static class CachedState implements SearchState
+	{
+		int mIndex;
+		int mOrder;
+		boolean mFinal;
+		boolean mEmitting;
+		SearchStateArc[] mSuccessors;
+
+		public SearchStateArc[] getSuccessors()
+		{
+			return mSuccessors;
+		}
+
+		public boolean isEmitting()
+		{
+			return mEmitting;
+		}
+
+		public boolean isFinal()
+		{
+			return mFinal;
+		}
+
+		public String toPrettyString()
+		{
+			return getSignature();
+		}
+
+		public String getSignature()
+		{
+			return "S" + mIndex;
+		}
+
+		public WordSequence getWordHistory()
+		{
+			return WordSequence.EMPTY;
+		}
+
+		public Object getLexState()
+		{
+			return this;
+		}
+
+		public int getOrder()
+		{
+			return mOrder;
+		}
+
+		public String toString()
+		{
+			return getSignature();
+		}
+	}
+
+	/// A state read from a file that stands for one state of an HMM.
+	private static class CachedHMMState extends CachedState 
+		implements HMMSearchState
+	{
+		private HMMState mHMMState;
+
+		CachedHMMState(HMMState hmmState)
+		{
+			mHMMState = hmmState;
+		}
+
+		public HMMState getHMMState()
+		{
+			return mHMMState;
+		}
+	}
+
+	/// A state read from a file that marks a word pronunciation.
+	private static class CachedWordState extends CachedState 
+		implements WordSearchState
+	{
+		private Pronunciation mPronunciation;
+		private boolean mWordStart;
+
+		CachedWordState(Pronunciation pronunciation, boolean wordStart)
+		{
+			mPronunciation = pronunciation;
+			mWordStart = wordStart;
+		}
+
+		public Pronunciation getPronunciation()
+		{
+			return mPronunciation;
+		}
+
+		public boolean isWordStart()
+		{
+			return mWordStart;
+		}
+	}
+
+	/// A state read from a file that marks a unit (phone).
+	private static class CachedUnitState extends CachedState 
+		implements UnitSearchState
+	{
+		private Unit mUnit;
+
+		CachedUnitState(Unit unit)
+		{
+			mUnit = unit;
+		}
+
+		public Unit getUnit()
+		{
+			return mUnit;
+		}
+	}
+}
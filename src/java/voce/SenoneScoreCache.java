@@ -0,0 +1,241 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.decoder.scorer.Scoreable;
+import edu.cmu.sphinx.decoder.search.Token;
+import edu.cmu.sphinx.frontend.Data;
+import edu.cmu.sphinx.linguist.HMMSearchState;
+import edu.cmu.sphinx.linguist.SearchState;
+import edu.cmu.sphinx.linguist.acoustic.HMMState;
+import edu.cmu.sphinx.linguist.acoustic.tiedstate.CompositeSenone;
+import edu.cmu.sphinx.linguist.acoustic.tiedstate.GaussianMixture;
+import edu.cmu.sphinx.linguist.acoustic.tiedstate.Senone;
+import edu.cmu.sphinx.linguist.acoustic.tiedstate.SenoneHMMState;
+
+import java.lang.reflect.Field;
+import java.util.Arrays;
+import java.util.IdentityHashMap;
+
+/// Scores tokens against the acoustic model while keeping the senone 
+/// scores of the current frame to itself.  GaussianMixture and 
+/// CompositeSenone cache the last score they computed in fields of 
+/// their own, which is only safe while a single recognizer uses them.  
+/// When recognizers that share the acoustic model (see RecognizerPool) 
+/// decode different audio at the same time, one of them can read a 
+/// score the other computed for its own frame.  A cache like this one 
+/// is used by a single thread instead: the senones' means and variances 
+/// are still shared, but their scores are not.
+public class SenoneScoreCache
+{
+	/// The frame the cached scores are for.
+	private Data mData = null;
+
+	/// Numbers the frames, so that a score can be checked against the 
+	/// frame it was computed for without clearing the arrays.
+	private int mFrame = 0;
+
+	/// The frame and score of each GaussianMixture, by senone ID.
+	private int[] mFrames = new int[0];
+	private float[] mScores = new float[0];
+
+	/// The scores of the composite senones for the current frame.
+	private IdentityHashMap<Senone, Float> mCompositeScores = 
+		new IdentityHashMap<Senone, Float>();
+
+	/// The weight of each composite senone seen so far.
+	private IdentityHashMap<Senone, Float> mCompositeWeights = 
+		new IdentityHashMap<Senone, Float>();
+
+	/// Token and CompositeSenone fields that have no accessors, or null 
+	/// if this version of Sphinx4 does not have them, in which case the 
+	/// senones score themselves.
+	private static final Field mAcousticScoreField = findField(
+		Token.class, "logAcousticScore");
+	private static final Field mCompositeWeightField = findField(
+		CompositeSenone.class, "weight");
+
+	/// Scores a scoreable against 'data' like Scoreable.calculateScore.  
+	/// Tokens whose state has a senone are scored through this cache; 
+	/// anything else is scored by the scoreable itself.
+	public float calculateScore(Scoreable scoreable, Data data, 
+		boolean keepData, float gain)
+	{
+		if (scoreable instanceof Token)
+		{
+			Token token = (Token) scoreable;
+			SearchState state = token.getSearchState();
+
+			if (state instanceof HMMSearchState)
+			{
+				HMMState hmmState = ((HMMSearchState) state).getHMMState();
+
+				if (hmmState instanceof SenoneHMMState 
+					&& null != mAcousticScoreField)
+				{
+					// The same steps as Token.calculateScore.
+					float acousticScore = getScore(
+						((SenoneHMMState) hmmState).getSenone(), data) * gain;
+					setAcousticScore(token, acousticScore);
+					token.setScore(token.getScore() + acousticScore);
+
+					if (keepData)
+					{
+						token.setAppObject(data);
+					}
+
+					return token.getScore();
+				}
+			}
+		}
+
+		return scoreable.calculateScore(data, keepData, gain);
+	}
+
+	/// Returns the score of a senone for 'data', computing it the first 
+	/// time it is asked for in a frame.
+	public float getScore(Senone senone, Data data)
+	{
+		if (data != mData)
+		{
+			mData = data;
+			mCompositeScores.clear();
+
+			if (++mFrame == Integer.MAX_VALUE)
+			{
+				Arrays.fill(mFrames, 0);
+				mFrame = 1;
+			}
+		}
+
+		if (senone instanceof GaussianMixture)
+		{
+			GaussianMixture mixture = (GaussianMixture) senone;
+			long id = mixture.getID();
+
+			if (id < 0 || id >= Integer.MAX_VALUE)
+			{
+				return mixture.calculateScore(data);
+			}
+
+			int i = (int) id;
+
+			if (i >= mFrames.length)
+			{
+				int length = Math.max(i + 1, 2 * mFrames.length);
+				int[] frames = new int[length];
+				float[] scores = new float[length];
+				System.arraycopy(mFrames, 0, frames, 0, mFrames.length);
+				System.arraycopy(mScores, 0, scores, 0, mScores.length);
+				mFrames = frames;
+				mScores = scores;
+			}
+
+			if (mFrames[i] != mFrame)
+			{
+				mScores[i] = mixture.calculateScore(data);
+				mFrames[i] = mFrame;
+			}
+
+			return mScores[i];
+		}
+
+		if (senone instanceof CompositeSenone 
+			&& null != mCompositeWeightField)
+		{
+			// The same as CompositeSenone.getScore: the best score of its 
+			// senones plus its weight.
+			Float cached = mCompositeScores.get(senone);
+
+			if (null != cached)
+			{
+				return cached.floatValue();
+			}
+
+			Senone[] senones = ((CompositeSenone) senone).getSenones();
+			float best = -Float.MAX_VALUE;
+
+			for (int i = 0; i < senones.length; ++i)
+			{
+				best = Math.max(best, getScore(senones[i], data));
+			}
+
+			float score = best + getCompositeWeight(senone);
+			mCompositeScores.put(senone, new Float(score));
+			return score;
+		}
+
+		return senone.getScore(data);
+	}
+
+	/// Returns the weight of a composite senone.
+	private float getCompositeWeight(Senone senone)
+	{
+		Float weight = mCompositeWeights.get(senone);
+
+		if (null == weight)
+		{
+			try
+			{
+				weight = new Float(mCompositeWeightField.getFloat(senone));
+			}
+			catch (IllegalAccessException e)
+			{
+				throw new RuntimeException(e);
+			}
+
+			mCompositeWeights.put(senone, weight);
+		}
+
+		return weight.floatValue();
+	}
+
+	private static void setAcousticScore(Token token, float score)
+	{
+		try
+		{
+			mAcousticScoreField.setFloat(token, score);
+		}
+		catch (IllegalAccessException e)
+		{
+			throw new RuntimeException(e);
+		}
+	}
+
+	/// Returns the named private field, or null if it does not exist.
+	private static Field findField(Class<?> c, String name)
+	{
+		try
+		{
+			Field field = c.getDeclaredField(name);
+			field.setAccessible(true);
+			return field;
+		}
+		catch (Exception e)
+		{
+			Utils.log("warning", "Cannot score senones separately for " 
+				+ "each recognizer: " + e);
+			return null;
+		}
+	}
+}
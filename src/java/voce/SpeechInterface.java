@@ -23,6 +23,11 @@
 /// The main package that contains everything in the Voce Java API.
 package voce;
 
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Properties;
+
 /// A set of static methods that give users access to the main speech 
 /// interaction components.  These methods are the only ones exposed to 
 /// other programming languages through the Java Native Interface.
@@ -30,6 +35,10 @@ public class SpeechInterface
 {
 	private static SpeechSynthesizer mSynthesizer = null;
 	private static SpeechRecognizer mRecognizer = null;
+	private static StreamServer mStreamServer = null;
+
+	/// The number of threads preloadPhrases renders phrases on.
+	private static int mSynthesisThreads = 1;
 
 	/// Initializes Voce.  The 'vocePath' String specifies the path where 
 	/// Voce classes and config file can be found.  'initSynthesis' 
@@ -43,6 +52,124 @@ public class SpeechInterface
 	/// is empty, a simple default grammar will be used.
 	public static void init(String vocePath, boolean initSynthesis, 
 		boolean initRecognition, String grammarPath, String grammarName)
+	{
+		init(vocePath, initSynthesis, initRecognition, grammarPath, 
+			grammarName, "");
+	}
+
+	/// Initializes Voce with extra options.  The first five parameters 
+	/// are the same as above.  'options' is a list of 'name=value' 
+	/// entries separated by spaces, commas or semicolons.  The supported 
+	/// options are:
+	///
+	/// queueCapacity - The maximum number of recognized strings kept in 
+	///   the recognizer's queue.  0 (the default) means no limit.
+	/// queueOverflow - What happens when a string is recognized while 
+	///   the queue is full: 'dropOldest' (the default) discards the 
+	///   oldest queued strings, 'dropNewest' discards the new string, 
+	///   and 'coalesce' discards strings that are already queued and 
+	///   otherwise behaves like 'dropOldest'.
+	/// audioInput - Where the recognizer gets its audio: 'microphone' 
+	///   (the default), 'file' or 'push'.  With 'file', the microphone 
+	///   is never opened and audio is only recognized through 
+	///   recognizeFile.  'push' reads audio that native code hands over 
+	///   with voce::pushAudio; it is only available through the C++ 
+	///   interface.
+	/// audioOutput - Where the synthesizer plays its audio: 'device' 
+	///   (the default) or 'none'.  With 'none', no audio line is ever 
+	///   opened, synthesize requests are ignored, and speech is only 
+	///   synthesized into memory by voce::synthesizeToBuffer.  Use it on 
+	///   machines without an audio device.
+	/// phraseCacheSize - When greater than 0, synthesized phrases are 
+	///   kept in memory, up to this many kilobytes, and a phrase spoken 
+	///   again is copied from memory instead of being synthesized again.  
+	///   The least recently used phrases are dropped first.  See 
+	///   getPhraseCacheStats.  The default is 0, or 4096 with 
+	///   'phraseFile'.
+	/// phraseFile - A file of phrases, one per line, to render into the 
+	///   phrase cache in the background while the application starts, 
+	///   so that they play without delay.  See preloadPhrases.
+	/// synthesisThreads - The number of threads that render preloaded 
+	///   phrases, each with its own copy of the voice.  By default 
+	///   there is one per CPU.
+	/// pushBufferSize - The number of samples the push audio buffer can 
+	///   hold (rounded up to a power of two).  The default is 65536, 
+	///   about 4 seconds.
+	/// searchProfile - The search strategy: 'flat' (the default) 
+	///   compiles the grammar into a flat search graph, which is best for 
+	///   small and medium vocabularies.  'lexTree' shares word prefixes 
+	///   in a lexical tree and prunes the search per word, which scales 
+	///   to grammars of many thousands of words.  See ProfileBenchmark.
+	/// dictionary - A binary pronunciation dictionary written by 
+	///   DictionaryCompiler.  It is memory-mapped instead of parsing the 
+	///   CMU dictionary text file, which makes startup faster and keeps 
+	///   the dictionary off the Java heap.  By default the text 
+	///   dictionary in the acoustic model jar is used.
+	/// pruneDictionary - When 'true', only the pronunciations of the 
+	///   grammar's words and the filler words are kept once the grammar 
+	///   is loaded.  With the text dictionary, only the words in the 
+	///   grammar files are read from it, so the rest never take up heap; 
+	///   with a compiled dictionary, the rest are released.  Loading 
+	///   another grammar with setGrammar reads its words and prunes the 
+	///   dictionary again.  The default is 'false'.
+	/// maxHeap - The maximum Java heap size, in the format of the JVM's 
+	///   -Xmx option (for example, '64m').  Only used by the C++ 
+	///   interface, which creates the JVM.  The default is '256m'.
+	/// grammarCache - A directory in which to cache the compiled search 
+	///   graph for the grammar.  Later runs with the same grammar, 
+	///   dictionary and acoustic model load the graph from the cache 
+	///   instead of compiling it.  By default nothing is cached.
+	/// partialResults - When greater than 0, the best hypothesis for the 
+	///   utterance being spoken is published every this many 10 ms 
+	///   frames (when it changes), through popPartialResult.  0 (the 
+	///   default) only publishes final results.
+	/// scorerThreads - The number of threads that score each audio frame 
+	///   against the acoustic model.  By default there is one per CPU.
+	/// scorerPriority - The priority of the scoring threads, from 1 
+	///   (lowest) to 10 (highest).  The default is 5.
+	/// scorerAffinity - The CPUs the scoring threads may run on, as a list 
+	///   of CPU numbers and ranges (for example, '0-3,6').  Only used by 
+	///   the C++ interface, on Windows and Linux.  By default the 
+	///   operating system decides.  The priority and CPUs apply to the 
+	///   helper threads only; the recognizer's own thread also scores 
+	///   part of each frame and is left as it is.
+	/// scorerAutoTune - When 'true', the recognizer measures how long 
+	///   scoring takes with each number of threads up to 'scorerThreads' 
+	///   over the first frames it decodes, then keeps the fastest.  The 
+	///   default is 'false'.  Without any of the scorer options, Sphinx4's 
+	///   own scorer is used, with one thread per CPU.
+	/// wakePhrase - When set, the recognizer listens only for this 
+	///   phrase, with a small search that absorbs all other speech, and 
+	///   decodes with the grammar only after hearing it.  This uses far 
+	///   less CPU while nobody is talking to the application.  Words are 
+	///   separated by '+', and several phrases by '|' (for example, 
+	///   'hey+voce|ok+voce').  The wake phrase itself is not returned.  
+	///   By default the grammar is always used.  See WakeBenchmark.
+	/// wakeUtterances - The number of utterances decoded with the 
+	///   grammar after each wake phrase.  The default is 1.
+	/// nativeFrontEnd - When 'true', the audio is turned into features 
+	///   by native code (vectorized with SSE2 or AVX where available) 
+	///   instead of the Java front end stages.  The features are the 
+	///   same to within rounding.  Only available through the C++ 
+	///   interface, and not with 'streams'.  The default is 'false'.  
+	///   See FrontEndBenchmark.
+	/// featureCache - A directory where the features of each decoded 
+	///   audio file are saved.  Decoding the same file again, for 
+	///   example with a new grammar, reads the saved features instead of 
+	///   running the front end on the audio.  A feature file is made 
+	///   again when the audio file, config file or front end changes.  
+	///   Only used with 'audioInput=file'.  By default nothing is saved.  
+	///   See FeatureCacheBenchmark.
+	/// streams - When greater than 0, instead of a single recognizer, 
+	///   this many recognizers are created to decode separate streams of 
+	///   pushed audio, each with its own grammar, while sharing one copy 
+	///   of the acoustic model and dictionary.  See createStream.  Only 
+	///   available through the C++ interface.  Of the recognizer options 
+	///   above, only 'pushBufferSize' and 'maxHeap' apply to streams; 
+	///   the others are ignored with a warning.  The default is 0.
+	public static void init(String vocePath, boolean initSynthesis, 
+		boolean initRecognition, String grammarPath, String grammarName, 
+		String options)
 	{
 		Utils.setPrintDebug(false);
 		Utils.log("debug", "Beginning initialization");
@@ -53,11 +180,36 @@ public class SpeechInterface
 				+ "uninitialized.");
 		}
 
+		Properties voceOptions = Utils.parseOptions(options);
+
 		if (initSynthesis)
 		{
+			String phraseFile = voceOptions.getProperty("phraseFile");
+
 			// Create a speech synthesizer and give it a name.
 			Utils.log("", "Initializing synthesizer");
-			mSynthesizer = new SpeechSynthesizer("Kevin16");
+			mSynthesizer = new SpeechSynthesizer("Kevin16", 
+				!"none".equals(voceOptions.getProperty("audioOutput")), 
+				1024L * Utils.getIntOption(voceOptions, 
+				"phraseCacheSize", null == phraseFile ? 0 : 4096));
+			mSynthesisThreads = Utils.getIntOption(voceOptions, 
+				"synthesisThreads", 
+				Runtime.getRuntime().availableProcessors());
+
+			if (null != phraseFile)
+			{
+				try
+				{
+					mSynthesizer.preloadPhrases(
+						BatchRecognizer.readFileList(phraseFile), 
+						mSynthesisThreads);
+				}
+				catch (IOException e)
+				{
+					Utils.log("ERROR", "Cannot read phrase file: " 
+						+ phraseFile);
+				}
+			}
 		}
 
 		if (initRecognition)
@@ -69,16 +221,32 @@ public class SpeechInterface
 
 			// Always use the same config file.
 			String configFilename = "voce.config.xml";
+			int numStreams = Utils.getIntOption(voceOptions, 
+				"streams", 0);
 
-			// Create the speech recognizer.
-			Utils.log("", "Initializing recognizer. " 
-				+ "This may take some time...");
-			mRecognizer = new SpeechRecognizer(vocePath + "/" 
-				+ configFilename, grammarPath, grammarName);
+			if (numStreams > 0)
+			{
+				// Create the stream recognizers.  Streams are started 
+				// with createStream.
+				Utils.log("", "Initializing " + numStreams 
+					+ " stream recognizers. This may take some time...");
+				mStreamServer = new StreamServer(vocePath + "/" 
+					+ configFilename, grammarPath, grammarName, 
+					numStreams, voceOptions);
+			}
+			else
+			{
+				// Create the speech recognizer.
+				Utils.log("", "Initializing recognizer. " 
+					+ "This may take some time...");
+				mRecognizer = new SpeechRecognizer(vocePath + "/" 
+					+ configFilename, grammarPath, grammarName, 
+					voceOptions);
 
-			// Enable the recognizer; this will start the recognition 
-			// thread.
-			setRecognizerEnabled(true);
+				// Enable the recognizer; this will start the recognition 
+				// thread.
+				setRecognizerEnabled(true);
+			}
 		}
 
 		Utils.log("", "Initialization complete");
@@ -99,6 +267,11 @@ public class SpeechInterface
 			mRecognizer.destroy();
 		}
 
+		if (null != mStreamServer)
+		{
+			mStreamServer.destroy();
+		}
+
 		Utils.log("", "Shutdown complete");
 	}
 
@@ -117,6 +290,97 @@ public class SpeechInterface
 		mSynthesizer.synthesize(message);
 	}
 
+	/// Synthesizes the given string right away into memory instead of 
+	/// playing it, and hands the samples to native code: 'buffer' is 
+	/// passed to nativeCreateSynthesisBuffer, which returns the memory 
+	/// to write them to.  The calling thread waits until the whole 
+	/// string is synthesized.  Returns the sample rate in Hz, or 0 if 
+	/// the string cannot be synthesized.  Used by 
+	/// voce::synthesizeToBuffer.
+	public static int synthesizeToBuffer(String message, long buffer)
+	{
+		if (null == mSynthesizer)
+		{
+			Utils.log("warning", "synthesizeToBuffer called before " 
+				+ "synthesizer was initialized.  Request will be ignored.");
+			return 0;
+		}
+
+		short[] samples = mSynthesizer.synthesizeToBuffer(message);
+
+		if (null == samples)
+		{
+			return 0;
+		}
+
+		if (samples.length > 0)
+		{
+			ByteBuffer bytes = nativeCreateSynthesisBuffer(buffer, 
+				samples.length);
+
+			if (null == bytes)
+			{
+				return 0;
+			}
+
+			bytes.order(ByteOrder.nativeOrder()).asShortBuffer().put(
+				samples);
+		}
+
+		return mSynthesizer.getBufferSampleRate();
+	}
+
+	/// Renders phrases into the phrase cache in the background, so that 
+	/// synthesizing them later starts without delay.  'phrases' holds 
+	/// one phrase per line.  Requires the 'phraseCacheSize' or 
+	/// 'phraseFile' init option.
+	public static void preloadPhrases(String phrases)
+	{
+		if (null == mSynthesizer)
+		{
+			Utils.log("warning", "preloadPhrases called before " 
+				+ "synthesizer was initialized.  Request will be ignored.");
+			return;
+		}
+
+		mSynthesizer.preloadPhrases(phrases.split("\n"), 
+			mSynthesisThreads);
+	}
+
+	/// Returns the number of preloaded phrases that have not been 
+	/// rendered yet.
+	public static int getPreloadPendingCount()
+	{
+		if (null == mSynthesizer)
+		{
+			return 0;
+		}
+
+		return mSynthesizer.getPreloadPendingCount();
+	}
+
+	/// Returns the phrase cache's counters: the number of phrases found 
+	/// in the cache, the number synthesized because they were not, the 
+	/// number dropped to make room, the bytes of samples kept, and the 
+	/// number of phrases kept.  They are all 0 without the 
+	/// 'phraseCacheSize' init option.
+	public static long[] getPhraseCacheStats()
+	{
+		long[] stats = null;
+
+		if (null != mSynthesizer)
+		{
+			stats = mSynthesizer.getPhraseCacheStats();
+		}
+
+		if (null == stats)
+		{
+			stats = new long[5];
+		}
+
+		return stats;
+	}
+
 	/// Checks whether the speech synthesizer is currently synthesizing a message.
 	public static boolean isSynthesizing()
 	{
@@ -152,6 +416,22 @@ public class SpeechInterface
 		return mRecognizer.getQueueSize();
 	}
 
+	/// Returns the number of recognized strings that were dropped 
+	/// because the recognizer's queue was full.  See the 'queueCapacity' 
+	/// and 'queueOverflow' init options.
+	public static long getRecognizerDropCount()
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "getRecognizerDropCount "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "0.");
+			return 0;
+		}
+
+		return mRecognizer.getQueueDropCount();
+	}
+
 	/// Returns and removes the oldest recognized string from the 
 	/// recognizer's queue.
 	public static String popRecognizedString()
@@ -167,6 +447,275 @@ public class SpeechInterface
 		return mRecognizer.popString();
 	}
 
+	/// Returns and removes the oldest recognized string from the 
+	/// recognizer's queue, waiting up to 'timeoutMs' milliseconds for one 
+	/// to arrive if the queue is empty.  Returns null if nothing was 
+	/// recognized before the timeout expired.  Use this instead of 
+	/// polling getRecognizerQueueSize in a loop.
+	public static String waitForRecognizedString(int timeoutMs)
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "waitForRecognizedString "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "null.");
+			return null;
+		}
+
+		return mRecognizer.waitString(timeoutMs);
+	}
+
+	/// Removes all recognized strings from the recognizer's queue in 
+	/// one call.  The strings are packed, oldest first, into one UTF-8 
+	/// byte array with a zero byte after each string.  Returns null if 
+	/// the queue is empty.  The queue is emptied one string at a time, 
+	/// so strings recognized meanwhile may be left for the next call, 
+	/// and strings taken by other threads at the same time are not 
+	/// included.  This is mainly meant for the C++ interface, where it 
+	/// replaces one JNI call per string with a single call.
+	public static byte[] popAllRecognizedStrings()
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "popAllRecognizedStrings "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "null.");
+			return null;
+		}
+
+		return mRecognizer.popAllStrings();
+	}
+
+	/// Chooses whether recognized strings are stored in the recognizer's 
+	/// queue (false, the default) or passed to nativeStringRecognized as 
+	/// soon as they are recognized (true).  Only the C++ interface should 
+	/// enable this, since it provides the native method.
+	public static void setNativeRecognitionEnabled(boolean e)
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "setNativeRecognitionEnabled "
+				+ "called before recognizer was initialized.  Request " 
+				+ "will be ignored.");
+			return;
+		}
+
+		mRecognizer.setNativeDeliveryEnabled(e);
+	}
+
+	/// Receives each recognized string on the recognition thread when 
+	/// native delivery is enabled.  Implemented in voce.h and registered 
+	/// with RegisterNatives when the C++ interface initializes Voce.
+	static native void nativeStringRecognized(String s);
+
+	/// Allocates the native ring buffer used by the 'push' audio input 
+	/// (or by a stream, see createStream) and returns a direct 
+	/// ByteBuffer that wraps it.  'samples' is rounded up to a power of 
+	/// two.  Called by PushAudioSource; implemented in voce.h.
+	static native ByteBuffer nativeCreateAudioBuffer(int stream, 
+		int samples);
+
+	/// Makes the native sample buffer 'buffer' (see synthesizeToBuffer) 
+	/// hold 'samples' samples and returns a direct ByteBuffer that wraps 
+	/// it.  Implemented in voce.h.
+	static native ByteBuffer nativeCreateSynthesisBuffer(long buffer, 
+		int samples);
+
+	/// Returns the number of samples pushed to 'stream' waiting to be 
+	/// read.  An underrun is counted if fewer than 'wanted' are 
+	/// available.  Implemented in voce.h.
+	static native int nativeAudioAvailable(int stream, int wanted);
+
+	/// Hands 'count' samples at the start of the data pushed to 'stream' 
+	/// back to the producer once they have been read.  Implemented in 
+	/// voce.h.
+	static native void nativeAudioConsumed(int stream, int count);
+
+	/// Starts recognizing a new stream of pushed audio with the given 
+	/// grammar (from the grammar path given to init), or with the 
+	/// grammar the stream was last used with if 'grammarName' is empty.  
+	/// Returns the stream's handle, or -1 if all streams are in use.  
+	/// Requires the 'streams' init option.
+	public static int createStream(String grammarName)
+	{
+		if (null == mStreamServer)
+		{
+			Utils.log("warning", "createStream "
+				+ "called without the 'streams' init option.  Returning " 
+				+ "-1.");
+			return -1;
+		}
+
+		return mStreamServer.createStream(grammarName);
+	}
+
+	/// Stops recognizing the given stream and makes it available to 
+	/// createStream again.
+	public static void destroyStream(int stream)
+	{
+		if (null == mStreamServer)
+		{
+			Utils.log("warning", "destroyStream "
+				+ "called without the 'streams' init option.  Request " 
+				+ "will be ignored.");
+			return;
+		}
+
+		mStreamServer.destroyStream(stream);
+	}
+
+	/// Returns and removes the oldest string recognized in the given 
+	/// stream.  Returns an empty string if there is none.
+	public static String popStreamResult(int stream)
+	{
+		if (null == mStreamServer)
+		{
+			Utils.log("warning", "popStreamResult "
+				+ "called without the 'streams' init option.  Returning " 
+				+ "an empty string.");
+			return "";
+		}
+
+		return mStreamServer.popResult(stream);
+	}
+
+	/// Pins the calling thread to the CPUs whose bits are set in 'mask'.  
+	/// Returns false if this is not supported.  Called by 
+	/// ParallelAcousticScorer; implemented in voce.h.
+	static native boolean nativeSetThreadAffinity(long mask);
+
+	/// Creates a native feature extractor for audio at the given sample 
+	/// rate and returns its handle, or 0 if it cannot be created.  The 
+	/// settings are listed in NativeFeatureExtractor.getSettings.  Called 
+	/// by NativeFeatureExtractor; implemented in voce.h.
+	static native long nativeCreateFeatureExtractor(int sampleRate, 
+		double[] settings);
+
+	/// Turns the first 'count' samples into feature vectors, stored one 
+	/// after the other in 'features', and returns their number. 
+	/// Implemented in voce.h.
+	static native int nativeExtractFeatures(long extractor, 
+		double[] samples, int count, float[] features);
+
+	/// Ends the current utterance, stores its remaining feature vectors 
+	/// in 'features' and returns their number.  Implemented in voce.h.
+	static native int nativeEndFeatureUtterance(long extractor, 
+		float[] features);
+
+	/// Destroys a native feature extractor.  Does nothing for 0. 
+	/// Implemented in voce.h.
+	static native void nativeDestroyFeatureExtractor(long extractor);
+
+	/// Returns the number of threads the recognizer currently uses to 
+	/// score each audio frame.  See the 'scorerThreads' and 
+	/// 'scorerAutoTune' init options.
+	public static int getScorerThreadCount()
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "getScorerThreadCount "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "0.");
+			return 0;
+		}
+
+		return mRecognizer.getScorerThreadCount();
+	}
+
+	/// Returns and removes the oldest partial result: the best guess at 
+	/// what is being said before the utterance has ended.  Returns an 
+	/// empty string if there is none.  Requires the 'partialResults' 
+	/// init option.  The final result still arrives through 
+	/// popRecognizedString.
+	public static String popPartialResult()
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "popPartialResult "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "an empty string.");
+			return "";
+		}
+
+		return mRecognizer.popPartialResult();
+	}
+
+	/// Returns the average number of milliseconds by which the first 
+	/// partial result of an utterance came before its final result.
+	public static int getPartialResultLeadTime()
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "getPartialResultLeadTime "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "0.");
+			return 0;
+		}
+
+		return mRecognizer.getPartialResultLeadTime();
+	}
+
+	/// Chooses whether partial results are stored in a queue (false, the 
+	/// default) or passed to nativePartialRecognized (true).  Only the 
+	/// C++ interface should enable this, since it provides the native 
+	/// method.
+	public static void setNativePartialRecognitionEnabled(boolean e)
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "setNativePartialRecognitionEnabled "
+				+ "called before recognizer was initialized.  Request " 
+				+ "will be ignored.");
+			return;
+		}
+
+		mRecognizer.setNativePartialDeliveryEnabled(e);
+	}
+
+	/// Receives each partial result on the recognition thread when 
+	/// native partial delivery is enabled.  Implemented in voce.h.
+	static native void nativePartialRecognized(String s);
+
+	/// Recognizes the speech in a WAV or raw audio file (16 kHz, 16-bit, 
+	/// signed, mono; raw data must be little-endian) and returns it.  
+	/// The calling thread waits until the whole file has been decoded.  
+	/// Requires the 'audioInput=file' init option.
+	public static String recognizeFile(String filename)
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "recognizeFile "
+				+ "called before recognizer was initialized.  Returning " 
+				+ "an empty string.");
+			return "";
+		}
+
+		return mRecognizer.recognizeFile(filename);
+	}
+
+	/// Replaces the recognizer's grammar.  'grammarPath' and 
+	/// 'grammarName' work as in init.  Only the search graph is rebuilt, 
+	/// so this is much faster than destroying and re-initializing Voce.  
+	/// Recognized strings that have not been read yet are discarded.  
+	/// Returns the time taken in milliseconds, or -1 on failure.
+	public static long setGrammar(String grammarPath, String grammarName)
+	{
+		if (null == mRecognizer)
+		{
+			Utils.log("warning", "setGrammar "
+				+ "called before recognizer was initialized.  Request " 
+				+ "will be ignored.");
+			return -1;
+		}
+
+		if (grammarPath.equals(""))
+		{
+			grammarPath = "./";
+		}
+
+		return mRecognizer.setGrammar(grammarPath, grammarName);
+	}
+
 	/// Enables and disables the speech recognizer.
 	public static void setRecognizerEnabled(boolean e)
 	{
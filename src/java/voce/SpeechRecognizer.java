@@ -23,27 +23,106 @@
 package voce;
 
 import edu.cmu.sphinx.frontend.util.Microphone;
+import edu.cmu.sphinx.jsapi.JSGFGrammar;
+import edu.cmu.sphinx.linguist.Linguist;
+import edu.cmu.sphinx.linguist.lextree.LexTreeLinguist;
+import edu.cmu.sphinx.frontend.util.StreamDataSource;
 import edu.cmu.sphinx.recognizer.Recognizer;
 import edu.cmu.sphinx.result.Result;
+import edu.cmu.sphinx.result.ResultListener;
 import edu.cmu.sphinx.util.props.ConfigurationManager;
 import edu.cmu.sphinx.util.props.PropertyException;
 
-import java.util.LinkedList;
+import java.util.Arrays;
+import java.util.Properties;
+import java.util.Set;
+import java.io.BufferedInputStream;
 import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileWriter;
 import java.io.IOException;
+import java.io.InputStream;
+import java.io.PrintWriter;
 import java.net.URL;
+import javax.sound.sampled.AudioFileFormat;
+import javax.sound.sampled.AudioFormat;
+import javax.sound.sampled.AudioInputStream;
+import javax.sound.sampled.AudioSystem;
+import javax.sound.sampled.UnsupportedAudioFileException;
 
 /// Handles all speech recognition (i.e. speech-to-text) functions.  Uses 
 /// a separate thread for recognition.  Maintains an internal queue of 
 /// recognized strings.
-public class SpeechRecognizer implements Runnable
+public class SpeechRecognizer implements Runnable, ResultListener
 {
+	/// The maximum number of partial results kept in the partial result 
+	/// queue.  Each one supersedes the last, so only the newest matter.
+	private static final int PARTIAL_QUEUE_CAPACITY = 16;
+
 	/// The speech Recognizer instance.
 	private Recognizer mRecognizer = null;
 
-	/// The Microphone instance.
+	/// The configuration the recognizer was created from.  Kept so the 
+	/// grammar can be changed later.
+	private ConfigurationManager mConfigurationManager = null;
+
+	/// The grammar and the linguist that compiles it into the search 
+	/// graph.
+	private JSGFGrammar mGrammar = null;
+	private Linguist mLinguist = null;
+
+	/// The names of the search manager and linguist components used by 
+	/// the search profile.
+	private String mSearchManagerName = "searchManager";
+	private String mLinguistName = "flatLinguist";
+
+	/// The dictionary that drops the words the grammar does not use.  
+	/// This is null unless dictionary pruning is enabled.
+	private ScopedDictionary mScopedDictionary = null;
+
+	/// The acoustic scorer, used to report how many threads it scores 
+	/// with.  This is null unless a scorer option replaced Sphinx4's 
+	/// scorer with a ParallelAcousticScorer.
+	private ParallelAcousticScorer mScorer = null;
+
+	/// The recognizer that listens only for the wake phrase, and the 
+	/// phrases it listens for.  These are null unless a wake phrase is 
+	/// set.
+	private Recognizer mWakeRecognizer = null;
+	private String[] mWakePhrases = null;
+
+	/// The number of utterances decoded with the grammar after each wake 
+	/// phrase, and how many of them are left.  While none are left, only 
+	/// the wake recognizer runs.  Only used by the thread that decodes.
+	private int mWakeUtterances = 1;
+	private int mAwakeUtterancesLeft = 0;
+
+	/// The number of times the wake phrase was heard.
+	private volatile int mWakeCount = 0;
+
+	/// The Microphone instance.  This is null when audio is read from 
+	/// files or pushed from native code instead.
 	private Microphone mMicrophone = null;
 
+	/// The data source that reads audio pushed from native code.  This 
+	/// is null unless audio input is set to 'push'.
+	private PushAudioSource mPushAudioSource = null;
+
+	/// The data source used to read audio files.  This is null when 
+	/// audio comes from the microphone.
+	private StreamDataSource mStreamDataSource = null;
+
+	/// Records and replays the features of audio files, or null if the 
+	/// 'featureCache' option is not set.  The feature files are kept in 
+	/// mFeatureCacheDirectory.
+	private FeatureCache mFeatureCache = null;
+	private String mFeatureCacheDirectory = null;
+
+	/// The config file and the name of the front end the decoder reads 
+	/// from, which identify the features it sees.
+	private String mConfigFilename;
+	private String mFrontEndName = "epFrontEnd";
+
 	/// The thread used for speech recognition.  This is necessary to 
 	/// avoid making applications wait for recognition to finish.
 	private volatile Thread mRecognitionThread = null;
@@ -53,24 +132,230 @@ public class SpeechRecognizer implements Runnable
 	/// and the recognition thread.
 	private boolean mRecognitionThreadEnabled = false;
 
-	/// A queue of the recognized strings.
-	private LinkedList<String> mRecognizedStringQueue;
+	/// A queue of the recognized strings.  The recognition thread adds 
+	/// to it while application threads remove from it, and consumers can 
+	/// block on it while waiting for results.
+	private StringQueue mRecognizedStringQueue;
+
+	/// The buffer popAllStrings packs strings into, kept between calls, 
+	/// and the lock that lets only one caller use it at a time.
+	private byte[] mPackBuffer = new byte[256];
+	private Object mPackLock = new Object();
+
+	/// When true, recognized strings are handed straight to the native 
+	/// handler registered by the C++ interface instead of being queued.
+	private volatile boolean mNativeDeliveryEnabled = false;
+
+	/// A queue of partial results: the best hypothesis so far for the 
+	/// utterance being spoken.  Only used when partial results are 
+	/// enabled.
+	private StringQueue mPartialResultQueue = new StringQueue(
+		PARTIAL_QUEUE_CAPACITY, StringQueue.DROP_OLDEST);
+
+	/// When true, partial results are handed straight to the native 
+	/// handler registered by the C++ interface instead of being queued.
+	private volatile boolean mNativePartialDeliveryEnabled = false;
+
+	/// The last partial result published for the current utterance.  
+	/// Only used by the recognition thread.
+	private String mLastPartialResult = "";
+
+	/// The time and frame number of the current utterance's first 
+	/// partial result, or 0 if there has not been one.  Only used by the 
+	/// recognition thread.
+	private long mFirstPartialTime = 0;
+	private int mFirstPartialFrame = 0;
+
+	/// The number of utterances that had a partial result, and the 
+	/// total time their first partial result came before the final one.
+	private volatile int mPartialLeadCount = 0;
+	private volatile long mPartialLeadTotal = 0;
 
 	/// Constructs and initializes the speech recognizer.  'grammarPath' can 
 	/// be a relative or absolute path.  'grammarName' is the name of a 
 	/// grammar within a .gram file in the 'grammarPath' (all .gram files 
 	/// in 'grammarPath' will automatically be searched).  If the 
-	/// 'grammarName' is empty, no grammar will be used.
+	/// 'grammarName' is empty, no grammar will be used.  'options' holds 
+	/// the recognizer options given to SpeechInterface.init.
 	public SpeechRecognizer(String configFilename, String grammarPath, 
-		String grammarName)
+		String grammarName, Properties options)
 	{
+		// Setup the recognized string queue.
+		int queueCapacity = Utils.getIntOption(options, "queueCapacity", 0);
+		int overflowPolicy = StringQueue.DROP_OLDEST;
+		String overflowName = options.getProperty("queueOverflow");
+
+		if (null != overflowName)
+		{
+			overflowPolicy = StringQueue.parseOverflowPolicy(overflowName);
+
+			if (overflowPolicy < 0)
+			{
+				Utils.log("warning", "Unknown queue overflow policy: " 
+					+ overflowName + ".  Defaulting to 'dropOldest'.");
+				overflowPolicy = StringQueue.DROP_OLDEST;
+			}
+		}
+
+		mRecognizedStringQueue = new StringQueue(queueCapacity, 
+			overflowPolicy);
+
+		int partialInterval = Utils.getIntOption(options, "partialResults", 
+			0);
+
 		try
 		{
 			URL configURL = new File(configFilename).toURI().toURL();
 			ConfigurationManager cm = new ConfigurationManager(configURL);
+			mConfigurationManager = cm;
+			mConfigFilename = configFilename;
 
 			mRecognizer = (Recognizer) cm.lookup("recognizer");
-			mMicrophone = (Microphone) cm.lookup("microphone");
+			String wakePhrase = options.getProperty("wakePhrase");
+
+			if (null != wakePhrase)
+			{
+				setupWakeRecognizer(cm, wakePhrase, options);
+			}
+
+			String audioInput = options.getProperty("audioInput", 
+				"microphone");
+
+			if (audioInput.equals("file"))
+			{
+				// Switch the decoder over to the front end that reads 
+				// from a stream.
+				mStreamDataSource = (StreamDataSource) cm.lookup(
+					"streamDataSource");
+				mFeatureCacheDirectory = options.getProperty("featureCache");
+
+				if (null != mFeatureCacheDirectory)
+				{
+					// Read through the front end that can record and 
+					// replay features.
+					mFeatureCache = (FeatureCache) cm.lookup("featureCache");
+					setFrontEnd(cm, "cachedFileFrontEnd");
+				}
+				else
+				{
+					setFrontEnd(cm, "fileFrontEnd");
+				}
+			}
+			else if (audioInput.equals("push"))
+			{
+				// Switch the decoder over to the front end that reads 
+				// audio pushed from native code.
+				mPushAudioSource = (PushAudioSource) cm.lookup(
+					"pushAudioSource");
+				String bufferSize = options.getProperty("pushBufferSize");
+
+				if (null != bufferSize)
+				{
+					cm.setProperty("pushAudioSource", "bufferSize", 
+						bufferSize);
+				}
+
+				setFrontEnd(cm, "pushFrontEnd");
+			}
+			else
+			{
+				if (!audioInput.equals("microphone"))
+				{
+					Utils.log("warning", "Unknown audio input: " 
+						+ audioInput + ".  Defaulting to 'microphone'.");
+				}
+
+				mMicrophone = (Microphone) cm.lookup("microphone");
+			}
+
+			if (null == mFeatureCache 
+				&& null != options.getProperty("featureCache"))
+			{
+				Utils.log("warning", "The feature cache is only used with " 
+					+ "'audioInput=file'.");
+			}
+
+			if ("true".equals(options.getProperty("nativeFrontEnd")))
+			{
+				setupNativeFrontEnd(cm);
+			}
+
+			String searchProfile = options.getProperty("searchProfile", 
+				"flat");
+
+			if (searchProfile.equals("lexTree"))
+			{
+				// Switch the decoder over to the search manager and 
+				// linguist meant for large vocabularies.
+				cm.lookup("wordPruningSearchManager");
+				cm.setProperty("decoder", "searchManager", 
+					"wordPruningSearchManager");
+				mSearchManagerName = "wordPruningSearchManager";
+				mLinguistName = "lexTreeLinguist";
+			}
+			else if (!searchProfile.equals("flat"))
+			{
+				Utils.log("warning", "Unknown search profile: " 
+					+ searchProfile + ".  Defaulting to 'flat'.");
+			}
+
+			String cacheDirectory = options.getProperty("grammarCache");
+
+			if (null != cacheDirectory 
+				&& !mLinguistName.equals("flatLinguist"))
+			{
+				Utils.log("warning", "The grammar cache is only used with " 
+					+ "the 'flat' search profile.");
+			}
+			else if (null != cacheDirectory)
+			{
+				setupGrammarCache(cm, cacheDirectory, configFilename, 
+					grammarPath, grammarName, options);
+			}
+
+			String dictionaryFile = options.getProperty("dictionary");
+
+			if (null != dictionaryFile)
+			{
+				// Switch the grammar and linguist over to the compiled, 
+				// memory-mapped dictionary.  The text dictionary is then 
+				// never loaded.
+				cm.lookup("mappedDictionary");
+				cm.setProperty("mappedDictionary", "dictionaryPath", 
+					dictionaryFile);
+				setDictionary(cm, "mappedDictionary");
+			}
+
+			if ("true".equals(options.getProperty("pruneDictionary")))
+			{
+				// Look words up through a dictionary that can drop the 
+				// ones the grammar does not use.
+				mScopedDictionary = (ScopedDictionary) cm.lookup(
+					"scopedDictionary");
+
+				if (null != dictionaryFile)
+				{
+					cm.setProperty("scopedDictionary", "dictionary", 
+						"mappedDictionary");
+				}
+				else if (!grammarName.equals(""))
+				{
+					// Only the grammar's words are read from the text 
+					// dictionary.
+					Set<String> words = 
+						ScopedDictionary.readGrammarWords(grammarPath);
+
+					if (null != words && null != wakePhrase)
+					{
+						words.addAll(Arrays.asList(
+							wakePhrase.toLowerCase().split("[\\s|]+")));
+					}
+
+					mScopedDictionary.setVocabulary(words);
+				}
+
+				setDictionary(cm, "scopedDictionary");
+			}
 
 			if (!grammarName.equals(""))
 			{
@@ -88,8 +373,33 @@ public class SpeechRecognizer implements Runnable
 					+ "'digits.gram'");
 			}
 
+			if (partialInterval > 0)
+			{
+				// The decoder reports a result to its listeners after 
+				// every block of frames.  All but the last one of an 
+				// utterance are partial.
+				cm.setProperty("decoder", "featureBlockSize", 
+					String.valueOf(partialInterval));
+				mRecognizer.addResultListener(this);
+			}
+
+			setupScorer(cm, options);
 			mRecognizer.allocate();
-			mRecognizedStringQueue = new LinkedList<String>();
+
+			if (null != mWakeRecognizer)
+			{
+				mWakeRecognizer.allocate();
+			}
+
+			// These were created along with the recognizer.
+			mGrammar = (JSGFGrammar) cm.lookup("jsgfGrammar");
+			mLinguist = (Linguist) cm.lookup(mLinguistName);
+
+			if (null != mScopedDictionary)
+			{
+				// The grammar has looked up all of its words by now.
+				mScopedDictionary.prune();
+			}
 		}
 		catch (IOException e)
 		{
@@ -108,6 +418,220 @@ public class SpeechRecognizer implements Runnable
 		}
 	}
 
+	/// Applies the scorer options: the number of scoring threads, their 
+	/// priority and CPU affinity, and whether the number of threads is 
+	/// tuned automatically.  Without any of them the search keeps 
+	/// Sphinx4's ThreadedAcousticScorer; with any of them it switches 
+	/// over to the ParallelAcousticScorer that supports them.
+	private void setupScorer(ConfigurationManager cm, Properties options) 
+		throws PropertyException, InstantiationException
+	{
+		String threads = options.getProperty("scorerThreads");
+		String priority = options.getProperty("scorerPriority");
+		String affinity = options.getProperty("scorerAffinity");
+		String autoTune = options.getProperty("scorerAutoTune");
+
+		if (null == threads && null == priority && null == affinity 
+			&& null == autoTune)
+		{
+			return;
+		}
+
+		mScorer = (ParallelAcousticScorer) cm.lookup("parallelScorer");
+		cm.setProperty("parallelScorer", "frontend", mFrontEndName);
+
+		if (null != threads)
+		{
+			// An absolute number of threads rather than one relative to 
+			// the number of CPUs.
+			cm.setProperty("parallelScorer", "isCpuRelative", "false");
+			cm.setProperty("parallelScorer", "numThreads", threads);
+		}
+
+		if (null != priority)
+		{
+			cm.setProperty("parallelScorer", "threadPriority", priority);
+		}
+
+		if (null != affinity)
+		{
+			cm.setProperty("parallelScorer", "cpuAffinity", affinity);
+		}
+
+		if ("true".equals(autoTune))
+		{
+			cm.setProperty("parallelScorer", "autoTune", "true");
+		}
+
+		cm.setProperty(mSearchManagerName, "scorer", "parallelScorer");
+	}
+
+	/// Creates the recognizer that listens for the wake phrase.  The 
+	/// words of the phrase are separated by '+', and several phrases can 
+	/// be given separated by '|' (for example, 'hey+voce|ok+voce').  A 
+	/// grammar accepting them is written to a temporary directory.
+	private void setupWakeRecognizer(ConfigurationManager cm, 
+		String wakePhrase, Properties options) 
+		throws IOException, PropertyException, InstantiationException
+	{
+		String[] phrases = wakePhrase.toLowerCase().split("\\|");
+
+		for (int i = 0; i < phrases.length; ++i)
+		{
+			phrases[i] = phrases[i].replace('+', ' ').trim().replaceAll(
+				"\\s+", " ");
+
+			if (!phrases[i].matches("[a-z' ]+"))
+			{
+				Utils.log("warning", "Invalid wake phrase: " + wakePhrase 
+					+ ".  The wake phrase will not be used.");
+				return;
+			}
+		}
+
+		File directory = File.createTempFile("voceWake", "");
+		directory.delete();
+		directory.mkdirs();
+		directory.deleteOnExit();
+		File file = new File(directory, "wake.gram");
+		file.deleteOnExit();
+		PrintWriter out = new PrintWriter(new FileWriter(file));
+
+		try
+		{
+			out.println("#JSGF V1.0;");
+			out.println("grammar wake;");
+			out.print("public <wake> = ");
+
+			for (int i = 0; i < phrases.length; ++i)
+			{
+				out.print((0 == i ? "" : " | ") + phrases[i]);
+			}
+
+			out.println(";");
+		}
+		finally
+		{
+			out.close();
+		}
+
+		mWakeRecognizer = (Recognizer) cm.lookup("wakeRecognizer");
+		cm.setProperty("wakeGrammar", "grammarLocation", 
+			directory.getPath());
+		mWakePhrases = phrases;
+		mWakeUtterances = Math.max(1, Utils.getIntOption(options, 
+			"wakeUtterances", 1));
+	}
+
+	/// Points the components that read features at the named front end.
+	private void setFrontEnd(ConfigurationManager cm, String frontEnd) 
+		throws PropertyException
+	{
+		cm.setProperty("threadedScorer", "frontend", frontEnd);
+		cm.setProperty("speedTracker", "frontend", frontEnd);
+		mFrontEndName = frontEnd;
+
+		if (null != mWakeRecognizer)
+		{
+			cm.setProperty("wakeScorer", "frontend", frontEnd);
+		}
+	}
+
+	/// Switches the decoder over to the front end that computes 
+	/// features in native code (see NativeFeatureExtractor) for the 
+	/// audio input already chosen.  Keeps the Java front end if the 
+	/// natives are not there, which is the case unless the C++ interface 
+	/// created the virtual machine.
+	private void setupNativeFrontEnd(ConfigurationManager cm) 
+		throws PropertyException
+	{
+		if (!NativeFeatureExtractor.isAvailable())
+		{
+			Utils.log("warning", "The native front end is only available " 
+				+ "through the C++ interface.  Using the Java front end.");
+			return;
+		}
+
+		if (null != mFeatureCache)
+		{
+			setFrontEnd(cm, "nativeCachedFileFrontEnd");
+		}
+		else if (null != mStreamDataSource)
+		{
+			setFrontEnd(cm, "nativeFileFrontEnd");
+		}
+		else if (null != mPushAudioSource)
+		{
+			setFrontEnd(cm, "nativePushFrontEnd");
+		}
+		else
+		{
+			setFrontEnd(cm, "nativeEpFrontEnd");
+		}
+	}
+
+	/// Points the components that look words up in the dictionary at 
+	/// the named dictionary component.
+	private void setDictionary(ConfigurationManager cm, String dictionary) 
+		throws PropertyException
+	{
+		cm.setProperty("jsgfGrammar", "dictionary", dictionary);
+
+		// FlatLinguist has no dictionary of its own; it gets its words 
+		// from the grammar.  The same goes for the wake linguist.
+		if (!mLinguistName.equals("flatLinguist"))
+		{
+			cm.setProperty(mLinguistName, "dictionary", dictionary);
+		}
+
+		if (null != mWakeRecognizer)
+		{
+			cm.setProperty("wakeGrammar", "dictionary", dictionary);
+		}
+
+		if (mLinguistName.equals("lexTreeLinguist"))
+		{
+			cm.setProperty("grammarLanguageModel", "dictionary", 
+				dictionary);
+		}
+	}
+
+	/// Switches the search over to the linguist that keeps its search 
+	/// graph in a cache file in 'cacheDirectory', named after the 
+	/// grammar.  The linguist reads the compiled search graph from it if 
+	/// it was built from the same grammar, dictionary and acoustic 
+	/// model, and writes it otherwise.
+	private void setupGrammarCache(ConfigurationManager cm, 
+		String cacheDirectory, String configFilename, String grammarPath, 
+		String grammarName, Properties options) 
+		throws PropertyException, InstantiationException
+	{
+		String cacheName = grammarName.equals("") ? "default" : grammarName;
+		File cacheFile = new File(cacheDirectory, cacheName + ".graph");
+		String key;
+
+		try
+		{
+			key = CachingFlatLinguist.computeCacheKey(configFilename, 
+				grammarPath, grammarName, options);
+		}
+		catch (IOException e)
+		{
+			Utils.log("warning", "Cannot identify the grammar for the " 
+				+ "grammar cache: " + e.getMessage() 
+				+ ".  The cache will not be used.");
+			return;
+		}
+
+		new File(cacheDirectory).mkdirs();
+		cm.lookup("cachingFlatLinguist");
+		cm.setProperty("cachingFlatLinguist", "cacheKey", key);
+		cm.setProperty("cachingFlatLinguist", "cacheFile", 
+			cacheFile.getPath());
+		cm.setProperty("searchManager", "linguist", "cachingFlatLinguist");
+		mLinguistName = "cachingFlatLinguist";
+	}
+
 	/// Contains the main processing to be done by the recognition 
 	/// thread.  Called indirectly after 'start' is called.
 	public void run()
@@ -116,24 +640,27 @@ public class SpeechRecognizer implements Runnable
 
 		while (true == mRecognitionThreadEnabled)
 		{
-			if (!mMicrophone.isRecording())
+			if (!isEnabled())
 			{
 				Utils.log("warning", "Recognition thread is running, but " 
-					+ "the microphone is disabled.");
+					+ "the audio input is disabled.");
 			}
 			else
 			{
-				Result result = mRecognizer.recognize();
+				String s = recognizeUtterance();
 
-				if (result != null)
+				// Only save non-empty strings.
+				if (null != s && !s.equals(""))
 				{
-					String s = result.getBestFinalResultNoFiller();
+					Utils.log("debug", "Finished recognizing");
 
-					// Only save non-empty strings.
-					if (!s.equals(""))
+					if (mNativeDeliveryEnabled)
+					{
+						SpeechInterface.nativeStringRecognized(s);
+					}
+					else
 					{
-						Utils.log("debug", "Finished recognizing");
-						mRecognizedStringQueue.addLast(s);
+						mRecognizedStringQueue.add(s);
 					}
 				}
 			}
@@ -142,6 +669,163 @@ public class SpeechRecognizer implements Runnable
 		Utils.log("debug", "Recognition thread finished");
 	}
 
+	/// Decodes the next utterance and returns its text, or null at the 
+	/// end of the audio.  With a wake phrase, utterances are only decoded 
+	/// with the grammar for a while after the wake phrase is heard; the 
+	/// rest go to the much cheaper wake recognizer and an empty string is 
+	/// returned for them.
+	private String recognizeUtterance()
+	{
+		if (null != mWakeRecognizer && 0 == mAwakeUtterancesLeft)
+		{
+			Result result = mWakeRecognizer.recognize();
+
+			if (null == result)
+			{
+				return null;
+			}
+
+			String s = result.getBestFinalResultNoFiller();
+
+			for (int i = 0; i < mWakePhrases.length; ++i)
+			{
+				if (s.equals(mWakePhrases[i]))
+				{
+					Utils.log("debug", "Heard the wake phrase");
+					mAwakeUtterancesLeft = mWakeUtterances;
+					++mWakeCount;
+					break;
+				}
+			}
+
+			return "";
+		}
+
+		Result result = mRecognizer.recognize();
+
+		if (null == result)
+		{
+			return null;
+		}
+
+		if (mAwakeUtterancesLeft > 0)
+		{
+			--mAwakeUtterancesLeft;
+		}
+
+		return result.getBestFinalResultNoFiller();
+	}
+
+	/// Returns the number of times the wake phrase has been heard.
+	public int getWakeCount()
+	{
+		return mWakeCount;
+	}
+
+	/// Receives each result from the decoder when partial results are 
+	/// enabled.  Called on the recognition thread every 'partialResults' 
+	/// frames while an utterance is decoded, and once more when it ends.  
+	/// A partial result is published only if it differs from the 
+	/// previous one.
+	public void newResult(Result result)
+	{
+		if (result.isFinal())
+		{
+			if (0 != mFirstPartialTime)
+			{
+				long lead = System.currentTimeMillis() - mFirstPartialTime;
+				mPartialLeadTotal += lead;
+				++mPartialLeadCount;
+
+				Utils.log("debug", "First partial result came " + lead 
+					+ " ms (" + (result.getFrameNumber() 
+					- mFirstPartialFrame) + " frames) before the final " 
+					+ "result");
+			}
+
+			mLastPartialResult = "";
+			mFirstPartialTime = 0;
+			return;
+		}
+
+		String s = result.getBestResultNoFiller();
+
+		if (s.equals("") || s.equals(mLastPartialResult))
+		{
+			return;
+		}
+
+		mLastPartialResult = s;
+
+		if (0 == mFirstPartialTime)
+		{
+			mFirstPartialTime = System.currentTimeMillis();
+			mFirstPartialFrame = result.getFrameNumber();
+		}
+
+		if (mNativePartialDeliveryEnabled)
+		{
+			SpeechInterface.nativePartialRecognized(s);
+		}
+		else
+		{
+			mPartialResultQueue.add(s);
+		}
+	}
+
+	/// Returns and removes the oldest partial result from the partial 
+	/// result queue.  Returns an empty string if the queue is empty.
+	public String popPartialResult()
+	{
+		String s = mPartialResultQueue.poll();
+
+		if (null == s)
+		{
+			return "";
+		}
+		else
+		{
+			return s;
+		}
+	}
+
+	/// Chooses whether partial results are queued (false) or passed 
+	/// directly to the native handler registered by the C++ interface 
+	/// (true).  The native handler runs on the recognition thread.
+	public void setNativePartialDeliveryEnabled(boolean e)
+	{
+		mNativePartialDeliveryEnabled = e;
+	}
+
+	/// Returns the average time, in milliseconds, between the first 
+	/// partial result of an utterance and its final result.  Returns 0 
+	/// if no utterance has had a partial result.
+	public int getPartialResultLeadTime()
+	{
+		int count = mPartialLeadCount;
+
+		if (0 == count)
+		{
+			return 0;
+		}
+
+		return (int)(mPartialLeadTotal / count);
+	}
+
+	/// Returns the number of threads the acoustic scorer currently 
+	/// scores each frame with.  While auto-tuning, this changes as each 
+	/// thread count is measured.
+	public int getScorerThreadCount()
+	{
+		if (null == mScorer)
+		{
+			// Sphinx4's scorer, configured with one thread per CPU.
+			return Runtime.getRuntime().availableProcessors();
+		}
+
+		return mScorer.getNumThreads();
+	}
+
 	/// Returns the number of recognized strings currently in the 
 	/// recognized string queue.
 	public int getQueueSize()
@@ -149,57 +833,517 @@ public class SpeechRecognizer implements Runnable
 		return mRecognizedStringQueue.size();
 	}
 
+	/// Returns the number of recognized strings dropped because the 
+	/// recognized string queue was full (or, with the 'coalesce' policy, 
+	/// because they were duplicates).
+	public long getQueueDropCount()
+	{
+		return mRecognizedStringQueue.getDropCount();
+	}
+
 	/// Returns and removes the oldest recognized string from the 
 	/// recognized string queue.  Returns an empty string if the 
 	/// queue is empty.
 	public String popString()
 	{
-		if (getQueueSize() > 0)
+		String s = mRecognizedStringQueue.poll();
+
+		if (null == s)
 		{
-			return mRecognizedStringQueue.removeFirst();
+			return "";
 		}
 		else
 		{
+			return s;
+		}
+	}
+
+	/// Returns and removes the oldest recognized string from the 
+	/// recognized string queue, waiting up to 'timeoutMs' milliseconds 
+	/// for one to arrive if the queue is empty.  The calling thread 
+	/// sleeps while it waits.  Returns null if the timeout expires first.
+	public String waitString(int timeoutMs)
+	{
+		return mRecognizedStringQueue.poll(timeoutMs);
+	}
+
+	/// Removes every string from the recognized string queue and returns 
+	/// them packed into a single UTF-8 byte array, oldest first, each 
+	/// followed by a zero byte.  Returns null if the queue is empty, so 
+	/// nothing is allocated in the common case.  Otherwise the strings 
+	/// are encoded into a buffer kept between calls, and only the 
+	/// returned array is allocated.
+	public byte[] popAllStrings()
+	{
+		if (mRecognizedStringQueue.isEmpty())
+		{
+			return null;
+		}
+
+		synchronized (mPackLock)
+		{
+			int length = 0;
+			String s = mRecognizedStringQueue.poll();
+
+			while (null != s)
+			{
+				length = packString(s, length);
+				s = mRecognizedStringQueue.poll();
+			}
+
+			if (0 == length)
+			{
+				return null;
+			}
+
+			byte[] packed = new byte[length];
+			System.arraycopy(mPackBuffer, 0, packed, 0, length);
+			return packed;
+		}
+	}
+
+	/// Appends 's' in UTF-8, followed by a zero byte, to mPackBuffer at 
+	/// 'position', growing the buffer if needed.  Returns the position 
+	/// after the zero byte.  Unpaired surrogates are written as '?', as 
+	/// String.getBytes does.
+	private int packString(String s, int position)
+	{
+		// At most 3 bytes per char, plus the zero byte.
+		int needed = position + 3 * s.length() + 1;
+
+		if (mPackBuffer.length < needed)
+		{
+			byte[] buffer = new byte[Math.max(needed, 
+				2 * mPackBuffer.length)];
+			System.arraycopy(mPackBuffer, 0, buffer, 0, position);
+			mPackBuffer = buffer;
+		}
+
+		byte[] b = mPackBuffer;
+
+		for (int i = 0; i < s.length(); ++i)
+		{
+			char c = s.charAt(i);
+
+			if (c < 0x80)
+			{
+				b[position++] = (byte)c;
+			}
+			else if (c < 0x800)
+			{
+				b[position++] = (byte)(0xc0 | (c >> 6));
+				b[position++] = (byte)(0x80 | (c & 0x3f));
+			}
+			else if (Character.isHighSurrogate(c) && i + 1 < s.length() 
+				&& Character.isLowSurrogate(s.charAt(i + 1)))
+			{
+				int code = Character.toCodePoint(c, s.charAt(++i));
+				b[position++] = (byte)(0xf0 | (code >> 18));
+				b[position++] = (byte)(0x80 | ((code >> 12) & 0x3f));
+				b[position++] = (byte)(0x80 | ((code >> 6) & 0x3f));
+				b[position++] = (byte)(0x80 | (code & 0x3f));
+			}
+			else if (Character.isHighSurrogate(c) 
+				|| Character.isLowSurrogate(c))
+			{
+				b[position++] = (byte)'?';
+			}
+			else
+			{
+				b[position++] = (byte)(0xe0 | (c >> 12));
+				b[position++] = (byte)(0x80 | ((c >> 6) & 0x3f));
+				b[position++] = (byte)(0x80 | (c & 0x3f));
+			}
+		}
+
+		b[position++] = 0;
+		return position;
+	}
+
+	/// Chooses whether recognized strings are queued (false) or passed 
+	/// directly to the native handler registered by the C++ interface 
+	/// (true).  The native handler runs on the recognition thread.
+	public void setNativeDeliveryEnabled(boolean e)
+	{
+		mNativeDeliveryEnabled = e;
+	}
+
+	/// Recognizes the speech in an audio file and returns it.  The file 
+	/// can be a WAV file or raw data; either way it must contain 16 kHz, 
+	/// 16-bit, signed, mono PCM samples (raw data must be little-endian).  
+	/// If the file contains several utterances, their results are joined 
+	/// with spaces.  Returns an empty string if nothing was recognized or 
+	/// the file cannot be read.  Only available when audio input is set 
+	/// to 'file'.
+	public synchronized String recognizeFile(String filename)
+	{
+		if (null == mStreamDataSource)
+		{
+			Utils.log("warning", "recognizeFile called, but the " 
+				+ "recognizer is not reading from files.  Use the " 
+				+ "'audioInput=file' option.");
+			return "";
+		}
+
+		try
+		{
+			if (null != mFeatureCache)
+			{
+				return decodeCachedFile(filename);
+			}
+
+			if (null == mWakeRecognizer)
+			{
+				return decodeFile(mRecognizer, mStreamDataSource, filename);
+			}
+
+			return decodeFileAfterWakePhrase(filename);
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Cannot read audio file: " + filename);
+			e.printStackTrace();
 			return "";
 		}
 	}
 
+	/// Decodes an audio file like decodeFile, but returns only what is 
+	/// said after the wake phrase.  Every file starts out waiting for the 
+	/// wake phrase.
+	private String decodeFileAfterWakePhrase(String filename) 
+		throws IOException
+	{
+		InputStream stream = openAudioFile(filename);
+
+		try
+		{
+			mStreamDataSource.setInputStream(stream, filename);
+			return recognizeUtterances();
+		}
+		finally
+		{
+			stream.close();
+		}
+	}
+
+	/// Decodes an audio file from its feature file in the feature cache 
+	/// if there is an up to date one.  Otherwise decodes the audio and 
+	/// records its feature file along the way.
+	private String decodeCachedFile(String filename) throws IOException
+	{
+		File cacheFile = FeatureCache.getCacheFile(mFeatureCacheDirectory, 
+			filename);
+		String key = FeatureCache.computeKey(mConfigFilename, 
+			mFrontEndName, filename);
+
+		if (mFeatureCache.replay(cacheFile, key))
+		{
+			try
+			{
+				return recognizeUtterances();
+			}
+			finally
+			{
+				mFeatureCache.stop();
+			}
+		}
+
+		InputStream stream = openAudioFile(filename);
+
+		try
+		{
+			mStreamDataSource.setInputStream(stream, filename);
+			mFeatureCache.record(cacheFile, key);
+			return recognizeUtterances();
+		}
+		finally
+		{
+			// The recording is only kept if the whole file was decoded.
+			mFeatureCache.stop();
+			stream.close();
+		}
+	}
+
+	/// Recognizes utterances until the front end runs out of data, and 
+	/// returns their results joined with spaces.  In wake phrase mode, 
+	/// starts out waiting for the wake phrase.
+	private String recognizeUtterances()
+	{
+		mAwakeUtterancesLeft = 0;
+
+		String text = "";
+		String s = recognizeUtterance();
+
+		while (null != s)
+		{
+			if (!s.equals(""))
+			{
+				text = text.equals("") ? s : text + " " + s;
+			}
+
+			s = recognizeUtterance();
+		}
+
+		return text;
+	}
+
+	/// Replaces the grammar without reallocating the recognizer.  Only 
+	/// the grammar and the linguist's search graph are rebuilt; the 
+	/// acoustic model, dictionary and front end stay loaded.  The 
+	/// recognizer is briefly disabled while this happens, and any 
+	/// recognized strings that have not been read yet are discarded.  
+	/// Returns the time taken in milliseconds, or -1 if the grammar 
+	/// cannot be loaded (in which case the recognizer is left with a 
+	/// partially loaded grammar until a valid one is set).
+	public synchronized long setGrammar(String grammarPath, 
+		String grammarName)
+	{
+		if (null == mGrammar || null == mLinguist)
+		{
+			Utils.log("warning", "setGrammar called, but the recognizer " 
+				+ "was not created.");
+			return -1;
+		}
+
+		if (grammarName.equals(""))
+		{
+			Utils.log("warning", "setGrammar called without a grammar " 
+				+ "name.  Request will be ignored.");
+			return -1;
+		}
+
+		// The search graph must not change while an utterance is being 
+		// decoded.
+		boolean wasEnabled = isEnabled();
+
+		if (wasEnabled)
+		{
+			setEnabled(false);
+		}
+
+		long startTime = System.currentTimeMillis();
+		long duration = -1;
+
+		try
+		{
+			mConfigurationManager.setProperty("jsgfGrammar", 
+				"grammarLocation", grammarPath);
+			mConfigurationManager.setProperty("jsgfGrammar", "grammarName", 
+				grammarName);
+
+			if (null != mScopedDictionary)
+			{
+				mScopedDictionary.setVocabulary(
+					ScopedDictionary.readGrammarWords(grammarPath));
+			}
+
+			mGrammar.loadJSGF(grammarName);
+
+			if (mLinguist instanceof LexTreeLinguist)
+			{
+				// The lex tree is built from the grammar's words, so it 
+				// has to be built again.  LexTreeLinguist.allocate sets 
+				// its acoustic model to null once the tree is compiled, 
+				// so allocating it again would throw a 
+				// NullPointerException.  Its newProperties reads the 
+				// acoustic model back from its properties.  The grammar 
+				// language model rebuilds itself when allocated.
+				mLinguist.newProperties(mConfigurationManager
+					.getPropertySheet("lexTreeLinguist"));
+				mLinguist.allocate();
+			}
+			else
+			{
+				// The linguist rebuilds its search graph when it notices 
+				// the new grammar.  Do that now rather than at the start 
+				// of the next utterance.
+				mLinguist.startRecognition();
+				mLinguist.stopRecognition();
+			}
+
+			if (null != mScopedDictionary)
+			{
+				mScopedDictionary.prune();
+			}
+
+			duration = System.currentTimeMillis() - startTime;
+			Utils.log("", "Grammar '" + grammarName + "' loaded in " 
+				+ duration + " ms");
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Cannot load grammar: " + grammarName);
+			e.printStackTrace();
+		}
+		catch (PropertyException e)
+		{
+			Utils.log("ERROR", "Cannot configure grammar: " + grammarName);
+			e.printStackTrace();
+		}
+
+		if (wasEnabled)
+		{
+			setEnabled(true);
+		}
+
+		return duration;
+	}
+
+	/// Decodes an audio file using the given recognizer, whose front end 
+	/// must read from 'source', and returns the recognized text.  Results 
+	/// for separate utterances are joined with spaces.
+	public static String decodeFile(Recognizer recognizer, 
+		StreamDataSource source, String filename) throws IOException
+	{
+		InputStream stream = openAudioFile(filename);
+
+		try
+		{
+			source.setInputStream(stream, filename);
+
+			// The end of the stream makes recognize return null.
+			String text = "";
+			Result result = recognizer.recognize();
+
+			while (null != result)
+			{
+				String s = result.getBestFinalResultNoFiller();
+
+				if (!s.equals(""))
+				{
+					text = text.equals("") ? s : text + " " + s;
+				}
+
+				result = recognizer.recognize();
+			}
+
+			return text;
+		}
+		finally
+		{
+			stream.close();
+		}
+	}
+
+	/// Returns the length of an audio file in seconds, assuming the 
+	/// format described in recognizeFile.
+	public static double getAudioFileDuration(String filename) 
+		throws IOException
+	{
+		File file = new File(filename);
+
+		if (!filename.toLowerCase().endsWith(".wav"))
+		{
+			// 16000 samples per second, 2 bytes per sample.
+			return file.length() / 32000.0;
+		}
+
+		try
+		{
+			AudioFileFormat format = AudioSystem.getAudioFileFormat(file);
+			return format.getFrameLength() 
+				/ (double)format.getFormat().getFrameRate();
+		}
+		catch (UnsupportedAudioFileException e)
+		{
+			throw new IOException("Unsupported audio file: " + filename);
+		}
+	}
+
+	/// Opens an audio file for recognition.  WAV files are opened through 
+	/// Java Sound, which skips the header; anything else is treated as 
+	/// raw samples.
+	static InputStream openAudioFile(String filename) 
+		throws IOException
+	{
+		File file = new File(filename);
+
+		if (!filename.toLowerCase().endsWith(".wav"))
+		{
+			return new BufferedInputStream(new FileInputStream(file));
+		}
+
+		try
+		{
+			AudioInputStream stream = AudioSystem.getAudioInputStream(file);
+			AudioFormat format = stream.getFormat();
+
+			if (16000 != (int)format.getSampleRate() 
+				|| 16 != format.getSampleSizeInBits() 
+				|| 1 != format.getChannels() 
+				|| format.isBigEndian() 
+				|| !AudioFormat.Encoding.PCM_SIGNED.equals(
+					format.getEncoding()))
+			{
+				Utils.log("warning", filename + " is not 16 kHz, 16-bit, " 
+					+ "signed, little-endian mono PCM.  Recognition " 
+					+ "results will be poor.");
+			}
+
+			return stream;
+		}
+		catch (UnsupportedAudioFileException e)
+		{
+			throw new IOException("Unsupported audio file: " + filename);
+		}
+	}
+
 	/// Enables and disables the speech recognizer.  Starts and stops the 
 	/// speech recognition thread.
 	public void setEnabled(boolean e)
 	{
-		if (e)
+		if (null == mMicrophone && null == mPushAudioSource)
 		{
-			Utils.log("debug", "Starting microphone...");
-			boolean success = mMicrophone.startRecording();
-			Utils.log("debug", "Microphone on");
+			// There is no recognition thread when reading from files.
+			return;
+		}
 
-			if (!success)
+		if (e)
+		{
+			if (null != mPushAudioSource)
 			{
-				Utils.log("warning", "Cannot initialize microphone. " + 
-					"Speech recognition disabled.");
-				return;
+				mPushAudioSource.start();
 			}
 			else
 			{
-				if (null != mRecognitionThread)
+				Utils.log("debug", "Starting microphone...");
+				boolean success = mMicrophone.startRecording();
+				Utils.log("debug", "Microphone on");
+
+				if (!success)
 				{
-					Utils.log("warning", "New recognition thread being " 
-						+ "created before the previous one finished.");
+					Utils.log("warning", "Cannot initialize microphone. " + 
+						"Speech recognition disabled.");
+					return;
 				}
+			}
 
-				mRecognitionThread = new Thread(this, "Recognition thread");
-
-				// Start running the recognition thread.
-				mRecognitionThreadEnabled = true;
-				mRecognitionThread.start();
+			if (null != mRecognitionThread)
+			{
+				Utils.log("warning", "New recognition thread being " 
+					+ "created before the previous one finished.");
 			}
+
+			mRecognitionThread = new Thread(this, "Recognition thread");
+
+			// Start running the recognition thread.
+			mRecognitionThreadEnabled = true;
+			mRecognitionThread.start();
 		}
 		else
 		{
-			Utils.log("debug", "Stopping microphone...");
-			mMicrophone.stopRecording();
-			Utils.log("debug", "Microphone off");
+			if (null != mPushAudioSource)
+			{
+				// This also ends the stream the recognition thread may 
+				// be waiting on.
+				mPushAudioSource.stop();
+			}
+			else
+			{
+				Utils.log("debug", "Stopping microphone...");
+				mMicrophone.stopRecording();
+				Utils.log("debug", "Microphone off");
+			}
 
 			// The following line indirectly stops the recognition thread 
 			// from running.  The next time the recognition thread checks 
@@ -222,16 +1366,34 @@ public class SpeechRecognizer implements Runnable
 			}
 
 			mRecognitionThread = null;
-			mMicrophone.clear();
+
+			if (null != mPushAudioSource)
+			{
+				mPushAudioSource.clear();
+			}
+			else
+			{
+				mMicrophone.clear();
+			}
 
 			Utils.log("debug", "Clearing recognized string queue");
 			mRecognizedStringQueue.clear();
+			mPartialResultQueue.clear();
 		}
 	}
 
 	/// Returns true if the recognizer is currently enabled.
 	public boolean isEnabled()
 	{
+		if (null != mPushAudioSource)
+		{
+			return mPushAudioSource.isStarted();
+		}
+		else if (null == mMicrophone)
+		{
+			return false;
+		}
+
 		return mMicrophone.isRecording();
 	}
 
@@ -243,6 +1405,11 @@ public class SpeechRecognizer implements Runnable
 		setEnabled(false);
 
 		// It should now be safe to deallocate the recognizer.
+		if (null != mWakeRecognizer)
+		{
+			mWakeRecognizer.deallocate();
+		}
+
 		mRecognizer.deallocate();
 	}
 }
@@ -23,6 +23,7 @@
 package voce;
 
 import java.io.File;
+import java.util.HashMap;
 import java.util.Locale;
 import java.beans.PropertyChangeEvent;
 import java.beans.PropertyChangeListener;
@@ -41,17 +42,100 @@ import javax.speech.synthesis.Speakable;
 import javax.speech.synthesis.SpeakableAdapter;
 import javax.speech.synthesis.SpeakableEvent;
 import com.sun.speech.freetts.jsapi.FreeTTSEngineCentral; 
+import com.sun.speech.freetts.VoiceManager;
+import com.sun.speech.freetts.lexicon.Lexicon;
 
 /// Handles all speech synthesis (i.e. text-to-speech) 
 /// functions.
 public class SpeechSynthesizer
 {
-	/// The speech Synthesizer instance.
+	/// The lexicon of each voice loaded by loadVoice, by lowercase voice 
+	/// name.  A lexicon is only read once it is loaded, so every 
+	/// instance of a voice shares one.
+	private static HashMap<String, Lexicon> mLexicons = 
+		new HashMap<String, Lexicon>();
+
+	/// The speech Synthesizer instance.  This is null when the audio 
+	/// device is not used.
 	private Synthesizer mSynthesizer = null;
 
+	/// The name of the voice.
+	private String mVoiceName;
+
+	/// The FreeTTS voice used by synthesizeToBuffer, which writes into 
+	/// mBufferPlayer instead of the audio device.  Loaded on first use.
+	private com.sun.speech.freetts.Voice mBufferVoice = null;
+	private volatile BufferAudioPlayer mBufferPlayer = null;
+
+	/// The synthesized phrases kept for reuse, or null if they are not 
+	/// kept.
+	private PhraseCache mPhraseCache = null;
+
+	/// Plays synthesize requests when the phrase cache is enabled, 
+	/// instead of mSynthesizer.
+	private PhrasePlayer mPlayer = null;
+
+	/// Renders phrases into the phrase cache in the background.  Created 
+	/// by the first preloadPhrases call.
+	private SynthesisPool mPool = null;
+
 	/// Constructs and initializes the speech synthesizer.
 	public SpeechSynthesizer(String name)
 	{
+		this(name, true);
+	}
+
+	/// Constructs and initializes the speech synthesizer.  If 
+	/// 'useAudioDevice' is false, no audio line is ever opened: 
+	/// synthesize requests are ignored and only synthesizeToBuffer 
+	/// works.
+	public SpeechSynthesizer(String name, boolean useAudioDevice)
+	{
+		this(name, useAudioDevice, 0);
+	}
+
+	/// Constructs and initializes the speech synthesizer.  If 
+	/// 'phraseCacheSize' is greater than 0, up to that many bytes of 
+	/// synthesized phrases are kept (see PhraseCache), and synthesize 
+	/// requests are played by a PhrasePlayer so that repeated phrases 
+	/// come from the cache too.  If the voice cannot be loaded for that, 
+	/// synthesize requests are played through JSAPI, as without the 
+	/// cache.
+	public SpeechSynthesizer(String name, boolean useAudioDevice, 
+		long phraseCacheSize)
+	{
+		mVoiceName = name;
+
+		if (phraseCacheSize > 0)
+		{
+			mPhraseCache = new PhraseCache(phraseCacheSize);
+		}
+
+		if (!useAudioDevice || null != mPhraseCache)
+		{
+			// Load the voice now.  Otherwise, the first synthesize 
+			// request in a user's app could be delayed.
+			if (createBufferVoice())
+			{
+				if (useAudioDevice)
+				{
+					mPlayer = new PhrasePlayer(this);
+				}
+
+				return;
+			}
+
+			if (!useAudioDevice)
+			{
+				return;
+			}
+
+			// Still speak through JSAPI, just without the cache.
+			Utils.log("warning", "Cannot load the voice for the phrase " 
+				+ "cache.  Synthesize requests will be played without " 
+				+ "caching them.");
+		}
+
 		// Create a default voice.
 		Voice theVoice = new Voice(name, 
 			Voice.GENDER_DONT_CARE, Voice.AGE_DONT_CARE, null);
@@ -104,6 +188,26 @@ public class SpeechSynthesizer
 	/// Deallocates voice synthesizer.
 	public void destroy()
 	{
+		if (null != mPool)
+		{
+			mPool.destroy();
+		}
+
+		if (null != mPlayer)
+		{
+			mPlayer.destroy();
+		}
+
+		if (null != mBufferVoice)
+		{
+			mBufferVoice.deallocate();
+		}
+
+		if (null == mSynthesizer)
+		{
+			return;
+		}
+
 		mSynthesizer.cancelAll();
 		
 		try
@@ -122,13 +226,220 @@ public class SpeechSynthesizer
 	{
 		//Utils.log("debug", "SpeechSynthesizer.speak: Adding message to speech queue: " + message);
 	
+		if (null != mPlayer)
+		{
+			mPlayer.speak(message);
+			return;
+		}
+
+		if (null == mSynthesizer)
+		{
+			Utils.log("warning", "synthesize called, but the " 
+				+ "synthesizer does not use the audio device.  Use " 
+				+ "synthesizeToBuffer.");
+			return;
+		}
+
 		// Note that the Synthesize class maintains its own internal queue.
 		mSynthesizer.speakPlainText(message, null);
 	}
 
+	/// Synthesizes a message right away into memory instead of playing 
+	/// it, and returns its 16-bit mono samples (see 
+	/// getBufferSampleRate), or null if it cannot be synthesized.  The 
+	/// calling thread waits until the whole message is synthesized.  
+	/// Messages queued by synthesize are not affected.  The samples may 
+	/// be shared with the phrase cache and must not be modified.
+	public short[] synthesizeToBuffer(String message)
+	{
+		// Look in the cache before waiting for the voice, which may be 
+		// busy with another message.
+		if (null != mPhraseCache)
+		{
+			short[] samples = mPhraseCache.get(mVoiceName, message);
+
+			if (null != samples)
+			{
+				return samples;
+			}
+		}
+
+		short[] samples = render(message);
+
+		if (null != mPhraseCache && null != samples)
+		{
+			mPhraseCache.put(mVoiceName, message, samples);
+		}
+
+		return samples;
+	}
+
+	/// Synthesizes a message with the FreeTTS voice and returns its 
+	/// samples, or null if it cannot be synthesized.
+	private synchronized short[] render(String message)
+	{
+		if (!createBufferVoice())
+		{
+			return null;
+		}
+
+		return render(mBufferVoice, mBufferPlayer, message);
+	}
+
+	/// Synthesizes a message with a voice loaded by loadVoice, which 
+	/// writes into 'player', and returns its samples, or null if it 
+	/// cannot be synthesized.
+	static short[] render(com.sun.speech.freetts.Voice voice, 
+		BufferAudioPlayer player, String message)
+	{
+		player.reset();
+
+		if (!voice.speak(message))
+		{
+			Utils.log("warning", "Cannot synthesize: " + message);
+			player.reset();
+			return null;
+		}
+
+		short[] samples = player.getSamples();
+		player.reset();
+		return samples;
+	}
+
+	/// Renders phrases into the phrase cache in the background, so that 
+	/// synthesizing them later starts right away.  They are rendered on 
+	/// a pool of 'numThreads' threads, each with its own voice, created 
+	/// by the first call.  Phrases that are already cached are skipped.  
+	/// Requires the phrase cache.
+	public synchronized void preloadPhrases(String[] phrases, 
+		int numThreads)
+	{
+		if (null == mPhraseCache)
+		{
+			Utils.log("warning", "preloadPhrases called, but there is no " 
+				+ "phrase cache to keep the phrases in.  Use the " 
+				+ "'phraseCacheSize' option.");
+			return;
+		}
+
+		if (null == mPool)
+		{
+			mPool = new SynthesisPool(mVoiceName, numThreads, 
+				mPhraseCache);
+		}
+
+		mPool.preload(phrases);
+	}
+
+	/// Returns the number of phrases given to preloadPhrases that have 
+	/// not been rendered yet.
+	public int getPreloadPendingCount()
+	{
+		SynthesisPool pool = mPool;
+		return null == pool ? 0 : pool.getPendingCount();
+	}
+
+	/// Returns the phrase cache's counters (see PhraseCache.getStats), 
+	/// or null if there is no phrase cache.
+	public long[] getPhraseCacheStats()
+	{
+		if (null == mPhraseCache)
+		{
+			return null;
+		}
+
+		return mPhraseCache.getStats();
+	}
+
+	/// Returns the sample rate, in Hz, of the samples returned by 
+	/// synthesizeToBuffer, or 0 if the voice cannot be loaded.  Does not 
+	/// wait for a message being synthesized.
+	public int getBufferSampleRate()
+	{
+		if (null == mBufferPlayer && !createBufferVoice())
+		{
+			return 0;
+		}
+
+		return mBufferPlayer.getSampleRate();
+	}
+
+	/// Loads the FreeTTS voice used by synthesizeToBuffer.  Returns false 
+	/// if there is no voice with this synthesizer's name.
+	private synchronized boolean createBufferVoice()
+	{
+		if (null != mBufferPlayer)
+		{
+			return true;
+		}
+
+		BufferAudioPlayer player = new BufferAudioPlayer();
+		mBufferVoice = loadVoice(mVoiceName, player);
+
+		if (null == mBufferVoice)
+		{
+			return false;
+		}
+
+		mBufferPlayer = player;
+		return true;
+	}
+
+	/// Loads a new instance of the named FreeTTS voice that writes into 
+	/// 'player' instead of the audio device.  Returns null if there is 
+	/// no such voice.  Instances of the same voice share its lexicon, 
+	/// which is only loaded by the first.  The caller deallocates the 
+	/// voice.
+	static synchronized com.sun.speech.freetts.Voice loadVoice(
+		String name, BufferAudioPlayer player)
+	{
+		com.sun.speech.freetts.Voice[] voices = 
+			VoiceManager.getInstance().getVoices();
+
+		for (int i = 0; i < voices.length; ++i)
+		{
+			// The JSAPI voice names are capitalized; the FreeTTS ones 
+			// are not.
+			if (voices[i].getName().equalsIgnoreCase(name))
+			{
+				String key = name.toLowerCase();
+				Lexicon lexicon = mLexicons.get(key);
+
+				if (null != lexicon)
+				{
+					voices[i].setLexicon(lexicon);
+				}
+
+				voices[i].setAudioPlayer(player);
+				voices[i].allocate();
+
+				if (null == lexicon)
+				{
+					mLexicons.put(key, voices[i].getLexicon());
+				}
+
+				return voices[i];
+			}
+		}
+
+		Utils.log("ERROR", "Cannot find the voice " + name 
+			+ " for synthesizing into memory.");
+		return null;
+	}
+
 	/// Checks whether the synthesizer is currently active.
 	public boolean isSynthesizing()
 	{
+		if (null != mPlayer)
+		{
+			return mPlayer.isPlaying();
+		}
+
+		if (null == mSynthesizer)
+		{
+			return false;
+		}
+
 		if ((mSynthesizer.getEngineState() & Synthesizer.QUEUE_NOT_EMPTY)
 			 == Synthesizer.QUEUE_NOT_EMPTY)
 		{
@@ -144,6 +455,14 @@ public class SpeechSynthesizer
 	/// messages from the queue.
 	public void stopSynthesizing()
 	{
-		mSynthesizer.cancelAll();
+		if (null != mPlayer)
+		{
+			mPlayer.cancelAll();
+		}
+
+		if (null != mSynthesizer)
+		{
+			mSynthesizer.cancelAll();
+		}
 	}
 }
@@ -0,0 +1,270 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.File;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.lang.management.ManagementFactory;
+import java.lang.management.MemoryPoolMXBean;
+import java.lang.management.MemoryType;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Properties;
+
+/// A command line tool that measures how long the recognizer takes to 
+/// start and how much heap it needs, with and without the search graph 
+/// cache (the 'grammarCache' option of SpeechInterface.init), the 
+/// memory-mapped dictionary (the 'dictionary' option) and dictionary 
+/// pruning (the 'pruneDictionary' option).  Usage:
+///
+/// java -cp voce.jar voce.StartupBenchmark [options] outputFile
+///
+/// Each mode creates a recognizer that reads audio files, so no 
+/// microphone is needed, and destroys it again.  One recognizer is 
+/// created and destroyed first without being measured, so that every 
+/// mode runs with the classes already loaded.  The results are written 
+/// as CSV: the startup time, the peak heap used while starting (the sum 
+/// of each heap pool's peak), and the heap the recognizer still uses 
+/// once it has started.  Modes:
+///
+/// compile - The search graph is compiled, as without the cache.
+/// cacheWrite - The graph is compiled and written to an empty cache.
+/// cacheRead - The graph is read from the cache written by cacheWrite.
+/// prunedDictionary - Like compile, but only the grammar's words are 
+///   read from the text dictionary.
+/// mappedDictionary - Like compile, but the words are read from the 
+///   compiled dictionary given by -dictionary instead of the text 
+///   dictionary.  Only run when -dictionary is given.
+///
+/// Options:
+///
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -grammarPath path - Where to find the grammar (default: ./).
+/// -grammarName name - The grammar to load (default: digits).
+/// -cacheDirectory dir - The cache directory for cacheWrite and 
+///   cacheRead (default: startupBenchmarkCache).  Its .graph files are 
+///   deleted first.
+/// -dictionary file - A dictionary written by DictionaryCompiler, for 
+///   the mappedDictionary mode.
+public class StartupBenchmark
+{
+	public static void main(String[] args)
+	{
+		String configFilename = "voce.config.xml";
+		String grammarPath = "./";
+		String grammarName = "";
+		String cacheDirectory = "startupBenchmarkCache";
+		String dictionaryFile = null;
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-grammarPath") && i + 1 < args.length)
+			{
+				grammarPath = args[++i];
+			}
+			else if (args[i].equals("-grammarName") && i + 1 < args.length)
+			{
+				grammarName = args[++i];
+			}
+			else if (args[i].equals("-cacheDirectory") 
+				&& i + 1 < args.length)
+			{
+				cacheDirectory = args[++i];
+			}
+			else if (args[i].equals("-dictionary") && i + 1 < args.length)
+			{
+				dictionaryFile = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 1)
+		{
+			System.out.println("Usage: java voce.StartupBenchmark " 
+				+ "[-config file] [-grammarPath path] [-grammarName name] " 
+				+ "[-cacheDirectory dir] [-dictionary file] outputFile");
+			System.exit(1);
+		}
+
+		PrintWriter out = null;
+
+		try
+		{
+			out = new PrintWriter(new FileWriter(positional.get(0)));
+			out.println("mode,startupMillis,peakHeapMB,heapMB");
+
+			Properties warmUp = new Properties();
+			warmUp.setProperty("audioInput", "file");
+			new SpeechRecognizer(configFilename, grammarPath, grammarName, 
+				warmUp).destroy();
+
+			ArrayList<String> modes = new ArrayList<String>();
+			modes.add("compile");
+			modes.add("cacheWrite");
+			modes.add("cacheRead");
+			modes.add("prunedDictionary");
+
+			if (null != dictionaryFile)
+			{
+				modes.add("mappedDictionary");
+			}
+
+			for (int i = 0; i < modes.size(); ++i)
+			{
+				String mode = modes.get(i);
+				Properties options = new Properties();
+				options.setProperty("audioInput", "file");
+
+				if (mode.startsWith("cache"))
+				{
+					options.setProperty("grammarCache", cacheDirectory);
+				}
+
+				if (mode.equals("cacheWrite"))
+				{
+					deleteGraphFiles(cacheDirectory);
+				}
+
+				if (mode.equals("prunedDictionary"))
+				{
+					options.setProperty("pruneDictionary", "true");
+				}
+
+				if (mode.equals("mappedDictionary"))
+				{
+					options.setProperty("dictionary", dictionaryFile);
+				}
+
+				String row = measureStartup(configFilename, grammarPath, 
+					grammarName, options);
+				out.println(mode + "," + row);
+				out.flush();
+				Utils.log("", mode + ": " + row);
+			}
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+		}
+
+		System.exit(0);
+	}
+
+	/// Creates a recognizer with the given options and destroys it 
+	/// again.  Returns the startup time in milliseconds, the peak heap 
+	/// used while starting and the heap used once started, in 
+	/// megabytes, as CSV columns.
+	static String measureStartup(String configFilename, 
+		String grammarPath, String grammarName, Properties options)
+	{
+		List<MemoryPoolMXBean> pools = getHeapPools();
+		long usedBefore = getUsedHeap();
+
+		for (int i = 0; i < pools.size(); ++i)
+		{
+			pools.get(i).resetPeakUsage();
+		}
+
+		long startTime = System.nanoTime();
+		SpeechRecognizer recognizer = new SpeechRecognizer(configFilename, 
+			grammarPath, grammarName, options);
+		double startupMillis = (System.nanoTime() - startTime) / 1e6;
+		long peak = 0;
+
+		for (int i = 0; i < pools.size(); ++i)
+		{
+			peak += pools.get(i).getPeakUsage().getUsed();
+		}
+
+		long used = getUsedHeap() - usedBefore;
+		recognizer.destroy();
+
+		return startupMillis + "," + peak / 1048576.0 + "," 
+			+ used / 1048576.0;
+	}
+
+	/// Returns the heap in use after a garbage collection, in bytes.
+	private static long getUsedHeap()
+	{
+		Runtime runtime = Runtime.getRuntime();
+		System.gc();
+		System.gc();
+		return runtime.totalMemory() - runtime.freeMemory();
+	}
+
+	/// Returns the memory pools that make up the heap.
+	private static List<MemoryPoolMXBean> getHeapPools()
+	{
+		List<MemoryPoolMXBean> all = 
+			ManagementFactory.getMemoryPoolMXBeans();
+		List<MemoryPoolMXBean> heap = new ArrayList<MemoryPoolMXBean>();
+
+		for (int i = 0; i < all.size(); ++i)
+		{
+			if (MemoryType.HEAP == all.get(i).getType())
+			{
+				heap.add(all.get(i));
+			}
+		}
+
+		return heap;
+	}
+
+	/// Deletes the cached search graphs in 'directory'.
+	private static void deleteGraphFiles(String directory)
+	{
+		File[] files = new File(directory).listFiles();
+
+		if (null == files)
+		{
+			return;
+		}
+
+		for (int i = 0; i < files.length; ++i)
+		{
+			if (files[i].getName().endsWith(".graph"))
+			{
+				files[i].delete();
+			}
+		}
+	}
+}
@@ -0,0 +1,248 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+
+/// A command line tool that measures how many streams can be recognized 
+/// in real time per CPU core when the streams share one acoustic model 
+/// (see StreamServer).  For 1, 2, 4 and so on up to the maximum number 
+/// of streams, every stream decodes the same audio files at the same 
+/// time, and the slowest stream's real-time factor (decoding time 
+/// divided by audio length) is recorded.  A stream count keeps up with 
+/// live audio if that factor is at most 1.  Usage:
+///
+/// java -cp voce.jar voce.StreamBenchmark [options] fileList outputFile
+///
+/// 'fileList' is a text file naming one audio file per line (see 
+/// SpeechRecognizer.recognizeFile for the supported formats).  The 
+/// results are written as CSV.  Options:
+///
+/// -maxStreams N - Largest number of streams (default: 4 per CPU).
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -grammarPath path - Directory containing grammar files.
+/// -grammarName name - Grammar to use (default: the digits grammar).
+public class StreamBenchmark
+{
+	/// The audio files each stream decodes.
+	private String[] mFilenames;
+
+	/// The recognizers, one per stream.
+	private RecognizerPool mPool;
+
+	public static void main(String[] args)
+	{
+		int numCpus = Runtime.getRuntime().availableProcessors();
+		int maxStreams = 4 * numCpus;
+		String configFilename = "voce.config.xml";
+		String grammarPath = "./";
+		String grammarName = "";
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-maxStreams") && i + 1 < args.length)
+			{
+				maxStreams = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-grammarPath") && i + 1 < args.length)
+			{
+				grammarPath = args[++i];
+			}
+			else if (args[i].equals("-grammarName") && i + 1 < args.length)
+			{
+				grammarName = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 2 || maxStreams < 1)
+		{
+			System.out.println("Usage: java voce.StreamBenchmark " 
+				+ "[-maxStreams N] [-config file] [-grammarPath path] " 
+				+ "[-grammarName name] fileList outputFile");
+			System.exit(1);
+		}
+
+		try
+		{
+			Utils.log("", "Initializing " + maxStreams + " recognizers. " 
+				+ "This may take some time...");
+			StreamBenchmark benchmark = new StreamBenchmark();
+			benchmark.mFilenames = BatchRecognizer.readFileList(
+				positional.get(0));
+			benchmark.mPool = new RecognizerPool(configFilename, 
+				grammarPath, grammarName, maxStreams);
+			benchmark.run(positional.get(1), numCpus);
+			benchmark.mPool.deallocate();
+		}
+		catch (Exception e)
+		{
+			Utils.log("ERROR", "Stream benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+
+		System.exit(0);
+	}
+
+	/// Runs the benchmark for each stream count and writes the results 
+	/// to 'outputFilename'.
+	private void run(String outputFilename, int numCpus) throws IOException
+	{
+		PrintWriter out = new PrintWriter(new FileWriter(outputFilename));
+		int realTimeStreams = 0;
+
+		try
+		{
+			out.println("streams,cpus,audioSeconds,wallSeconds," 
+				+ "worstRealTimeFactor,meanRealTimeFactor");
+
+			for (int streams = 1; streams <= mPool.size(); 
+				streams = nextCount(streams, mPool.size()))
+			{
+				double[] factors = new double[streams];
+				long startTime = System.nanoTime();
+				double audioSeconds = decodeStreams(factors);
+				double wallSeconds = (System.nanoTime() - startTime) / 1e9;
+				double worst = 0;
+				double total = 0;
+
+				for (int i = 0; i < streams; ++i)
+				{
+					worst = Math.max(worst, factors[i]);
+					total += factors[i];
+				}
+
+				out.println(streams + "," + numCpus + "," + audioSeconds 
+					+ "," + wallSeconds + "," + worst + "," 
+					+ total / streams);
+				out.flush();
+				Utils.log("", streams + " streams: worst real-time factor " 
+					+ worst);
+
+				if (worst <= 1)
+				{
+					realTimeStreams = streams;
+				}
+			}
+		}
+		finally
+		{
+			out.close();
+		}
+
+		Utils.log("", "Up to " + realTimeStreams + " streams (" 
+			+ (double) realTimeStreams / numCpus 
+			+ " per core) run in real time");
+	}
+
+	/// Decodes all files on the first factors.length recognizers at 
+	/// once, storing each stream's real-time factor in 'factors'.  
+	/// Returns the length of the audio decoded by each stream.
+	private double decodeStreams(final double[] factors)
+	{
+		final double[] audioSeconds = new double[factors.length];
+		Thread[] threads = new Thread[factors.length];
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			final int index = i;
+
+			threads[i] = new Thread(new Runnable()
+				{
+					public void run()
+					{
+						long startTime = System.nanoTime();
+						audioSeconds[index] = decodeFiles(index);
+						double decodeSeconds = (System.nanoTime() 
+							- startTime) / 1e9;
+						factors[index] = audioSeconds[index] > 0 
+							? decodeSeconds / audioSeconds[index] : 0;
+					}
+				}, "Benchmark stream " + i);
+			threads[i].start();
+		}
+
+		for (int i = 0; i < threads.length; ++i)
+		{
+			try
+			{
+				threads[i].join();
+			}
+			catch (InterruptedException e)
+			{
+			}
+		}
+
+		return audioSeconds[0];
+	}
+
+	/// Decodes every file with the given recognizer and returns the 
+	/// total length of the audio in seconds.
+	private double decodeFiles(int recognizerIndex)
+	{
+		double audioSeconds = 0;
+
+		for (int i = 0; i < mFilenames.length; ++i)
+		{
+			try
+			{
+				audioSeconds += SpeechRecognizer.getAudioFileDuration(
+					mFilenames[i]);
+				SpeechRecognizer.decodeFile(
+					mPool.getRecognizer(recognizerIndex), 
+					mPool.getDataSource(recognizerIndex), mFilenames[i]);
+			}
+			catch (IOException e)
+			{
+				Utils.log("warning", "Cannot decode " + mFilenames[i] 
+					+ ": " + e.getMessage());
+			}
+		}
+
+		return audioSeconds;
+	}
+
+	/// Returns the stream count after 'streams': the next power of two, 
+	/// or 'max' if that is smaller.
+	private static int nextCount(int streams, int max)
+	{
+		if (streams == max)
+		{
+			return max + 1;
+		}
+
+		return Math.min(streams * 2, max);
+	}
+}
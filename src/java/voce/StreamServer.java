@@ -0,0 +1,358 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import edu.cmu.sphinx.recognizer.Recognizer;
+import edu.cmu.sphinx.result.Result;
+import edu.cmu.sphinx.util.props.PropertyException;
+
+import java.io.IOException;
+import java.util.Properties;
+
+/// Serves many audio streams at once from a single copy of the acoustic 
+/// model, dictionary and LogMath tables.  Each stream has its own 
+/// grammar, decoder and front end state (see RecognizerPool).  A fixed 
+/// number of recognizers is created up front: createStream hands out an 
+/// idle one and starts its recognition thread, and destroyStream gives 
+/// it back.  Audio is pushed to each stream from native code through 
+/// its own ring buffer (see PushAudioSource), so this is only usable 
+/// through the C++ interface.
+///
+/// The server's lock only guards which streams are in use.  Loading a 
+/// grammar and stopping a recognition thread can take a long time, so 
+/// they are done without it; a stream being started or stopped is 
+/// reserved so no other call takes it meanwhile.
+public class StreamServer
+{
+	/// The maximum number of streams.  The C++ interface has a push 
+	/// audio buffer for each, plus one for the single recognizer.
+	public static final int MAX_STREAMS = 255;
+
+	/// The number of recognized strings kept for each stream.  The 
+	/// oldest are dropped when a stream's queue is full.
+	private static final int RESULT_QUEUE_CAPACITY = 64;
+
+	/// The init options that only apply to the single recognizer.  A 
+	/// warning is logged for each one given with 'streams'.
+	private static final String[] UNSUPPORTED_OPTIONS = 
+	{
+		"queueCapacity", "queueOverflow", "audioInput", "searchProfile", 
+		"dictionary", "pruneDictionary", "grammarCache", "partialResults", 
+		"scorerThreads", "scorerPriority", "scorerAffinity", 
+		"scorerAutoTune", "wakePhrase", "wakeUtterances", "nativeFrontEnd", 
+		"featureCache"
+	};
+
+	/// A recognizer from the pool, and the thread that decodes its 
+	/// stream while it is in use.
+	private static class Stream implements Runnable
+	{
+		Recognizer recognizer;
+		PushAudioSource source;
+		StringQueue results = new StringQueue(RESULT_QUEUE_CAPACITY, 
+			StringQueue.DROP_OLDEST);
+		String grammarName;
+
+		/// True while the stream is started, in use or being stopped.  
+		/// Only changed while holding the server's lock.
+		boolean reserved = false;
+
+		/// True while the stream's handle is valid.  Only changed while 
+		/// holding the server's lock.
+		boolean inUse = false;
+		volatile boolean running = false;
+		Thread thread = null;
+
+		public void run()
+		{
+			while (running)
+			{
+				Result result = recognizer.recognize();
+
+				if (null != result)
+				{
+					String s = result.getBestFinalResultNoFiller();
+
+					if (!s.equals(""))
+					{
+						results.add(s);
+					}
+				}
+			}
+		}
+	}
+
+	/// The recognizers, or null if they could not be created.
+	private RecognizerPool mPool = null;
+
+	/// The streams; the handle of stream i is i + 1, which is also the 
+	/// number of its push audio buffer.
+	private Stream[] mStreams = new Stream[0];
+
+	/// The directory in which grammars are found.
+	private String mGrammarPath;
+
+	/// Held while loading a grammar.  The streams share the configuration 
+	/// manager and dictionary, so grammars are loaded one at a time, but 
+	/// without blocking the streams that are already running.
+	private final Object mGrammarLock = new Object();
+
+	/// Creates 'numStreams' recognizers, all starting with the given 
+	/// grammar.  'grammarPath' and 'grammarName' are the same as for 
+	/// SpeechRecognizer.  Of the recognizer's init options in 'options' 
+	/// (see SpeechInterface.init), only 'pushBufferSize' is used.
+	public StreamServer(String configFilename, String grammarPath, 
+		String grammarName, int numStreams, Properties options)
+	{
+		mGrammarPath = grammarPath;
+
+		for (int i = 0; i < UNSUPPORTED_OPTIONS.length; ++i)
+		{
+			if (null != options.getProperty(UNSUPPORTED_OPTIONS[i]))
+			{
+				Utils.log("warning", "The '" + UNSUPPORTED_OPTIONS[i] 
+					+ "' init option is not supported with 'streams' " 
+					+ "and will be ignored.");
+			}
+		}
+
+		if (numStreams > MAX_STREAMS)
+		{
+			Utils.log("warning", "At most " + MAX_STREAMS 
+				+ " streams are supported.");
+			numStreams = MAX_STREAMS;
+		}
+
+		try
+		{
+			mPool = new RecognizerPool(configFilename, grammarPath, 
+				grammarName, numStreams, true, true, 
+				Utils.getIntOption(options, "pushBufferSize", 0));
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Cannot load stream recognizers: ");
+			e.printStackTrace();
+			return;
+		}
+		catch (PropertyException e)
+		{
+			Utils.log("ERROR", "Cannot configure stream recognizers: ");
+			e.printStackTrace();
+			return;
+		}
+		catch (InstantiationException e)
+		{
+			Utils.log("ERROR", "Cannot create stream recognizers: ");
+			e.printStackTrace();
+			return;
+		}
+
+		mStreams = new Stream[numStreams];
+
+		for (int i = 0; i < numStreams; ++i)
+		{
+			mStreams[i] = new Stream();
+			mStreams[i].recognizer = mPool.getRecognizer(i);
+			mStreams[i].source = mPool.getPushAudioSource(i);
+			mStreams[i].grammarName = grammarName;
+		}
+	}
+
+	/// Returns the number of streams that can be used at once.
+	public int getMaxStreams()
+	{
+		return mStreams.length;
+	}
+
+	/// Starts recognizing a new stream with the given grammar, or with 
+	/// the grammar it was last used with if 'grammarName' is empty.  
+	/// Returns the stream's handle, or -1 if all streams are in use or 
+	/// the grammar cannot be loaded.
+	public int createStream(String grammarName)
+	{
+		int i = reserveStream();
+
+		if (-1 == i)
+		{
+			Utils.log("warning", "All " + mStreams.length 
+				+ " streams are in use.");
+			return -1;
+		}
+
+		Stream stream = mStreams[i];
+
+		if (!grammarName.equals("") && !grammarName.equals(
+			stream.grammarName))
+		{
+			try
+			{
+				synchronized (mGrammarLock)
+				{
+					mPool.setGrammar(i, mGrammarPath, grammarName);
+				}
+
+				stream.grammarName = grammarName;
+			}
+			catch (IOException e)
+			{
+				Utils.log("ERROR", "Cannot load grammar: " + grammarName);
+				e.printStackTrace();
+				releaseStream(stream);
+				return -1;
+			}
+			catch (PropertyException e)
+			{
+				Utils.log("ERROR", "Cannot configure grammar: " 
+					+ grammarName);
+				e.printStackTrace();
+				releaseStream(stream);
+				return -1;
+			}
+		}
+
+		stream.source.start();
+		stream.running = true;
+		stream.thread = new Thread(stream, "Recognition thread " + (i + 1));
+		stream.thread.start();
+
+		synchronized (this)
+		{
+			stream.inUse = true;
+		}
+
+		return i + 1;
+	}
+
+	/// Stops recognizing a stream and makes it available to createStream 
+	/// again.  Audio and results that have not been read are discarded.
+	public void destroyStream(int handle)
+	{
+		Stream stream;
+
+		synchronized (this)
+		{
+			stream = getStream(handle);
+
+			if (null == stream)
+			{
+				Utils.log("warning", "destroyStream called with an " 
+					+ "unknown stream: " + handle);
+				return;
+			}
+
+			// The stream stays reserved until its thread has stopped.
+			stream.inUse = false;
+		}
+
+		// This ends the utterance the thread may be waiting on.
+		stream.running = false;
+		stream.source.stop();
+
+		try
+		{
+			stream.thread.join();
+		}
+		catch (InterruptedException e)
+		{
+		}
+
+		stream.thread = null;
+		stream.source.clear();
+		stream.results.clear();
+		releaseStream(stream);
+	}
+
+	/// Returns and removes the oldest string recognized in the given 
+	/// stream.  Returns an empty string if there is none.
+	public String popResult(int handle)
+	{
+		Stream stream = getStream(handle);
+
+		if (null == stream)
+		{
+			return "";
+		}
+
+		String s = stream.results.poll();
+
+		if (null == s)
+		{
+			return "";
+		}
+
+		return s;
+	}
+
+	/// Stops all streams and deallocates the recognizers.
+	public void destroy()
+	{
+		for (int i = 0; i < mStreams.length; ++i)
+		{
+			if (null != getStream(i + 1))
+			{
+				destroyStream(i + 1);
+			}
+		}
+
+		if (null != mPool)
+		{
+			mPool.deallocate();
+		}
+	}
+
+	/// Reserves a stream that is not in use and returns its index, or 
+	/// -1 if all streams are in use.
+	private synchronized int reserveStream()
+	{
+		for (int i = 0; i < mStreams.length; ++i)
+		{
+			if (!mStreams[i].reserved)
+			{
+				mStreams[i].reserved = true;
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	/// Makes a reserved stream available to createStream again.
+	private synchronized void releaseStream(Stream stream)
+	{
+		stream.reserved = false;
+	}
+
+	/// Returns the stream with the given handle, or null if there is no 
+	/// such stream in use.
+	private synchronized Stream getStream(int handle)
+	{
+		if (handle < 1 || handle > mStreams.length 
+			|| !mStreams[handle - 1].inUse)
+		{
+			return null;
+		}
+
+		return mStreams[handle - 1];
+	}
+}
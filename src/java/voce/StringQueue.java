@@ -0,0 +1,288 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.util.List;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+
+/// A thread-safe first-in-first-out queue of Strings, used to pass 
+/// recognized strings from the recognition thread to the application.  
+/// Adding and removing never lock; a lock is only taken to put a 
+/// consumer to sleep when it waits on an empty queue, and by the 
+/// producer only when a consumer is actually waiting.  The queue can 
+/// have a maximum capacity, with an overflow policy deciding what gets 
+/// dropped when it is full.  Only one thread may add strings.
+public class StringQueue
+{
+	/// Overflow policy: remove the oldest strings to make room.
+	public static final int DROP_OLDEST = 0;
+
+	/// Overflow policy: discard the string being added.
+	public static final int DROP_NEWEST = 1;
+
+	/// Overflow policy: discard a string if an identical one is already 
+	/// queued, and otherwise remove the oldest strings to make room.  
+	/// Duplicates are discarded even when the queue is not full.
+	public static final int COALESCE = 2;
+
+	/// The queued strings.  ConcurrentLinkedQueue is a non-blocking 
+	/// linked queue.
+	private ConcurrentLinkedQueue<String> mQueue = 
+		new ConcurrentLinkedQueue<String>();
+
+	/// The number of queued strings.  Kept separately because 
+	/// ConcurrentLinkedQueue.size walks the whole queue.  It is counted 
+	/// up before a string is queued and down after it is removed, so it 
+	/// is never below the real number.
+	private AtomicInteger mSize = new AtomicInteger(0);
+
+	/// The queued strings again, so that the COALESCE policy can find 
+	/// duplicates without walking the queue.  A string is added to the 
+	/// set before it is queued and removed after it is taken out.  This 
+	/// is null with the other policies.
+	private ConcurrentHashMap<String, Boolean> mQueuedStrings = null;
+
+	/// The number of consumers waiting in poll(int).
+	private AtomicInteger mNumWaiters = new AtomicInteger(0);
+
+	/// The monitor waiting consumers sleep on.
+	private Object mWaitLock = new Object();
+
+	/// The maximum number of queued strings, or 0 for no limit.
+	private int mCapacity = 0;
+
+	/// What to do when a string is added to a full queue.
+	private int mOverflowPolicy = DROP_OLDEST;
+
+	/// The number of strings dropped by the overflow policy.
+	private AtomicLong mDropCount = new AtomicLong(0);
+
+	/// Creates an unbounded queue.
+	public StringQueue()
+	{
+	}
+
+	/// Creates a queue holding at most 'capacity' strings (0 means no 
+	/// limit) that handles overflow according to 'overflowPolicy'.
+	public StringQueue(int capacity, int overflowPolicy)
+	{
+		mCapacity = Math.max(capacity, 0);
+		mOverflowPolicy = overflowPolicy;
+
+		if (COALESCE == mOverflowPolicy)
+		{
+			mQueuedStrings = new ConcurrentHashMap<String, Boolean>();
+		}
+	}
+
+	/// Returns the overflow policy constant with the given name 
+	/// ("dropOldest", "dropNewest" or "coalesce"), or -1 if the name is 
+	/// not recognized.
+	public static int parseOverflowPolicy(String name)
+	{
+		if (name.equalsIgnoreCase("dropOldest"))
+		{
+			return DROP_OLDEST;
+		}
+		else if (name.equalsIgnoreCase("dropNewest"))
+		{
+			return DROP_NEWEST;
+		}
+		else if (name.equalsIgnoreCase("coalesce"))
+		{
+			return COALESCE;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	/// Adds a string to the end of the queue, applying the overflow 
+	/// policy if the queue is full.
+	public void add(String s)
+	{
+		if (null != mQueuedStrings 
+			&& null != mQueuedStrings.putIfAbsent(s, Boolean.TRUE))
+		{
+			mDropCount.incrementAndGet();
+			return;
+		}
+
+		if (mCapacity > 0)
+		{
+			if (DROP_NEWEST == mOverflowPolicy)
+			{
+				// Consumers only ever shrink the queue, so this check 
+				// stays valid until the string is added.
+				if (mSize.get() >= mCapacity)
+				{
+					mDropCount.incrementAndGet();
+					return;
+				}
+			}
+			else
+			{
+				while (mSize.get() >= mCapacity && null != poll())
+				{
+					mDropCount.incrementAndGet();
+				}
+			}
+		}
+
+		mSize.incrementAndGet();
+		mQueue.offer(s);
+
+		// Waiters register themselves before checking the queue, so 
+		// either they see this string or we see them here.
+		if (mNumWaiters.get() > 0)
+		{
+			synchronized (mWaitLock)
+			{
+				mWaitLock.notifyAll();
+			}
+		}
+	}
+
+	/// Returns and removes the oldest string, or returns null if the 
+	/// queue is empty.
+	public String poll()
+	{
+		String s = mQueue.poll();
+
+		if (null != s)
+		{
+			if (null != mQueuedStrings)
+			{
+				mQueuedStrings.remove(s);
+			}
+
+			mSize.decrementAndGet();
+		}
+
+		return s;
+	}
+
+	/// Returns and removes the oldest string, waiting up to 'timeoutMs' 
+	/// milliseconds for one to be added if the queue is empty.  Returns 
+	/// null if the timeout expires first.
+	public String poll(int timeoutMs)
+	{
+		String s = poll();
+
+		if (null != s || timeoutMs <= 0)
+		{
+			return s;
+		}
+
+		long deadline = System.currentTimeMillis() + timeoutMs;
+		mNumWaiters.incrementAndGet();
+
+		try
+		{
+			synchronized (mWaitLock)
+			{
+				while (true)
+				{
+					s = poll();
+
+					if (null != s)
+					{
+						return s;
+					}
+
+					long remaining = deadline - System.currentTimeMillis();
+
+					if (remaining <= 0)
+					{
+						return null;
+					}
+
+					mWaitLock.wait(remaining);
+				}
+			}
+		}
+		catch (InterruptedException exception)
+		{
+			return null;
+		}
+		finally
+		{
+			mNumWaiters.decrementAndGet();
+		}
+	}
+
+	/// Removes every queued string and appends them, oldest first, to 
+	/// 'strings'.  Returns the number of strings moved.  This is not 
+	/// atomic: strings are removed one at a time, so strings added 
+	/// meanwhile may or may not be included, and other consumers may 
+	/// take some of the strings at the same time.  Each string is still 
+	/// returned by exactly one call.
+	public int drainTo(List<String> strings)
+	{
+		int count = 0;
+		String s = poll();
+
+		while (null != s)
+		{
+			strings.add(s);
+			++count;
+			s = poll();
+		}
+
+		return count;
+	}
+
+	/// Returns the number of queued strings.  The count goes up just 
+	/// before each string is added and down just after each one is 
+	/// removed, so while other threads use the queue it can be too high 
+	/// by the number of calls in progress, but it is never negative.
+	public int size()
+	{
+		return mSize.get();
+	}
+
+	/// Returns the number of strings dropped by the overflow policy 
+	/// since the queue was created.
+	public long getDropCount()
+	{
+		return mDropCount.get();
+	}
+
+	/// Returns true if the queue is empty.
+	public boolean isEmpty()
+	{
+		return mQueue.isEmpty();
+	}
+
+	/// Removes all queued strings.
+	public void clear()
+	{
+		while (null != poll())
+		{
+		}
+	}
+}
@@ -0,0 +1,174 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+
+/// A command line tool that measures how fast the synthesizer produces 
+/// speech into memory (see SpeechSynthesizer.synthesizeToBuffer), in 
+/// seconds of audio per wall-clock second.  No audio device is needed.  
+/// Usage:
+///
+/// java -cp voce.jar voce.SynthesisBenchmark [options] textFile 
+///   outputFile
+///
+/// Each non-blank line of the text file is synthesized once untimed, to 
+/// warm up, and then timed.  For each line the results are written as 
+/// CSV: the seconds of audio, the wall-clock seconds it took, and their 
+/// ratio; a last 'total' row covers all of the lines.  Options:
+///
+/// -voice name - The voice to synthesize with (default: Kevin16).
+/// -repeat n - The number of timed passes over each line (default: 3).
+/// -phraseCacheSize kb - Keep synthesized phrases, as with the 
+///   'phraseCacheSize' option of SpeechInterface.init, so that the 
+///   timed passes measure the phrase cache (default: 0).
+public class SynthesisBenchmark
+{
+	public static void main(String[] args)
+	{
+		String voiceName = "Kevin16";
+		int repeat = 3;
+		int phraseCacheSize = 0;
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-voice") && i + 1 < args.length)
+			{
+				voiceName = args[++i];
+			}
+			else if (args[i].equals("-repeat") && i + 1 < args.length)
+			{
+				repeat = Integer.parseInt(args[++i]);
+			}
+			else if (args[i].equals("-phraseCacheSize") 
+				&& i + 1 < args.length)
+			{
+				phraseCacheSize = Integer.parseInt(args[++i]);
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 2 || repeat < 1)
+		{
+			System.out.println("Usage: java voce.SynthesisBenchmark " 
+				+ "[-voice name] [-repeat n] [-phraseCacheSize kb] " 
+				+ "textFile outputFile");
+			System.exit(1);
+		}
+
+		SpeechSynthesizer synthesizer = new SpeechSynthesizer(voiceName, 
+			false, 1024L * phraseCacheSize);
+		int sampleRate = synthesizer.getBufferSampleRate();
+
+		if (sampleRate <= 0)
+		{
+			System.exit(1);
+		}
+
+		PrintWriter out = null;
+
+		try
+		{
+			String[] lines = BatchRecognizer.readFileList(
+				positional.get(0));
+			out = new PrintWriter(new FileWriter(positional.get(1)));
+			out.println("text,audioSeconds,wallSeconds," 
+				+ "audioSecondsPerSecond");
+
+			double totalAudioSeconds = 0;
+			double totalWallSeconds = 0;
+
+			for (int i = 0; i < lines.length; ++i)
+			{
+				synthesizer.synthesizeToBuffer(lines[i]);
+
+				double audioSeconds = 0;
+				long startTime = System.nanoTime();
+
+				for (int j = 0; j < repeat; ++j)
+				{
+					short[] samples = synthesizer.synthesizeToBuffer(
+						lines[i]);
+
+					if (null != samples)
+					{
+						audioSeconds += (double)samples.length 
+							/ sampleRate;
+					}
+				}
+
+				double wallSeconds = (System.nanoTime() - startTime) / 1e9;
+				totalAudioSeconds += audioSeconds;
+				totalWallSeconds += wallSeconds;
+				out.println("\"" + lines[i].replace("\"", "\"\"") + "\"," 
+					+ formatRow(audioSeconds, wallSeconds));
+			}
+
+			String row = formatRow(totalAudioSeconds, totalWallSeconds);
+			out.println("total," + row);
+			Utils.log("", "total: " + row);
+
+			long[] stats = synthesizer.getPhraseCacheStats();
+
+			if (null != stats)
+			{
+				Utils.log("", "Phrase cache: " + stats[0] + " hits, " 
+					+ stats[1] + " misses, " + stats[2] + " evictions, " 
+					+ stats[3] + " bytes in " + stats[4] + " phrases");
+			}
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+
+			synthesizer.destroy();
+		}
+
+		System.exit(0);
+	}
+
+	/// Returns the CSV fields for 'audioSeconds' of audio synthesized in 
+	/// 'wallSeconds'.
+	private static String formatRow(double audioSeconds, 
+		double wallSeconds)
+	{
+		return audioSeconds + "," + wallSeconds + "," 
+			+ (wallSeconds > 0 ? audioSeconds / wallSeconds : 0);
+	}
+}
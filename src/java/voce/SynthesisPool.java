@@ -0,0 +1,209 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.util.ArrayList;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/// A pool of threads that synthesize phrases in the background.  A 
+/// FreeTTS voice only synthesizes one message at a time, so each thread 
+/// loads its own instance of the voice.  Used to preload the phrase 
+/// cache (see SpeechSynthesizer.preloadPhrases).
+public class SynthesisPool
+{
+	/// How long, in milliseconds, an idle thread waits for a phrase 
+	/// before checking whether the pool is being destroyed.
+	private static final int POLL_INTERVAL = 100;
+
+	private String mVoiceName;
+
+	/// Where the rendered phrases are kept.
+	private PhraseCache mPhraseCache;
+
+	/// The phrases waiting to be rendered.
+	private LinkedBlockingQueue<String> mQueue = 
+		new LinkedBlockingQueue<String>();
+
+	/// The number of phrases queued or being rendered.
+	private AtomicInteger mPendingCount = new AtomicInteger(0);
+
+	/// The number of phrases that could not be rendered.
+	private AtomicInteger mFailedCount = new AtomicInteger(0);
+
+	private volatile boolean mRunning = true;
+	private Thread[] mThreads;
+
+	/// The body of each thread.
+	private class Worker implements Runnable
+	{
+		public void run()
+		{
+			BufferAudioPlayer player = new BufferAudioPlayer();
+			com.sun.speech.freetts.Voice voice = null;
+
+			try
+			{
+				voice = SpeechSynthesizer.loadVoice(mVoiceName, player);
+			}
+			catch (RuntimeException e)
+			{
+				Utils.log("ERROR", "Cannot load the voice " + mVoiceName 
+					+ " for preloading: " + e);
+			}
+
+			while (mRunning)
+			{
+				String phrase;
+
+				try
+				{
+					phrase = mQueue.poll(POLL_INTERVAL, 
+						TimeUnit.MILLISECONDS);
+				}
+				catch (InterruptedException e)
+				{
+					break;
+				}
+
+				if (null == phrase)
+				{
+					continue;
+				}
+
+				// Without a voice the phrase is dropped, so that the 
+				// pending count still reaches 0.
+				try
+				{
+					if (null == voice)
+					{
+						mFailedCount.incrementAndGet();
+					}
+					else if (!mPhraseCache.contains(mVoiceName, phrase))
+					{
+						short[] samples = SpeechSynthesizer.render(voice, 
+							player, phrase);
+
+						if (null != samples)
+						{
+							mPhraseCache.put(mVoiceName, phrase, samples);
+						}
+						else
+						{
+							mFailedCount.incrementAndGet();
+						}
+					}
+				}
+				catch (RuntimeException e)
+				{
+					// FreeTTS reports some bad input with runtime 
+					// exceptions, which must not end the thread and leave 
+					// the phrase pending forever.
+					mFailedCount.incrementAndGet();
+					Utils.log("warning", "Cannot render '" + phrase 
+						+ "': " + e);
+				}
+				finally
+				{
+					mPendingCount.decrementAndGet();
+				}
+			}
+
+			if (null != voice)
+			{
+				voice.deallocate();
+			}
+		}
+	}
+
+	/// Creates a pool of 'numThreads' threads that render phrases with 
+	/// the named voice into 'phraseCache', and starts them.
+	public SynthesisPool(String voiceName, int numThreads, 
+		PhraseCache phraseCache)
+	{
+		mVoiceName = voiceName;
+		mPhraseCache = phraseCache;
+		mThreads = new Thread[Math.max(1, numThreads)];
+
+		for (int i = 0; i < mThreads.length; ++i)
+		{
+			mThreads[i] = new Thread(new Worker(), "Synthesis thread " 
+				+ (i + 1));
+			mThreads[i].setDaemon(true);
+			mThreads[i].start();
+		}
+	}
+
+	/// Queues phrases to be rendered into the phrase cache.  Blank 
+	/// phrases and phrases that are already cached are skipped.
+	public void preload(String[] phrases)
+	{
+		for (int i = 0; i < phrases.length; ++i)
+		{
+			if (phrases[i].trim().equals("") 
+				|| mPhraseCache.contains(mVoiceName, phrases[i]))
+			{
+				continue;
+			}
+
+			mPendingCount.incrementAndGet();
+			mQueue.add(phrases[i]);
+		}
+	}
+
+	/// Returns the number of phrases queued or being rendered.
+	public int getPendingCount()
+	{
+		return mPendingCount.get();
+	}
+
+	/// Returns the number of phrases that could not be rendered since 
+	/// the pool was created.  They are not in the phrase cache, so they 
+	/// are synthesized when spoken.
+	public int getFailedCount()
+	{
+		return mFailedCount.get();
+	}
+
+	/// Drops the phrases that have not been rendered, and stops the 
+	/// threads once they finish the ones being rendered.
+	public void destroy()
+	{
+		mRunning = false;
+		mPendingCount.addAndGet(-mQueue.drainTo(new ArrayList<String>()));
+
+		for (int i = 0; i < mThreads.length; ++i)
+		{
+			try
+			{
+				mThreads[i].join();
+			}
+			catch (InterruptedException e)
+			{
+				Thread.currentThread().interrupt();
+				return;
+			}
+		}
+	}
+}
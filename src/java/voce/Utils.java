@@ -22,6 +22,8 @@
 
 package voce;
 
+import java.util.Properties;
+
 /// A collection of utility functions used in 
 /// Voce.
 public class Utils
@@ -51,6 +53,69 @@ public class Utils
 		System.out.flush();
 	}
 	
+	/// Parses an options string into a set of properties.  The string 
+	/// is a list of 'name=value' entries separated by whitespace, commas 
+	/// or semicolons, e.g. "queueCapacity=16 queueOverflow=dropOldest".  
+	/// Malformed entries are logged and skipped.  The C++ interface 
+	/// reads the options it needs before the JVM starts with its own 
+	/// copy of these rules (internal::parseOptions in voce.h).
+	static public Properties parseOptions(String options)
+	{
+		Properties properties = new Properties();
+
+		if (null == options)
+		{
+			return properties;
+		}
+
+		String[] entries = options.trim().split("[\\s,;]+");
+
+		for (int i = 0; i < entries.length; ++i)
+		{
+			if (entries[i].equals(""))
+			{
+				continue;
+			}
+
+			int separator = entries[i].indexOf('=');
+
+			if (separator <= 0)
+			{
+				log("warning", "Ignoring malformed option: " + entries[i]);
+				continue;
+			}
+
+			properties.setProperty(entries[i].substring(0, separator), 
+				entries[i].substring(separator + 1));
+		}
+
+		return properties;
+	}
+
+	/// Returns the named option as an int, or 'defaultValue' if it is 
+	/// missing or not a number.
+	static public int getIntOption(Properties options, String name, 
+		int defaultValue)
+	{
+		String value = options.getProperty(name);
+
+		if (null == value)
+		{
+			return defaultValue;
+		}
+
+		try
+		{
+			return Integer.parseInt(value);
+		}
+		catch (NumberFormatException e)
+		{
+			log("warning", "Option " + name + " must be a number.  Using " 
+				+ defaultValue + ".");
+			return defaultValue;
+		}
+	}
+
 	/// Sets how much debug output to print ('true' prints debug and error 
 	/// messages; 'false' prints only error messages).
 	static public void setPrintDebug(boolean printDebug)
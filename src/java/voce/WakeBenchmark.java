@@ -0,0 +1,180 @@
+/************************************************************************
+* Voce                                                                  *
+* http://voce.sourceforge.net                                           *
+* Copyright (C) 2005-2008                                               *
+* Tyler Streeter (http://www.tylerstreeter.net)                         *
+*                                                                       *
+* This library is free software; you can redistribute it and/or         *
+* modify it under the terms of EITHER:                                  *
+*   (1) The GNU Lesser General Public License as published by the Free  *
+*       Software Foundation; either version 2.1 of the License, or (at  *
+*       your option) any later version. The text of the GNU Lesser      *
+*       General Public License is included with this library in the     *
+*       file license-LGPL.txt.                                          *
+*   (2) The BSD-style license that is included with this library in     *
+*       the file license-BSD.txt.                                       *
+*                                                                       *
+* This library is distributed in the hope that it will be useful,       *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+* license-LGPL.txt and license-BSD.txt for more details.                *
+************************************************************************/
+
+package voce;
+
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.lang.management.ManagementFactory;
+import java.lang.management.ThreadMXBean;
+import java.util.ArrayList;
+
+/// A command line tool that measures how much CPU time the recognizer 
+/// spends on a long recording, such as an hour of background audio, 
+/// with and without a wake phrase (see the 'wakePhrase' option of 
+/// SpeechInterface.init).  Usage:
+///
+/// java -cp voce.jar voce.WakeBenchmark [options] audioFile outputFile
+///
+/// The audio file must be in the format described in 
+/// SpeechRecognizer.recognizeFile.  For each mode the results are 
+/// written as CSV: the CPU time used by all threads while decoding, as 
+/// a percentage of one CPU over the length of the audio, the number of 
+/// times the wake phrase was heard, and the recognized text.  Options:
+///
+/// -config file - Sphinx4 config file (default: ./voce.config.xml).
+/// -grammarPath path - Where to find the grammar (default: ./).
+/// -grammarName name - The grammar to decode with (default: digits).
+/// -wakePhrase phrase - The wake phrase, in the format of the 
+///   'wakePhrase' option (default: hey+voce).
+public class WakeBenchmark
+{
+	public static void main(String[] args)
+	{
+		String configFilename = "voce.config.xml";
+		String grammarPath = "./";
+		String grammarName = "";
+		String wakePhrase = "hey+voce";
+		ArrayList<String> positional = new ArrayList<String>();
+
+		for (int i = 0; i < args.length; ++i)
+		{
+			if (args[i].equals("-config") && i + 1 < args.length)
+			{
+				configFilename = args[++i];
+			}
+			else if (args[i].equals("-grammarPath") && i + 1 < args.length)
+			{
+				grammarPath = args[++i];
+			}
+			else if (args[i].equals("-grammarName") && i + 1 < args.length)
+			{
+				grammarName = args[++i];
+			}
+			else if (args[i].equals("-wakePhrase") && i + 1 < args.length)
+			{
+				wakePhrase = args[++i];
+			}
+			else
+			{
+				positional.add(args[i]);
+			}
+		}
+
+		if (positional.size() != 2)
+		{
+			System.out.println("Usage: java voce.WakeBenchmark " 
+				+ "[-config file] [-grammarPath path] [-grammarName name] " 
+				+ "[-wakePhrase phrase] audioFile outputFile");
+			System.exit(1);
+		}
+
+		ThreadMXBean threads = ManagementFactory.getThreadMXBean();
+
+		if (!threads.isThreadCpuTimeSupported())
+		{
+			Utils.log("ERROR", "This JVM cannot measure thread CPU time.");
+			System.exit(1);
+		}
+
+		threads.setThreadCpuTimeEnabled(true);
+		PrintWriter out = null;
+
+		try
+		{
+			String audioFile = positional.get(0);
+			double audioSeconds = SpeechRecognizer.getAudioFileDuration(
+				audioFile);
+
+			out = new PrintWriter(new FileWriter(positional.get(1)));
+			out.println("mode,audioSeconds,cpuSeconds,cpuPercent," 
+				+ "wakeCount,text");
+
+			String[] modes = {"grammar", "wakePhrase"};
+
+			for (int i = 0; i < modes.length; ++i)
+			{
+				String options = "audioInput=file";
+
+				if (modes[i].equals("wakePhrase"))
+				{
+					options += " wakePhrase=" + wakePhrase;
+				}
+
+				SpeechRecognizer recognizer = new SpeechRecognizer(
+					configFilename, grammarPath, grammarName, 
+					Utils.parseOptions(options));
+
+				long cpuTime = getCpuTime(threads);
+				String text = recognizer.recognizeFile(audioFile);
+				double cpuSeconds = (getCpuTime(threads) - cpuTime) / 1e9;
+				int wakeCount = recognizer.getWakeCount();
+				recognizer.destroy();
+
+				String row = audioSeconds + "," + cpuSeconds + "," 
+					+ (audioSeconds > 0 ? 100 * cpuSeconds / audioSeconds 
+					: 0) + "," + wakeCount;
+				out.println(modes[i] + "," + row + ",\"" 
+					+ text.replace("\"", "\"\"") + "\"");
+				out.flush();
+				Utils.log("", modes[i] + ": " + row);
+			}
+		}
+		catch (IOException e)
+		{
+			Utils.log("ERROR", "Benchmark failed: ");
+			e.printStackTrace();
+			System.exit(1);
+		}
+		finally
+		{
+			if (null != out)
+			{
+				out.close();
+			}
+		}
+
+		System.exit(0);
+	}
+
+	/// Returns the CPU time, in nanoseconds, used so far by every live 
+	/// thread.  The recognizer's threads live as long as it does, so the 
+	/// difference between two calls covers all of its work.
+	private static long getCpuTime(ThreadMXBean threads)
+	{
+		long[] ids = threads.getAllThreadIds();
+		long total = 0;
+
+		for (int i = 0; i < ids.length; ++i)
+		{
+			long time = threads.getThreadCpuTime(ids[i]);
+
+			if (time > 0)
+			{
+				total += time;
+			}
+		}
+
+		return total;
+	}
+}
@@ -1,4 +1,4 @@
-${JDK_HOME}/bin/javac -classpath ../../../lib/freetts.jar:../../../lib/jsapi.jar:../../../lib/sphinx4.jar Utils.java SpeechSynthesizer.java SpeechRecognizer.java SpeechInterface.java
+${JDK_HOME}/bin/javac -classpath ../../../lib/freetts.jar:../../../lib/jsapi.jar:../../../lib/sphinx4.jar Utils.java StringQueue.java QueueBenchmark.java SpeechSynthesizer.java SpeechRecognizer.java PushAudioSource.java SearchGraphFile.java CachingFlatLinguist.java MappedDictionary.java DictionaryCompiler.java ScopedDictionary.java GrammarLanguageModel.java ProfileBenchmark.java ParallelAcousticScorer.java SenoneScoreCache.java RecognizerPool.java BatchRecognizer.java StreamServer.java StreamBenchmark.java PoolCheck.java WakeBenchmark.java StartupBenchmark.java NativeFeatureExtractor.java FrontEndBenchmark.java FeatureCache.java FeatureCacheBenchmark.java BufferAudioPlayer.java SynthesisBenchmark.java PhraseCache.java PhrasePlayer.java SynthesisPool.java BatchSynthesizer.java SpeechInterface.java
 cd ..
 ${JDK_HOME}/bin/jar cmvf voce/MANIFEST.MF ../../lib/voce.jar voce/*.class
 cd ../../lib
@@ -1 +1 @@
-javap -s -p SpeechInterface SpeechSynthesizer SpeechRecognizer Utils
\ No newline at end of file
+javap -s -p SpeechInterface SpeechSynthesizer SpeechRecognizer PushAudioSource SearchGraphFile CachingFlatLinguist MappedDictionary DictionaryCompiler ScopedDictionary GrammarLanguageModel ProfileBenchmark ParallelAcousticScorer SenoneScoreCache StringQueue QueueBenchmark RecognizerPool BatchRecognizer StreamServer StreamBenchmark PoolCheck WakeBenchmark StartupBenchmark NativeFeatureExtractor FrontEndBenchmark FeatureCache FeatureCacheBenchmark BufferAudioPlayer SynthesisBenchmark PhraseCache PhrasePlayer SynthesisPool BatchSynthesizer Utils
\ No newline at end of file